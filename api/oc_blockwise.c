@@ -14,21 +14,99 @@
 // limitations under the License.
 */
 
+#include "oc_api.h"
 #include "port/oc_connectivity.h"
 #include <oc_config.h>
 #ifdef OC_BLOCK_WISE
 #include "oc_blockwise.h"
+#include "api/oc_knx_sec.h"
 #include "oc_endpoint.h"
 #include "port/oc_log.h"
+#include "util/oc_hash_index.h"
 #include "util/oc_list.h"
 #include "util/oc_memb.h"
 
+#ifndef OC_BLOCKWISE_MAX_BYTES
+/* the memory held by the states of all transfers in flight together. The
+ * static pools of requests and responses bound it already, the dynamic ones
+ * are bounded to as many buffered transfers. */
+#ifdef OC_DYNAMIC_ALLOCATION
+#define OC_BLOCKWISE_MAX_TRANSFERS (32)
+#else /* OC_DYNAMIC_ALLOCATION */
+#define OC_BLOCKWISE_MAX_TRANSFERS (2 * OC_MAX_NUM_CONCURRENT_REQUESTS)
+#endif /* !OC_DYNAMIC_ALLOCATION */
+#define OC_BLOCKWISE_MAX_BYTES                                                 \
+  (OC_BLOCKWISE_MAX_TRANSFERS *                                                \
+   (sizeof(oc_blockwise_response_state_t) + (size_t)OC_MAX_APP_DATA_SIZE))
+#endif /* !OC_BLOCKWISE_MAX_BYTES */
+
+#ifndef OC_BLOCKWISE_STALE_TIME
+/* seconds without a block after which a server transfer may be evicted to
+ * make room for a new one; also the period of the expiry sweep */
+#define OC_BLOCKWISE_STALE_TIME (2 * COAP_RESPONSE_TIMEOUT)
+#endif /* !OC_BLOCKWISE_STALE_TIME */
+
 OC_MEMB(oc_blockwise_request_states_s, oc_blockwise_request_state_t,
         OC_MAX_NUM_CONCURRENT_REQUESTS);
 OC_MEMB(oc_blockwise_response_states_s, oc_blockwise_response_state_t,
         OC_MAX_NUM_CONCURRENT_REQUESTS);
 OC_LIST(oc_blockwise_requests);
 OC_LIST(oc_blockwise_responses);
+/* the states of each list by (endpoint, href, role), and the client side
+ * ones by message id, token and client callback */
+OC_HASH_INDEX(requests_by_key, OC_MAX_NUM_CONCURRENT_REQUESTS);
+OC_HASH_INDEX(responses_by_key, OC_MAX_NUM_CONCURRENT_REQUESTS);
+#ifdef OC_CLIENT
+OC_HASH_INDEX(requests_by_mid, OC_MAX_NUM_CONCURRENT_REQUESTS);
+OC_HASH_INDEX(responses_by_mid, OC_MAX_NUM_CONCURRENT_REQUESTS);
+OC_HASH_INDEX(requests_by_token, OC_MAX_NUM_CONCURRENT_REQUESTS);
+OC_HASH_INDEX(responses_by_token, OC_MAX_NUM_CONCURRENT_REQUESTS);
+OC_HASH_INDEX(requests_by_client_cb, OC_MAX_NUM_CONCURRENT_REQUESTS);
+OC_HASH_INDEX(responses_by_client_cb, OC_MAX_NUM_CONCURRENT_REQUESTS);
+#endif /* OC_CLIENT */
+/* the streamed application resources, and /a/swu and the /fp tables of
+ * every device */
+OC_MEMB(oc_blockwise_streams_s, oc_blockwise_stream_t,
+        OC_MAX_APP_RESOURCES + 4 * OC_MAX_NUM_DEVICES);
+OC_LIST(oc_blockwise_streams);
+
+typedef struct oc_blockwise_table_s
+{
+  oc_list_t *list;
+  struct oc_memb *pool;
+  oc_hash_index_t *by_key;
+#ifdef OC_CLIENT
+  oc_hash_index_t *by_mid;
+  oc_hash_index_t *by_token;
+  oc_hash_index_t *by_client_cb;
+#endif /* OC_CLIENT */
+} oc_blockwise_table_t;
+
+static const oc_blockwise_table_t requests = {
+  &oc_blockwise_requests,
+  &oc_blockwise_request_states_s,
+  &requests_by_key,
+#ifdef OC_CLIENT
+  &requests_by_mid,
+  &requests_by_token,
+  &requests_by_client_cb,
+#endif /* OC_CLIENT */
+};
+
+static const oc_blockwise_table_t responses = {
+  &oc_blockwise_responses,
+  &oc_blockwise_response_states_s,
+  &responses_by_key,
+#ifdef OC_CLIENT
+  &responses_by_mid,
+  &responses_by_token,
+  &responses_by_client_cb,
+#endif /* OC_CLIENT */
+};
+
+/* bytes held by the states of all transfers */
+static size_t blockwise_bytes;
+static bool sweep_scheduled;
 
 #ifdef OC_APP_DATA_BUFFER_POOL
 typedef struct oc_app_data_buffer_t
@@ -38,31 +116,211 @@ typedef struct oc_app_data_buffer_t
 OC_MEMB_STATIC(oc_app_data_s, oc_app_data_buffer_t, OC_APP_DATA_BUFFER_POOL);
 #endif /* OC_APP_DATA_BUFFER_POOL */
 
+static const oc_blockwise_table_t *
+table_of(const oc_blockwise_state_t *buffer)
+{
+  return buffer->is_response ? &responses : &requests;
+}
+
+static uint32_t
+fnv1a(uint32_t hash, const void *data, size_t len)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  size_t i;
+  for (i = 0; i < len; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/* hashes the address fields oc_endpoint_compare() looks at */
+static uint32_t
+key_hash(const char *href, size_t href_len, const oc_endpoint_t *endpoint,
+         oc_blockwise_role_t role)
+{
+  const uint8_t *addr = endpoint->addr.ipv6.address;
+  size_t addr_len = 16;
+  uint16_t port = endpoint->addr.ipv6.port;
+#ifdef OC_IPV4
+  if (!(endpoint->flags & IPV6)) {
+    addr = endpoint->addr.ipv4.address;
+    addr_len = 4;
+    port = endpoint->addr.ipv4.port;
+  }
+#endif /* OC_IPV4 */
+  uint8_t r = (uint8_t)role;
+  uint32_t hash = fnv1a(2166136261u, href, href_len);
+  hash = fnv1a(hash, addr, addr_len);
+  hash = fnv1a(hash, &port, sizeof(port));
+  hash = fnv1a(hash, &endpoint->device, sizeof(endpoint->device));
+  return fnv1a(hash, &r, sizeof(r));
+}
+
+static uint32_t
+state_key_hash(const oc_blockwise_state_t *buffer)
+{
+  return key_hash(oc_string(buffer->href), oc_string_len(buffer->href),
+                  &buffer->endpoint, buffer->role);
+}
+
+#ifdef OC_CLIENT
+static uint32_t
+client_cb_hash(const void *client_cb)
+{
+  return oc_hash_bytes((const uint8_t *)&client_cb, sizeof(client_cb));
+}
+#endif /* OC_CLIENT */
+
+static void
+unindex_buffer(const oc_blockwise_table_t *table, oc_blockwise_state_t *buffer)
+{
+  oc_hash_index_remove(table->by_key, buffer, state_key_hash(buffer));
+#ifdef OC_CLIENT
+  oc_hash_index_remove(table->by_mid, buffer, oc_hash_u16(buffer->mid));
+  oc_hash_index_remove(table->by_token, buffer,
+                       oc_hash_bytes(buffer->token, buffer->token_len));
+  oc_hash_index_remove(table->by_client_cb, buffer,
+                       client_cb_hash(buffer->client_cb));
+#endif /* OC_CLIENT */
+}
+
+static bool
+index_buffer(const oc_blockwise_table_t *table, oc_blockwise_state_t *buffer)
+{
+  if (!oc_hash_index_add(table->by_key, buffer, state_key_hash(buffer))) {
+    return false;
+  }
+#ifdef OC_CLIENT
+  if (!oc_hash_index_add(table->by_mid, buffer, oc_hash_u16(buffer->mid)) ||
+      !oc_hash_index_add(table->by_token, buffer,
+                         oc_hash_bytes(buffer->token, buffer->token_len)) ||
+      !oc_hash_index_add(table->by_client_cb, buffer,
+                         client_cb_hash(buffer->client_cb))) {
+    unindex_buffer(table, buffer);
+    return false;
+  }
+#endif /* OC_CLIENT */
+  return true;
+}
+
+static size_t
+state_size(const oc_blockwise_table_t *table, bool streamed)
+{
+  size_t size = table->pool->size;
+#ifdef OC_DYNAMIC_ALLOCATION
+  if (!streamed) {
+    size += OC_MAX_APP_DATA_SIZE;
+  }
+#else  /* OC_DYNAMIC_ALLOCATION */
+  (void)streamed;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  return size;
+}
+
+static void
+oc_blockwise_free_buffer(const oc_blockwise_table_t *table,
+                         oc_blockwise_state_t *buffer);
+
+static oc_event_callback_retval_t
+oc_blockwise_sweep(void *data)
+{
+  (void)data;
+  oc_clock_time_t now = oc_clock_time();
+  const oc_blockwise_table_t *tables[] = { &requests, &responses };
+  size_t i;
+  for (i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+    oc_blockwise_state_t *buffer = oc_list_head(*tables[i]->list), *next;
+    while (buffer != NULL) {
+      next = buffer->next;
+      if (now - buffer->last_access >=
+          (oc_clock_time_t)OC_EXCHANGE_LIFETIME * OC_CLOCK_SECOND) {
+        OC_DBG("block-wise transfer of %s expired",
+               oc_string_checked(buffer->href));
+        oc_blockwise_free_buffer(tables[i], buffer);
+      }
+      buffer = next;
+    }
+  }
+  return OC_EVENT_CONTINUE;
+}
+
 static oc_blockwise_state_t *
-oc_blockwise_init_buffer(struct oc_memb *pool, const char *href,
+least_recently_used(oc_list_t list, oc_blockwise_state_t *lru,
+                    oc_clock_time_t now)
+{
+  oc_blockwise_state_t *buffer = oc_list_head(list);
+  for (; buffer != NULL; buffer = buffer->next) {
+    /* a client side transfer belongs to a request of this device, it
+     * ends with its client callback */
+    if (buffer->role != OC_BLOCKWISE_SERVER ||
+        now - buffer->last_access <
+          (oc_clock_time_t)OC_BLOCKWISE_STALE_TIME * OC_CLOCK_SECOND) {
+      continue;
+    }
+    if (!lru || buffer->last_access < lru->last_access) {
+      lru = buffer;
+    }
+  }
+  return lru;
+}
+
+/* makes room for size bytes within the budget by evicting the server
+ * transfers that have been stale longest */
+static bool
+reserve_bytes(size_t size)
+{
+  oc_clock_time_t now = oc_clock_time();
+  while (blockwise_bytes + size > (size_t)OC_BLOCKWISE_MAX_BYTES) {
+    oc_blockwise_state_t *lru =
+      least_recently_used(oc_blockwise_requests, NULL, now);
+    lru = least_recently_used(oc_blockwise_responses, lru, now);
+    if (!lru) {
+      OC_WRN("block-wise budget exhausted");
+      return false;
+    }
+    OC_DBG("evicting stale block-wise transfer of %s",
+           oc_string_checked(lru->href));
+    oc_blockwise_free_buffer(table_of(lru), lru);
+  }
+  return true;
+}
+
+static oc_blockwise_state_t *
+oc_blockwise_init_buffer(const oc_blockwise_table_t *table, const char *href,
                          size_t href_len, oc_endpoint_t *endpoint,
-                         oc_method_t method, oc_blockwise_role_t role)
+                         oc_method_t method, oc_blockwise_role_t role,
+                         bool streamed)
 {
   if (href_len == 0)
     return NULL;
 
-  oc_blockwise_state_t *buffer = (oc_blockwise_state_t *)oc_memb_alloc(pool);
+  if (!reserve_bytes(state_size(table, streamed))) {
+    return NULL;
+  }
+  oc_blockwise_state_t *buffer =
+    (oc_blockwise_state_t *)oc_memb_alloc(table->pool);
   if (buffer) {
+    buffer->streamed = streamed;
 #ifdef OC_DYNAMIC_ALLOCATION
+    /* the blocks of a streamed transfer are never held in the state */
+    if (streamed) {
+      buffer->buffer = NULL;
+    } else {
 #ifdef OC_APP_DATA_BUFFER_POOL
-    oc_app_data_buffer_t *app_buffer =
-      (oc_app_data_buffer_t *)oc_memb_alloc(&oc_app_data_s);
-    if (app_buffer) {
-      buffer->block = app_buffer;
-      buffer->buffer = app_buffer->buffer;
-    }
+      oc_app_data_buffer_t *app_buffer =
+        (oc_app_data_buffer_t *)oc_memb_alloc(&oc_app_data_s);
+      if (app_buffer) {
+        buffer->block = app_buffer;
+        buffer->buffer = app_buffer->buffer;
+      }
 #endif /* OC_APP_DATA_BUFFER_POOL */
-    if (!buffer->buffer) {
-      buffer->buffer = (uint8_t *)malloc(OC_MAX_APP_DATA_SIZE);
-    }
-    if (!buffer->buffer) {
-      oc_memb_free(pool, buffer);
-      return NULL;
+      if (!buffer->buffer) {
+        buffer->buffer = (uint8_t *)malloc(OC_MAX_APP_DATA_SIZE);
+      }
+      if (!buffer->buffer) {
+        oc_memb_free(table->pool, buffer);
+        return NULL;
+      }
     }
 #endif /* OC_DYNAMIC_ALLOCATION */
     buffer->next_block_offset = 0;
@@ -70,14 +328,29 @@ oc_blockwise_init_buffer(struct oc_memb *pool, const char *href,
     buffer->ref_count = 1;
     buffer->method = method;
     buffer->role = role;
+    buffer->is_response = (table == &responses);
+    buffer->last_access = oc_clock_time();
     memcpy(&buffer->endpoint, endpoint, sizeof(oc_endpoint_t));
     buffer->endpoint.next = NULL;
     oc_new_string(&buffer->href, href, href_len);
     buffer->next = NULL;
 #ifdef OC_CLIENT
     buffer->mid = 0;
+    buffer->token_len = 0;
     buffer->client_cb = NULL;
 #endif /* OC_CLIENT */
+    oc_list_add(*table->list, buffer);
+    blockwise_bytes += state_size(table, streamed);
+    if (!index_buffer(table, buffer)) {
+      OC_ERR("insufficient memory to index block-wise buffer");
+      oc_blockwise_free_buffer(table, buffer);
+      return NULL;
+    }
+    if (!sweep_scheduled) {
+      oc_ri_add_timed_event_callback_seconds(NULL, oc_blockwise_sweep,
+                                             OC_BLOCKWISE_STALE_TIME);
+      sweep_scheduled = true;
+    }
     return buffer;
   }
   OC_WRN("block-wise buffers exhausted");
@@ -85,7 +358,7 @@ oc_blockwise_init_buffer(struct oc_memb *pool, const char *href,
 }
 
 static void
-oc_blockwise_free_buffer(oc_list_t list, struct oc_memb *pool,
+oc_blockwise_free_buffer(const oc_blockwise_table_t *table,
                          oc_blockwise_state_t *buffer)
 {
 
@@ -94,9 +367,11 @@ oc_blockwise_free_buffer(oc_list_t list, struct oc_memb *pool,
     return;
   }
 
+  unindex_buffer(table, buffer);
+  blockwise_bytes -= state_size(table, buffer->streamed);
   oc_free_string(&buffer->uri_query);
   oc_free_string(&buffer->href);
-  oc_list_remove(list, buffer);
+  oc_list_remove(*table->list, buffer);
 #ifdef OC_DYNAMIC_ALLOCATION
 #ifdef OC_APP_DATA_BUFFER_POOL
   if (buffer->block) {
@@ -109,23 +384,22 @@ oc_blockwise_free_buffer(oc_list_t list, struct oc_memb *pool,
   }
   buffer->buffer = NULL;
 #endif
-  oc_memb_free(pool, buffer);
-}
+  oc_memb_free(table->pool, buffer);
 
-static oc_event_callback_retval_t
-oc_blockwise_request_timeout(void *data)
-{
-  oc_blockwise_free_buffer(oc_blockwise_requests,
-                           &oc_blockwise_request_states_s, data);
-  return OC_EVENT_DONE;
+  if (sweep_scheduled && !oc_list_head(oc_blockwise_requests) &&
+      !oc_list_head(oc_blockwise_responses)) {
+    oc_ri_remove_timed_event_callback(NULL, oc_blockwise_sweep);
+    sweep_scheduled = false;
+  }
 }
 
-static oc_event_callback_retval_t
-oc_blockwise_response_timeout(void *data)
+static oc_blockwise_state_t *
+alloc_request_buffer(const char *href, size_t href_len, oc_endpoint_t *endpoint,
+                     oc_method_t method, oc_blockwise_role_t role,
+                     bool streamed)
 {
-  oc_blockwise_free_buffer(oc_blockwise_responses,
-                           &oc_blockwise_response_states_s, data);
-  return OC_EVENT_DONE;
+  return oc_blockwise_init_buffer(&requests, href, href_len, endpoint, method,
+                                  role, streamed);
 }
 
 oc_blockwise_state_t *
@@ -133,25 +407,25 @@ oc_blockwise_alloc_request_buffer(const char *href, size_t href_len,
                                   oc_endpoint_t *endpoint, oc_method_t method,
                                   oc_blockwise_role_t role)
 {
-  oc_blockwise_request_state_t *buffer =
-    (oc_blockwise_request_state_t *)oc_blockwise_init_buffer(
-      &oc_blockwise_request_states_s, href, href_len, endpoint, method, role);
-  if (buffer) {
-    oc_ri_add_timed_event_callback_seconds(buffer, oc_blockwise_request_timeout,
-                                           OC_EXCHANGE_LIFETIME);
-    oc_list_add(oc_blockwise_requests, buffer);
-  }
-  return (oc_blockwise_state_t *)buffer;
+  return alloc_request_buffer(href, href_len, endpoint, method, role, false);
 }
 
 oc_blockwise_state_t *
-oc_blockwise_alloc_response_buffer(const char *href, size_t href_len,
-                                   oc_endpoint_t *endpoint, oc_method_t method,
-                                   oc_blockwise_role_t role)
+oc_blockwise_alloc_stream_request(const char *href, size_t href_len,
+                                  oc_endpoint_t *endpoint, oc_method_t method)
+{
+  return alloc_request_buffer(href, href_len, endpoint, method,
+                              OC_BLOCKWISE_SERVER, true);
+}
+
+static oc_blockwise_state_t *
+alloc_response_buffer(const char *href, size_t href_len,
+                      oc_endpoint_t *endpoint, oc_method_t method,
+                      oc_blockwise_role_t role, bool streamed)
 {
   oc_blockwise_response_state_t *buffer =
     (oc_blockwise_response_state_t *)oc_blockwise_init_buffer(
-      &oc_blockwise_response_states_s, href, href_len, endpoint, method, role);
+      &responses, href, href_len, endpoint, method, role, streamed);
   if (buffer) {
     int i = COAP_ETAG_LEN;
     uint32_t r = oc_random_value();
@@ -163,25 +437,36 @@ oc_blockwise_alloc_response_buffer(const char *href, size_t href_len,
 #ifdef OC_CLIENT
     buffer->observe_seq = -1;
 #endif /* OC_CLIENT */
-    oc_ri_add_timed_event_callback_seconds(
-      buffer, oc_blockwise_response_timeout, OC_EXCHANGE_LIFETIME);
-    oc_list_add(oc_blockwise_responses, buffer);
   }
   return (oc_blockwise_state_t *)buffer;
 }
 
+oc_blockwise_state_t *
+oc_blockwise_alloc_response_buffer(const char *href, size_t href_len,
+                                   oc_endpoint_t *endpoint, oc_method_t method,
+                                   oc_blockwise_role_t role)
+{
+  return alloc_response_buffer(href, href_len, endpoint, method, role, false);
+}
+
+oc_blockwise_state_t *
+oc_blockwise_alloc_stream_response(const char *href, size_t href_len,
+                                   oc_endpoint_t *endpoint, oc_method_t method)
+{
+  return alloc_response_buffer(href, href_len, endpoint, method,
+                               OC_BLOCKWISE_SERVER, true);
+}
+
 void
 oc_blockwise_free_request_buffer(oc_blockwise_state_t *buffer)
 {
-  oc_ri_remove_timed_event_callback(buffer, oc_blockwise_request_timeout);
-  oc_blockwise_request_timeout(buffer);
+  oc_blockwise_free_buffer(&requests, buffer);
 }
 
 void
 oc_blockwise_free_response_buffer(oc_blockwise_state_t *buffer)
 {
-  oc_ri_remove_timed_event_callback(buffer, oc_blockwise_response_timeout);
-  oc_blockwise_response_timeout(buffer);
+  oc_blockwise_free_buffer(&responses, buffer);
 }
 
 #ifdef OC_CLIENT
@@ -230,80 +515,99 @@ oc_blockwise_scrub_buffers(bool all)
   }
 }
 
+static oc_blockwise_state_t *
+touch(oc_blockwise_state_t *buffer)
+{
+  if (buffer) {
+    buffer->last_access = oc_clock_time();
+  }
+  return buffer;
+}
+
 #ifdef OC_CLIENT
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer_by_token(oc_list_t list, uint8_t *token,
-                                  uint8_t token_len)
+oc_blockwise_find_buffer_by_token(const oc_blockwise_table_t *table,
+                                  uint8_t *token, uint8_t token_len)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  if (token_len == 0) {
+    return NULL;
+  }
+  uint32_t pos;
+  uint32_t hash = oc_hash_bytes(token, token_len);
+  oc_blockwise_state_t *buffer =
+    oc_hash_index_first(table->by_token, hash, &pos);
   while (buffer) {
-    if (token_len > 0 && buffer->role == OC_BLOCKWISE_CLIENT &&
+    if (buffer->role == OC_BLOCKWISE_CLIENT &&
         buffer->token_len == token_len &&
         memcmp(buffer->token, token, token_len) == 0)
       break;
-    buffer = buffer->next;
+    buffer = oc_hash_index_next(table->by_token, hash, &pos);
   }
-  return buffer;
+  return touch(buffer);
 }
 
 oc_blockwise_state_t *
 oc_blockwise_find_request_buffer_by_token(uint8_t *token, uint8_t token_len)
 {
-  return oc_blockwise_find_buffer_by_token(oc_blockwise_requests, token,
-                                           token_len);
+  return oc_blockwise_find_buffer_by_token(&requests, token, token_len);
 }
 
 oc_blockwise_state_t *
 oc_blockwise_find_response_buffer_by_token(uint8_t *token, uint8_t token_len)
 {
-  return oc_blockwise_find_buffer_by_token(oc_blockwise_responses, token,
-                                           token_len);
+  return oc_blockwise_find_buffer_by_token(&responses, token, token_len);
 }
 
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer_by_mid(oc_list_t list, uint16_t mid)
+oc_blockwise_find_buffer_by_mid(const oc_blockwise_table_t *table,
+                                uint16_t mid)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  uint32_t pos;
+  uint32_t hash = oc_hash_u16(mid);
+  oc_blockwise_state_t *buffer = oc_hash_index_first(table->by_mid, hash, &pos);
   while (buffer) {
     if (buffer->mid == mid && buffer->role == OC_BLOCKWISE_CLIENT)
       break;
-    buffer = buffer->next;
+    buffer = oc_hash_index_next(table->by_mid, hash, &pos);
   }
-  return buffer;
+  return touch(buffer);
 }
 
 oc_blockwise_state_t *
 oc_blockwise_find_request_buffer_by_mid(uint16_t mid)
 {
-  return oc_blockwise_find_buffer_by_mid(oc_blockwise_requests, mid);
+  return oc_blockwise_find_buffer_by_mid(&requests, mid);
 }
 
 oc_blockwise_state_t *
 oc_blockwise_find_response_buffer_by_mid(uint16_t mid)
 {
-  return oc_blockwise_find_buffer_by_mid(oc_blockwise_responses, mid);
+  return oc_blockwise_find_buffer_by_mid(&responses, mid);
 }
 
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer_by_client_cb(oc_list_t list, oc_endpoint_t *endpoint,
-                                      void *client_cb)
+oc_blockwise_find_buffer_by_client_cb(const oc_blockwise_table_t *table,
+                                      oc_endpoint_t *endpoint, void *client_cb)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  uint32_t pos;
+  uint32_t hash = client_cb_hash(client_cb);
+  oc_blockwise_state_t *buffer =
+    oc_hash_index_first(table->by_client_cb, hash, &pos);
   while (buffer) {
     if (buffer->role == OC_BLOCKWISE_CLIENT && buffer->client_cb == client_cb &&
         oc_endpoint_compare(endpoint, &buffer->endpoint) == 0) {
       break;
     }
-    buffer = buffer->next;
+    buffer = oc_hash_index_next(table->by_client_cb, hash, &pos);
   }
-  return buffer;
+  return touch(buffer);
 }
 
 oc_blockwise_state_t *
 oc_blockwise_find_request_buffer_by_client_cb(oc_endpoint_t *endpoint,
                                               void *client_cb)
 {
-  return oc_blockwise_find_buffer_by_client_cb(oc_blockwise_requests, endpoint,
+  return oc_blockwise_find_buffer_by_client_cb(&requests, endpoint,
                                                client_cb);
 }
 
@@ -311,29 +615,65 @@ oc_blockwise_state_t *
 oc_blockwise_find_response_buffer_by_client_cb(oc_endpoint_t *endpoint,
                                                void *client_cb)
 {
-  return oc_blockwise_find_buffer_by_client_cb(oc_blockwise_responses, endpoint,
+  return oc_blockwise_find_buffer_by_client_cb(&responses, endpoint,
                                                client_cb);
 }
+
+void
+oc_blockwise_set_mid(oc_blockwise_state_t *buffer, uint16_t mid)
+{
+  const oc_blockwise_table_t *table = table_of(buffer);
+  oc_hash_index_remove(table->by_mid, buffer, oc_hash_u16(buffer->mid));
+  buffer->mid = mid;
+  oc_hash_index_add(table->by_mid, buffer, oc_hash_u16(buffer->mid));
+}
+
+void
+oc_blockwise_set_token(oc_blockwise_state_t *buffer, const uint8_t *token,
+                       uint8_t token_len)
+{
+  const oc_blockwise_table_t *table = table_of(buffer);
+  oc_hash_index_remove(table->by_token, buffer,
+                       oc_hash_bytes(buffer->token, buffer->token_len));
+  memcpy(buffer->token, token, token_len);
+  buffer->token_len = token_len;
+  oc_hash_index_add(table->by_token, buffer,
+                    oc_hash_bytes(buffer->token, buffer->token_len));
+}
+
+void
+oc_blockwise_set_client_cb(oc_blockwise_state_t *buffer, void *client_cb)
+{
+  const oc_blockwise_table_t *table = table_of(buffer);
+  oc_hash_index_remove(table->by_client_cb, buffer,
+                       client_cb_hash(buffer->client_cb));
+  buffer->client_cb = client_cb;
+  oc_hash_index_add(table->by_client_cb, buffer,
+                    client_cb_hash(buffer->client_cb));
+}
 #endif /* OC_CLIENT */
 
 static oc_blockwise_state_t *
-oc_blockwise_find_buffer(oc_list_t list, const char *href, size_t href_len,
-                         oc_endpoint_t *endpoint, oc_method_t method,
-                         const char *query, size_t query_len,
-                         oc_blockwise_role_t role)
+oc_blockwise_find_buffer(const oc_blockwise_table_t *table, const char *href,
+                         size_t href_len, oc_endpoint_t *endpoint,
+                         oc_method_t method, const char *query,
+                         size_t query_len, oc_blockwise_role_t role)
 {
-  oc_blockwise_state_t *buffer = oc_list_head(list);
+  uint32_t pos;
+  uint32_t hash = key_hash(href, href_len, endpoint, role);
+  oc_blockwise_state_t *buffer = oc_hash_index_first(table->by_key, hash, &pos);
   while (buffer) {
-    if (strncmp(href, oc_string(buffer->href), href_len) == 0 &&
+    if (href_len == oc_string_len(buffer->href) &&
+        memcmp(href, oc_string(buffer->href), href_len) == 0 &&
         oc_endpoint_compare(&buffer->endpoint, endpoint) == 0 &&
         buffer->method == method && buffer->role == role &&
         query_len == oc_string_len(buffer->uri_query) &&
         memcmp(query, oc_string(buffer->uri_query), query_len) == 0) {
       break;
     }
-    buffer = buffer->next;
+    buffer = oc_hash_index_next(table->by_key, hash, &pos);
   }
-  return buffer;
+  return touch(buffer);
 }
 
 oc_blockwise_state_t *
@@ -342,8 +682,8 @@ oc_blockwise_find_request_buffer(const char *href, size_t href_len,
                                  const char *query, size_t query_len,
                                  oc_blockwise_role_t role)
 {
-  return oc_blockwise_find_buffer(oc_blockwise_requests, href, href_len,
-                                  endpoint, method, query, query_len, role);
+  return oc_blockwise_find_buffer(&requests, href, href_len, endpoint, method,
+                                  query, query_len, role);
 }
 
 oc_blockwise_state_t *
@@ -352,8 +692,8 @@ oc_blockwise_find_response_buffer(const char *href, size_t href_len,
                                   const char *query, size_t query_len,
                                   oc_blockwise_role_t role)
 {
-  return oc_blockwise_find_buffer(oc_blockwise_responses, href, href_len,
-                                  endpoint, method, query, query_len, role);
+  return oc_blockwise_find_buffer(&responses, href, href_len, endpoint,
+                                  method, query, query_len, role);
 }
 
 const void *
@@ -395,7 +735,198 @@ oc_blockwise_handle_block(oc_blockwise_state_t *buffer,
 
   return true;
 }
-#endif /* OC_BLOCK_WISE */
+
+oc_blockwise_stream_t *
+oc_blockwise_get_stream(const oc_resource_t *resource)
+{
+  oc_blockwise_stream_t *stream = oc_list_head(oc_blockwise_streams);
+  while (stream && stream->resource != resource) {
+    stream = stream->next;
+  }
+  return stream;
+}
+
+oc_blockwise_stream_t *
+oc_blockwise_find_stream(const char *href, size_t href_len, size_t device)
+{
+  oc_blockwise_stream_t *stream = oc_list_head(oc_blockwise_streams);
+  while (stream) {
+    const oc_resource_t *resource = stream->resource;
+    if (resource->device == device &&
+        oc_string_len(resource->uri) == href_len + 1 &&
+        memcmp(oc_string(resource->uri) + 1, href, href_len) == 0) {
+      break;
+    }
+    stream = stream->next;
+  }
+  return stream;
+}
+
+static oc_blockwise_stream_t *
+find_stream_of_buffer(const oc_blockwise_state_t *buffer)
+{
+  return oc_blockwise_find_stream(oc_string(buffer->href),
+                                  oc_string_len(buffer->href),
+                                  buffer->endpoint.device);
+}
+
+uint8_t
+oc_blockwise_stream_write(oc_blockwise_state_t *buffer, uint32_t block_offset,
+                          const uint8_t *block, uint32_t block_len, bool more)
+{
+  oc_blockwise_stream_t *stream = find_stream_of_buffer(buffer);
+  if (!stream || !stream->sink) {
+    return NOT_FOUND_4_04;
+  }
+  if (!oc_knx_sec_check_acl(buffer->method, stream->resource,
+                            &buffer->endpoint)) {
+    return UNAUTHORIZED_4_01;
+  }
+  if (block_offset > buffer->next_block_offset) {
+    return REQUEST_ENTITY_INCOMPLETE_4_08;
+  }
+  if (block_offset < buffer->next_block_offset) {
+    OC_DBG("skipping duplicate block at offset %u", (unsigned)block_offset);
+    return 0;
+  }
+  if (!stream->sink(stream->resource, &buffer->endpoint,
+                    oc_string(buffer->uri_query),
+                    oc_string_len(buffer->uri_query), block_offset, block,
+                    block_len, more, stream->sink_data)) {
+    return BAD_REQUEST_4_00;
+  }
+  buffer->next_block_offset += block_len;
+  return 0;
+}
+
+int
+oc_blockwise_stream_read(oc_blockwise_state_t *buffer, uint32_t block_offset,
+                         uint8_t *block, uint32_t block_size, bool *more)
+{
+  oc_blockwise_stream_t *stream = find_stream_of_buffer(buffer);
+  if (!stream || !stream->source) {
+    return -1;
+  }
+  *more = false;
+  int block_len =
+    stream->source(stream->resource, oc_string(buffer->uri_query),
+                   oc_string_len(buffer->uri_query), block_offset, block,
+                   block_size, more, stream->source_data);
+  if (block_len < 0 || (uint32_t)block_len > block_size) {
+    return -1;
+  }
+  buffer->next_block_offset = block_offset + (uint32_t)block_len;
+  return block_len;
+}
+
+static void
+free_stream(oc_blockwise_stream_t *stream)
+{
+  stream->resource->properties &= ~OC_STREAMED;
+  oc_list_remove(oc_blockwise_streams, stream);
+  oc_memb_free(&oc_blockwise_streams_s, stream);
+}
+
+static oc_blockwise_stream_t *
+get_or_add_stream(oc_resource_t *resource)
+{
+  oc_blockwise_stream_t *stream = oc_blockwise_get_stream(resource);
+  if (!stream) {
+    stream = (oc_blockwise_stream_t *)oc_memb_alloc(&oc_blockwise_streams_s);
+    if (!stream) {
+      OC_ERR("out of memory for streamed resources");
+      return NULL;
+    }
+    memset(stream, 0, sizeof(*stream));
+    stream->resource = resource;
+    oc_list_add(oc_blockwise_streams, stream);
+    resource->properties |= OC_STREAMED;
+  }
+  return stream;
+}
+
+bool
+oc_resource_set_block_sink(oc_resource_t *resource, oc_block_sink_cb_t sink,
+                           void *user_data)
+{
+  if (!resource) {
+    return false;
+  }
+  oc_blockwise_stream_t *stream = sink ? get_or_add_stream(resource)
+                                       : oc_blockwise_get_stream(resource);
+  if (!stream) {
+    return sink == NULL;
+  }
+  stream->sink = sink;
+  stream->sink_data = user_data;
+  if (!stream->sink && !stream->source) {
+    free_stream(stream);
+  }
+  return true;
+}
+
+bool
+oc_resource_set_block_source(oc_resource_t *resource,
+                             oc_content_format_t content_format,
+                             oc_block_source_cb_t source, void *user_data)
+{
+  if (!resource) {
+    return false;
+  }
+  oc_blockwise_stream_t *stream = source ? get_or_add_stream(resource)
+                                         : oc_blockwise_get_stream(resource);
+  if (!stream) {
+    return source == NULL;
+  }
+  stream->source = source;
+  stream->source_data = user_data;
+  stream->content_format = content_format;
+  if (!stream->sink && !stream->source) {
+    free_stream(stream);
+  }
+  return true;
+}
+
+void
+oc_blockwise_remove_stream(const oc_resource_t *resource)
+{
+  oc_blockwise_stream_t *stream = oc_blockwise_get_stream(resource);
+  if (stream) {
+    free_stream(stream);
+  }
+}
+
+void
+oc_blockwise_free_streams(void)
+{
+  oc_blockwise_stream_t *stream;
+  while ((stream = oc_list_head(oc_blockwise_streams)) != NULL) {
+    free_stream(stream);
+  }
+}
+#else /* OC_BLOCK_WISE */
+bool
+oc_resource_set_block_sink(oc_resource_t *resource, oc_block_sink_cb_t sink,
+                           void *user_data)
+{
+  (void)resource;
+  (void)sink;
+  (void)user_data;
+  return false;
+}
+
+bool
+oc_resource_set_block_source(oc_resource_t *resource,
+                             oc_content_format_t content_format,
+                             oc_block_source_cb_t source, void *user_data)
+{
+  (void)resource;
+  (void)content_format;
+  (void)source;
+  (void)user_data;
+  return false;
+}
+#endif /* !OC_BLOCK_WISE */
 
 oc_blockwise_state_t *
 oc_get_request_buffer_with_ptr(uint8_t *data)
@@ -22,6 +22,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #ifdef OC_DYNAMIC_ALLOCATION
+#include "oc_buffer_settings.h"
+#include <stddef.h>
 #include <stdlib.h>
 #endif /* OC_DYNAMIC_ALLOCATION */
 
@@ -44,23 +46,163 @@ OC_MEMB(oc_incoming_buffers, oc_message_t, OC_MAX_NUM_CONCURRENT_REQUESTS);
 OC_MEMB(oc_outgoing_buffers, oc_message_t, OC_MAX_NUM_CONCURRENT_REQUESTS);
 #endif /* !OC_INOUT_BUFFER_POOL */
 
+#if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
+/*
+ * Size-classed slab for message payloads.
+ *
+ * Every block is prefixed with a small header recording its class and
+ * capacity. Freed blocks are kept on a per-class free list and handed out
+ * again without going through the heap. The class sizes follow the runtime
+ * buffer settings, so a block that is smaller than the current class size
+ * (e.g. after oc_set_mtu_size()) is released to the heap instead of being
+ * recycled. Once no payload is in use anymore, the free lists are trimmed back
+ * to OC_BUFFER_SLAB_MIN_FREE blocks per class.
+ *
+ * All access is serialized with the network event handler mutex, as payloads
+ * are allocated on the network thread and released on the main thread.
+ */
+typedef union oc_slab_block_s {
+  struct
+  {
+    union oc_slab_block_s *next;
+    size_t capacity;
+    uint8_t slab_class;
+  } hdr;
+  max_align_t align;
+} oc_slab_block_t;
+
+typedef struct
+{
+  oc_slab_block_t *free_list;
+  oc_buffer_slab_stats_t stats;
+} oc_slab_t;
+
+static oc_slab_t slabs[OC_BUFFER_SLAB_NUM_CLASSES];
+
+static size_t
+slab_class_size(oc_buffer_slab_class_t slab_class, size_t size)
+{
+  switch (slab_class) {
+  case OC_BUFFER_SLAB_SMALL:
+    return OC_BUFFER_SLAB_SMALL_SIZE;
+  case OC_BUFFER_SLAB_MTU:
+    return (size_t)oc_get_mtu_size();
+  default:
+    /* the large class grows to the largest size requested so far */
+    return (size > slabs[slab_class].stats.block_size)
+             ? size
+             : slabs[slab_class].stats.block_size;
+  }
+}
+
+static oc_buffer_slab_class_t
+slab_class_for_size(size_t size)
+{
+  if (size <= OC_BUFFER_SLAB_SMALL_SIZE) {
+    return OC_BUFFER_SLAB_SMALL;
+  }
+  if (size <= (size_t)oc_get_mtu_size()) {
+    return OC_BUFFER_SLAB_MTU;
+  }
+  return OC_BUFFER_SLAB_LARGE;
+}
+
+static void
+slab_release_free_blocks(oc_slab_t *slab, size_t keep)
+{
+  while (slab->free_list && slab->stats.num_free > keep) {
+    oc_slab_block_t *block = slab->free_list;
+    slab->free_list = block->hdr.next;
+    slab->stats.num_free--;
+    free(block);
+  }
+}
+
+static uint8_t *
+slab_alloc(size_t size)
+{
+  oc_buffer_slab_class_t slab_class = slab_class_for_size(size);
+  oc_slab_t *slab = &slabs[slab_class];
+  size_t block_size = slab_class_size(slab_class, size);
+
+  if (block_size != slab->stats.block_size) {
+    /* class was resized, cached blocks no longer match */
+    slab_release_free_blocks(slab, 0);
+    slab->stats.block_size = block_size;
+  }
+
+  oc_slab_block_t *block = slab->free_list;
+  if (block) {
+    slab->free_list = block->hdr.next;
+    slab->stats.num_free--;
+  } else {
+    block = (oc_slab_block_t *)malloc(sizeof(oc_slab_block_t) + block_size);
+    if (!block) {
+      return NULL;
+    }
+    block->hdr.capacity = block_size;
+    block->hdr.slab_class = (uint8_t)slab_class;
+    slab->stats.num_heap_allocs++;
+  }
+  block->hdr.next = NULL;
+
+  slab->stats.num_allocs++;
+  slab->stats.num_in_use++;
+  if (slab->stats.num_in_use > slab->stats.high_water_mark) {
+    slab->stats.high_water_mark = slab->stats.num_in_use;
+  }
+  return (uint8_t *)(block + 1);
+}
+
+static void
+slab_free(uint8_t *data)
+{
+  oc_slab_block_t *block = (oc_slab_block_t *)data - 1;
+  oc_slab_t *slab = &slabs[block->hdr.slab_class];
+
+  slab->stats.num_in_use--;
+  if (block->hdr.capacity != slab->stats.block_size) {
+    free(block);
+  } else {
+    block->hdr.next = slab->free_list;
+    slab->free_list = block;
+    slab->stats.num_free++;
+  }
+
+  size_t in_use = 0;
+  int i;
+  for (i = 0; i < OC_BUFFER_SLAB_NUM_CLASSES; i++) {
+    in_use += slabs[i].stats.num_in_use;
+  }
+  if (in_use == 0) {
+    /* idle: give burst allocations back to the heap */
+    for (i = 0; i < OC_BUFFER_SLAB_NUM_CLASSES; i++) {
+      slab_release_free_blocks(&slabs[i], OC_BUFFER_SLAB_MIN_FREE);
+    }
+  }
+}
+#endif /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+
 static oc_message_t *
-allocate_message(struct oc_memb *pool)
+allocate_message(struct oc_memb *pool, size_t size)
 {
   oc_network_event_handler_mutex_lock();
   oc_message_t *message = (oc_message_t *)oc_memb_alloc(pool);
   // OC_DBG(" message allocated %p", message);
-  oc_network_event_handler_mutex_unlock();
-  if (message) {
 #if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
-    message->data = malloc(OC_PDU_SIZE);
-    // OC_DBG(" (((((((( message data %p size: %d", message->data, OC_PDU_SIZE);
+  if (message) {
+    message->data = slab_alloc(size);
     if (!message->data) {
       OC_ERR("Out of memory, cannot allocate message");
       oc_memb_free(pool, message);
-      return NULL;
+      message = NULL;
     }
-#endif /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+  }
+#else  /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+  (void)size;
+#endif /* !OC_DYNAMIC_ALLOCATION || OC_INOUT_BUFFER_SIZE */
+  oc_network_event_handler_mutex_unlock();
+  if (message) {
     message->pool = pool;
     message->length = 0;
     message->next = 0;
@@ -91,7 +233,7 @@ oc_message_t *
 oc_allocate_message_from_pool(struct oc_memb *pool)
 {
   if (pool) {
-    return allocate_message(pool);
+    return allocate_message(pool, OC_PDU_SIZE);
   }
   return NULL;
 }
@@ -105,13 +247,55 @@ oc_set_buffers_avail_cb(oc_memb_buffers_avail_callback_t cb)
 oc_message_t *
 oc_allocate_message(void)
 {
-  return allocate_message(&oc_incoming_buffers);
+  return allocate_message(&oc_incoming_buffers, OC_PDU_SIZE);
+}
+
+oc_message_t *
+oc_allocate_message_with_size(size_t size)
+{
+  if (size > (size_t)OC_PDU_SIZE) {
+    size = OC_PDU_SIZE;
+  }
+  return allocate_message(&oc_incoming_buffers, size);
+}
+
+void
+oc_message_shrink(oc_message_t *message)
+{
+#if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
+  if (!message || !message->data) {
+    return;
+  }
+  const oc_slab_block_t *block = (const oc_slab_block_t *)message->data - 1;
+  if (slab_class_for_size(message->length) >= block->hdr.slab_class) {
+    return;
+  }
+  oc_network_event_handler_mutex_lock();
+  uint8_t *data = slab_alloc(message->length);
+  if (data) {
+    memcpy(data, message->data, message->length);
+    slab_free(message->data);
+    message->data = data;
+  }
+  oc_network_event_handler_mutex_unlock();
+#else  /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+  (void)message;
+#endif /* !OC_DYNAMIC_ALLOCATION || OC_INOUT_BUFFER_SIZE */
 }
 
 oc_message_t *
 oc_internal_allocate_outgoing_message(void)
 {
-  return allocate_message(&oc_outgoing_buffers);
+  return allocate_message(&oc_outgoing_buffers, OC_PDU_SIZE);
+}
+
+oc_message_t *
+oc_internal_allocate_outgoing_message_with_size(size_t size)
+{
+  if (size > (size_t)OC_PDU_SIZE) {
+    size = OC_PDU_SIZE;
+  }
+  return allocate_message(&oc_outgoing_buffers, size);
 }
 
 void
@@ -131,18 +315,20 @@ oc_message_unref(oc_message_t *message)
     OC_DBG("refcount: %d", message->ref_count);
     if (message->ref_count <= 0) {
       // PRINT("oc_message_unref: deallocating\n");
+      struct oc_memb *pool = message->pool;
+      oc_network_event_handler_mutex_lock();
 #if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
       if (message->data != NULL) {
-        // OC_DBG(" )))))))) Free message data %p", message->data);
-        free(message->data);
+        slab_free(message->data);
+        message->data = NULL;
       }
 #endif /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
-      struct oc_memb *pool = message->pool;
       if (pool != NULL) {
         // OC_DBG(" FFFFFFFFFFF  Free message %p from pool %p size %d", message,
         //  pool, pool->size);
         oc_memb_free(pool, message);
       }
+      oc_network_event_handler_mutex_unlock();
 #if !defined(OC_DYNAMIC_ALLOCATION) || defined(OC_INOUT_BUFFER_SIZE)
       OC_DBG("buffer: freed TX/RX buffer; num free: %d", oc_memb_numfree(pool));
 #endif /* !OC_DYNAMIC_ALLOCATION || OC_INOUT_BUFFER_SIZE */
@@ -150,6 +336,49 @@ oc_message_unref(oc_message_t *message)
   }
 }
 
+int
+oc_buffer_get_slab_stats(oc_buffer_slab_class_t slab_class,
+                         oc_buffer_slab_stats_t *stats)
+{
+  if (!stats || slab_class >= OC_BUFFER_SLAB_NUM_CLASSES) {
+    return -1;
+  }
+#if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
+  oc_network_event_handler_mutex_lock();
+  *stats = slabs[slab_class].stats;
+  oc_network_event_handler_mutex_unlock();
+  return 0;
+#else  /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+  return -1;
+#endif /* !OC_DYNAMIC_ALLOCATION || OC_INOUT_BUFFER_SIZE */
+}
+
+void
+oc_buffer_reset_slab_high_water_marks(void)
+{
+#if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
+  oc_network_event_handler_mutex_lock();
+  int i;
+  for (i = 0; i < OC_BUFFER_SLAB_NUM_CLASSES; i++) {
+    slabs[i].stats.high_water_mark = slabs[i].stats.num_in_use;
+  }
+  oc_network_event_handler_mutex_unlock();
+#endif /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+}
+
+void
+oc_buffer_trim_slabs(void)
+{
+#if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
+  oc_network_event_handler_mutex_lock();
+  int i;
+  for (i = 0; i < OC_BUFFER_SLAB_NUM_CLASSES; i++) {
+    slab_release_free_blocks(&slabs[i], 0);
+  }
+  oc_network_event_handler_mutex_unlock();
+#endif /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+}
+
 void
 oc_recv_message(oc_message_t *message)
 {
@@ -172,8 +172,8 @@ prepare_coap_request_ex(oc_client_cb_t *cb, oc_content_format_t accept)
     }
     oc_rep_new(request_buffer->buffer, OC_MAX_APP_DATA_SIZE);
 
-    request_buffer->mid = cb->mid;
-    request_buffer->client_cb = cb;
+    oc_blockwise_set_mid(request_buffer, cb->mid);
+    oc_blockwise_set_client_cb(request_buffer, cb);
   }
 #endif /* OC_BLOCK_WISE_REQUEST */
 
@@ -562,7 +562,7 @@ oc_stop_observe(const char *uri, oc_endpoint_t *endpoint)
   if (!cb)
     return false;
 
-  cb->mid = coap_get_mid();
+  oc_ri_set_client_cb_mid(cb, coap_get_mid());
   cb->observe_seq = 1;
 
   bool status = false;
@@ -644,8 +644,8 @@ dispatch_ip_discovery_ex(oc_client_cb_t *cb4, const char *uri,
   if (cb) {
     cb->discovery = true;
     if (cb4) {
-      cb->mid = cb4->mid;
-      memcpy(cb->token, cb4->token, cb4->token_len);
+      oc_ri_set_client_cb_mid(cb, cb4->mid);
+      oc_ri_set_client_cb_token(cb, cb4->token, cb4->token_len);
     }
 
     if (prepare_coap_request_ex(cb, accept) &&
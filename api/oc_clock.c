@@ -23,7 +23,8 @@
 size_t
 oc_clock_time_rfc3339(char *out_buf, size_t out_buf_len)
 {
-  return oc_clock_encode_time_rfc3339(oc_clock_time(), out_buf, out_buf_len);
+  return oc_clock_encode_time_rfc3339(oc_clock_wall_time(), out_buf,
+                                     out_buf_len);
 }
 
 size_t
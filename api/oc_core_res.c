@@ -33,6 +33,7 @@
 #endif /* OC_IOT_ROUTER */
 
 #include "port/oc_assert.h"
+#include "util/oc_uri_trie.h"
 #include <stdarg.h>
 
 #ifdef OC_DYNAMIC_ALLOCATION
@@ -49,6 +50,66 @@ static oc_platform_info_t oc_platform_info;
 
 static size_t device_count = 0;
 
+/* the core resources of each device by path */
+OC_MEMB(core_uri_nodes_s, oc_uri_trie_node_t,
+        4 * WELLKNOWNCORE * OC_MAX_NUM_DEVICES);
+#ifdef OC_DYNAMIC_ALLOCATION
+static oc_uri_trie_node_t **core_resources_by_uri = NULL;
+static size_t num_core_indexes = 0;
+#else  /* OC_DYNAMIC_ALLOCATION */
+static oc_uri_trie_node_t *core_resources_by_uri[OC_MAX_NUM_DEVICES];
+static const size_t num_core_indexes = OC_MAX_NUM_DEVICES;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+static void
+index_core_resource(oc_resource_t *resource, size_t device)
+{
+  if (device >= num_core_indexes ||
+      !oc_uri_trie_add(&core_uri_nodes_s, &core_resources_by_uri[device],
+                       oc_string(resource->uri) + 1,
+                       oc_string_len(resource->uri) - 1, resource)) {
+    OC_ERR("could not index core resource %s", oc_string(resource->uri));
+  }
+}
+
+static void
+unindex_core_resource(oc_resource_t *resource, size_t device)
+{
+  if (device < num_core_indexes && oc_string_len(resource->uri) > 0) {
+    oc_uri_trie_remove(&core_uri_nodes_s, &core_resources_by_uri[device],
+                       oc_string(resource->uri) + 1,
+                       oc_string_len(resource->uri) - 1, resource);
+  }
+}
+
+static void
+clear_core_index(void)
+{
+  size_t device;
+  for (device = 0; device < num_core_indexes; device++) {
+    oc_uri_trie_clear(&core_uri_nodes_s, &core_resources_by_uri[device]);
+  }
+}
+
+#ifdef OC_DYNAMIC_ALLOCATION
+/* the core resources of the devices added so far moved */
+static void
+reindex_core_resources(void)
+{
+  size_t device;
+  int type;
+  clear_core_index();
+  for (device = 0; device < device_count; device++) {
+    for (type = 0; type < OC_NUM_CORE_RESOURCES_PER_DEVICE; type++) {
+      oc_resource_t *resource = oc_core_get_resource_by_index(type, device);
+      if (oc_string_len(resource->uri) > 0) {
+        index_core_resource(resource, device);
+      }
+    }
+  }
+}
+#endif /* OC_DYNAMIC_ALLOCATION */
+
 void
 oc_core_init(void)
 {
@@ -112,6 +173,12 @@ oc_core_shutdown(void)
     free(core_resources);
     core_resources = NULL;
   }
+#endif /* OC_DYNAMIC_ALLOCATION */
+  clear_core_index();
+#ifdef OC_DYNAMIC_ALLOCATION
+  free(core_resources_by_uri);
+  core_resources_by_uri = NULL;
+  num_core_indexes = 0;
 #endif /* OC_DYNAMIC_ALLOCATION */
   device_count = 0;
 }
@@ -399,6 +466,15 @@ oc_core_add_device(const char *name, const char *version, const char *base,
   oc_resource_t *device_resources = &core_resources[new_num - WELLKNOWNCORE];
   memset(device_resources, 0, WELLKNOWNCORE * sizeof(oc_resource_t));
 
+  core_resources_by_uri = (oc_uri_trie_node_t **)realloc(
+    core_resources_by_uri, (device_count + 1) * sizeof(oc_uri_trie_node_t *));
+  if (!core_resources_by_uri) {
+    oc_abort("Insufficient memory");
+  }
+  core_resources_by_uri[device_count] = NULL;
+  num_core_indexes = device_count + 1;
+  reindex_core_resources();
+
   oc_device_info = (oc_device_info_t *)realloc(
     oc_device_info, (device_count + 1) * sizeof(oc_device_info_t));
 
@@ -476,11 +552,13 @@ oc_core_populate_resource(int core_resource, size_t device_index,
   if (!r) {
     return;
   }
+  unindex_core_resource(r, device_index);
   r->device = device_index;
   oc_check_uri(uri);
   r->uri.next = NULL;
   r->uri.ptr = uri;
   r->uri.size = strlen(uri) + 1; // include null terminator in size
+  index_core_resource(r, device_index);
   r->properties = properties;
   va_list rt_list;
   int i;
@@ -500,6 +578,7 @@ oc_core_populate_resource(int core_resource, size_t device_index,
   r->put_handler.cb = put;
   r->post_handler.cb = post;
   r->delete_handler.cb = delete;
+  oc_discovery_invalidate_views();
 }
 
 oc_device_info_t *
@@ -527,30 +606,21 @@ oc_core_get_resource_by_index(int type, size_t device)
 }
 
 oc_resource_t *
-oc_core_get_resource_by_uri(const char *uri, size_t device)
+oc_core_get_resource_by_path(const char *path, size_t path_len, size_t device)
 {
-  int skip = 0, type = 0;
-  if (uri[0] == '/')
-    skip = 1;
-
-  // TODO: need to add all other KNX resources, not sure though if this function
-  // is being used anywhere
-  if ((strlen(uri) - skip) == 7 &&
-      memcmp(uri + skip, ".well-known/core", 17) == 0) {
-    type = WELLKNOWNCORE;
-  } else if ((strlen(uri) - skip) == 7 &&
-             memcmp(uri + skip, ".well-known/knx", 15) == 0) {
-    type = OC_KNX;
-  }
-
-#ifdef OC_SECURITY
-
-#endif /* OC_SECURITY */
-  else {
+  if (device >= num_core_indexes) {
     return NULL;
   }
-  size_t res = WELLKNOWNCORE * device + type;
-  return &core_resources[res];
+  return (oc_resource_t *)oc_uri_trie_find(core_resources_by_uri[device],
+                                           path, path_len);
+}
+
+oc_resource_t *
+oc_core_get_resource_by_uri(const char *uri, size_t device)
+{
+  if (uri[0] == '/')
+    uri++;
+  return oc_core_get_resource_by_path(uri, strlen(uri), device);
 }
 
 bool
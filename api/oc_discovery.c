@@ -34,6 +34,7 @@
 #ifdef OC_OSCORE
 #include "security/oc_tls.h"
 #endif
+#include <stdlib.h>
 
 bool
 oc_add_resource_to_wk(oc_resource_t *resource, oc_request_t *request,
@@ -183,12 +184,203 @@ oc_process_resources(oc_request_t *request, size_t device_index,
   return matches;
 }
 
+#ifdef OC_DYNAMIC_ALLOCATION
+
+/* A rendered /.well-known/core response. Besides the resource set, which
+ * drops all views when it changes, a view depends on the programming mode,
+ * individual address and load state of the device; these are kept with the
+ * view and compared on every lookup, so a change to any of them re-renders
+ * the view without every writer having to know about the cache.
+ */
+typedef struct oc_wkcore_view_s
+{
+  char *query;
+  size_t query_len;
+  uint8_t *payload;
+  size_t payload_len;
+  size_t device;
+  bool unicast;
+  bool pm;
+  uint32_t ia;
+  oc_lsm_state_t lsm_s;
+  int code;
+  uint32_t last_used;
+} oc_wkcore_view_t;
+
+static oc_wkcore_view_t wkcore_views[OC_WKCORE_VIEW_CACHE_SIZE];
+static uint32_t wkcore_views_use_counter;
+
+static bool
+is_unicast(const oc_request_t *request)
+{
+  return request->origin && (request->origin->flags & MULTICAST) == 0;
+}
+
+static bool
+view_has_key(const oc_wkcore_view_t *v, const oc_request_t *request)
+{
+  return v->last_used != 0 && v->device == request->resource->device &&
+         v->unicast == is_unicast(request) &&
+         v->query_len == request->query_len &&
+         (v->query_len == 0 ||
+          memcmp(v->query, request->query, v->query_len) == 0);
+}
+
+static bool
+view_is_current(const oc_wkcore_view_t *v)
+{
+  const oc_device_info_t *device = oc_core_get_device_info(v->device);
+  return device && v->pm == device->pm && v->ia == device->ia &&
+         v->lsm_s == device->lsm_s;
+}
+
 static void
-oc_wkcore_discovery_handler(oc_request_t *request,
-                            oc_interface_mask_t iface_mask, void *data)
+free_view(oc_wkcore_view_t *v)
+{
+  free(v->query);
+  free(v->payload);
+  memset(v, 0, sizeof(*v));
+}
+
+static bool
+wkcore_view_cacheable(const oc_request_t *request)
+{
+  char *value = NULL;
+  /* the group address listing follows the group object table */
+  return (request->accept == APPLICATION_LINK_FORMAT ||
+          request->accept == APPLICATION_JSON) &&
+         oc_ri_get_query_value(request->query, request->query_len, "d",
+                               &value) < 0;
+}
+
+static bool
+wkcore_view_lookup(oc_request_t *request)
+{
+  oc_response_buffer_t *response_buffer = request->response->response_buffer;
+  int i;
+  for (i = 0; i < OC_WKCORE_VIEW_CACHE_SIZE; i++) {
+    oc_wkcore_view_t *v = &wkcore_views[i];
+    if (!view_has_key(v, request)) {
+      continue;
+    }
+    if (!view_is_current(v) || v->payload_len > response_buffer->buffer_size) {
+      return false;
+    }
+    if (v->payload_len > 0) {
+      memcpy(response_buffer->buffer, v->payload, v->payload_len);
+    }
+    response_buffer->response_length = v->payload_len;
+    response_buffer->content_format = APPLICATION_LINK_FORMAT;
+    response_buffer->code = v->code;
+    v->last_used = ++wkcore_views_use_counter;
+    return true;
+  }
+  return false;
+}
+
+static void
+wkcore_view_store(const oc_request_t *request)
+{
+  const oc_response_buffer_t *response_buffer =
+    request->response->response_buffer;
+  const oc_device_info_t *device =
+    oc_core_get_device_info(request->resource->device);
+  size_t payload_len = 0;
+  if (response_buffer->code == oc_status_code(OC_STATUS_OK)) {
+    payload_len = response_buffer->response_length;
+  }
+  if (!device || response_buffer->code == 0 ||
+      payload_len > response_buffer->buffer_size) {
+    return;
+  }
+
+  oc_wkcore_view_t *slot = NULL;
+  int i;
+  for (i = 0; i < OC_WKCORE_VIEW_CACHE_SIZE; i++) {
+    oc_wkcore_view_t *v = &wkcore_views[i];
+    if (view_has_key(v, request)) {
+      slot = v;
+      break;
+    }
+    if (slot == NULL || v->last_used < slot->last_used) {
+      slot = v;
+    }
+  }
+  free_view(slot);
+
+  if (request->query_len > 0) {
+    slot->query = (char *)malloc(request->query_len);
+    if (!slot->query) {
+      goto error;
+    }
+    memcpy(slot->query, request->query, request->query_len);
+    slot->query_len = request->query_len;
+  }
+  if (payload_len > 0) {
+    slot->payload = (uint8_t *)malloc(payload_len);
+    if (!slot->payload) {
+      goto error;
+    }
+    memcpy(slot->payload, response_buffer->buffer, payload_len);
+    slot->payload_len = payload_len;
+  }
+  slot->device = request->resource->device;
+  slot->unicast = is_unicast(request);
+  slot->pm = device->pm;
+  slot->ia = device->ia;
+  slot->lsm_s = device->lsm_s;
+  slot->code = response_buffer->code;
+  slot->last_used = ++wkcore_views_use_counter;
+  return;
+
+error:
+  OC_ERR("oc_discovery: out of memory");
+  free_view(slot);
+}
+
+void
+oc_discovery_invalidate_views(void)
+{
+  int i;
+  for (i = 0; i < OC_WKCORE_VIEW_CACHE_SIZE; i++) {
+    free_view(&wkcore_views[i]);
+  }
+  oc_core_invalidate_group_object_table_index();
+}
+
+#else /* OC_DYNAMIC_ALLOCATION */
+
+static bool
+wkcore_view_cacheable(const oc_request_t *request)
+{
+  (void)request;
+  return false;
+}
+
+static bool
+wkcore_view_lookup(oc_request_t *request)
+{
+  (void)request;
+  return false;
+}
+
+static void
+wkcore_view_store(const oc_request_t *request)
+{
+  (void)request;
+}
+
+void
+oc_discovery_invalidate_views(void)
+{
+  oc_core_invalidate_group_object_table_index();
+}
+
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+static void
+oc_wkcore_render(oc_request_t *request)
 {
-  (void)data;
-  (void)iface_mask;
   size_t response_length = 0;
   int matches = 0;
 
@@ -413,6 +605,23 @@ oc_wkcore_discovery_handler(oc_request_t *request,
   }
 }
 
+static void
+oc_wkcore_discovery_handler(oc_request_t *request,
+                            oc_interface_mask_t iface_mask, void *data)
+{
+  (void)data;
+  (void)iface_mask;
+
+  bool cacheable = wkcore_view_cacheable(request);
+  if (cacheable && wkcore_view_lookup(request)) {
+    return;
+  }
+  oc_wkcore_render(request);
+  if (cacheable) {
+    wkcore_view_store(request);
+  }
+}
+
 void
 oc_create_discovery_resource(int resource_idx, size_t device)
 {
@@ -24,6 +24,7 @@
 #include "oc_knx_sec.h"
 #include "oc_main.h"
 #include "oc_rep.h"
+#include "oc_response_cache_internal.h"
 #include <stdio.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -579,6 +580,23 @@ oc_reset_g_received_notification()
   oc_new_string(&g_received_notification.st, "", strlen(""));
 }
 
+/* parses the payload of an s-mode message once more, now with terminated
+ * strings, into the arena of the request */
+static oc_rep_t *
+s_mode_terminated_value(oc_request_t *request)
+{
+  oc_rep_t *payload = NULL;
+  if (request->_rep_arena == NULL ||
+      oc_parse_rep_in_arena(request->_payload, (int)request->_payload_len,
+                            request->_rep_arena, &payload) != CborNoError) {
+    OC_ERR(".knx: could not copy the s-mode value");
+    return NULL;
+  }
+  oc_request_t copy = *request;
+  copy.request_payload = payload;
+  return oc_s_mode_get_value(&copy);
+}
+
 /*
  {sia: 5678, es: {st: write, ga: 1, value: 100 }}
 */
@@ -802,10 +820,18 @@ oc_core_knx_knx_post_handler(oc_request_t *request,
   memset(&response_obj, 0, sizeof(oc_response_t));
   oc_ri_new_request_from_request(new_request, *request, response_buffer,
                                  response_obj);
-  new_request.request_payload = oc_s_mode_get_value(request);
   new_request.uri_path = ".knx";
   new_request.uri_path_len = 4;
 
+  /* /.knx parses its payload in place, so the strings in the value are not
+   * terminated; resources that did not opt in to that get a copy */
+  oc_rep_t *value = oc_s_mode_get_value(request);
+  bool value_has_spans =
+    value != NULL &&
+    (value->type == OC_REP_STRING || value->type == OC_REP_BYTE_STRING ||
+     value->type == OC_REP_OBJECT || value->type == OC_REP_OBJECT_ARRAY);
+  oc_rep_t *terminated_value = NULL;
+
   while (index != -1) {
     oc_string_t myurl = oc_core_find_group_object_table_url_from_index(index);
     PRINT(" .knx : url  %s\n", oc_string_checked(myurl));
@@ -816,6 +842,13 @@ oc_core_knx_knx_post_handler(oc_request_t *request,
       if (my_resource == NULL) {
         return;
       }
+      new_request.request_payload = value;
+      if (value_has_spans && !(my_resource->properties & OC_ZERO_COPY)) {
+        if (terminated_value == NULL) {
+          terminated_value = s_mode_terminated_value(request);
+        }
+        new_request.request_payload = terminated_value;
+      }
 
       // check if the data is allowed to write or update
       oc_cflag_mask_t cflags = oc_core_group_object_table_cflag_entries(index);
@@ -908,7 +941,7 @@ oc_create_knx_knx_resource(int resource_idx, size_t device)
   OC_DBG("oc_create_knx_knx_resource (.knx)\n");
 
   oc_core_populate_resource(resource_idx, device, "/.knx", OC_IF_LI | OC_IF_G,
-                            APPLICATION_CBOR, OC_DISCOVERABLE,
+                            APPLICATION_CBOR, OC_DISCOVERABLE | OC_ZERO_COPY,
                             oc_core_knx_knx_get_handler, 0,
                             oc_core_knx_knx_post_handler, 0, 1, "urn:knx:g.s");
 }
@@ -1592,12 +1625,16 @@ oc_knx_dump_fingerprint()
 void
 oc_knx_set_fingerprint(uint64_t fingerprint)
 {
+  if (fingerprint != g_fingerprint) {
+    oc_response_cache_clear();
+  }
   g_fingerprint = fingerprint;
 }
 
 void
 oc_knx_increase_fingerprint()
 {
+  oc_response_cache_clear();
   g_fingerprint++;
   oc_knx_dump_fingerprint();
 }
@@ -16,9 +16,13 @@
 
 #include "oc_api.h"
 #include "api/oc_knx_fp.h"
+#include "api/oc_knx_table.h"
 #include "oc_discovery.h"
 #include "oc_core_res.h"
+#include "util/oc_hash_index.h"
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
@@ -33,6 +37,31 @@
 #endif
 static oc_group_object_table_t g_got[GOT_MAX_ENTRIES];
 
+/* Number of (group address, entry) pairs of the Group Object Table that the
+ * group address index holds without OC_DYNAMIC_ALLOCATION. A table with more
+ * pairs is searched by scanning it.
+ */
+#ifndef GOT_MAX_GROUP_ADDRESSES
+#define GOT_MAX_GROUP_ADDRESSES (4 * GOT_MAX_ENTRIES)
+#endif
+
+/* A datapoint reachable through a group address, with its link-format line
+ * for ?d=urn:knx:g.s.<ga> discovery once it has been framed.
+ */
+typedef struct oc_ga_point_s
+{
+  uint32_t group_address;
+  oc_resource_t *resource;
+  char *line;
+  size_t line_len;
+} oc_ga_point_t;
+
+OC_HASH_INDEX(ga_points_by_ga, GOT_MAX_GROUP_ADDRESSES);
+static oc_ga_point_t *ga_points;
+static int num_ga_points;
+static size_t ga_points_device;
+static bool ga_points_valid;
+
 #ifdef OC_PUBLISHER_TABLE
 #ifndef GPT_MAX_ENTRIES
 #define GPT_MAX_ENTRIES 20
@@ -45,6 +74,31 @@ static oc_group_rp_table_t g_gpt[GPT_MAX_ENTRIES];
 #endif
 static oc_group_rp_table_t g_grt[GRT_MAX_ENTRIES];
 
+/* the fields of a Group Object Table entry, on the wire and in storage */
+static const oc_table_field_t got_fields[] = {
+  OC_TABLE_FIELD(oc_group_object_table_t, id, OC_TABLE_INT, "id", 0),
+  OC_TABLE_FIELD(oc_group_object_table_t, href, OC_TABLE_TEXT, "href", 11),
+  OC_TABLE_ARRAY(oc_group_object_table_t, ga, ga_len, OC_TABLE_UINT32_ARRAY,
+                 "ga", 7),
+  OC_TABLE_FIELD(oc_group_object_table_t, cflags, OC_TABLE_CFLAGS, "cflags",
+                 8),
+};
+#define GOT_NUM_FIELDS (sizeof(got_fields) / sizeof(got_fields[0]))
+
+/* the fields of a publisher or recipient table entry */
+static const oc_table_field_t rp_fields[] = {
+  OC_TABLE_FIELD(oc_group_rp_table_t, id, OC_TABLE_INT, "id", 0),
+  OC_TABLE_FIELD(oc_group_rp_table_t, ia, OC_TABLE_INT, "ia", 12),
+  OC_TABLE_FIELD(oc_group_rp_table_t, iid, OC_TABLE_INT64, "iid", 26),
+  OC_TABLE_FIELD(oc_group_rp_table_t, fid, OC_TABLE_INT64, "fid", 25),
+  OC_TABLE_FIELD(oc_group_rp_table_t, grpid, OC_TABLE_UINT32, "grpid", 13),
+  OC_TABLE_FIELD(oc_group_rp_table_t, path, OC_TABLE_TEXT, "path", 112),
+  OC_TABLE_FIELD(oc_group_rp_table_t, url, OC_TABLE_TEXT, "url", 10),
+  OC_TABLE_ARRAY(oc_group_rp_table_t, ga, ga_len, OC_TABLE_UINT32_ARRAY, "ga",
+                 7),
+};
+#define RP_NUM_FIELDS (sizeof(rp_fields) / sizeof(rp_fields[0]))
+
 // -----------------------------------------------------------------------------
 
 static void oc_print_group_rp_table_entry(int entry, char *Store,
@@ -119,6 +173,7 @@ oc_core_set_group_object_table(int index, oc_group_object_table_t entry)
     OC_ERR("index to large index:%d %d", index,
            oc_core_get_group_object_table_total_size());
   }
+  oc_core_invalidate_group_object_table_index();
   g_got[index].cflags = entry.cflags;
   g_got[index].id = entry.id;
 
@@ -302,54 +357,100 @@ oc_belongs_href_to_resource(oc_string_t href, bool discoverable,
   return false;
 }
 
+/**
+ * @brief the block of a table listing that is being produced
+ *
+ * The listing is produced one entry at a time; the entries in front of the
+ * block are produced only to count their length.
+ */
+typedef struct oc_fp_listing_block_t
+{
+  uint32_t pos;      /**< offset of the next entry in the listing */
+  uint32_t offset;   /**< offset of the block in the listing */
+  uint8_t *block;    /**< the block */
+  size_t block_size; /**< size of the block */
+  size_t block_len;  /**< bytes written to the block */
+  bool more;         /**< the listing continues after the block */
+} oc_fp_listing_block_t;
+
+static void
+oc_fp_listing_add(oc_fp_listing_block_t *b, const char *text, size_t len)
+{
+  uint32_t end = b->offset + (uint32_t)b->block_size;
+  if (b->pos + len > end) {
+    b->more = true;
+  }
+  if (b->pos < end && b->pos + len > b->offset) {
+    uint32_t from = MAX(b->pos, b->offset);
+    uint32_t to = MIN(b->pos + (uint32_t)len, end);
+    memcpy(b->block + (from - b->offset), text + (from - b->pos), to - from);
+    b->block_len = to - b->offset;
+  }
+  b->pos += (uint32_t)len;
+}
+
+/* example entry: <fp/g/1>;ct=60, entries are separated by ",\n" */
 static void
-oc_core_fp_g_get_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
-                         void *data)
+oc_fp_listing_add_entry(oc_fp_listing_block_t *b, const char *table, int id)
 {
-  (void)data;
-  (void)iface_mask;
-  size_t response_length = 0;
-  int i;
-  int length = 0;
-  PRINT("oc_core_fp_g_get_handler\n");
+  char entry[32];
+  int len = snprintf(entry, sizeof(entry), "%s<fp/%s/%d>;ct=60",
+                     b->pos > 0 ? ",\n" : "", table, id);
+  oc_fp_listing_add(b, entry, (size_t)len);
+}
+
+/* answers the GET requests that the block source does not get: those without
+ * a link-format Accept option, and all of them without OC_BLOCK_WISE */
+static void
+oc_fp_listing_get(oc_request_t *request, oc_block_source_cb_t source)
+{
+  oc_response_buffer_t *response_buffer = request->response->response_buffer;
 
   /* check if the accept header is link-format */
   if (request->accept != APPLICATION_LINK_FORMAT) {
-    request->response->response_buffer->code =
-      oc_status_code(OC_STATUS_BAD_REQUEST);
+    response_buffer->code = oc_status_code(OC_STATUS_BAD_REQUEST);
     return;
   }
 
-  /* example entry: </fp/g/1>;ct=60   (cbor)*/
-  for (i = 0; i < GOT_MAX_ENTRIES; i++) {
+  bool more = false;
+  int length = source(request->resource, request->query,
+                      (size_t)request->query_len, 0, response_buffer->buffer,
+                      response_buffer->buffer_size, &more, NULL);
+  if (more) {
+    OC_ERR("listing does not fit in %d bytes",
+           (int)response_buffer->buffer_size);
+    oc_send_linkformat_response(request, OC_STATUS_INTERNAL_SERVER_ERROR, 0);
+    return;
+  }
+  oc_send_linkformat_response(request, OC_STATUS_OK, (size_t)length);
+}
 
+static int
+oc_core_fp_g_block_source(oc_resource_t *resource, const char *query,
+                          size_t query_len, uint32_t offset, uint8_t *block,
+                          size_t block_size, bool *more, void *data)
+{
+  (void)resource;
+  (void)query;
+  (void)query_len;
+  (void)data;
+  oc_fp_listing_block_t b = { 0, offset, block, block_size, 0, false };
+  for (int i = 0; i < GOT_MAX_ENTRIES && !b.more; i++) {
     if (g_got[i].ga_len > 0) {
-      // index  in use
-      PRINT("  . adding %d\n", i);
-      if (response_length > 0) {
-        length = oc_rep_add_line_to_buffer(",\n");
-        response_length += length;
-      }
-
-      length = oc_rep_add_line_to_buffer("<fp/g/");
-      response_length += length;
-      char string[10];
-      sprintf((char *)&string, "%d>", g_got[i].id);
-      length = oc_rep_add_line_to_buffer(string);
-      response_length += length;
-
-      length = oc_rep_add_line_to_buffer(";ct=60");
-      response_length += length;
+      oc_fp_listing_add_entry(&b, "g", g_got[i].id);
     }
   }
+  *more = b.more;
+  return (int)b.block_len;
+}
 
-  if (response_length > 0) {
-    oc_send_linkformat_response(request, OC_STATUS_OK, response_length);
-  } else {
-    oc_send_linkformat_response(request, OC_STATUS_OK, 0);
-  }
-
-  PRINT("oc_core_fp_g_get_handler - end\n");
+static void
+oc_core_fp_g_get_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
+                         void *data)
+{
+  (void)data;
+  (void)iface_mask;
+  oc_fp_listing_get(request, oc_core_fp_g_block_source);
 }
 
 static bool
@@ -416,112 +517,58 @@ oc_core_fp_g_post_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
     return;
   }
 
-  /* debugging info */
-  oc_print_rep_as_json(request->request_payload, true);
+  CborParser parser;
+  CborValue rows;
+  if (oc_table_enter_rows(request->_payload, request->_payload_len, &parser,
+                          &rows) != CborNoError) {
+    OC_ERR("  ERROR payload is not an array");
+    oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+    return;
+  }
 
-  int index = -1;
-  int id;
-  oc_rep_t *rep = request->request_payload;
-
-  while (rep != NULL) {
-    switch (rep->type) {
-    case OC_REP_OBJECT: {
-
-      // find id and the storage index for this object
-      oc_rep_t *object = rep->value.object;
-      id = oc_table_find_id_from_rep(object);
-      if (id == -1) {
-        OC_ERR("  ERROR id %d", index);
-        oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
-        return;
-      }
-      index = oc_core_find_index_in_group_object_table_from_id(id);
-      if (index != -1) {
-        // index already in use, so it will be changed
-        return_status = OC_STATUS_CHANGED;
-      } else {
-        // no index, so we will create one
-        return_status = OC_STATUS_CREATED;
-      }
-      index = find_empty_slot_in_group_object_table(id);
-      if (index == -1) {
-        OC_ERR("  ERROR index %d", index);
+  while (!cbor_value_at_end(&rows)) {
+    if (!cbor_value_is_map(&rows)) {
+      if (cbor_value_advance(&rows) != CborNoError) {
         oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
         return;
       }
-      PRINT("  storing at index: %d\n", index);
-      object = rep->value.object;
-      while (object != NULL) {
-        switch (object->type) {
-        case OC_REP_STRING: {
-          if (object->iname == 11) {
-            oc_free_string(&g_got[index].href);
-            oc_new_string(&g_got[index].href, oc_string(object->value.string),
-                          oc_string_len(object->value.string));
-          }
-        } break;
-        case OC_REP_INT: {
-          if (oc_string_len(object->name) == 0 && object->iname == 0) {
-            // id (0)
-            g_got[index].id = (int)object->value.integer;
-          }
-          if (oc_string_len(object->name) == 0 && object->iname == 8) {
-            // cflags (8)
-            g_got[index].cflags = object->value.integer;
-          }
-        } break;
-        case OC_REP_INT_ARRAY: {
-          if (object->iname == 8) {
-            g_got[index].cflags = OC_CFLAG_NONE;
-            int64_t *arr = oc_int_array(object->value.array);
-            for (int i = 0; i < (int)oc_int_array_size(object->value.array);
-                 i++) {
-              if (arr[i] == 1) {
-                g_got[index].cflags += OC_CFLAG_READ;
-              } else if (arr[i] == 2) {
-                g_got[index].cflags += OC_CFLAG_WRITE;
-              } else if (arr[i] == 3) {
-                g_got[index].cflags += OC_CFLAG_TRANSMISSION;
-              } else if (arr[i] == 4) {
-                g_got[index].cflags += OC_CFLAG_UPDATE;
-              } else if (arr[i] == 5) {
-                g_got[index].cflags += OC_CFLAG_INIT;
-              }
-            }
-          }
-          if (object->iname == 7) {
-            int64_t *arr = oc_int_array(object->value.array);
-            int array_size = (int)oc_int_array_size(object->value.array);
-            uint32_t *new_array =
-              (uint32_t *)malloc(array_size * sizeof(uint32_t));
-            if (new_array) {
-              for (int i = 0; i < array_size; i++) {
-                new_array[i] = (uint32_t)arr[i];
-              }
-              if (g_got[index].ga != 0) {
-                free(g_got[index].ga);
-              }
-              g_got[index].ga_len = array_size;
-              g_got[index].ga = new_array;
-            } else {
-              OC_ERR("out of memory");
-              return_status = OC_STATUS_INTERNAL_SERVER_ERROR;
-            }
-          }
-        } break;
-        default:
-          break;
-        } // switch
-
-        object = object->next;
-      } // next object in array
-      status_ok = oc_fp_p_check_and_save(index, device_index, status_ok);
+      continue;
     }
-    default:
-      break;
-    } // object level
-    rep = rep->next;
-  } // top level
+
+    // find id and the storage index for this object
+    int64_t id = -1;
+    if (!oc_table_find_int(&rows, 0, &id) || id < 0 || id > INT_MAX) {
+      OC_ERR("  ERROR id %d", (int)id);
+      oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+      return;
+    }
+    int index = oc_core_find_index_in_group_object_table_from_id((int)id);
+    if (index != -1) {
+      // index already in use, so it will be changed
+      return_status = OC_STATUS_CHANGED;
+    } else {
+      // no index, so we will create one
+      return_status = OC_STATUS_CREATED;
+    }
+    index = find_empty_slot_in_group_object_table((int)id);
+    if (index == -1) {
+      OC_ERR("  ERROR index %d", index);
+      oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+      return;
+    }
+    PRINT("  storing at index: %d\n", index);
+    oc_core_invalidate_group_object_table_index();
+    CborError err =
+      oc_table_decode(&rows, got_fields, GOT_NUM_FIELDS, &g_got[index]);
+    if (err != CborNoError) {
+      OC_ERR("  ERROR decoding index %d: %d", index, err);
+      oc_send_cbor_response(request, err == CborErrorOutOfMemory
+                                       ? OC_STATUS_INTERNAL_SERVER_ERROR
+                                       : OC_STATUS_BAD_REQUEST);
+      return;
+    }
+    status_ok = oc_fp_p_check_and_save(index, device_index, status_ok);
+  }
 
   PRINT("oc_core_fp_g_post_handler status=%d - end\n", (int)status_ok);
   if (status_ok) {
@@ -537,9 +584,12 @@ oc_create_fp_g_resource(int resource_idx, size_t device)
 {
   OC_DBG("oc_create_fp_g_resource\n");
   oc_core_populate_resource(resource_idx, device, "/fp/g", OC_IF_C | OC_IF_B,
-                            APPLICATION_CBOR, OC_DISCOVERABLE,
+                            APPLICATION_CBOR, OC_DISCOVERABLE | OC_RAW_PAYLOAD,
                             oc_core_fp_g_get_handler, 0,
                             oc_core_fp_g_post_handler, 0, 0, 1, "urn:knx:if.c");
+  oc_resource_set_block_source(
+    oc_core_get_resource_by_index(resource_idx, device),
+    APPLICATION_LINK_FORMAT, oc_core_fp_g_block_source, NULL);
 }
 
 static void
@@ -574,14 +624,7 @@ oc_core_fp_g_x_get_handler(oc_request_t *request,
   }
 
   oc_rep_begin_root_object();
-  // id 0
-  oc_rep_i_set_int(root, 0, g_got[index].id);
-  // href- 11
-  oc_rep_i_set_text_string(root, 11, oc_string(g_got[index].href));
-  // ga - 7
-  oc_rep_i_set_int_array(root, 7, g_got[index].ga, g_got[index].ga_len);
-  // cflags 8
-  oc_rep_i_set_int(root, 8, g_got[index].cflags);
+  oc_table_encode(&root_map, got_fields, GOT_NUM_FIELDS, &g_got[index]);
   oc_rep_end_root_object();
   oc_send_cbor_response(request, OC_STATUS_OK);
 
@@ -666,202 +709,150 @@ oc_core_find_publisher_table_url_from_index(int index)
   return g_gpt[index].url;
 }
 
-static void
-oc_core_fp_p_get_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
-                         void *data)
+static int
+oc_core_fp_p_block_source(oc_resource_t *resource, const char *query,
+                          size_t query_len, uint32_t offset, uint8_t *block,
+                          size_t block_size, bool *more, void *data)
 {
+  (void)resource;
+  (void)query;
+  (void)query_len;
   (void)data;
-  (void)iface_mask;
-  size_t response_length = 0;
-  int i;
-  int length = 0;
-  PRINT("oc_core_fp_p_get_handler\n");
-
-  /* check if the accept header is link-format */
-  if (request->accept != APPLICATION_LINK_FORMAT) {
-    request->response->response_buffer->code =
-      oc_status_code(OC_STATUS_BAD_REQUEST);
-    return;
-  }
-  /* example entry: </fp/p/1>;ct=60 */
-  for (i = 0; i < oc_core_get_publisher_table_size(); i++) {
-
+  oc_fp_listing_block_t b = { 0, offset, block, block_size, 0, false };
+  for (int i = 0; i < oc_core_get_publisher_table_size() && !b.more; i++) {
     if (g_gpt[i].ga_len != 0) {
-      // index  in use
-
-      if (response_length > 0) {
-        length = oc_rep_add_line_to_buffer(",\n");
-        response_length += length;
-      }
-
-      length = oc_rep_add_line_to_buffer("<fp/p/");
-      response_length += length;
-      char string[10];
-      sprintf((char *)&string, "%d>", g_gpt[i].id);
-      length = oc_rep_add_line_to_buffer(string);
-      response_length += length;
-
-      length = oc_rep_add_line_to_buffer(";ct=60");
-      response_length += length;
+      oc_fp_listing_add_entry(&b, "p", g_gpt[i].id);
     }
   }
-
-  if (response_length > 0) {
-    oc_send_linkformat_response(request, OC_STATUS_OK, response_length);
-  } else {
-    oc_send_linkformat_response(request, OC_STATUS_OK, 0);
-  }
-
-  PRINT("oc_core_fp_p_get_handler - end\n");
+  *more = b.more;
+  return (int)b.block_len;
 }
 
 static void
-oc_core_fp_p_post_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
-                          void *data)
+oc_core_fp_p_get_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
+                         void *data)
 {
   (void)data;
   (void)iface_mask;
-  oc_status_t return_status = OC_STATUS_BAD_REQUEST;
-
-  PRINT("oc_core_fp_p_post_handler\n");
+  oc_fp_listing_get(request, oc_core_fp_p_block_source);
+}
 
+/* stores the entries of a POST to /fp/p or /fp/r */
+static void
+oc_core_fp_rp_post(oc_request_t *request, char *store,
+                   oc_group_rp_table_t *rp_table, int max_size)
+{
   /* check if the accept header is cbor-format */
   if (request->accept != APPLICATION_CBOR) {
     request->response->response_buffer->code =
       oc_status_code(OC_STATUS_BAD_REQUEST);
     return;
   }
-  oc_print_rep_as_json(request->request_payload, true);
 
-  int index = -1;
-  int id;
-  oc_rep_t *rep = request->request_payload;
-
-  while (rep != NULL) {
-    switch (rep->type) {
-    case OC_REP_OBJECT: {
-      /* find the storage index, e.g. for this object */
-      oc_rep_t *object = rep->value.object;
-      id = oc_table_find_id_from_rep(object);
-      index = oc_core_find_index_in_rp_table_from_id(
-        id, g_gpt, oc_core_get_publisher_table_size());
-      if (index != -1) {
-        // index already in use, so it will be changed
-        return_status = OC_STATUS_CHANGED;
-      } else {
-        // no index, so we will create one
-        return_status = OC_STATUS_CREATED;
-      }
-      index = find_empty_slot_in_rp_table(id, g_gpt,
-                                          oc_core_get_publisher_table_size());
-      if (index == -1) {
-        PRINT("  ERROR index %d\n", index);
+  CborParser parser;
+  CborValue rows;
+  if (oc_table_enter_rows(request->_payload, request->_payload_len, &parser,
+                          &rows) != CborNoError) {
+    OC_ERR("  ERROR payload is not an array");
+    oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+    return;
+  }
+
+  while (!cbor_value_at_end(&rows)) {
+    if (!cbor_value_is_map(&rows)) {
+      if (cbor_value_advance(&rows) != CborNoError) {
         oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
         return;
       }
-      g_gpt[index].id = id;
-
-      object = rep->value.object;
-      while (object != NULL) {
-        switch (object->type) {
-        case OC_REP_INT: {
-          if (object->iname == 12) {
-            g_gpt[index].ia = (int)object->value.integer;
-          }
-          if (object->iname == 13) {
-            g_gpt[index].grpid = (uint32_t)object->value.integer;
-          }
-          if (object->iname == 26) {
-            g_gpt[index].iid = object->value.integer;
-          }
-          if (object->iname == 25) {
-            g_gpt[index].fid = object->value.integer;
-          }
-        } break;
-        case OC_REP_STRING: {
-          if (object->iname == 112) {
-            oc_free_string(&g_gpt[index].path);
-            oc_new_string(&g_gpt[index].path, oc_string(object->value.string),
-                          oc_string_len(object->value.string));
-          }
-          if (object->iname == 10) {
-            oc_free_string(&g_gpt[index].url);
-            oc_new_string(&g_gpt[index].url, oc_string(object->value.string),
-                          oc_string_len(object->value.string));
-          }
-        } break;
-        case OC_REP_INT_ARRAY: {
-          if (object->iname == 7) {
-            // g_got[index].id = object->value.integer;
-            int64_t *arr = oc_int_array(object->value.array);
-            int array_size = (int)oc_int_array_size(object->value.array);
-            uint32_t *new_array =
-              (uint32_t *)malloc(array_size * sizeof(uint32_t));
-            if (new_array) {
-              for (int i = 0; i < array_size; i++) {
-                new_array[i] = (uint32_t)arr[i];
-              }
-              if (g_gpt[index].ga != 0) {
-                free(g_gpt[index].ga);
-              }
-              g_gpt[index].ga_len = array_size;
-              g_gpt[index].ga = new_array;
-            } else {
-              OC_ERR("out of memory");
-              return_status = OC_STATUS_INTERNAL_SERVER_ERROR;
-            }
-          }
-        } break;
-        case OC_REP_NIL:
-          break;
-        default:
-          break;
-        }
-        object = object->next;
-      }
-    } break;
-    case OC_REP_NIL:
-      break;
-    default:
-      break;
+      continue;
     }
 
-    oc_print_group_rp_table_entry(index, GPT_STORE, g_gpt,
-                                  oc_core_get_publisher_table_size());
-    bool do_save = true;
-    if (oc_string_len(g_gpt[index].url) > OC_MAX_URL_LENGTH) {
-      // do_save = false;
-      OC_ERR("  url is longer than %d \n", (int)OC_MAX_URL_LENGTH);
+    // find the storage index, e.g. for this object
+    int64_t id = -1;
+    if (!oc_table_find_int(&rows, 0, &id) || id < 0 || id > INT_MAX) {
+      OC_ERR("  ERROR id %d", (int)id);
+      oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+      return;
     }
-    if (oc_string_len(g_gpt[index].path) > OC_MAX_URL_LENGTH) {
-      // do_save = false;
-      OC_ERR("  path is longer than %d \n", (int)OC_MAX_URL_LENGTH);
+    int index = find_empty_slot_in_rp_table((int)id, rp_table, max_size);
+    if (index == -1) {
+      OC_ERR("  ERROR index %d", index);
+      oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+      return;
     }
-
-    oc_print_group_rp_table_entry(index, GPT_STORE, g_gpt,
-                                  oc_core_get_publisher_table_size());
-    if (do_save) {
-      oc_dump_group_rp_table_entry(index, GPT_STORE, g_gpt,
-                                   oc_core_get_publisher_table_size());
+    PRINT("  storing at %d\n", index);
+    CborError err =
+      oc_table_decode(&rows, rp_fields, RP_NUM_FIELDS, &rp_table[index]);
+    if (err != CborNoError) {
+      OC_ERR("  ERROR decoding index %d: %d", index, err);
+      oc_send_cbor_response(request, err == CborErrorOutOfMemory
+                                       ? OC_STATUS_INTERNAL_SERVER_ERROR
+                                       : OC_STATUS_BAD_REQUEST);
+      return;
     }
 
-    rep = rep->next;
-  };
+    if (oc_string_len(rp_table[index].url) > OC_MAX_URL_LENGTH) {
+      OC_ERR("  url is longer than %d \n", (int)OC_MAX_URL_LENGTH);
+    }
+    if (oc_string_len(rp_table[index].path) > OC_MAX_URL_LENGTH) {
+      OC_ERR("  path is longer than %d \n", (int)OC_MAX_URL_LENGTH);
+    }
+    oc_print_group_rp_table_entry(index, store, rp_table, max_size);
+    oc_dump_group_rp_table_entry(index, store, rp_table, max_size);
+  }
 
   oc_knx_increase_fingerprint();
-  PRINT("oc_core_fp_p_post_handler - end\n");
-  // oc_send_cbor_response(request, OC_STATUS_OK);
   oc_send_cbor_response_no_payload_size(request, OC_STATUS_CHANGED);
 }
 
+static void
+oc_core_fp_p_post_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
+                          void *data)
+{
+  (void)data;
+  (void)iface_mask;
+  PRINT("oc_core_fp_p_post_handler\n");
+  oc_core_fp_rp_post(request, GPT_STORE, g_gpt,
+                     oc_core_get_publisher_table_size());
+  PRINT("oc_core_fp_p_post_handler - end\n");
+}
+
 void
 oc_create_fp_p_resource(int resource_idx, size_t device)
 {
   OC_DBG("oc_create_fp_p_resource\n");
   oc_core_populate_resource(resource_idx, device, "/fp/p", OC_IF_C | OC_IF_B,
-                            APPLICATION_CBOR, OC_DISCOVERABLE,
+                            APPLICATION_CBOR, OC_DISCOVERABLE | OC_RAW_PAYLOAD,
                             oc_core_fp_p_get_handler, 0,
                             oc_core_fp_p_post_handler, 0, 0, 1, "urn:knx:if.c");
+  oc_resource_set_block_source(
+    oc_core_get_resource_by_index(resource_idx, device),
+    APPLICATION_LINK_FORMAT, oc_core_fp_p_block_source, NULL);
+}
+
+/* whether a GET of /fp/p/x returns a field of a publisher table entry:
+ * numbers that are not set (-1, or a grpid of 0) are left out, and the path
+ * is returned with the ia, the url without it */
+static bool
+publisher_field_is_set(const oc_table_field_t *field,
+                       const oc_group_rp_table_t *entry)
+{
+  switch (field->path[0]) {
+  case 12:
+    return entry->ia > -1;
+  case 13:
+    return entry->grpid > 0;
+  case 26:
+    return entry->iid > -1;
+  case 25:
+    return entry->fid > -1;
+  case 112:
+    return entry->ia > -1 && oc_string_len(entry->path) > 0;
+  case 10:
+    return entry->ia <= -1;
+  default:
+    return true;
+  }
 }
 
 static void
@@ -898,39 +889,11 @@ oc_core_fp_p_x_get_handler(oc_request_t *request,
   }
 
   oc_rep_begin_root_object();
-  /* id 0 */
-  oc_rep_i_set_int(root, 0, g_gpt[index].id);
-  /* ia - 12 */
-  if (g_gpt[index].ia > -1) {
-    oc_rep_i_set_int(root, 12, g_gpt[index].ia);
-  }
-  // grpid - 13
-  if (g_gpt[index].grpid > 0) {
-    oc_rep_i_set_int(root, 13, g_gpt[index].grpid);
-  }
-  /* iid - 26 */
-  if (g_gpt[index].iid > -1) {
-    oc_rep_i_set_int(root, 26, g_gpt[index].iid);
-  }
-  /* fid - 25 */
-  if (g_gpt[index].fid > -1) {
-    oc_rep_i_set_int(root, 25, g_gpt[index].fid);
-  }
-
-  /* frame url as ia exist.*/
-  if (g_gpt[index].ia > -1) {
-    if (oc_string_len(g_gpt[index].path) > 0) {
-      /* set the path only if it not empty
-         path- 112 */
-      oc_rep_i_set_text_string(root, 112, oc_string(g_gpt[index].path));
+  for (size_t i = 0; i < RP_NUM_FIELDS; i++) {
+    if (publisher_field_is_set(&rp_fields[i], &g_gpt[index])) {
+      oc_table_encode(&root_map, &rp_fields[i], 1, &g_gpt[index]);
     }
-  } else {
-    /* url -10 */
-    oc_rep_i_set_text_string(root, 10, oc_string(g_gpt[index].url));
   }
-
-  /* ga -7 */
-  oc_rep_i_set_int_array(root, 7, g_gpt[index].ga, g_gpt[index].ga_len);
   oc_rep_end_root_object();
 
   oc_send_cbor_response(request, OC_STATUS_OK);
@@ -989,53 +952,32 @@ oc_create_fp_p_x_resource(int resource_idx, size_t device)
 
 // --------------------------RECIPIENT-----------------------------------------
 
-static void
-oc_core_fp_r_get_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
-                         void *data)
+static int
+oc_core_fp_r_block_source(oc_resource_t *resource, const char *query,
+                          size_t query_len, uint32_t offset, uint8_t *block,
+                          size_t block_size, bool *more, void *data)
 {
+  (void)resource;
+  (void)query;
+  (void)query_len;
   (void)data;
-  (void)iface_mask;
-  size_t response_length = 0;
-  int i;
-  int length = 0;
-  PRINT("oc_core_fp_r_get_handler\n");
-
-  /* check if the accept header is link-format */
-  if (request->accept != APPLICATION_LINK_FORMAT) {
-    request->response->response_buffer->code =
-      oc_status_code(OC_STATUS_BAD_REQUEST);
-    return;
-  }
-  /* example entry: </fp/r/1>;ct=60 (cbor) */
-  for (i = 0; i < GRT_MAX_ENTRIES; i++) {
-
+  oc_fp_listing_block_t b = { 0, offset, block, block_size, 0, false };
+  for (int i = 0; i < GRT_MAX_ENTRIES && !b.more; i++) {
     if (g_grt[i].ga_len != 0) {
-      // index  in use
-
-      if (response_length > 0) {
-        length = oc_rep_add_line_to_buffer(",\n");
-        response_length += length;
-      }
-
-      length = oc_rep_add_line_to_buffer("<fp/r/");
-      response_length += length;
-      char string[10];
-      sprintf((char *)&string, "%d>", g_grt[i].id);
-      length = oc_rep_add_line_to_buffer(string);
-      response_length += length;
-
-      length = oc_rep_add_line_to_buffer(";ct=60");
-      response_length += length;
+      oc_fp_listing_add_entry(&b, "r", g_grt[i].id);
     }
   }
+  *more = b.more;
+  return (int)b.block_len;
+}
 
-  if (response_length > 0) {
-    oc_send_linkformat_response(request, OC_STATUS_OK, response_length);
-  } else {
-    oc_send_linkformat_response(request, OC_STATUS_OK, 0);
-  }
-
-  PRINT("oc_core_fp_r_get_handler - end\n");
+static void
+oc_core_fp_r_get_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
+                         void *data)
+{
+  (void)data;
+  (void)iface_mask;
+  oc_fp_listing_get(request, oc_core_fp_r_block_source);
 }
 
 static void
@@ -1044,139 +986,10 @@ oc_core_fp_r_post_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
 {
   (void)data;
   (void)iface_mask;
-  oc_status_t return_status = OC_STATUS_BAD_REQUEST;
-
-  /* check if the accept header is cbor-format */
-  if (request->accept != APPLICATION_CBOR) {
-    request->response->response_buffer->code =
-      oc_status_code(OC_STATUS_BAD_REQUEST);
-    return;
-  }
-
-  oc_print_rep_as_json(request->request_payload, true);
-
-  int index = -1;
-  int id = -1;
-  oc_rep_t *rep = request->request_payload;
-
-  while (rep != NULL) {
-    switch (rep->type) {
-    case OC_REP_OBJECT: {
-      // find the storage index, e.g. for this object
-      oc_rep_t *object = rep->value.object;
-      id = oc_table_find_id_from_rep(object);
-      if (id == -1) {
-        OC_ERR("  ERROR id %d", index);
-        oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
-        return;
-      }
-      index = oc_core_find_index_in_rp_table_from_id(
-        id, g_grt, oc_core_get_recipient_table_size());
-      if (index != -1) {
-        // index already in use, so it will be changed
-        return_status = OC_STATUS_CHANGED;
-      } else {
-        // no index, so we will create one
-        return_status = OC_STATUS_CREATED;
-      }
-      index = find_empty_slot_in_rp_table(id, g_grt,
-                                          oc_core_get_recipient_table_size());
-      if (index == -1) {
-        OC_ERR("  ERROR index %d", index);
-        oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
-        return;
-      }
-      PRINT("  storing at %d\n", index);
-      g_grt[index].id = id;
-
-      object = rep->value.object;
-      while (object != NULL) {
-        switch (object->type) {
-
-        case OC_REP_INT: {
-          if (object->iname == 12) {
-            g_grt[index].ia = (int)object->value.integer;
-          }
-          if (object->iname == 13) {
-            g_grt[index].grpid = (uint32_t)object->value.integer;
-          }
-          if (object->iname == 26) {
-            g_grt[index].iid = object->value.integer;
-          }
-          if (object->iname == 25) {
-            g_grt[index].fid = object->value.integer;
-          }
-        } break;
-
-        case OC_REP_STRING: {
-          if (object->iname == 112) {
-            oc_free_string(&g_grt[index].path);
-            oc_new_string(&g_grt[index].path, oc_string(object->value.string),
-                          oc_string_len(object->value.string));
-          }
-          if (object->iname == 10) {
-            oc_free_string(&g_grt[index].url);
-            oc_new_string(&g_grt[index].url, oc_string(object->value.string),
-                          oc_string_len(object->value.string));
-          }
-        } break;
-        case OC_REP_INT_ARRAY: {
-          if (object->iname == 7) {
-            // g_got[index].id = object->value.integer;
-            int64_t *arr = oc_int_array(object->value.array);
-            int array_size = (int)oc_int_array_size(object->value.array);
-            uint32_t *new_array =
-              (uint32_t *)malloc(array_size * sizeof(uint32_t));
-            if (new_array) {
-              for (int i = 0; i < array_size; i++) {
-                new_array[i] = (uint32_t)arr[i];
-              }
-              if (g_grt[index].ga != 0) {
-                free(g_grt[index].ga);
-              }
-              g_grt[index].ga_len = array_size;
-              g_grt[index].ga = new_array;
-            } else {
-              OC_ERR("out of memory");
-              return_status = OC_STATUS_INTERNAL_SERVER_ERROR;
-            }
-          }
-        } break;
-        case OC_REP_NIL:
-          break;
-        default:
-          break;
-        }
-        object = object->next;
-      }
-    }
-    case OC_REP_NIL:
-      break;
-    default:
-      break;
-    }
-    bool do_save = true;
-    if (oc_string_len(g_grt[index].url) > OC_MAX_URL_LENGTH) {
-      // do_save = false;
-      OC_ERR("  url is longer than %d \n", (int)OC_MAX_URL_LENGTH);
-    }
-    if (oc_string_len(g_grt[index].path) > OC_MAX_URL_LENGTH) {
-      // do_save = false;
-      OC_ERR("  path is longer than %d \n", (int)OC_MAX_URL_LENGTH);
-    }
-
-    oc_print_group_rp_table_entry(index, GRT_STORE, g_grt, GRT_MAX_ENTRIES);
-    if (do_save) {
-      oc_dump_group_rp_table_entry(index, GRT_STORE, g_grt, GRT_MAX_ENTRIES);
-    }
-    rep = rep->next;
-  };
-
-  oc_knx_increase_fingerprint();
-
+  PRINT("oc_core_fp_r_post_handler\n");
+  oc_core_fp_rp_post(request, GRT_STORE, g_grt,
+                     oc_core_get_recipient_table_size());
   PRINT("oc_core_fp_r_post_handler - end\n");
-  // oc_send_cbor_response(request, OC_STATUS_OK);
-  oc_send_cbor_response_no_payload_size(request, OC_STATUS_CHANGED);
 }
 
 void
@@ -1184,9 +997,12 @@ oc_create_fp_r_resource(int resource_idx, size_t device)
 {
   OC_DBG("oc_create_fp_r_resource\n");
   oc_core_populate_resource(resource_idx, device, "/fp/r", OC_IF_C | OC_IF_B,
-                            APPLICATION_CBOR, OC_DISCOVERABLE,
+                            APPLICATION_CBOR, OC_DISCOVERABLE | OC_RAW_PAYLOAD,
                             oc_core_fp_r_get_handler, 0,
                             oc_core_fp_r_post_handler, 0, 0, 1, "urn:knx:if.c");
+  oc_resource_set_block_source(
+    oc_core_get_resource_by_index(resource_idx, device),
+    APPLICATION_LINK_FORMAT, oc_core_fp_r_block_source, NULL);
 }
 
 static void
@@ -1428,131 +1244,22 @@ oc_print_group_object_table_entry(int entry)
     return;
   }
 
-  PRINT("    id (0)     : %d\n", g_got[entry].id);
-  PRINT("    href (11)  : %s\n", oc_string_checked(g_got[entry].href));
-  PRINT("    cflags (8) : %d string: ", g_got[entry].cflags);
-  oc_print_cflags(g_got[entry].cflags);
-  PRINT("    ga (7)     : [");
-  for (int i = 0; i < g_got[entry].ga_len; i++) {
-    PRINT(" %u", g_got[entry].ga[i]);
-  }
-  PRINT(" ]\n");
+  oc_table_print(got_fields, GOT_NUM_FIELDS, &g_got[entry]);
 }
 
 void
 oc_dump_group_object_table_entry(int entry)
 {
-  char filename[20];
-  snprintf(filename, 20, "%s_%d", GOT_STORE, entry);
-
-  uint8_t *buf = malloc(OC_MAX_APP_DATA_SIZE);
-  if (!buf)
-    return;
-
-  oc_rep_new(buf, OC_MAX_APP_DATA_SIZE);
-  // write the data
-  oc_rep_begin_root_object();
-  // id 0
-  oc_rep_i_set_int(root, 0, g_got[entry].id);
-  // href- 11
-  oc_rep_i_set_text_string(root, 11, oc_string(g_got[entry].href));
-  // ga - 7
-  oc_rep_i_set_int_array(root, 7, g_got[entry].ga, g_got[entry].ga_len);
-
-  // cflags 8 /// this is different than the response on the wire
-  oc_rep_i_set_int(root, 8, g_got[entry].cflags);
-
-  oc_rep_end_root_object();
-
-  int size = oc_rep_get_encoded_payload_size();
-  if (size > 0) {
-    OC_DBG("oc_dump_group_object_table_entry: dumped current state [%s] [%d]: "
-           "size %d",
-           filename, entry, size);
-    long written_size = oc_storage_write(filename, buf, size);
-    if (written_size != (long)size) {
-      PRINT("oc_dump_group_object_table_entry: written %d != %d (towrite)\n",
-            (int)written_size, size);
-    }
-  }
-
-  free(buf);
+  oc_table_dump(GOT_STORE, entry, got_fields, GOT_NUM_FIELDS, &g_got[entry]);
 }
 
-#define GOT_ENTRY_MAX_SIZE (1024)
 void
 oc_load_group_object_table_entry(int entry)
 {
-  long ret = 0;
-  char filename[20];
-  snprintf(filename, 20, "%s_%d", GOT_STORE, entry);
-
-  oc_rep_t *rep, *head;
-
-  uint8_t *buf = malloc(GOT_ENTRY_MAX_SIZE);
-  if (!buf) {
-    return;
-  }
-
-  ret = oc_storage_read(filename, buf, GOT_ENTRY_MAX_SIZE);
-  if (ret > 0) {
-  const size_t rep_size = 8; // TODO: find how many should we set
-  char rep_counts[rep_size];
-  uint8_t rep_mem[rep_size * sizeof(oc_rep_t)];
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), rep_size, rep_counts, rep_mem, 0 };
-
-    oc_rep_set_pool(&rep_objects);
-    int err = oc_parse_rep(buf, ret, &rep);
-    head = rep;
-    if (err == 0) {
-      while (rep != NULL) {
-        switch (rep->type) {
-
-        case OC_REP_INT:
-          if (rep->iname == 0) {
-            g_got[entry].id = (int)rep->value.integer;
-          }
-          if (rep->iname == 8) {
-            g_got[entry].cflags = (int)rep->value.integer;
-          }
-          break;
-        case OC_REP_STRING:
-          if (rep->iname == 11) {
-
-            oc_free_string(&g_got[entry].href);
-            oc_new_string(&g_got[entry].href, oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          break;
-        case OC_REP_INT_ARRAY:
-          if (rep->iname == 7) {
-            int64_t *arr = oc_int_array(rep->value.array);
-            int array_size = (int)oc_int_array_size(rep->value.array);
-            uint32_t *new_array =
-              (uint32_t *)malloc(array_size * sizeof(uint32_t));
-            if ((new_array) && (array_size > 0)) {
-              for (int i = 0; i < array_size; i++) {
-#pragma warning(suppress : 6386)
-                new_array[i] = (uint32_t)arr[i];
-              }
-              if (g_got[entry].ga != 0) {
-                free(g_got[entry].ga);
-              }
-              PRINT("  ga size %d\n", array_size);
-              g_got[entry].ga_len = array_size;
-              g_got[entry].ga = new_array;
-            }
-          }
-          break;
-        default:
-          break;
-        }
-        rep = rep->next;
-      }
-    }
-    oc_free_rep(head);
+  if (oc_table_load(GOT_STORE, entry, got_fields, GOT_NUM_FIELDS,
+                    &g_got[entry])) {
+    oc_core_invalidate_group_object_table_index();
   }
-  free(buf);
 }
 
 void
@@ -1568,10 +1275,10 @@ oc_load_group_object_table()
 void
 oc_free_group_object_table_entry(int entry, bool init)
 {
+  oc_core_invalidate_group_object_table_index();
   g_got[entry].id = -1;
   if (init == false) {
-    oc_free_string(&g_got[entry].href);
-    free(g_got[entry].ga);
+    oc_table_free(got_fields, GOT_NUM_FIELDS, &g_got[entry]);
   }
 
   g_got[entry].ga = NULL;
@@ -1631,78 +1338,15 @@ oc_print_group_rp_table_entry(int entry, char *Store,
     return;
   }
   PRINT("  %s [%d] --> [%d]\n", Store, entry, rp_table[entry].ga_len);
-  PRINT("    id (0)     : %d\n", rp_table[entry].id);
-  PRINT("    ia (12)    : %d\n", rp_table[entry].ia);
-  PRINT("    iid (26)   : %" PRIu64 "\n", rp_table[entry].iid);
-  PRINT("    fid (25)   : %" PRIu64 "\n", rp_table[entry].fid);
-  PRINT("    grpid (13) : %u\n", rp_table[entry].grpid);
-  if (oc_string_len(rp_table[entry].path) > 0) {
-    PRINT("    path (112) : '%s'\n", oc_string_checked(rp_table[entry].path));
-  }
-  if (oc_string_len(rp_table[entry].url) > 0) {
-    PRINT("    url (10)   : '%s'\n", oc_string_checked(rp_table[entry].url));
-  }
-  PRINT("    ga (7)     : [");
-  for (int i = 0; i < rp_table[entry].ga_len; i++) {
-    PRINT(" %u", rp_table[entry].ga[i]);
-  }
-  PRINT(" ]\n");
+  oc_table_print(rp_fields, RP_NUM_FIELDS, &rp_table[entry]);
 }
 
-#define RP_ENTRY_MAX_SIZE (1024)
 static void
 oc_dump_group_rp_table_entry(int entry, char *Store,
                              oc_group_rp_table_t *rp_table, int max_size)
 {
   (void)max_size;
-  char filename[20];
-  snprintf(filename, 20, "%s_%d", Store, entry);
-  // PRINT("oc_dump_group_rp_table_entry %s, fname=%s\n", Store, filename);
-
-  uint8_t *buf = malloc(RP_ENTRY_MAX_SIZE);
-  if (!buf) {
-    PRINT("oc_dump_group_rp_table_entry: no allocated mem\n");
-    return;
-  }
-
-  oc_rep_new(buf, RP_ENTRY_MAX_SIZE);
-  // write the data
-  oc_rep_begin_root_object();
-  // id 0
-  oc_rep_i_set_int(root, 0, rp_table[entry].id);
-  // ia- 12
-  oc_rep_i_set_int(root, 12, rp_table[entry].ia);
-  // iid 26
-  oc_rep_i_set_int(root, 26, rp_table[entry].iid);
-  // fid - 25
-  oc_rep_i_set_int(root, 25, rp_table[entry].fid);
-  // grpid - 13
-  oc_rep_i_set_int(root, 13, rp_table[entry].grpid);
-  // path- 112
-  oc_rep_i_set_text_string(root, 112, oc_string(rp_table[entry].path));
-  // url - 10
-  oc_rep_i_set_text_string(root, 10, oc_string(rp_table[entry].url));
-  // ga - 7
-  oc_rep_i_set_int_array(root, 7, rp_table[entry].ga, rp_table[entry].ga_len);
-
-  // cflags 8 /// this is different than the response on the wire
-  // oc_rep_i_set_int(root, 8, rp_table[entry].cflags);
-
-  oc_rep_end_root_object();
-
-  int size = oc_rep_get_encoded_payload_size();
-  if (size > 0) {
-    OC_DBG("oc_dump_group_rp_table_entry: dumped current state [%s] [%s] [%d]: "
-           "size %d",
-           filename, Store, entry, size);
-    long written_size = oc_storage_write(filename, buf, size);
-    if (written_size != (long)size) {
-      PRINT("oc_dump_group_rp_table_entry: written %d != %d (towrite)\n",
-            (int)written_size, size);
-    }
-  }
-
-  free(buf);
+  oc_table_dump(Store, entry, rp_fields, RP_NUM_FIELDS, &rp_table[entry]);
 }
 
 void
@@ -1710,89 +1354,7 @@ oc_load_group_rp_table_entry(int entry, char *Store,
                              oc_group_rp_table_t *rp_table, int max_size)
 {
   (void)max_size;
-  long ret = 0;
-  char filename[20];
-  snprintf(filename, 20, "%s_%d", Store, entry);
-
-  oc_rep_t *rep, *head;
-
-  uint8_t *buf = malloc(OC_MAX_APP_DATA_SIZE);
-  if (!buf) {
-    return;
-  }
-
-  ret = oc_storage_read(filename, buf, OC_MAX_APP_DATA_SIZE);
-  if (ret > 0) {
-    struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
-    oc_rep_set_pool(&rep_objects);
-    int err = oc_parse_rep(buf, ret, &rep);
-    head = rep;
-    if (err == 0) {
-      while (rep != NULL) {
-        switch (rep->type) {
-
-        case OC_REP_INT:
-          if (rep->iname == 0) {
-            rp_table[entry].id = (int)rep->value.integer;
-          }
-          if (rep->iname == 12) {
-            rp_table[entry].ia = (int)rep->value.integer;
-          }
-          if (rep->iname == 13) {
-            rp_table[entry].grpid = (uint32_t)rep->value.integer;
-          }
-          if (rep->iname == 25) {
-            rp_table[entry].fid = rep->value.integer;
-          }
-          if (rep->iname == 26) {
-            rp_table[entry].iid = rep->value.integer;
-          }
-          break;
-        case OC_REP_STRING:
-          if (rep->iname == 112) {
-            oc_free_string(&rp_table[entry].path);
-            oc_new_string(&rp_table[entry].path, oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 10) {
-            oc_free_string(&rp_table[entry].url);
-            oc_new_string(&rp_table[entry].url, oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          break;
-        case OC_REP_INT_ARRAY:
-          if (rep->iname == 7) {
-            int64_t *arr = oc_int_array(rep->value.array);
-            int array_size = (int)oc_int_array_size(rep->value.array);
-            uint32_t *new_array =
-              (uint32_t *)malloc(array_size * sizeof(uint32_t));
-            if ((new_array != NULL) && (array_size > 0)) {
-              for (int i = 0; i < array_size; i++) {
-#pragma warning(suppress : 6386)
-                new_array[i] = (uint32_t)arr[i];
-              }
-              // assign only when the new array is allocated correctly
-              rp_table[entry].ga_len = array_size;
-            }
-            if (rp_table[entry].ga != 0) {
-              free(rp_table[entry].ga);
-            }
-            PRINT("  ga size %d\n", array_size);
-            // if (rp_table[entry].ga) {
-            //   free(rp_table[entry].ga);
-            // }
-            rp_table[entry].ga = new_array;
-          }
-          break;
-        default:
-          break;
-        }
-        rep = rep->next;
-      }
-    }
-    oc_free_rep(head);
-  }
-  free(buf);
+  oc_table_load(Store, entry, rp_fields, RP_NUM_FIELDS, &rp_table[entry]);
 }
 
 void
@@ -1829,9 +1391,7 @@ oc_free_group_rp_table_entry(int entry, char *Store,
   rp_table[entry].fid = -1;
   rp_table[entry].grpid = 0;
   if (init == false) {
-    oc_free_string(&rp_table[entry].path);
-    oc_free_string(&rp_table[entry].url);
-    free(rp_table[entry].ga);
+    oc_table_free(rp_fields, RP_NUM_FIELDS, &rp_table[entry]);
   }
   rp_table[entry].ga = NULL;
   rp_table[entry].ga_len = 0;
@@ -2102,6 +1662,118 @@ is_in_array(uint32_t value, uint32_t *array, int array_size)
   return false;
 }
 
+static uint32_t
+ga_hash(uint32_t group_address)
+{
+  return oc_hash_bytes((const uint8_t *)&group_address, sizeof(group_address));
+}
+
+void
+oc_core_invalidate_group_object_table_index(void)
+{
+  int i;
+  for (i = 0; i < num_ga_points; i++) {
+    free(ga_points[i].line);
+  }
+  free(ga_points);
+  ga_points = NULL;
+  num_ga_points = 0;
+  oc_hash_index_clear(&ga_points_by_ga);
+  ga_points_valid = false;
+}
+
+/* Index the datapoints of the Group Object Table by group address, in table
+ * order, resolving the href of each entry once. Returns false when the
+ * index cannot be built and the table has to be scanned.
+ */
+static bool
+build_ga_points(size_t device_index)
+{
+  if (ga_points_valid && ga_points_device == device_index) {
+    return true;
+  }
+  oc_core_invalidate_group_object_table_index();
+
+  int total = 0;
+  int index, i;
+  for (index = 0; index < GOT_MAX_ENTRIES; index++) {
+    total += g_got[index].ga_len;
+  }
+  if (total > 0) {
+    ga_points = (oc_ga_point_t *)calloc((size_t)total, sizeof(oc_ga_point_t));
+    if (!ga_points) {
+      return false;
+    }
+  }
+  for (index = 0; index < GOT_MAX_ENTRIES; index++) {
+    if (g_got[index].ga_len <= 0 || g_got[index].ga == NULL) {
+      continue;
+    }
+    oc_resource_t *resource = oc_ri_get_app_resource_by_uri(
+      oc_string(g_got[index].href), oc_string_len(g_got[index].href),
+      device_index);
+    for (i = 0; i < g_got[index].ga_len; i++) {
+      oc_ga_point_t *point = &ga_points[num_ga_points];
+      point->group_address = g_got[index].ga[i];
+      point->resource = resource;
+      if (!oc_hash_index_add(&ga_points_by_ga, point,
+                             ga_hash(point->group_address))) {
+        OC_WRN("group address index full, scanning the table");
+        oc_core_invalidate_group_object_table_index();
+        return false;
+      }
+      num_ga_points++;
+    }
+  }
+  ga_points_device = device_index;
+  ga_points_valid = true;
+  return true;
+}
+
+static bool
+add_ga_points_to_response(oc_request_t *request, size_t device_index,
+                          uint32_t group_address, size_t *response_length,
+                          int matches)
+{
+  bool added = false;
+  uint32_t pos;
+  oc_ga_point_t *point = (oc_ga_point_t *)oc_hash_index_first(
+    &ga_points_by_ga, ga_hash(group_address), &pos);
+  for (; point != NULL; point = (oc_ga_point_t *)oc_hash_index_next(
+                          &ga_points_by_ga, ga_hash(group_address), &pos)) {
+    if (point->group_address != group_address) {
+      continue;
+    }
+    added = true;
+    if (point->resource == NULL) {
+      continue;
+    }
+    if (matches > 0) {
+      *response_length += oc_rep_add_line_to_buffer(",\n");
+    }
+    if (point->line) {
+      *response_length +=
+        oc_rep_add_line_size_to_buffer(point->line, (int)point->line_len);
+    } else {
+      /* frame the line in place once and keep it for the next query */
+      int start = oc_rep_get_encoded_payload_size();
+      oc_add_resource_to_wk(point->resource, request, device_index,
+                            response_length, 0);
+      int end = oc_rep_get_encoded_payload_size();
+      if (start >= 0 && end > start) {
+        point->line = (char *)malloc((size_t)(end - start));
+        if (point->line) {
+          memcpy(point->line, oc_rep_get_encoder_buf() + start,
+                 (size_t)(end - start));
+          point->line_len = (size_t)(end - start);
+        }
+      }
+    }
+    matches++;
+  }
+  return added;
+}
+
 bool
 oc_add_points_in_group_object_table_to_response(oc_request_t *request,
                                                 size_t device_index,
@@ -2118,6 +1790,11 @@ oc_add_points_in_group_object_table_to_response(oc_request_t *request,
 
   PRINT("oc_add_points_in_group_object_table_to_response %d\n", group_address);
 
+  if (build_ga_points(device_index)) {
+    return add_ga_points_to_response(request, device_index, group_address,
+                                     response_length, matches);
+  }
+
   int index;
   for (index = 0; index < GOT_MAX_ENTRIES; index++) {
     if (g_got[index].ga_len > 0) {
@@ -2126,10 +1803,14 @@ oc_add_points_in_group_object_table_to_response(oc_request_t *request,
         // note, not checked if the resource is already there...
         PRINT("oc_add_points_in_group_object_table_to_response [%d] %s\n",
               index, oc_string_checked(g_got[index].href));
-        oc_add_resource_to_wk(oc_ri_get_app_resource_by_uri(
-                                oc_string(g_got[index].href),
-                                oc_string_len(g_got[index].href), device_index),
-                              request, device_index, response_length, matches);
+        if (oc_add_resource_to_wk(oc_ri_get_app_resource_by_uri(
+                                    oc_string(g_got[index].href),
+                                    oc_string_len(g_got[index].href),
+                                    device_index),
+                                  request, device_index, response_length,
+                                  matches)) {
+          matches++;
+        }
         return_value = true;
       }
     }
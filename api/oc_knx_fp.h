@@ -550,6 +550,16 @@ bool oc_add_points_in_group_object_table_to_response(oc_request_t *request,
                                                      size_t *response_length,
                                                      int matches);
 
+/**
+ * @brief drop the group address index used for
+ * .well-known/core?d=urn:knx:g.s.[group-address] discovery
+ *
+ * Called when the Group Object Table changes, and when resources are added
+ * or deleted since the index holds the resources the hrefs resolve to.
+ * The index is rebuilt on the next query.
+ */
+void oc_core_invalidate_group_object_table_index(void);
+
 /**
  * @brief checks if the href (url) belongs to the device
  *
@@ -18,8 +18,10 @@
 #include "oc_ri.h"
 #include "api/oc_knx_gm.h"
 #include "api/oc_knx_fp.h"
+#include "api/oc_knx_table.h"
 #include "oc_discovery.h"
 #include "oc_core_res.h"
+#include <limits.h>
 #include <stdio.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -149,11 +151,41 @@ void oc_load_group_mapping_table_entry(int entry);
 #define GM_STORE_KEY "gm_store_key"
 #define GM_STORE_MCAST "gm_store_mcast"
 
-#define GM_ENTRY_MAX_SIZE (1024)
-
 /** the list of group mappings */
 oc_group_mapping_table_t g_gm_entries[G_GM_MAX_ENTRIES];
 
+/** the fields of a group mapping in storage */
+static const oc_table_field_t gm_fields[] = {
+  OC_TABLE_FIELD(oc_group_mapping_table_t, id, OC_TABLE_INT, "id", 0),
+  OC_TABLE_FIELD(oc_group_mapping_table_t, dataType, OC_TABLE_UINT32,
+                 "dataType", 116),
+  OC_TABLE_ARRAY(oc_group_mapping_table_t, ga, ga_len, OC_TABLE_INT64_ARRAY,
+                 "ga", 7),
+  OC_TABLE_FIELD(oc_group_mapping_table_t, authentication, OC_TABLE_BOOL, "a",
+                 97),
+  OC_TABLE_FIELD(oc_group_mapping_table_t, confidentiality, OC_TABLE_BOOL,
+                 "c", 99),
+  OC_TABLE_FIELD(oc_group_mapping_table_t, groupKey, OC_TABLE_BYTES,
+                 "groupKey", 107),
+};
+#define GM_NUM_FIELDS (sizeof(gm_fields) / sizeof(gm_fields[0]))
+
+/** the fields of a group mapping on the wire, the security under s (115) */
+static const oc_table_field_t gm_post_fields[] = {
+  OC_TABLE_FIELD(oc_group_mapping_table_t, id, OC_TABLE_INT, "id", 0),
+  OC_TABLE_FIELD(oc_group_mapping_table_t, dataType, OC_TABLE_UINT32,
+                 "dataType", 116),
+  OC_TABLE_ARRAY(oc_group_mapping_table_t, ga, ga_len, OC_TABLE_INT64_ARRAY,
+                 "ga", 7),
+  OC_TABLE_NESTED(oc_group_mapping_table_t, groupKey, OC_TABLE_BYTES,
+                  "groupKey", 2, 115, 107),
+  OC_TABLE_NESTED(oc_group_mapping_table_t, authentication, OC_TABLE_BOOL, "a",
+                  3, 115, 28, 97),
+  OC_TABLE_NESTED(oc_group_mapping_table_t, confidentiality, OC_TABLE_BOOL,
+                  "c", 3, 115, 28, 99),
+};
+#define GM_POST_NUM_FIELDS (sizeof(gm_post_fields) / sizeof(gm_post_fields[0]))
+
 // ----------------------------------------------------------------------------
 
 static int
@@ -230,147 +262,21 @@ oc_print_group_mapping_table_entry(int entry)
     return;
   }
 
-  PRINT("    id (0)         : %d\n", g_gm_entries[entry].id);
-  PRINT("    dataType (116) : %d\n", g_gm_entries[entry].dataType);
-  PRINT("    ga (7)        : [");
-  for (int i = 0; i < g_gm_entries[entry].ga_len; i++) {
-    PRINT(" %" PRIu64 "", (uint64_t)g_gm_entries[entry].ga[i]);
-  }
-  PRINT(" ]\n");
-  if (oc_string_len(g_gm_entries[entry].groupKey) > 0) {
-    PRINT("    groupKey        : ");
-    int length = (int)oc_string_len(g_gm_entries[entry].groupKey);
-    char *ms = oc_string(g_gm_entries[entry].groupKey);
-    for (int i = 0; i < length; i++) {
-      PRINT("%02x", (unsigned char)ms[i]);
-    }
-    PRINT("\n");
-    PRINT("    a (97)         : %d\n", g_gm_entries[entry].authentication);
-    PRINT("    c (99)         : %d\n", g_gm_entries[entry].confidentiality);
-  }
+  oc_table_print(gm_fields, GM_NUM_FIELDS, &g_gm_entries[entry]);
 }
 
 void
 oc_dump_group_mapping_table_entry(int entry)
 {
-  char filename[20];
-  snprintf(filename, 20, "%s_%d", GM_STORE, entry);
-
-  uint8_t *buf = malloc(OC_MAX_APP_DATA_SIZE);
-  if (!buf)
-    return;
-
-  oc_rep_new(buf, OC_MAX_APP_DATA_SIZE);
-  // write the data
-  oc_rep_begin_root_object();
-  // id 0
-  oc_rep_i_set_int(root, 0, g_gm_entries[entry].id);
-  // dataType
-  oc_rep_i_set_int(root, 116, g_gm_entries[entry].dataType);
-  // ga - 7
-  oc_rep_i_set_int_array(root, 7, g_gm_entries[entry].ga,
-                         g_gm_entries[entry].ga_len);
-  // security
-  oc_rep_i_set_boolean(root, 97, g_gm_entries[entry].authentication);
-  oc_rep_i_set_boolean(root, 99, g_gm_entries[entry].confidentiality);
-  oc_rep_i_set_byte_string(root, 107, oc_string(g_gm_entries[entry].groupKey),
-                           oc_string_len(g_gm_entries[entry].groupKey));
-
-  oc_rep_end_root_object();
-
-  int size = oc_rep_get_encoded_payload_size();
-  if (size > 0) {
-    OC_DBG("oc_dump_group_mapping_table_entry: dumped current state [%s] [%d]: "
-           "size %d",
-           filename, entry, size);
-    long written_size = oc_storage_write(filename, buf, size);
-    if (written_size != (long)size) {
-      PRINT("oc_dump_group_mapping_table_entry: written %d != %d (towrite)\n",
-            (int)written_size, size);
-    }
-  }
-
-  free(buf);
+  oc_table_dump(GM_STORE, entry, gm_fields, GM_NUM_FIELDS,
+                &g_gm_entries[entry]);
 }
 
 void
 oc_load_group_mapping_table_entry(int entry)
 {
-  long ret = 0;
-  char filename[20];
-  snprintf(filename, 20, "%s_%d", GM_STORE, entry);
-
-  oc_rep_t *rep, *head;
-
-  uint8_t *buf = malloc(GM_ENTRY_MAX_SIZE);
-  if (!buf) {
-    return;
-  }
-
-  ret = oc_storage_read(filename, buf, GM_ENTRY_MAX_SIZE);
-  if (ret > 0) {
-    struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
-    oc_rep_set_pool(&rep_objects);
-    int err = oc_parse_rep(buf, ret, &rep);
-    head = rep;
-    if (err == 0) {
-      while (rep != NULL) {
-        switch (rep->type) {
-        case OC_REP_INT:
-          if (rep->iname == 0) {
-            g_gm_entries[entry].id = (int)rep->value.integer;
-          }
-          if (rep->iname == 116) {
-            g_gm_entries[entry].dataType = (int)rep->value.integer;
-          }
-          break;
-
-        case OC_REP_BYTE_STRING:
-          if (rep->iname == 107) {
-            // g_gm_entries[entry].authentication = (int)rep->value.boolean;
-            oc_free_string(&g_gm_entries[entry].groupKey);
-            oc_new_string(&g_gm_entries[entry].groupKey,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          break;
-        case OC_REP_BOOL:
-          if (rep->iname == 97) {
-            g_gm_entries[entry].authentication = (int)rep->value.boolean;
-          }
-          if (rep->iname == 99) {
-            g_gm_entries[entry].confidentiality = (int)rep->value.boolean;
-          }
-          break;
-        case OC_REP_INT_ARRAY:
-          if (rep->iname == 7) {
-            int64_t *arr = oc_int_array(rep->value.array);
-            int array_size = (int)oc_int_array_size(rep->value.array);
-            uint64_t *new_array =
-              (uint64_t *)malloc(array_size * sizeof(uint64_t));
-            if ((new_array) && (array_size > 0)) {
-              for (int i = 0; i < array_size; i++) {
-#pragma warning(suppress : 6386)
-                new_array[i] = (uint32_t)arr[i];
-              }
-              if (g_gm_entries[entry].ga != 0) {
-                free(g_gm_entries[entry].ga);
-              }
-              PRINT("  ga size %d\n", array_size);
-              g_gm_entries[entry].ga_len = array_size;
-              g_gm_entries[entry].ga = new_array;
-            }
-          }
-          break;
-        default:
-          break;
-        }
-        rep = rep->next;
-      }
-    }
-    oc_free_rep(head);
-  }
-  free(buf);
+  oc_table_load(GM_STORE, entry, gm_fields, GM_NUM_FIELDS,
+                &g_gm_entries[entry]);
 }
 
 void
@@ -474,11 +380,7 @@ oc_core_fp_gm_post_handler(oc_request_t *request,
   (void)data;
   (void)iface_mask;
   size_t response_length = 0;
-  oc_rep_t *object = NULL;
-  oc_rep_t *s_object = NULL;
-  oc_rep_t *sec_object = NULL;
   oc_status_t return_status = OC_STATUS_BAD_REQUEST;
-  int id = -1;
 
   PRINT("oc_core_fp_gm_post_handler\n");
 
@@ -495,128 +397,56 @@ oc_core_fp_gm_post_handler(oc_request_t *request,
     oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
     return;
   }
-  // find the id of the entry
-  oc_rep_t *rep = request->request_payload;
 
-  while (rep != NULL) {
-    switch (rep->type) {
-    case OC_REP_OBJECT: {
-      // find the storage index, e.g. for this object
-      oc_rep_t *object = rep->value.object;
-      id = oc_table_find_id_from_rep(object);
-      if (id == -1) {
-        OC_ERR("  ERROR id %d", id);
+  CborParser parser;
+  CborValue rows;
+  if (oc_table_enter_rows(request->_payload, request->_payload_len, &parser,
+                          &rows) != CborNoError) {
+    OC_ERR("  ERROR payload is not an array");
+    oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+    return;
+  }
+
+  while (!cbor_value_at_end(&rows)) {
+    if (!cbor_value_is_map(&rows)) {
+      if (cbor_value_advance(&rows) != CborNoError) {
         oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
         return;
       }
-      // entry storage
-      oc_group_mapping_table_t my_entry;
-
-      int index = find_group_mapping_index(id);
-      if (index != -1) {
-        PRINT("   entry already exist! \n");
-        return_status = OC_STATUS_CHANGED;
-      } else {
-        index = find_empty_group_mapping_index();
-        if (index == -1) {
-          PRINT("  no space left!\n");
-          oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
-          return;
-        }
-        return_status = OC_STATUS_CREATED;
+      continue;
+    }
+
+    // find the id of the entry
+    int64_t id = -1;
+    if (!oc_table_find_int(&rows, 0, &id) || id < 0 || id > INT_MAX) {
+      OC_ERR("  ERROR id %d", (int)id);
+      oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+      return;
+    }
+
+    int index = find_group_mapping_index((int)id);
+    if (index != -1) {
+      PRINT("   entry already exist! \n");
+      return_status = OC_STATUS_CHANGED;
+    } else {
+      index = find_empty_group_mapping_index();
+      if (index == -1) {
+        PRINT("  no space left!\n");
+        oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+        return;
       }
-      PRINT("  storage index: %d (%d)\n", index, id);
-      g_gm_entries[index].id = id;
-
-      // parse the response
-      object = rep->value.object;
-      while (object != NULL) {
-        if (object->type == OC_REP_INT_ARRAY) {
-          // ga
-          if (object->iname == 7) {
-            int64_t *array = 0;
-            size_t array_size = 0;
-            // not making a deep copy
-            oc_rep_i_get_int_array(object, 7, &array, &array_size);
-            if (array_size > 0) {
-              // make the deep copy
-              if ((g_gm_entries[index].ga_len > 0) &&
-                  (&g_gm_entries[index].ga != NULL)) {
-                int64_t *cur_arr = g_gm_entries[index].ga;
-                if (cur_arr) {
-                  free(cur_arr);
-                }
-                g_gm_entries[index].ga = NULL;
-              }
-              g_gm_entries[index].ga_len = (int)array_size;
-              int64_t *new_array =
-                (int64_t *)malloc(array_size * sizeof(uint64_t));
-              if (new_array) {
-                for (size_t i = 0; i < array_size; i++) {
-                  new_array[i] = array[i];
-                }
-                g_gm_entries[index].ga = new_array;
-              } else {
-                OC_ERR("out of memory");
-                return_status = OC_STATUS_INTERNAL_SERVER_ERROR;
-              }
-            }
-          }
-        } else if (object->type == OC_REP_INT) {
-          if (object->iname == 116) {
-            // dataType (116)
-            PRINT("   dataType %d\n", (int)object->value.integer);
-            g_gm_entries[index].dataType = (int)object->value.integer;
-          }
-        } else if (object->type == OC_REP_OBJECT) {
-          // level of s
-          s_object = object->value.object;
-          int s_object_nr = object->iname;
-          PRINT("  s_object_nr %d\n", s_object_nr);
-          while (s_object) {
-            if (s_object->type == OC_REP_BYTE_STRING) {
-              if (s_object->iname == 107 && s_object_nr == 115) {
-                // groupkey (115(s)::107)
-                oc_free_string(&(g_gm_entries[index].groupKey));
-                oc_new_string(&g_gm_entries[index].groupKey,
-                              oc_string(s_object->value.string),
-                              oc_string_len(s_object->value.string));
-              }
-            } else if (s_object->type == OC_REP_OBJECT) {
-              sec_object = s_object->value.object;
-              if (sec_object == NULL) {
-                continue;
-              }
-              // get the number of the object which was the object in the
-              // s_object.
-              int sec_object_nr = s_object->iname;
-              while (sec_object) {
-                if (sec_object->type == OC_REP_BOOL) {
-                  if (sec_object->iname == 97 && s_object_nr == 115 &&
-                      sec_object_nr == 28) {
-                    // 115:28:97
-                    g_gm_entries[index].authentication =
-                      s_object->value.boolean;
-                  }
-                  if (sec_object->iname == 99 && s_object_nr == 115 &&
-                      sec_object_nr == 28) {
-                    // 115:28:97
-                    g_gm_entries[index].confidentiality =
-                      s_object->value.boolean;
-                  }
-                } /* type */
-
-                sec_object = sec_object->next;
-              }
-            }
-            s_object = s_object->next;
-          }
-        }
-        object = object->next;
-      } // while (inner object)
-    }   // case
-    }   // switch (over all objects)
-    rep = rep->next;
+      return_status = OC_STATUS_CREATED;
+    }
+    PRINT("  storage index: %d (%d)\n", index, (int)id);
+    CborError err = oc_table_decode(&rows, gm_post_fields, GM_POST_NUM_FIELDS,
+                                    &g_gm_entries[index]);
+    if (err != CborNoError) {
+      OC_ERR("  ERROR decoding index %d: %d", index, err);
+      oc_send_cbor_response(request, err == CborErrorOutOfMemory
+                                       ? OC_STATUS_INTERNAL_SERVER_ERROR
+                                       : OC_STATUS_BAD_REQUEST);
+      return;
+    }
   }
 
   for (int i = 0; i < oc_core_get_group_mapping_table_size(); i++) {
@@ -636,8 +466,8 @@ oc_create_fp_gm_resource(int resource_idx, size_t device)
   OC_DBG("oc_create_fp_gm_resource\n");
   oc_core_populate_resource(
     resource_idx, device, "/fp/gm", OC_IF_C | OC_IF_B, APPLICATION_CBOR,
-    OC_DISCOVERABLE, oc_core_fp_gm_get_handler, 0, oc_core_fp_gm_post_handler,
-    0, 0, 1, "urn:knx:if.c");
+    OC_DISCOVERABLE | OC_RAW_PAYLOAD, oc_core_fp_gm_get_handler, 0,
+    oc_core_fp_gm_post_handler, 0, 0, 1, "urn:knx:if.c");
 }
 
 static void
@@ -16,6 +16,7 @@
 
 #include "oc_api.h"
 #include "api/oc_knx_sec.h"
+#include "api/oc_knx_table.h"
 #include "oc_discovery.h"
 #include "oc_core_res.h"
 #include <stdio.h>
@@ -36,6 +37,22 @@ uint64_t g_oscore_osndelay = 0;
 #define G_AT_MAX_ENTRIES 20
 oc_auth_at_t g_at_entries[G_AT_MAX_ENTRIES];
 
+/* the fields of an access token in storage */
+static const oc_table_field_t at_fields[] = {
+  OC_TABLE_FIELD(oc_auth_at_t, id, OC_TABLE_TEXT, "id", 0),
+  OC_TABLE_FIELD(oc_auth_at_t, scope, OC_TABLE_INT, "scope", 9),
+  OC_TABLE_FIELD(oc_auth_at_t, profile, OC_TABLE_INT, "profile", 38),
+  OC_TABLE_FIELD(oc_auth_at_t, osc_id, OC_TABLE_BYTES, "osc:id", 840),
+  OC_TABLE_FIELD(oc_auth_at_t, osc_ms, OC_TABLE_BYTES, "osc:ms", 842),
+  OC_TABLE_FIELD(oc_auth_at_t, osc_alg, OC_TABLE_BYTES, "osc:alg", 844),
+  OC_TABLE_FIELD(oc_auth_at_t, osc_contextid, OC_TABLE_BYTES, "osc:contextid",
+                 846),
+  OC_TABLE_FIELD(oc_auth_at_t, sub, OC_TABLE_TEXT, "sub", 82),
+  OC_TABLE_FIELD(oc_auth_at_t, kid, OC_TABLE_TEXT, "kid", 81),
+  OC_TABLE_ARRAY(oc_auth_at_t, ga, ga_len, OC_TABLE_INT64_ARRAY, "ga", 777),
+};
+#define AT_NUM_FIELDS (sizeof(at_fields) / sizeof(at_fields[0]))
+
 // ----------------------------------------------------------------------------
 
 static void oc_at_dump_entry(size_t device_index, int entry);
@@ -365,40 +382,6 @@ find_index_from_at_string(const char *at, int len_at)
   return -1;
 }
 
-/* finds 0 ==> id */
-static oc_string_t *
-find_access_token_from_payload(oc_rep_t *object)
-{
-  oc_string_t *index = NULL;
-  while (object != NULL) {
-    switch (object->type) {
-    case OC_REP_BYTE_STRING: {
-      if (oc_string_len(object->name) == 0 && object->iname == 0) {
-        index = &object->value.string;
-        PRINT(" find_access_token_from_payload: %s \n",
-              oc_string_checked(*index));
-        return index;
-      }
-    } break;
-    case OC_REP_STRING: {
-      if (oc_string_len(object->name) == 0 && object->iname == 0) {
-        index = &object->value.string;
-        PRINT(" find_access_token_from_payload: %s \n",
-              oc_string_checked(*index));
-        return index;
-      }
-    } break;
-    case OC_REP_NIL:
-      break;
-    default:
-      break;
-    } /* switch */
-    object = object->next;
-  } /* while */
-  PRINT("  find_access_token_from_payload Error \n");
-  return index;
-}
-
 // ----------------------------------------------------------------------------
 
 static void
@@ -443,18 +426,68 @@ oc_core_auth_at_get_handler(oc_request_t *request,
   PRINT("oc_core_auth_at_get_handler - end\n");
 }
 
+/* scope (9): an array of interfaces, or of group addresses */
+static CborError
+decode_at_scope(CborValue *value, void *row)
+{
+  static const oc_table_field_t ga_field =
+    OC_TABLE_ARRAY(oc_auth_at_t, ga, ga_len, OC_TABLE_INT64_ARRAY, "ga", 9);
+  oc_auth_at_t *entry = (oc_auth_at_t *)row;
+  CborValue it;
+  CborError err = cbor_value_enter_container(value, &it);
+  if (err != CborNoError) {
+    return cbor_value_advance(value);
+  }
+  if (cbor_value_is_integer(&it)) {
+    err = oc_table_decode_field(value, &ga_field, row);
+    // always set the group address scope, if there is 1 or more ga entries
+    entry->scope = entry->ga_len > 0 ? OC_IF_G : OC_IF_NONE;
+    return err;
+  }
+
+  oc_interface_mask_t interfaces = OC_IF_NONE;
+  while (err == CborNoError && !cbor_value_at_end(&it)) {
+    char if_str[32];
+    size_t if_len = sizeof(if_str);
+    if (cbor_value_is_text_string(&it) &&
+        cbor_value_copy_text_string(&it, if_str, &if_len, NULL) ==
+          CborNoError) {
+      interfaces |= oc_ri_get_interface_mask(if_str, if_len);
+    }
+    err = cbor_value_advance(&it);
+  }
+  if (err == CborNoError) {
+    err = cbor_value_leave_container(value, &it);
+    entry->scope = interfaces;
+  }
+  return err;
+}
+
+/* the fields of an access token on the wire, cnf (8) holding the kid (3) or
+ * the OSCORE security context (4) */
+static const oc_table_field_t at_post_fields[] = {
+  OC_TABLE_FIELD(oc_auth_at_t, id, OC_TABLE_TEXT, "id", 0),
+  OC_TABLE_CUSTOM_FIELD("scope", 9, decode_at_scope),
+  OC_TABLE_FIELD(oc_auth_at_t, sub, OC_TABLE_TEXT, "sub", 2),
+  OC_TABLE_FIELD(oc_auth_at_t, aud, OC_TABLE_TEXT, "aud", 3),
+  OC_TABLE_FIELD(oc_auth_at_t, profile, OC_TABLE_INT, "profile", 38),
+  OC_TABLE_NESTED(oc_auth_at_t, kid, OC_TABLE_TEXT, "kid", 2, 8, 3),
+  OC_TABLE_NESTED(oc_auth_at_t, osc_id, OC_TABLE_BYTES, "osc:id", 3, 8, 4, 0),
+  OC_TABLE_NESTED(oc_auth_at_t, osc_ms, OC_TABLE_BYTES, "osc:ms", 3, 8, 4, 2),
+  OC_TABLE_NESTED(oc_auth_at_t, osc_alg, OC_TABLE_BYTES, "osc:alg", 3, 8, 4,
+                  4),
+  OC_TABLE_NESTED(oc_auth_at_t, osc_contextid, OC_TABLE_BYTES,
+                  "osc:contextid", 3, 8, 4, 6),
+};
+#define AT_POST_NUM_FIELDS (sizeof(at_post_fields) / sizeof(at_post_fields[0]))
+
 static void
 oc_core_auth_at_post_handler(oc_request_t *request,
                              oc_interface_mask_t iface_mask, void *data)
 {
   (void)data;
   (void)iface_mask;
-  oc_rep_t *rep = NULL;
-  oc_rep_t *object = NULL;
-  oc_rep_t *subobject = NULL;
-  oc_rep_t *oscobject = NULL;
   oc_status_t return_status = OC_STATUS_BAD_REQUEST;
-  int index = -1;
   PRINT("oc_core_auth_at_post_handler\n");
 
   /* check if the accept header is cbor-format */
@@ -464,213 +497,69 @@ oc_core_auth_at_post_handler(oc_request_t *request,
   }
   size_t device_index = request->resource->device;
 
-  /* debugging info */
-  oc_print_rep_as_json(request->request_payload, true);
+  CborParser parser;
+  CborValue rows;
+  if (oc_table_enter_rows(request->_payload, request->_payload_len, &parser,
+                          &rows) != CborNoError) {
+    OC_ERR("  ERROR payload is not an array");
+    oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+    return;
+  }
 
-  rep = request->request_payload;
-  while (rep != NULL) {
-    if (rep->type == OC_REP_OBJECT) {
-      object = rep->value.object;
-      oc_string_t *at = find_access_token_from_payload(object);
-      if (at == NULL) {
-        PRINT("  access token not found!\n");
+  while (!cbor_value_at_end(&rows)) {
+    if (!cbor_value_is_map(&rows)) {
+      if (cbor_value_advance(&rows) != CborNoError) {
         oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
         return;
       }
-      index = find_index_from_at(at);
-      if (index != -1) {
-        PRINT("   entry already exist! \n");
-        return_status = OC_STATUS_CHANGED;
-      } else {
-        index = find_empty_at_index();
-        return_status = OC_STATUS_CREATED;
-        if (index == -1) {
-          PRINT("  no space left!\n");
-          oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
-          return;
-        }
+      continue;
+    }
+
+    /* the access token (0) identifies the entry */
+    CborValue token;
+    oc_auth_at_t at;
+    memset(&at, 0, sizeof(at));
+    if (!oc_table_find_string(&rows, 0, &token) ||
+        oc_table_decode_field(&token, &at_post_fields[0], &at) !=
+          CborNoError) {
+      PRINT("  access token not found!\n");
+      oc_free_string(&at.id);
+      oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+      return;
+    }
+    int index = find_index_from_at(&at.id);
+    if (index != -1) {
+      PRINT("   entry already exist! \n");
+      return_status = OC_STATUS_CHANGED;
+    } else {
+      index = find_empty_at_index();
+      return_status = OC_STATUS_CREATED;
+      if (index == -1) {
+        PRINT("  no space left!\n");
+        oc_free_string(&at.id);
+        oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
+        return;
       }
-      PRINT("  storage index: %d (%s)\n", index, oc_string_checked(*at));
-      oc_free_string(&(g_at_entries[index].id));
-      oc_new_string(&g_at_entries[index].id, oc_string(*at),
-                    oc_string_len(*at));
-
-      object = rep->value.object;
-      while (object != NULL) {
-        if (object->type == OC_REP_STRING_ARRAY) {
-          // scope
-          if (object->iname == 9) {
-            // scope: array of interfaces as string
-            oc_string_array_t str_array;
-            size_t str_array_size = 0;
-            oc_interface_mask_t interfaces = OC_IF_NONE;
-            oc_rep_i_get_string_array(object, 9, &str_array, &str_array_size);
-            for (size_t i = 0; i < str_array_size; i++) {
-              char *if_str = oc_string_array_get_item(str_array, i);
-              oc_interface_mask_t if_mask =
-                oc_ri_get_interface_mask(if_str, strlen(if_str));
-              interfaces = interfaces + if_mask;
-            }
-            g_at_entries[index].scope = interfaces;
-          }
-        } else if (object->type == OC_REP_INT_ARRAY) {
-          // scope
-          if (object->iname == 9) {
-            g_at_entries[index].scope = OC_IF_NONE;
-            int64_t *array = 0;
-            size_t array_size = 0;
-            // not making a deep copy
-            oc_rep_i_get_int_array(object, 9, &array, &array_size);
-            if (array_size > 0) {
-              // make the deep copy
-              if ((g_at_entries[index].ga_len > 0) &&
-                  (&g_at_entries[index].ga != NULL)) {
-                // always set the group address scope, if there is 1 or more ga
-                // entries
-                g_at_entries[index].scope = OC_IF_G;
-                int64_t *cur_arr = g_at_entries[index].ga;
-                if (cur_arr) {
-                  free(cur_arr);
-                }
-                g_at_entries[index].ga = NULL;
-              }
-              g_at_entries[index].ga_len = (int)array_size;
-              int64_t *new_array =
-                (int64_t *)malloc(array_size * sizeof(uint64_t));
-              if (new_array) {
-                for (size_t i = 0; i < array_size; i++) {
-                  new_array[i] = array[i];
-                }
-                g_at_entries[index].ga = new_array;
-              } else {
-                OC_ERR("out of memory");
-              }
-            }
-          }
-        } else if (object->type == OC_REP_STRING) {
-          if (object->iname == 2) {
-            // sub
-            oc_free_string(&(g_at_entries[index].sub));
-            oc_new_string(&g_at_entries[index].sub,
-                          oc_string(object->value.string),
-                          oc_string_len(object->value.string));
-          }
-          if (object->iname == 3) {
-            // aud
-            oc_free_string(&(g_at_entries[index].aud));
-            oc_new_string(&g_at_entries[index].aud,
-                          oc_string(object->value.string),
-                          oc_string_len(object->value.string));
-          }
-        } else if (object->type == OC_REP_INT) {
-          if (object->iname == 38) {
-            // profile (38 ("coap_dtls" ==1 or "coap_oscore" == 2))
-            PRINT("   profile %d\n", (int)object->value.integer);
-            g_at_entries[index].profile = (int)object->value.integer;
-          }
-        } else if (object->type == OC_REP_OBJECT) {
-          // level of cnf or sub.
-          subobject = object->value.object;
-          int subobject_nr = object->iname;
-          PRINT("  subobject_nr %d\n", subobject_nr);
-          while (subobject) {
-            if (subobject->type == OC_REP_STRING) {
-              if (subobject->iname == 3 && subobject_nr == 8) {
-                // cnf::kid (8::3)
-                oc_free_string(&(g_at_entries[index].kid));
-                oc_new_string(&g_at_entries[index].kid,
-                              oc_string(subobject->value.string),
-                              oc_string_len(subobject->value.string));
-              }
-            } else if (subobject->type == OC_REP_OBJECT) {
-              oscobject = subobject->value.object;
-              int oscobject_nr = subobject->iname;
-              while (oscobject) {
-                if (oscobject->type == OC_REP_STRING) {
-                  if (oscobject->iname == 0 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::kid (id)
-                    oc_free_string(&(g_at_entries[index].osc_id));
-                    oc_new_string(&g_at_entries[index].osc_id,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                  if (oscobject->iname == 2 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::ms
-                    oc_free_string(&(g_at_entries[index].osc_ms));
-                    oc_new_string(&g_at_entries[index].osc_ms,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                  if (oscobject->iname == 4 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::alg
-                    oc_free_string(&(g_at_entries[index].osc_alg));
-                    oc_new_string(&g_at_entries[index].osc_alg,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                  if (oscobject->iname == 6 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::contextId
-                    oc_free_string(&(g_at_entries[index].osc_contextid));
-                    oc_new_string(&g_at_entries[index].osc_contextid,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                } else if (oscobject->type == OC_REP_BYTE_STRING) {
-                  // byte string, e.g. tolerating 0 in the data
-                  if (oscobject->iname == 0 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::kid (id)
-                    oc_free_string(&(g_at_entries[index].osc_id));
-                    oc_new_string(&g_at_entries[index].osc_id,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                  if (oscobject->iname == 2 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::ms
-                    oc_free_string(&(g_at_entries[index].osc_ms));
-                    oc_new_string(&g_at_entries[index].osc_ms,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                  if (oscobject->iname == 4 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::alg
-                    oc_free_string(&(g_at_entries[index].osc_alg));
-                    oc_new_string(&g_at_entries[index].osc_alg,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                  if (oscobject->iname == 6 && subobject_nr == 8 &&
-                      oscobject_nr == 4) {
-                    // cnf::osc::contextId
-                    oc_free_string(&(g_at_entries[index].osc_contextid));
-                    oc_new_string(&g_at_entries[index].osc_contextid,
-                                  oc_string(oscobject->value.string),
-                                  oc_string_len(oscobject->value.string));
-                  }
-                } /* type */
-
-                oscobject = oscobject->next;
-              }
-            }
-            subobject = subobject->next;
-          }
-        }
-        object = object->next;
-      } // while (inner object)
-    }   // if type == object
+    }
+    PRINT("  storage index: %d (%s)\n", index, oc_string_checked(at.id));
+    oc_free_string(&at.id);
+
+    CborError err = oc_table_decode(&rows, at_post_fields, AT_POST_NUM_FIELDS,
+                                    &g_at_entries[index]);
+    if (err != CborNoError) {
+      OC_ERR("  ERROR decoding index %d: %d", index, err);
+      oc_send_cbor_response(request, err == CborErrorOutOfMemory
+                                       ? OC_STATUS_INTERNAL_SERVER_ERROR
+                                       : OC_STATUS_BAD_REQUEST);
+      return;
+    }
+
     // show the entry on screen
     oc_print_auth_at_entry(device_index, index);
 
     // dump the entry to persistent storage
     oc_at_dump_entry(device_index, index);
-    rep = rep->next;
-  } // while (rep)
+  }
 
   PRINT("oc_core_auth_at_post_handler - activating oscore context\n");
   // add the oscore contexts by reinitializing all used oscore keys.
@@ -706,7 +595,8 @@ oc_create_auth_at_resource(int resource_idx, size_t device)
 {
   oc_core_populate_resource(resource_idx, device, "/auth/at",
                             OC_IF_B | OC_IF_SEC, APPLICATION_LINK_FORMAT,
-                            OC_DISCOVERABLE, oc_core_auth_at_get_handler, 0,
+                            OC_DISCOVERABLE | OC_RAW_PAYLOAD,
+                            oc_core_auth_at_get_handler, 0,
                             oc_core_auth_at_post_handler,
                             oc_core_auth_at_delete_handler, 1, "dpt.a[n]");
 }
@@ -725,6 +615,21 @@ oc_create_auth_resource(int resource_idx, size_t device)
 
 // ----------------------------------------------------------------------------
 
+/* whether a GET of /auth/at/x returns a field of at_post_fields: the text
+ * strings other than the id are left out when they are empty */
+static bool
+at_field_is_set(const oc_table_field_t *field, const oc_auth_at_t *entry)
+{
+  switch (field->path[0]) {
+  case 2:
+    return oc_string_len(entry->sub) > 0;
+  case 3:
+    return oc_string_len(entry->aud) > 0;
+  default:
+    return true;
+  }
+}
+
 static void
 oc_core_auth_at_x_get_handler(oc_request_t *request,
                               oc_interface_mask_t iface_mask, void *data)
@@ -763,13 +668,11 @@ oc_core_auth_at_x_get_handler(oc_request_t *request,
 
   // return the data
   oc_rep_begin_root_object();
-  // profile : 38
-  oc_rep_i_set_int(root, 38, g_at_entries[index].profile);
-  // id : 0
-  oc_rep_i_set_text_string(root, 0, oc_string(g_at_entries[index].id));
-  // audience : 3
-  if (oc_string_len(g_at_entries[index].aud) > 0) {
-    oc_rep_i_set_text_string(root, 3, oc_string(g_at_entries[index].aud));
+  /* id, sub, aud and profile; the scope and cnf follow */
+  for (size_t i = 0; i < AT_POST_NUM_FIELDS; i++) {
+    if (at_field_is_set(&at_post_fields[i], &g_at_entries[index])) {
+      oc_table_encode(&root_map, &at_post_fields[i], 1, &g_at_entries[index]);
+    }
   }
   // the scope as list of cflags or group object table entries
   int nr_entries = oc_total_interface_in_mask(g_at_entries[index].scope);
@@ -978,58 +881,11 @@ void
 oc_print_auth_at_entry(size_t device_index, int index)
 {
   (void)device_index;
-  // PRINT("  at index: %d\n", index);
-  if (index > -1) {
-    if (oc_string_len(g_at_entries[index].id) > 0) {
-
-      PRINT("  at index: %d\n", index);
-      PRINT("    id (0)        : %s\n",
-            oc_string_checked(g_at_entries[index].id));
-      PRINT("    scope (9)     : %d\n", g_at_entries[index].scope);
-      PRINT("    profile (38)  : %d (%s)\n", g_at_entries[index].profile,
-            oc_at_profile_to_string(g_at_entries[index].profile));
-      if (g_at_entries[index].profile == OC_PROFILE_COAP_DTLS) {
-        if (oc_string_len(g_at_entries[index].sub) > 0) {
-          PRINT("    sub           : %s\n",
-                oc_string_checked(g_at_entries[index].sub));
-        }
-        if (oc_string_len(g_at_entries[index].kid) > 0) {
-          PRINT("    kid           : %s\n",
-                oc_string_checked(g_at_entries[index].kid));
-        }
-      }
-      if (g_at_entries[index].profile == OC_PROFILE_COAP_OSCORE) {
-        if (oc_string_len(g_at_entries[index].osc_id) > 0) {
-          PRINT("    osc:id        : %s\n",
-                oc_string_checked(g_at_entries[index].osc_id));
-        }
-        if (oc_string_len(g_at_entries[index].osc_ms) > 0) {
-          PRINT("    osc:ms        : ");
-          int length = (int)oc_string_len(g_at_entries[index].osc_ms);
-          char *ms = oc_string(g_at_entries[index].osc_ms);
-          for (int i = 0; i < length; i++) {
-            PRINT("%02x", (unsigned char)ms[i]);
-          }
-          PRINT("\n");
-        }
-        if (oc_string_len(g_at_entries[index].osc_alg) > 0) {
-          PRINT("    osc:alg       : %s\n",
-                oc_string_checked(g_at_entries[index].osc_alg));
-        }
-        if (oc_string_len(g_at_entries[index].osc_contextid) > 0) {
-          PRINT("    osc:contextid : %s\n",
-                oc_string_checked(g_at_entries[index].osc_contextid));
-        }
-        if (g_at_entries[index].ga_len > 0) {
-          PRINT("    osc:ga        : [");
-          for (int i = 0; i < g_at_entries[index].ga_len; i++) {
-            PRINT(" %" PRIu64 "", (uint64_t)g_at_entries[index].ga[i]);
-          }
-          PRINT(" ]\n");
-        }
-      }
-    }
+  if (index < 0 || oc_string_len(g_at_entries[index].id) == 0) {
+    return;
   }
+  PRINT("  at index: %d\n", index);
+  oc_table_print(at_fields, AT_NUM_FIELDS, &g_at_entries[index]);
 }
 
 int
@@ -1078,191 +934,17 @@ oc_at_dump_entry(size_t device_index, int entry)
   (void)entry;
   PRINT("no auth/at storage");
 #else
-  char filename[20];
-
-  snprintf(filename, 20, "%s_%d", AT_STORE, entry);
-  uint8_t *buf = malloc(OC_MAX_APP_DATA_SIZE);
-  if (!buf)
-    return;
-
-  oc_rep_new(buf, OC_MAX_APP_DATA_SIZE);
-  // write the data
-  oc_rep_begin_root_object();
-  // id 0
-  oc_rep_i_set_text_string(root, 0, oc_string(g_at_entries[entry].id));
-  // interface 9 /// this is different than the response on the wire
-  oc_rep_i_set_int(root, 9, g_at_entries[entry].scope);
-  oc_rep_i_set_int(root, 38, g_at_entries[entry].profile);
-
-  oc_rep_i_set_byte_string(root, 840, oc_string(g_at_entries[entry].osc_id),
-                           oc_string_len(g_at_entries[entry].osc_id));
-  oc_rep_i_set_byte_string(root, 842, oc_string(g_at_entries[entry].osc_ms),
-                           oc_string_len(g_at_entries[entry].osc_ms));
-  oc_rep_i_set_byte_string(root, 844, oc_string(g_at_entries[entry].osc_alg),
-                           oc_string_len(g_at_entries[entry].osc_alg));
-  oc_rep_i_set_byte_string(root, 846,
-                           oc_string(g_at_entries[entry].osc_contextid),
-                           oc_string_len(g_at_entries[entry].osc_contextid));
-  oc_rep_i_set_text_string(root, 82, oc_string(g_at_entries[entry].sub));
-  oc_rep_i_set_text_string(root, 81, oc_string(g_at_entries[entry].kid));
-
-  oc_rep_i_set_int_array(root, 777, g_at_entries[entry].ga,
-                         g_at_entries[entry].ga_len);
-
-  oc_rep_end_root_object();
-
-  int size = oc_rep_get_encoded_payload_size();
-  if (size > 0) {
-    OC_DBG("oc_at_dump_entry: dumped current state [%s] [%d]: "
-           "size %d",
-           filename, entry, size);
-    long written_size = oc_storage_write(filename, buf, size);
-    if (written_size != (long)size) {
-      PRINT("oc_at_dump_entry: [%s] written %d != %d (towrite)\n", filename,
-            (int)written_size, size);
-    }
-  }
-  free(buf);
+  // the scope (9) is stored as interface mask, not as on the wire
+  oc_table_dump(AT_STORE, entry, at_fields, AT_NUM_FIELDS,
+                &g_at_entries[entry]);
 #endif /* OC_USE_STORAGE */
 }
 
 static void
 oc_at_load_entry(int entry)
 {
-  int ret;
-  char filename[20];
-  oc_rep_t *rep, *head;
-  snprintf(filename, 20, "%s_%d", AT_STORE, entry);
-  uint8_t *buf = malloc(OC_MAX_APP_DATA_SIZE);
-  if (!buf)
-    return;
-
-  ret = oc_storage_read(filename, buf, OC_MAX_APP_DATA_SIZE);
-  if (ret > 0) {
-    struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
-    oc_rep_set_pool(&rep_objects);
-    int err = oc_parse_rep(buf, ret, &rep);
-    head = rep;
-    if (err == 0) {
-      while (rep != NULL) {
-        switch (rep->type) {
-
-        case OC_REP_INT:
-          if (rep->iname == 9) {
-            g_at_entries[entry].scope = (int)rep->value.integer;
-          }
-          if (rep->iname == 38) {
-            g_at_entries[entry].profile = (int)rep->value.integer;
-          }
-          break;
-        case OC_REP_STRING:
-          if (rep->iname == 0) {
-            oc_free_string(&g_at_entries[entry].id);
-            oc_new_string(&g_at_entries[entry].id, oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 840) {
-            oc_free_string(&g_at_entries[entry].osc_id);
-            oc_new_string(&g_at_entries[entry].osc_id,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 842) {
-            oc_free_string(&g_at_entries[entry].osc_ms);
-            oc_new_string(&g_at_entries[entry].osc_ms,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 844) {
-            oc_free_string(&g_at_entries[entry].osc_alg);
-            oc_new_string(&g_at_entries[entry].osc_alg,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 846) {
-            oc_free_string(&g_at_entries[entry].osc_contextid);
-            oc_new_string(&g_at_entries[entry].osc_contextid,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 82) {
-            oc_free_string(&g_at_entries[entry].sub);
-            oc_new_string(&g_at_entries[entry].sub,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 81) {
-            oc_free_string(&g_at_entries[entry].kid);
-            oc_new_string(&g_at_entries[entry].kid,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          break;
-        case OC_REP_BYTE_STRING:
-          if (rep->iname == 840) {
-            oc_free_string(&g_at_entries[entry].osc_id);
-            oc_new_string(&g_at_entries[entry].osc_id,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 842) {
-            oc_free_string(&g_at_entries[entry].osc_ms);
-            oc_new_string(&g_at_entries[entry].osc_ms,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 844) {
-            oc_free_string(&g_at_entries[entry].osc_alg);
-            oc_new_string(&g_at_entries[entry].osc_alg,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          if (rep->iname == 846) {
-            oc_free_string(&g_at_entries[entry].osc_contextid);
-            oc_new_string(&g_at_entries[entry].osc_contextid,
-                          oc_string(rep->value.string),
-                          oc_string_len(rep->value.string));
-          }
-          break;
-        case OC_REP_INT_ARRAY:
-          if (rep->iname == 777) {
-            int64_t *array = oc_int_array(rep->value.array);
-            int array_size = (int)oc_int_array_size(rep->value.array);
-
-            if (array_size > 0) {
-              // make the deep copy
-              if (g_at_entries[entry].ga_len > 0) {
-                uint64_t *cur_arr = g_at_entries[entry].ga;
-                if (cur_arr) {
-                  free(cur_arr);
-                }
-                g_at_entries[entry].ga = NULL;
-                // free(&g_at_entries[entry].ga);
-              }
-              g_at_entries[entry].ga_len = array_size;
-              int64_t *new_array =
-                (int64_t *)malloc(array_size * sizeof(uint64_t));
-
-              if (new_array) {
-                for (int i = 0; i < array_size; i++) {
-                  new_array[i] = array[i];
-                }
-                g_at_entries[entry].ga = new_array;
-              } else {
-                OC_ERR("out of memory");
-              }
-            }
-          }
-          break;
-        default:
-          break;
-        }
-        rep = rep->next;
-      }
-    }
-    oc_free_rep(head);
-  }
-  free(buf);
+  oc_table_load(AT_STORE, entry, at_fields, AT_NUM_FIELDS,
+                &g_at_entries[entry]);
 }
 
 int
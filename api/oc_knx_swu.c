@@ -548,6 +548,39 @@ oc_knx_swu_a_post_handler(oc_request_t *request, oc_interface_mask_t iface_mask,
   oc_send_cbor_response(request, OC_STATUS_BAD_REQUEST);
 }
 
+/* a package sent in blocks is passed to the software update callback block
+ * by block, the PUT handler is called without payload after the last block */
+static bool
+oc_knx_swu_a_block_sink(oc_resource_t *resource, const oc_endpoint_t *origin,
+                        const char *query, size_t query_len, uint32_t offset,
+                        const uint8_t *block, size_t block_len, bool more,
+                        void *data)
+{
+  (void)origin;
+  (void)more;
+  (void)data;
+  /* never accepted, the response is sent from the PUT handler */
+  static oc_separate_response_t s_streamed_response_swu;
+
+  oc_swu_t *my_cb = oc_get_swu_cb();
+  if (!my_cb || !my_cb->cb) {
+    return true;
+  }
+
+  int binary_size = 0;
+  int block_offset = 0;
+  char *value = NULL;
+  if (oc_ri_get_query_value(query, query_len, "po", &value) > 0) {
+    block_offset = atoi(value);
+  }
+  if (oc_ri_get_query_value(query, query_len, "pkgs", &value) > 0) {
+    binary_size = atoi(value);
+  }
+  my_cb->cb(resource->device, &s_streamed_response_swu, binary_size,
+            block_offset + offset, (uint8_t *)block, block_len, my_cb->data);
+  return true;
+}
+
 void
 oc_create_knx_swu_a_resource(int resource_idx, size_t device)
 {
@@ -556,6 +589,9 @@ oc_create_knx_swu_a_resource(int resource_idx, size_t device)
                             APPLICATION_CBOR, OC_DISCOVERABLE, 0,
                             oc_knx_swu_a_put_handler, oc_knx_swu_a_post_handler,
                             0, 1, ":dpt.file");
+  oc_resource_set_block_sink(
+    oc_core_get_resource_by_index(resource_idx, device),
+    oc_knx_swu_a_block_sink, NULL);
 }
 
 static void
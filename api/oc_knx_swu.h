@@ -119,6 +119,10 @@ void oc_swu_set_result(oc_swu_result_t result);
 /**
  * Callback invoked by the stack to set the software
  *
+ * A PUT request that is sent in blocks is passed on block by block, with a
+ * response that is not active. The callback is then called once more without
+ * data, with the active response to the request.
+ *
  * @param[in] device the device index
  * @param[in] response the instance of an internal struct that is used to track
  *                     the state of the separate response
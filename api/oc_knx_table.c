@@ -0,0 +1,573 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "api/oc_knx_table.h"
+#include "api/oc_knx_fp.h"
+#include "oc_rep.h"
+#include "port/oc_connectivity.h"
+#include "port/oc_log.h"
+#include "port/oc_storage.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#define OC_TABLE_FILENAME_SIZE (20)
+
+static void *
+member(void *row, size_t offset)
+{
+  return (uint8_t *)row + offset;
+}
+
+static const void *
+const_member(const void *row, size_t offset)
+{
+  return (const uint8_t *)row + offset;
+}
+
+static const oc_table_field_t *
+find_field(const oc_table_field_t *fields, size_t num_fields, const int *path,
+           uint8_t depth)
+{
+  for (size_t i = 0; i < num_fields; i++) {
+    if (fields[i].depth == depth &&
+        memcmp(fields[i].path, path, depth * sizeof(int)) == 0) {
+      return &fields[i];
+    }
+  }
+  return NULL;
+}
+
+static CborError
+decode_string(CborValue *value, oc_string_t *str)
+{
+  size_t len = 0;
+  CborError err = cbor_value_calculate_string_length(value, &len);
+  if (err != CborNoError) {
+    return err;
+  }
+  oc_free_string(str);
+  memset(str, 0, sizeof(*str));
+  oc_alloc_string(str, len + 1);
+  if (oc_string(*str) == NULL) {
+    return CborErrorOutOfMemory;
+  }
+  size_t copied = len + 1;
+  if (cbor_value_is_text_string(value)) {
+    err = cbor_value_copy_text_string(value, oc_string(*str), &copied, value);
+  } else {
+    err = cbor_value_copy_byte_string(value, (uint8_t *)oc_string(*str),
+                                      &copied, value);
+  }
+  oc_string(*str)[len] = '\0';
+  return err;
+}
+
+/* the number of integers in the array value */
+static CborError
+count_integers(const CborValue *value, int *count)
+{
+  CborValue it;
+  CborError err = cbor_value_enter_container(value, &it);
+  *count = 0;
+  while (err == CborNoError && !cbor_value_at_end(&it)) {
+    if (cbor_value_is_integer(&it)) {
+      (*count)++;
+    }
+    err = cbor_value_advance(&it);
+  }
+  return err;
+}
+
+static CborError
+decode_array(CborValue *value, const oc_table_field_t *field, void *row)
+{
+  int count = 0;
+  CborError err = count_integers(value, &count);
+  if (err != CborNoError) {
+    return err;
+  }
+  size_t size =
+    field->type == OC_TABLE_UINT32_ARRAY ? sizeof(uint32_t) : sizeof(int64_t);
+  void *array = NULL;
+  if (count > 0) {
+    array = malloc(count * size);
+    if (array == NULL) {
+      OC_ERR("out of memory");
+      return CborErrorOutOfMemory;
+    }
+  }
+
+  CborValue it;
+  err = cbor_value_enter_container(value, &it);
+  int i = 0;
+  while (err == CborNoError && !cbor_value_at_end(&it)) {
+    int64_t v = 0;
+    if (cbor_value_is_integer(&it) &&
+        cbor_value_get_int64(&it, &v) == CborNoError) {
+      if (field->type == OC_TABLE_UINT32_ARRAY) {
+        ((uint32_t *)array)[i++] = (uint32_t)v;
+      } else {
+        ((int64_t *)array)[i++] = v;
+      }
+    }
+    err = cbor_value_advance(&it);
+  }
+  if (err == CborNoError) {
+    err = cbor_value_leave_container(value, &it);
+  }
+  if (err != CborNoError) {
+    free(array);
+    return err;
+  }
+
+  void **ptr = (void **)member(row, field->offset);
+  free(*ptr);
+  *ptr = array;
+  *(int *)member(row, field->len_offset) = count;
+  return CborNoError;
+}
+
+static CborError
+decode_cflags(CborValue *value, oc_cflag_mask_t *cflags)
+{
+  if (cbor_value_is_integer(value)) {
+    int64_t v = 0;
+    CborError err = cbor_value_get_int64(value, &v);
+    *cflags = (oc_cflag_mask_t)v;
+    return err | cbor_value_advance(value);
+  }
+  /* on the wire: an array of flag numbers */
+  CborValue it;
+  CborError err = cbor_value_enter_container(value, &it);
+  int mask = OC_CFLAG_NONE;
+  while (err == CborNoError && !cbor_value_at_end(&it)) {
+    int64_t v = 0;
+    if (cbor_value_is_integer(&it) &&
+        cbor_value_get_int64(&it, &v) == CborNoError) {
+      switch (v) {
+      case 1:
+        mask |= OC_CFLAG_READ;
+        break;
+      case 2:
+        mask |= OC_CFLAG_WRITE;
+        break;
+      case 3:
+        mask |= OC_CFLAG_TRANSMISSION;
+        break;
+      case 4:
+        mask |= OC_CFLAG_UPDATE;
+        break;
+      case 5:
+        mask |= OC_CFLAG_INIT;
+        break;
+      default:
+        break;
+      }
+    }
+    err = cbor_value_advance(&it);
+  }
+  if (err == CborNoError) {
+    err = cbor_value_leave_container(value, &it);
+    *cflags = (oc_cflag_mask_t)mask;
+  }
+  return err;
+}
+
+CborError
+oc_table_decode_field(CborValue *value, const oc_table_field_t *field,
+                      void *row)
+{
+  void *p = member(row, field->offset);
+  int64_t v = 0;
+  bool b = false;
+  switch (field->type) {
+  case OC_TABLE_INT:
+  case OC_TABLE_UINT32:
+  case OC_TABLE_INT64:
+    if (!cbor_value_is_integer(value)) {
+      break;
+    }
+    cbor_value_get_int64(value, &v);
+    if (field->type == OC_TABLE_INT) {
+      *(int *)p = (int)v;
+    } else if (field->type == OC_TABLE_UINT32) {
+      *(uint32_t *)p = (uint32_t)v;
+    } else {
+      *(int64_t *)p = v;
+    }
+    break;
+  case OC_TABLE_BOOL:
+    if (cbor_value_is_boolean(value)) {
+      cbor_value_get_boolean(value, &b);
+      *(bool *)p = b;
+    }
+    break;
+  case OC_TABLE_TEXT:
+  case OC_TABLE_BYTES:
+    if (cbor_value_is_text_string(value) || cbor_value_is_byte_string(value)) {
+      return decode_string(value, (oc_string_t *)p);
+    }
+    break;
+  case OC_TABLE_UINT32_ARRAY:
+  case OC_TABLE_INT64_ARRAY:
+    if (cbor_value_is_array(value)) {
+      return decode_array(value, field, row);
+    }
+    break;
+  case OC_TABLE_CFLAGS:
+    if (cbor_value_is_integer(value) || cbor_value_is_array(value)) {
+      return decode_cflags(value, (oc_cflag_mask_t *)p);
+    }
+    break;
+  case OC_TABLE_CUSTOM:
+    return field->decode(value, row);
+  }
+  /* a value of another type is ignored */
+  return cbor_value_advance(value);
+}
+
+static CborError
+decode_map(CborValue *map, const oc_table_field_t *fields, size_t num_fields,
+           void *row, int *path, uint8_t depth)
+{
+  CborValue it;
+  CborError err = cbor_value_enter_container(map, &it);
+  while (err == CborNoError && !cbor_value_at_end(&it)) {
+    int64_t key = -1;
+    if (cbor_value_is_integer(&it)) {
+      cbor_value_get_int64(&it, &key);
+    }
+    err = cbor_value_advance(&it);
+    if (err != CborNoError) {
+      break;
+    }
+    if (key < 0 || key > INT_MAX) {
+      /* e.g. a string key */
+      err = cbor_value_advance(&it);
+      continue;
+    }
+    path[depth] = (int)key;
+    const oc_table_field_t *field =
+      find_field(fields, num_fields, path, depth + 1);
+    if (field) {
+      err = oc_table_decode_field(&it, field, row);
+    } else if (cbor_value_is_map(&it) && depth + 1 < OC_TABLE_MAX_DEPTH) {
+      err = decode_map(&it, fields, num_fields, row, path, depth + 1);
+    } else {
+      err = cbor_value_advance(&it);
+    }
+  }
+  if (err == CborNoError) {
+    err = cbor_value_leave_container(map, &it);
+  }
+  return err;
+}
+
+CborError
+oc_table_decode(CborValue *map, const oc_table_field_t *fields,
+                size_t num_fields, void *row)
+{
+  if (!cbor_value_is_map(map)) {
+    return CborErrorIllegalType;
+  }
+  int path[OC_TABLE_MAX_DEPTH] = { 0 };
+  return decode_map(map, fields, num_fields, row, path, 0);
+}
+
+static bool
+find_key(const CborValue *map, int key, CborValue *value)
+{
+  CborValue it;
+  if (!cbor_value_is_map(map) ||
+      cbor_value_enter_container(map, &it) != CborNoError) {
+    return false;
+  }
+  while (!cbor_value_at_end(&it)) {
+    int64_t k = -1;
+    if (cbor_value_is_integer(&it)) {
+      cbor_value_get_int64(&it, &k);
+    }
+    if (cbor_value_advance(&it) != CborNoError) {
+      return false;
+    }
+    if (k == key) {
+      *value = it;
+      return true;
+    }
+    if (cbor_value_advance(&it) != CborNoError) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool
+oc_table_find_int(const CborValue *map, int key, int64_t *value)
+{
+  CborValue v;
+  return find_key(map, key, &v) && cbor_value_is_integer(&v) &&
+         cbor_value_get_int64(&v, value) == CborNoError;
+}
+
+bool
+oc_table_find_string(const CborValue *map, int key, CborValue *value)
+{
+  return find_key(map, key, value) &&
+         (cbor_value_is_text_string(value) || cbor_value_is_byte_string(value));
+}
+
+CborError
+oc_table_enter_rows(const uint8_t *payload, size_t payload_len,
+                    CborParser *parser, CborValue *rows)
+{
+  CborValue root;
+  CborError err = cbor_parser_init(payload, payload_len, 0, parser, &root);
+  if (err != CborNoError) {
+    return err;
+  }
+  if (!cbor_value_is_array(&root)) {
+    return CborErrorIllegalType;
+  }
+  return cbor_value_enter_container(&root, rows);
+}
+
+void
+oc_table_encode(CborEncoder *map, const oc_table_field_t *fields,
+                size_t num_fields, const void *row)
+{
+  for (size_t i = 0; i < num_fields; i++) {
+    const oc_table_field_t *field = &fields[i];
+    if (field->depth != 1 || field->type == OC_TABLE_CUSTOM) {
+      continue;
+    }
+    const void *p = const_member(row, field->offset);
+    g_err |= cbor_encode_int(map, field->path[0]);
+    switch (field->type) {
+    case OC_TABLE_INT:
+      g_err |= cbor_encode_int(map, *(const int *)p);
+      break;
+    case OC_TABLE_CFLAGS:
+      /* stored as a bitmap, unlike the array on the wire */
+      g_err |= cbor_encode_int(map, *(const oc_cflag_mask_t *)p);
+      break;
+    case OC_TABLE_UINT32:
+      g_err |= cbor_encode_int(map, *(const uint32_t *)p);
+      break;
+    case OC_TABLE_INT64:
+      g_err |= cbor_encode_int(map, *(const int64_t *)p);
+      break;
+    case OC_TABLE_BOOL:
+      g_err |= cbor_encode_boolean(map, *(const bool *)p);
+      break;
+    case OC_TABLE_TEXT: {
+      const oc_string_t *str = (const oc_string_t *)p;
+      const char *text = oc_string(*str) ? oc_string(*str) : "";
+      g_err |= cbor_encode_text_string(map, text, oc_string_len(*str));
+    } break;
+    case OC_TABLE_BYTES: {
+      const oc_string_t *str = (const oc_string_t *)p;
+      g_err |= cbor_encode_byte_string(map, (const uint8_t *)oc_string(*str),
+                                       oc_string_len(*str));
+    } break;
+    case OC_TABLE_UINT32_ARRAY:
+    case OC_TABLE_INT64_ARRAY: {
+      int len = *(const int *)const_member(row, field->len_offset);
+      const void *array = *(void *const *)p;
+      CborEncoder array_encoder;
+      g_err |= cbor_encoder_create_array(map, &array_encoder, len);
+      for (int j = 0; j < len && array; j++) {
+        int64_t v = field->type == OC_TABLE_UINT32_ARRAY
+                      ? ((const uint32_t *)array)[j]
+                      : ((const int64_t *)array)[j];
+        g_err |= cbor_encode_int(&array_encoder, v);
+      }
+      g_err |= cbor_encoder_close_container(map, &array_encoder);
+    } break;
+    case OC_TABLE_CUSTOM:
+      break;
+    }
+  }
+}
+
+void
+oc_table_print(const oc_table_field_t *fields, size_t num_fields,
+               const void *row)
+{
+  for (size_t i = 0; i < num_fields; i++) {
+    const oc_table_field_t *field = &fields[i];
+    const void *p = const_member(row, field->offset);
+    int len = 0;
+    if (field->type == OC_TABLE_CUSTOM) {
+      continue;
+    }
+    if (field->type == OC_TABLE_TEXT || field->type == OC_TABLE_BYTES) {
+      len = (int)oc_string_len(*(const oc_string_t *)p);
+    } else if (field->type == OC_TABLE_UINT32_ARRAY ||
+               field->type == OC_TABLE_INT64_ARRAY) {
+      len = *(const int *)const_member(row, field->len_offset);
+    } else {
+      len = 1;
+    }
+    if (len == 0) {
+      continue;
+    }
+
+    char label[32];
+    int n = snprintf(label, sizeof(label), "%s (%d", field->name,
+                     field->path[0]);
+    for (uint8_t d = 1; d < field->depth && n > 0 && n < (int)sizeof(label);
+         d++) {
+      n += snprintf(label + n, sizeof(label) - n, ":%d", field->path[d]);
+    }
+    if (n > 0 && n < (int)sizeof(label)) {
+      snprintf(label + n, sizeof(label) - n, ")");
+    }
+    PRINT("    %-15s: ", label);
+
+    switch (field->type) {
+    case OC_TABLE_INT:
+      PRINT("%d\n", *(const int *)p);
+      break;
+    case OC_TABLE_CFLAGS:
+      PRINT("%d string: ", *(const oc_cflag_mask_t *)p);
+      oc_print_cflags(*(const oc_cflag_mask_t *)p);
+      break;
+    case OC_TABLE_UINT32:
+      PRINT("%u\n", *(const uint32_t *)p);
+      break;
+    case OC_TABLE_INT64:
+      PRINT("%" PRId64 "\n", *(const int64_t *)p);
+      break;
+    case OC_TABLE_BOOL:
+      PRINT("%d\n", *(const bool *)p);
+      break;
+    case OC_TABLE_TEXT:
+      PRINT("%s\n", oc_string_checked(*(const oc_string_t *)p));
+      break;
+    case OC_TABLE_BYTES: {
+      const oc_string_t *str = (const oc_string_t *)p;
+      const uint8_t *bytes = (const uint8_t *)oc_string(*str);
+      for (int j = 0; j < len; j++) {
+        PRINT("%02x", bytes[j]);
+      }
+      PRINT("\n");
+    } break;
+    case OC_TABLE_UINT32_ARRAY:
+    case OC_TABLE_INT64_ARRAY: {
+      const void *array = *(void *const *)p;
+      PRINT("[");
+      for (int j = 0; j < len && array; j++) {
+        if (field->type == OC_TABLE_UINT32_ARRAY) {
+          PRINT(" %u", ((const uint32_t *)array)[j]);
+        } else {
+          PRINT(" %" PRId64, ((const int64_t *)array)[j]);
+        }
+      }
+      PRINT(" ]\n");
+    } break;
+    case OC_TABLE_CUSTOM:
+      break;
+    }
+  }
+}
+
+void
+oc_table_free(const oc_table_field_t *fields, size_t num_fields, void *row)
+{
+  for (size_t i = 0; i < num_fields; i++) {
+    const oc_table_field_t *field = &fields[i];
+    void *p = member(row, field->offset);
+    switch (field->type) {
+    case OC_TABLE_TEXT:
+    case OC_TABLE_BYTES:
+      oc_free_string((oc_string_t *)p);
+      memset(p, 0, sizeof(oc_string_t));
+      break;
+    case OC_TABLE_UINT32_ARRAY:
+    case OC_TABLE_INT64_ARRAY:
+      free(*(void **)p);
+      *(void **)p = NULL;
+      *(int *)member(row, field->len_offset) = 0;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void
+oc_table_dump(const char *store, int entry, const oc_table_field_t *fields,
+              size_t num_fields, const void *row)
+{
+  char filename[OC_TABLE_FILENAME_SIZE];
+  snprintf(filename, sizeof(filename), "%s_%d", store, entry);
+
+  uint8_t *buf = malloc(OC_MAX_APP_DATA_SIZE);
+  if (!buf) {
+    return;
+  }
+
+  oc_rep_new(buf, OC_MAX_APP_DATA_SIZE);
+  oc_rep_begin_root_object();
+  oc_table_encode(&root_map, fields, num_fields, row);
+  oc_rep_end_root_object();
+
+  int size = oc_rep_get_encoded_payload_size();
+  if (size > 0) {
+    OC_DBG("oc_table_dump: dumped current state [%s]: size %d", filename,
+           size);
+    long written_size = oc_storage_write(filename, buf, size);
+    if (written_size != (long)size) {
+      PRINT("oc_table_dump: [%s] written %d != %d (towrite)\n", filename,
+            (int)written_size, size);
+    }
+  }
+
+  free(buf);
+}
+
+bool
+oc_table_load(const char *store, int entry, const oc_table_field_t *fields,
+              size_t num_fields, void *row)
+{
+  char filename[OC_TABLE_FILENAME_SIZE];
+  snprintf(filename, sizeof(filename), "%s_%d", store, entry);
+
+  uint8_t *buf = malloc(OC_MAX_APP_DATA_SIZE);
+  if (!buf) {
+    return false;
+  }
+
+  bool loaded = false;
+  long ret = oc_storage_read(filename, buf, OC_MAX_APP_DATA_SIZE);
+  if (ret > 0) {
+    CborParser parser;
+    CborValue root;
+    if (cbor_parser_init(buf, (size_t)ret, 0, &parser, &root) ==
+        CborNoError) {
+      loaded = oc_table_decode(&root, fields, num_fields, row) == CborNoError;
+    }
+  }
+
+  free(buf);
+  return loaded;
+}
@@ -0,0 +1,243 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+/**
+ * @brief field descriptors of the KNX tables
+ *
+ * The rows of the tables behind /fp/g, /fp/p, /fp/r, /fp/gm and /auth/at are
+ * C structs that are written as CBOR maps with integer keys, both on the wire
+ * and in persistent storage. Each table describes its row with an array of
+ * field descriptors (key, member offset, type), and the functions here decode,
+ * encode, print and free a row driven by that array.
+ *
+ * Decoding reads straight from TinyCBOR into the row; no oc_rep_t tree is
+ * made. Keys that are not described are skipped.
+ */
+
+#ifndef OC_KNX_TABLE_H
+#define OC_KNX_TABLE_H
+
+#include "deps/tinycbor/src/cbor.h"
+#include "oc_helpers.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Maximum number of keys in the path of a field, e.g. 8:4:2 (cnf:osc:ms).
+ */
+#define OC_TABLE_MAX_DEPTH (3)
+
+/**
+ * @brief type of the member a field is stored in
+ */
+typedef enum {
+  OC_TABLE_INT,          /**< int, or an enum */
+  OC_TABLE_UINT32,       /**< uint32_t */
+  OC_TABLE_INT64,        /**< int64_t */
+  OC_TABLE_BOOL,         /**< bool */
+  OC_TABLE_TEXT,         /**< oc_string_t, encoded as text string */
+  OC_TABLE_BYTES,        /**< oc_string_t, encoded as byte string */
+  OC_TABLE_UINT32_ARRAY, /**< uint32_t * with an int length */
+  OC_TABLE_INT64_ARRAY,  /**< int64_t * with an int length */
+  OC_TABLE_CFLAGS,       /**< oc_cflag_mask_t, an integer or an array of
+                              flag numbers (1 = read ... 5 = init) */
+  OC_TABLE_CUSTOM        /**< decoded by the decode callback of the field */
+} oc_table_field_type_t;
+
+/**
+ * @brief decode callback of an OC_TABLE_CUSTOM field
+ *
+ * @param value the value of the field, to be advanced past it
+ * @param row the row
+ * @return CborNoError on success
+ */
+typedef CborError (*oc_table_decode_cb_t)(CborValue *value, void *row);
+
+/**
+ * @brief descriptor of a field of a table row
+ */
+typedef struct oc_table_field_t
+{
+  const char *name;             /**< name used when printing */
+  int path[OC_TABLE_MAX_DEPTH]; /**< integer keys from the row down */
+  uint8_t depth;                /**< number of keys in path */
+  oc_table_field_type_t type;   /**< type of the member */
+  size_t offset;                /**< offset of the member in the row */
+  size_t len_offset;            /**< offset of the int length of arrays */
+  oc_table_decode_cb_t decode;  /**< decoder of OC_TABLE_CUSTOM fields */
+} oc_table_field_t;
+
+/** field under a single key */
+#define OC_TABLE_FIELD(row_t, member, type, name, key)                         \
+  {                                                                            \
+    name, { key }, 1, type, offsetof(row_t, member), 0, NULL                   \
+  }
+
+/** array field under a single key, with its length in len_member */
+#define OC_TABLE_ARRAY(row_t, member, len_member, type, name, key)             \
+  {                                                                            \
+    name, { key }, 1, type, offsetof(row_t, member),                           \
+      offsetof(row_t, len_member), NULL                                        \
+  }
+
+/** field in a nested map, e.g. OC_TABLE_NESTED(..., 2, 115, 107) */
+#define OC_TABLE_NESTED(row_t, member, type, name, depth, ...)                 \
+  {                                                                            \
+    name, { __VA_ARGS__ }, depth, type, offsetof(row_t, member), 0, NULL       \
+  }
+
+/** field under a single key that is decoded by decode_cb */
+#define OC_TABLE_CUSTOM_FIELD(name, key, decode_cb)                            \
+  {                                                                            \
+    name, { key }, 1, OC_TABLE_CUSTOM, 0, 0, decode_cb                         \
+  }
+
+/**
+ * @brief decode a CBOR map into a row
+ *
+ * The members of the described fields that are in the map are replaced,
+ * the others are left as they are. Strings and arrays are allocated, the
+ * previous ones are freed.
+ *
+ * @param map the map, advanced past it on success
+ * @param fields the fields of the row
+ * @param num_fields the number of fields
+ * @param row the row
+ * @return CborNoError on success, CborErrorOutOfMemory when a string or
+ *         array could not be allocated
+ */
+CborError oc_table_decode(CborValue *map, const oc_table_field_t *fields,
+                          size_t num_fields, void *row);
+
+/**
+ * @brief decode a single value into the member of a field
+ *
+ * A value of another type than the field is skipped. Useful in the decode
+ * callback of an OC_TABLE_CUSTOM field.
+ *
+ * @param value the value, advanced past it
+ * @param field the field
+ * @param row the row
+ * @return CborNoError on success
+ */
+CborError oc_table_decode_field(CborValue *value,
+                                const oc_table_field_t *field, void *row);
+
+/**
+ * @brief find an integer under key in a CBOR map, without decoding the map
+ *
+ * @param map the map
+ * @param key the key
+ * @param value the value found
+ * @return true if the key holds an integer
+ */
+bool oc_table_find_int(const CborValue *map, int key, int64_t *value);
+
+/**
+ * @brief find a text or byte string under key in a CBOR map
+ *
+ * @param map the map
+ * @param key the key
+ * @param value receives the value; not a copy, valid while the map is
+ * @return true if the key holds a string
+ */
+bool oc_table_find_string(const CborValue *map, int key, CborValue *value);
+
+/**
+ * @brief start reading the rows of a request payload, a CBOR array of maps
+ *
+ * @param payload the payload
+ * @param payload_len the size of the payload
+ * @param parser the parser, kept by the caller while the rows are read
+ * @param rows receives the iterator over the rows
+ * @return CborNoError if the payload is an array
+ */
+CborError oc_table_enter_rows(const uint8_t *payload, size_t payload_len,
+                              CborParser *parser, CborValue *rows);
+
+/**
+ * @brief encode the fields of a row into a CBOR map
+ *
+ * Only fields with a single key are encoded. Errors are collected in g_err,
+ * as with the oc_rep_* encoding macros.
+ *
+ * @param map the encoder of the map, e.g. &root_map
+ * @param fields the fields of the row
+ * @param num_fields the number of fields
+ * @param row the row
+ */
+void oc_table_encode(CborEncoder *map, const oc_table_field_t *fields,
+                     size_t num_fields, const void *row);
+
+/**
+ * @brief print the fields of a row, skipping empty strings and arrays
+ *
+ * @param fields the fields of the row
+ * @param num_fields the number of fields
+ * @param row the row
+ */
+void oc_table_print(const oc_table_field_t *fields, size_t num_fields,
+                    const void *row);
+
+/**
+ * @brief free the strings and arrays of a row and zero their lengths
+ *
+ * @param fields the fields of the row
+ * @param num_fields the number of fields
+ * @param row the row
+ */
+void oc_table_free(const oc_table_field_t *fields, size_t num_fields,
+                   void *row);
+
+/**
+ * @brief write a row to persistent storage as "<store>_<entry>"
+ *
+ * @param store the name of the store
+ * @param entry the index of the row
+ * @param fields the fields of the row
+ * @param num_fields the number of fields
+ * @param row the row
+ */
+void oc_table_dump(const char *store, int entry,
+                   const oc_table_field_t *fields, size_t num_fields,
+                   const void *row);
+
+/**
+ * @brief read a row from persistent storage, written by oc_table_dump()
+ *
+ * @param store the name of the store
+ * @param entry the index of the row
+ * @param fields the fields of the row
+ * @param num_fields the number of fields
+ * @param row the row
+ * @return true if the row was read
+ */
+bool oc_table_load(const char *store, int entry,
+                   const oc_table_field_t *fields, size_t num_fields,
+                   void *row);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_KNX_TABLE_H */
@@ -382,13 +382,27 @@ err:
 oc_clock_time_t
 oc_main_poll(void)
 {
+#ifdef OC_EXTERNAL_POLL
+  oc_connectivity_poll();
+#endif /* OC_EXTERNAL_POLL */
   oc_clock_time_t ticks_until_next_event = oc_etimer_request_poll();
   while (oc_process_run()) {
     ticks_until_next_event = oc_etimer_request_poll();
   }
+#ifdef OC_EXTERNAL_POLL
+  oc_connectivity_set_poll_timer(ticks_until_next_event);
+#endif /* OC_EXTERNAL_POLL */
   return ticks_until_next_event;
 }
 
+#ifdef OC_EXTERNAL_POLL
+int
+oc_main_get_poll_fd(void)
+{
+  return oc_connectivity_get_poll_fd();
+}
+#endif /* OC_EXTERNAL_POLL */
+
 void
 oc_main_shutdown(void)
 {
@@ -428,7 +442,10 @@ oc_main_initialized(void)
 void
 _oc_signal_event_loop(void)
 {
-  if (app_callbacks) {
+#ifdef OC_EXTERNAL_POLL
+  oc_connectivity_signal_poll_fd();
+#endif /* OC_EXTERNAL_POLL */
+  if (app_callbacks && app_callbacks->signal_event_loop) {
     app_callbacks->signal_event_loop();
   }
 }
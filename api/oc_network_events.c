@@ -16,6 +16,7 @@
 
 #include "oc_network_events.h"
 #include "oc_buffer.h"
+#include "oc_discovery.h"
 #include "oc_events.h"
 #include "oc_signal_event_loop.h"
 #include "port/oc_connectivity.h"
@@ -32,7 +33,11 @@ oc_process_network_event(void)
   oc_network_event_handler_mutex_lock();
   oc_message_t *message = (oc_message_t *)oc_list_pop(network_events);
   while (message != NULL) {
+    /* release the lock while handing over, dropping a message frees its
+     * payload, which takes the lock again */
+    oc_network_event_handler_mutex_unlock();
     oc_recv_message(message);
+    oc_network_event_handler_mutex_lock();
     message = oc_list_pop(network_events);
   }
 #ifdef OC_NETWORK_MONITOR
@@ -58,8 +63,10 @@ OC_PROCESS_THREAD(oc_network_events, ev, data)
     OC_PROCESS_YIELD();
 #ifdef OC_NETWORK_MONITOR
     if (ev == oc_events[INTERFACE_DOWN]) {
+      oc_discovery_invalidate_views();
       handle_network_interface_event_callback(NETWORK_INTERFACE_DOWN);
     } else if (ev == oc_events[INTERFACE_UP]) {
+      oc_discovery_invalidate_views();
       handle_network_interface_event_callback(NETWORK_INTERFACE_UP);
     }
 #endif /* OC_NETWORK_MONITOR */
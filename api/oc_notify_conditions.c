@@ -0,0 +1,260 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "oc_notify_conditions_internal.h"
+#include "messaging/coap/observe.h"
+#include "oc_config.h"
+#include "port/oc_clock.h"
+#include "port/oc_log.h"
+#include "util/oc_list.h"
+#include "util/oc_memb.h"
+
+#ifdef OC_SERVER
+
+typedef struct oc_notify_conditions_s
+{
+  struct oc_notify_conditions_s *next;
+  oc_resource_t *resource;
+  oc_clock_time_t pmin;
+  oc_clock_time_t pmax;
+  double step;
+  oc_clock_time_t last_sent;
+  double last_value;    /* value reported by the last notification */
+  double pending_value; /* latest value for the deferred notification */
+  bool sent;
+  bool pmax_armed;
+  bool has_last_value;
+  bool pending;
+  bool pending_has_value;
+  oc_notify_stats_t stats;
+} oc_notify_conditions_t;
+
+OC_LIST(conditions_list);
+OC_MEMB(conditions_s, oc_notify_conditions_t, OC_MAX_APP_RESOURCES);
+
+static oc_event_callback_retval_t pmin_elapsed(void *data);
+static oc_event_callback_retval_t pmax_elapsed(void *data);
+
+static oc_notify_conditions_t *
+find_conditions(const oc_resource_t *resource)
+{
+  oc_notify_conditions_t *c =
+    (oc_notify_conditions_t *)oc_list_head(conditions_list);
+  while (c != NULL && c->resource != resource) {
+    c = c->next;
+  }
+  return c;
+}
+
+static oc_clock_time_t
+ms_to_ticks(uint32_t ms)
+{
+  return (oc_clock_time_t)ms * OC_CLOCK_SECOND / 1000;
+}
+
+static void
+arm_pmax(oc_notify_conditions_t *c)
+{
+  if (c->pmax > 0 && !c->pmax_armed) {
+    oc_ri_add_timed_event_callback_ticks(c, pmax_elapsed, c->pmax);
+    c->pmax_armed = true;
+  }
+}
+
+static int
+send_notification(oc_notify_conditions_t *c, const double *value)
+{
+  oc_ri_remove_timed_event_callback(c, pmin_elapsed);
+  oc_ri_remove_timed_event_callback(c, pmax_elapsed);
+  c->pending = false;
+
+  int notified = coap_notify_observers(c->resource, NULL, NULL);
+  c->last_sent = oc_clock_time();
+  c->sent = true;
+  c->stats.sent++;
+  if (value) {
+    c->last_value = *value;
+    c->has_last_value = true;
+  }
+  c->pmax_armed = false;
+  arm_pmax(c);
+  return notified;
+}
+
+static oc_event_callback_retval_t
+pmin_elapsed(void *data)
+{
+  oc_notify_conditions_t *c = (oc_notify_conditions_t *)data;
+  if (c->resource->num_observers > 0) {
+    send_notification(c, c->pending_has_value ? &c->pending_value : NULL);
+  } else {
+    c->pending = false;
+  }
+  return OC_EVENT_DONE;
+}
+
+static oc_event_callback_retval_t
+pmax_elapsed(void *data)
+{
+  oc_notify_conditions_t *c = (oc_notify_conditions_t *)data;
+  c->pmax_armed = false;
+  if (c->resource->num_observers > 0) {
+    /* report the current state; the step baseline stays */
+    send_notification(c, NULL);
+  }
+  return OC_EVENT_DONE;
+}
+
+static bool
+below_step(const oc_notify_conditions_t *c, double value)
+{
+  if (c->step <= 0 || !c->has_last_value) {
+    return false;
+  }
+  double change = value - c->last_value;
+  if (change < 0) {
+    change = -change;
+  }
+  return change < c->step;
+}
+
+int
+oc_notify_conditions_notify(oc_resource_t *resource, const double *value)
+{
+  oc_notify_conditions_t *c = find_conditions(resource);
+  if (!c) {
+    return coap_notify_observers(resource, NULL, NULL);
+  }
+  if (resource->num_observers == 0) {
+    return 0;
+  }
+
+  if (c->pending) {
+    /* coalesce: the deferred notification reports the latest state */
+    c->pending_has_value = (value != NULL);
+    if (value) {
+      c->pending_value = *value;
+    }
+    c->stats.skipped++;
+    return 0;
+  }
+  if (value && below_step(c, *value)) {
+    c->stats.skipped++;
+    return 0;
+  }
+
+  oc_clock_time_t now = oc_clock_time();
+  if (c->sent && now - c->last_sent < c->pmin) {
+    c->pending = true;
+    c->pending_has_value = (value != NULL);
+    if (value) {
+      c->pending_value = *value;
+    }
+    oc_ri_add_timed_event_callback_ticks(c, pmin_elapsed,
+                                         c->last_sent + c->pmin - now);
+    return 0;
+  }
+  return send_notification(c, value);
+}
+
+bool
+oc_resource_set_notify_conditions(oc_resource_t *resource, uint32_t pmin_ms,
+                                  uint32_t pmax_ms, double step)
+{
+  if (resource == NULL) {
+    OC_ERR("oc_resource_set_notify_conditions: resource is NULL");
+    return false;
+  }
+  if (pmax_ms > 0 && pmax_ms < pmin_ms) {
+    OC_ERR("oc_resource_set_notify_conditions: pmax is less than pmin");
+    return false;
+  }
+  if (pmin_ms == 0 && pmax_ms == 0 && step <= 0) {
+    oc_notify_conditions_remove(resource);
+    return true;
+  }
+
+  oc_notify_conditions_t *c = find_conditions(resource);
+  if (!c) {
+    c = (oc_notify_conditions_t *)oc_memb_alloc(&conditions_s);
+    if (!c) {
+      OC_WRN("insufficient memory to add notify conditions");
+      return false;
+    }
+    c->resource = resource;
+    oc_list_add(conditions_list, c);
+  }
+  c->pmin = ms_to_ticks(pmin_ms);
+  c->pmax = ms_to_ticks(pmax_ms);
+  c->step = step;
+  if (c->pmax == 0) {
+    oc_ri_remove_timed_event_callback(c, pmax_elapsed);
+    c->pmax_armed = false;
+  } else if (resource->num_observers > 0) {
+    arm_pmax(c);
+  }
+  return true;
+}
+
+bool
+oc_resource_get_notify_stats(const oc_resource_t *resource,
+                             oc_notify_stats_t *stats)
+{
+  const oc_notify_conditions_t *c = find_conditions(resource);
+  if (!c || !stats) {
+    return false;
+  }
+  *stats = c->stats;
+  return true;
+}
+
+void
+oc_notify_conditions_observed(const oc_resource_t *resource)
+{
+  oc_notify_conditions_t *c = find_conditions(resource);
+  if (c) {
+    arm_pmax(c);
+  }
+}
+
+void
+oc_notify_conditions_remove(const oc_resource_t *resource)
+{
+  oc_notify_conditions_t *c = find_conditions(resource);
+  if (!c) {
+    return;
+  }
+  oc_ri_remove_timed_event_callback(c, pmin_elapsed);
+  oc_ri_remove_timed_event_callback(c, pmax_elapsed);
+  oc_list_remove(conditions_list, c);
+  oc_memb_free(&conditions_s, c);
+}
+
+void
+oc_notify_conditions_free_all(void)
+{
+  oc_notify_conditions_t *c;
+  while ((c = (oc_notify_conditions_t *)oc_list_head(conditions_list)) !=
+         NULL) {
+    oc_notify_conditions_remove(c->resource);
+  }
+}
+
+#else  /* OC_SERVER */
+typedef int dummy_declaration;
+#endif /* !OC_SERVER */
@@ -0,0 +1,71 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef OC_NOTIFY_CONDITIONS_INTERNAL_H
+#define OC_NOTIFY_CONDITIONS_INTERNAL_H
+
+#include "oc_api.h"
+#include "oc_ri.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief notify the observers of a resource, subject to the conditions set
+ * with oc_resource_set_notify_conditions()
+ *
+ * Resources without conditions are notified right away.
+ *
+ * @param resource the resource that changed
+ * @param value the new value to compare against the step condition, NULL if
+ *              the change has no value
+ * @return the number of observers notified now; 0 when the notification was
+ *         skipped or deferred
+ */
+int oc_notify_conditions_notify(oc_resource_t *resource, const double *value);
+
+/**
+ * @brief start the pmax period of a resource that got an observer, so that a
+ * resource that does not change is still reported
+ *
+ * Does nothing when the period is already running.
+ *
+ * @param resource the resource
+ */
+void oc_notify_conditions_observed(const oc_resource_t *resource);
+
+/**
+ * @brief drop the conditions of a resource and cancel its pending
+ * notifications, e.g. when it is deleted
+ *
+ * @param resource the resource
+ */
+void oc_notify_conditions_remove(const oc_resource_t *resource);
+
+/**
+ * @brief drop the conditions of all resources
+ */
+void oc_notify_conditions_free_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_NOTIFY_CONDITIONS_INTERNAL_H */
@@ -19,14 +19,18 @@
 #include "oc_config.h"
 #include "port/oc_assert.h"
 #include "port/oc_log.h"
+#include "util/oc_arena.h"
 #include "util/oc_memb.h"
 
 #include <inttypes.h>
 
-static struct oc_memb *rep_objects;
-static uint8_t *g_buf;
-CborEncoder g_encoder, root_map, links_array;
-CborError g_err;
+static OC_REP_THREAD_LOCAL struct oc_memb *rep_objects;
+/* set while oc_parse_rep_in_arena() or oc_parse_rep_in_place() runs */
+static OC_REP_THREAD_LOCAL oc_arena_t *rep_arena;
+static OC_REP_THREAD_LOCAL bool rep_in_place;
+static OC_REP_THREAD_LOCAL uint8_t *g_buf;
+OC_REP_THREAD_LOCAL CborEncoder g_encoder, root_map, links_array;
+OC_REP_THREAD_LOCAL CborError g_err;
 
 void
 oc_rep_set_pool(struct oc_memb *rep_objects_pool)
@@ -107,13 +111,15 @@ oc_rep_get_encoded_payload_size(void)
 static oc_rep_t *
 _alloc_rep(void)
 {
-  oc_rep_t *rep = oc_memb_alloc(rep_objects);
+  oc_rep_t *rep = rep_arena ? oc_arena_alloc(rep_arena, sizeof(oc_rep_t))
+                            : oc_memb_alloc(rep_objects);
   if (rep != NULL) {
     rep->name.size = 0;
     rep->iname = -1;
   }
 #ifdef OC_DEBUG
-  oc_assert(rep != NULL);
+  /* an exhausted arena is reported to the caller of the parse */
+  oc_assert(rep != NULL || rep_arena != NULL);
 #endif
   return rep;
 }
@@ -175,11 +181,96 @@ oc_free_rep(oc_rep_t *rep)
   the next pointer of the first object.
 */
 
-static void
-oc_parse_single_entity(CborValue *value, oc_rep_t **rep, CborError *err)
+static bool
+rep_alloc_string(oc_string_t *string, size_t size)
+{
+  if (rep_arena) {
+    string->next = NULL;
+    string->ptr = oc_arena_alloc(rep_arena, size);
+    string->size = string->ptr ? size : 0;
+  } else {
+    oc_alloc_string(string, size);
+  }
+  return oc_string(*string) != NULL;
+}
+
+/* Parse a text or byte string value. When parsing in place a string stored
+ * in one piece refers to the payload and is not terminated.
+ */
+static CborError
+rep_parse_string(const CborValue *value, oc_string_t *string)
 {
   size_t len;
+  CborError err = cbor_value_calculate_string_length(value, &len);
+  if (err != CborNoError) {
+    return err;
+  }
+  bool text = cbor_value_is_text_string(value);
+  if (rep_in_place) {
+    const void *chunk = NULL;
+    size_t chunk_len = 0;
+    if (text) {
+      err = cbor_value_get_text_string_chunk(value, (const char **)&chunk,
+                                             &chunk_len, NULL);
+    } else {
+      err = cbor_value_get_byte_string_chunk(value, (const uint8_t **)&chunk,
+                                             &chunk_len, NULL);
+    }
+    if (err == CborNoError && chunk != NULL && chunk_len == len) {
+      string->next = NULL;
+      string->ptr = (void *)chunk;
+      string->size = len + 1;
+      return CborNoError;
+    }
+    /* a string sent in chunks is copied */
+  }
+  len++;
+  if (!rep_alloc_string(string, len)) {
+    return CborErrorOutOfMemory;
+  }
+  if (text) {
+    return cbor_value_copy_text_string(value, oc_string(*string), &len, NULL);
+  }
+  return cbor_value_copy_byte_string(value, oc_cast(*string, uint8_t), &len,
+                                     NULL);
+}
+
+static bool
+rep_new_array(oc_rep_t *cur, oc_rep_value_type_t type, size_t len)
+{
+  oc_array_t *array = &cur->value.array;
+  if (rep_arena) {
+    size_t item_size = sizeof(int64_t);
+    size_t size = len;
+    if (type == OC_REP_DOUBLE) {
+      item_size = sizeof(double);
+    } else if (type == OC_REP_BOOL) {
+      item_size = sizeof(bool);
+    } else if (type == OC_REP_STRING || type == OC_REP_BYTE_STRING) {
+      item_size = 1;
+      size = len * STRING_ARRAY_ITEM_MAX_LEN;
+    }
+    array->next = NULL;
+    array->ptr = oc_arena_alloc(rep_arena, size * item_size);
+    array->size = array->ptr ? size : 0;
+  } else if (type == OC_REP_INT) {
+    oc_new_int_array(array, len);
+  } else if (type == OC_REP_DOUBLE) {
+    oc_new_double_array(array, len);
+  } else if (type == OC_REP_BOOL) {
+    oc_new_bool_array(array, len);
+  } else if (type == OC_REP_STRING) {
+    oc_new_string_array(array, len);
+  } else {
+    oc_new_byte_string_array(array, len);
+  }
+  cur->type = type | OC_REP_ARRAY;
+  return array->ptr != NULL;
+}
 
+static void
+oc_parse_single_entity(CborValue *value, oc_rep_t **rep, CborError *err)
+{
   *rep = _alloc_rep();
   if (*rep == NULL) {
     *err = CborErrorOutOfMemory;
@@ -207,23 +298,11 @@ oc_parse_single_entity(CborValue *value, oc_rep_t **rep, CborError *err)
     cur->type = OC_REP_DOUBLE;
     break;
   case CborByteStringType:
-    *err |= cbor_value_calculate_string_length(value, &len);
-    len++;
-    if (*err != CborNoError || len == 0)
-      return;
-    oc_alloc_string(&cur->value.string, len);
-    *err |= cbor_value_copy_byte_string(
-      value, oc_cast(cur->value.string, uint8_t), &len, NULL);
+    *err |= rep_parse_string(value, &cur->value.string);
     cur->type = OC_REP_BYTE_STRING;
     break;
   case CborTextStringType:
-    *err |= cbor_value_calculate_string_length(value, &len);
-    len++;
-    if (*err != CborNoError || len == 0)
-      return;
-    oc_alloc_string(&cur->value.string, len);
-    *err |= cbor_value_copy_text_string(value, oc_string(cur->value.string),
-                                        &len, NULL);
+    *err |= rep_parse_string(value, &cur->value.string);
     cur->type = OC_REP_STRING;
     break;
   case CborInvalidType:
@@ -261,7 +340,11 @@ oc_parse_rep_value(CborValue *value, oc_rep_t **rep, CborError *err)
     len++;
     if (*err != CborNoError || len == 0)
       return;
-    oc_alloc_string(&cur->name, len);
+    /* keys are always copied, so that they are terminated */
+    if (!rep_alloc_string(&cur->name, len)) {
+      *err = CborErrorOutOfMemory;
+      return;
+    }
     *err |= cbor_value_copy_text_string(value, (char *)oc_string(cur->name),
                                         &len, NULL);
     if (*err != CborNoError)
@@ -299,23 +382,11 @@ get_tagged_value:
     cur->type = OC_REP_DOUBLE;
     break;
   case CborByteStringType:
-    *err |= cbor_value_calculate_string_length(value, &len);
-    len++;
-    if (*err != CborNoError || len == 0)
-      return;
-    oc_alloc_string(&cur->value.string, len);
-    *err |= cbor_value_copy_byte_string(
-      value, oc_cast(cur->value.string, uint8_t), &len, NULL);
+    *err |= rep_parse_string(value, &cur->value.string);
     cur->type = OC_REP_BYTE_STRING;
     break;
   case CborTextStringType:
-    *err |= cbor_value_calculate_string_length(value, &len);
-    len++;
-    if (*err != CborNoError || len == 0)
-      return;
-    oc_alloc_string(&cur->value.string, len);
-    *err |= cbor_value_copy_text_string(value, oc_string(cur->value.string),
-                                        &len, NULL);
+    *err |= rep_parse_string(value, &cur->value.string);
     cur->type = OC_REP_STRING;
     break;
   case CborMapType: {
@@ -351,8 +422,10 @@ get_tagged_value:
       switch (array.type) {
       case CborIntegerType:
         if (k == 0) {
-          oc_new_int_array(&cur->value.array, len);
-          cur->type = OC_REP_INT | OC_REP_ARRAY;
+          if (!rep_new_array(cur, OC_REP_INT, len)) {
+            *err = CborErrorOutOfMemory;
+            return;
+          }
         } else if ((cur->type & OC_REP_INT) != OC_REP_INT) {
           *err |= CborErrorIllegalType;
           return;
@@ -363,8 +436,10 @@ get_tagged_value:
         break;
       case CborDoubleType:
         if (k == 0) {
-          oc_new_double_array(&cur->value.array, len);
-          cur->type = OC_REP_DOUBLE | OC_REP_ARRAY;
+          if (!rep_new_array(cur, OC_REP_DOUBLE, len)) {
+            *err = CborErrorOutOfMemory;
+            return;
+          }
         } else if ((cur->type & OC_REP_DOUBLE) != OC_REP_DOUBLE) {
           *err |= CborErrorIllegalType;
           return;
@@ -375,8 +450,10 @@ get_tagged_value:
         break;
       case CborBooleanType:
         if (k == 0) {
-          oc_new_bool_array(&cur->value.array, len);
-          cur->type = OC_REP_BOOL | OC_REP_ARRAY;
+          if (!rep_new_array(cur, OC_REP_BOOL, len)) {
+            *err = CborErrorOutOfMemory;
+            return;
+          }
         } else if ((cur->type & OC_REP_BOOL) != OC_REP_BOOL) {
           *err |= CborErrorIllegalType;
           return;
@@ -387,8 +464,10 @@ get_tagged_value:
         break;
       case CborByteStringType: {
         if (k == 0) {
-          oc_new_byte_string_array(&cur->value.array, len);
-          cur->type = OC_REP_BYTE_STRING | OC_REP_ARRAY;
+          if (!rep_new_array(cur, OC_REP_BYTE_STRING, len)) {
+            *err = CborErrorOutOfMemory;
+            return;
+          }
         } else if ((cur->type & OC_REP_BYTE_STRING) != OC_REP_BYTE_STRING) {
           *err |= CborErrorIllegalType;
           return;
@@ -408,8 +487,10 @@ get_tagged_value:
       } break;
       case CborTextStringType:
         if (k == 0) {
-          oc_new_string_array(&cur->value.array, len);
-          cur->type = OC_REP_STRING | OC_REP_ARRAY;
+          if (!rep_new_array(cur, OC_REP_STRING, len)) {
+            *err = CborErrorOutOfMemory;
+            return;
+          }
         } else if ((cur->type & OC_REP_STRING) != OC_REP_STRING) {
           *err |= CborErrorIllegalType;
           return;
@@ -536,6 +617,26 @@ oc_parse_rep(const uint8_t *in_payload, int payload_size, oc_rep_t **out_rep)
   return err;
 }
 
+int
+oc_parse_rep_in_arena(const uint8_t *in_payload, int payload_size,
+                      oc_arena_t *arena, oc_rep_t **out_rep)
+{
+  rep_arena = arena;
+  int err = oc_parse_rep(in_payload, payload_size, out_rep);
+  rep_arena = NULL;
+  return err;
+}
+
+int
+oc_parse_rep_in_place(const uint8_t *in_payload, int payload_size,
+                      oc_arena_t *arena, oc_rep_t **out_rep)
+{
+  rep_in_place = true;
+  int err = oc_parse_rep_in_arena(in_payload, payload_size, arena, out_rep);
+  rep_in_place = false;
+  return err;
+}
+
 static bool
 oc_rep_get_value(oc_rep_t *rep, oc_rep_value_type_t type, const char *key,
                  void **value, size_t *size)
@@ -1078,8 +1179,11 @@ oc_rep_to_json_format(oc_rep_t *rep, char *buf, size_t buf_size, int tab_depth,
       break;
     }
     case OC_REP_STRING: {
+      /* a string parsed in place is not terminated */
       num_char_printed =
-        snprintf(buf, buf_size, "\"%s\"", oc_string_checked(rep->value.string));
+        snprintf(buf, buf_size, "\"%.*s\"",
+                 (int)oc_string_len(rep->value.string),
+                 oc_string_checked(rep->value.string));
       OC_JSON_UPDATE_BUFFER_AND_TOTAL;
       break;
     }
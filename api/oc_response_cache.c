@@ -0,0 +1,207 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "oc_response_cache_internal.h"
+#include "oc_config.h"
+#include "port/oc_log.h"
+#include "util/oc_hash_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OC_DYNAMIC_ALLOCATION
+
+typedef struct oc_cached_response_s
+{
+  const oc_resource_t *resource;
+  uint32_t hash;
+  oc_content_format_t accept;
+  char *query;
+  size_t query_len;
+  uint8_t *payload;
+  size_t payload_len;
+  oc_content_format_t content_format;
+  uint32_t max_age;
+  int code;
+  uint32_t last_used;
+} oc_cached_response_t;
+
+static oc_cached_response_t responses[OC_RESPONSE_CACHE_SIZE];
+static uint32_t use_counter;
+
+static uint32_t
+request_hash(const oc_request_t *request)
+{
+  uint32_t hash = oc_hash_bytes((const uint8_t *)&request->resource,
+                                sizeof(request->resource));
+  if (request->query_len > 0) {
+    hash ^= oc_hash_bytes((const uint8_t *)request->query,
+                          (size_t)request->query_len);
+  }
+  return hash ^ oc_hash_u16((uint16_t)request->accept);
+}
+
+static bool
+matches(const oc_cached_response_t *r, const oc_request_t *request,
+        uint32_t hash)
+{
+  return r->resource == request->resource && r->hash == hash &&
+         r->accept == request->accept &&
+         r->query_len == (size_t)request->query_len &&
+         (r->query_len == 0 ||
+          memcmp(r->query, request->query, r->query_len) == 0);
+}
+
+static void
+free_response(oc_cached_response_t *r)
+{
+  free(r->query);
+  free(r->payload);
+  memset(r, 0, sizeof(*r));
+}
+
+bool
+oc_response_cache_lookup(const oc_request_t *request,
+                         oc_response_buffer_t *response_buffer)
+{
+  uint32_t hash = request_hash(request);
+  int i;
+  for (i = 0; i < OC_RESPONSE_CACHE_SIZE; i++) {
+    oc_cached_response_t *r = &responses[i];
+    if (r->resource == NULL || !matches(r, request, hash)) {
+      continue;
+    }
+    if (r->payload_len > response_buffer->buffer_size) {
+      return false;
+    }
+    OC_DBG("oc_response_cache: hit for %s", oc_string(r->resource->uri));
+    if (r->payload_len > 0) {
+      memcpy(response_buffer->buffer, r->payload, r->payload_len);
+    }
+    response_buffer->response_length = r->payload_len;
+    response_buffer->content_format = r->content_format;
+    response_buffer->max_age = r->max_age;
+    response_buffer->code = r->code;
+    r->last_used = ++use_counter;
+    return true;
+  }
+  return false;
+}
+
+void
+oc_response_cache_store(const oc_request_t *request,
+                        const oc_response_buffer_t *response_buffer)
+{
+  uint32_t hash = request_hash(request);
+  oc_cached_response_t *slot = NULL;
+  int i;
+  for (i = 0; i < OC_RESPONSE_CACHE_SIZE; i++) {
+    oc_cached_response_t *r = &responses[i];
+    if (r->resource != NULL && matches(r, request, hash)) {
+      slot = r;
+      break;
+    }
+    if (slot == NULL || (slot->resource != NULL &&
+                         (r->resource == NULL ||
+                          r->last_used < slot->last_used))) {
+      slot = r;
+    }
+  }
+  free_response(slot);
+
+  if (request->query_len > 0) {
+    slot->query = (char *)malloc((size_t)request->query_len);
+    if (!slot->query) {
+      goto error;
+    }
+    memcpy(slot->query, request->query, (size_t)request->query_len);
+    slot->query_len = (size_t)request->query_len;
+  }
+  if (response_buffer->response_length > 0) {
+    slot->payload = (uint8_t *)malloc(response_buffer->response_length);
+    if (!slot->payload) {
+      goto error;
+    }
+    memcpy(slot->payload, response_buffer->buffer,
+           response_buffer->response_length);
+    slot->payload_len = response_buffer->response_length;
+  }
+  slot->resource = request->resource;
+  slot->hash = hash;
+  slot->accept = request->accept;
+  slot->content_format = response_buffer->content_format;
+  slot->max_age = response_buffer->max_age;
+  slot->code = response_buffer->code;
+  slot->last_used = ++use_counter;
+  return;
+
+error:
+  OC_ERR("oc_response_cache: out of memory");
+  free_response(slot);
+}
+
+void
+oc_response_cache_invalidate(const oc_resource_t *resource)
+{
+  int i;
+  for (i = 0; i < OC_RESPONSE_CACHE_SIZE; i++) {
+    if (responses[i].resource == resource) {
+      free_response(&responses[i]);
+    }
+  }
+}
+
+void
+oc_response_cache_clear(void)
+{
+  int i;
+  for (i = 0; i < OC_RESPONSE_CACHE_SIZE; i++) {
+    free_response(&responses[i]);
+  }
+}
+
+#else /* OC_DYNAMIC_ALLOCATION */
+
+bool
+oc_response_cache_lookup(const oc_request_t *request,
+                         oc_response_buffer_t *response_buffer)
+{
+  (void)request;
+  (void)response_buffer;
+  return false;
+}
+
+void
+oc_response_cache_store(const oc_request_t *request,
+                        const oc_response_buffer_t *response_buffer)
+{
+  (void)request;
+  (void)response_buffer;
+}
+
+void
+oc_response_cache_invalidate(const oc_resource_t *resource)
+{
+  (void)resource;
+}
+
+void
+oc_response_cache_clear(void)
+{
+}
+
+#endif /* !OC_DYNAMIC_ALLOCATION */
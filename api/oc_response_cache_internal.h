@@ -0,0 +1,77 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef OC_RESPONSE_CACHE_INTERNAL_H
+#define OC_RESPONSE_CACHE_INTERNAL_H
+
+#include "messaging/coap/oc_coap.h"
+#include "oc_ri.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of GET responses kept for resources marked with OC_CACHED. When the
+ * cache is full the least recently used response is dropped.
+ */
+#ifndef OC_RESPONSE_CACHE_SIZE
+#define OC_RESPONSE_CACHE_SIZE (8)
+#endif /* OC_RESPONSE_CACHE_SIZE */
+
+/**
+ * @brief answer a GET request from the cache
+ *
+ * A response matches when it was made by the same resource for the same
+ * query and Accept option.
+ *
+ * @param request the request
+ * @param response_buffer receives the payload, content format, Max-Age and
+ *                        status code of the cached response
+ * @return true if the request was answered
+ */
+bool oc_response_cache_lookup(const oc_request_t *request,
+                              oc_response_buffer_t *response_buffer);
+
+/**
+ * @brief keep the response of a GET handler
+ *
+ * @param request the request
+ * @param response_buffer the response made by the handler
+ */
+void oc_response_cache_store(const oc_request_t *request,
+                             const oc_response_buffer_t *response_buffer);
+
+/**
+ * @brief drop the responses of a resource, e.g. when its state changed
+ *
+ * @param resource the resource
+ */
+void oc_response_cache_invalidate(const oc_resource_t *resource);
+
+/**
+ * @brief drop all responses, e.g. when the device configuration changed
+ */
+void oc_response_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_RESPONSE_CACHE_INTERNAL_H */
@@ -20,11 +20,15 @@
 #include <string.h>
 
 #include "util/oc_etimer.h"
+#include "util/oc_hash_index.h"
 #include "util/oc_list.h"
+#include "util/oc_arena.h"
 #include "util/oc_memb.h"
 #include "util/oc_process.h"
+#include "util/oc_uri_trie.h"
 
 #include "messaging/coap/constants.h"
+#include "messaging/coap/dedup.h"
 #include "messaging/coap/engine.h"
 #include "messaging/coap/oc_coap.h"
 #ifdef OC_TCP
@@ -42,8 +46,11 @@
 #include "oc_session_events.h"
 #endif /* OC_TCP */
 #include "oc_api.h"
+#include "oc_notify_conditions_internal.h"
+#include "oc_response_cache_internal.h"
 #include "oc_ri.h"
 #include "oc_uuid.h"
+#include "oc_worker_internal.h"
 
 #include "oc_knx_sec.h"
 
@@ -58,17 +65,62 @@
 
 #ifdef OC_SERVER
 OC_LIST(app_resources);
-OC_LIST(observe_callbacks);
 OC_MEMB(app_resources_s, oc_resource_t, OC_MAX_APP_RESOURCES);
+/* the app resources of each device by path */
+OC_MEMB(app_uri_nodes_s, oc_uri_trie_node_t, 4 * OC_MAX_APP_RESOURCES);
+#ifdef OC_DYNAMIC_ALLOCATION
+static oc_uri_trie_node_t **app_resources_by_uri = NULL;
+static size_t num_app_indexes = 0;
+#else  /* OC_DYNAMIC_ALLOCATION */
+static oc_uri_trie_node_t *app_resources_by_uri[OC_MAX_NUM_DEVICES];
+static const size_t num_app_indexes = OC_MAX_NUM_DEVICES;
+#endif /* !OC_DYNAMIC_ALLOCATION */
 #endif /* OC_SERVER */
 
 #ifdef OC_CLIENT
 #include "oc_client_state.h"
 OC_LIST(client_cbs);
 OC_MEMB(client_cbs_s, oc_client_cb_t, OC_MAX_NUM_CONCURRENT_REQUESTS + 1);
+/* responses find their callback by MID or by token */
+OC_HASH_INDEX(client_cbs_by_mid, OC_MAX_NUM_CONCURRENT_REQUESTS + 1);
+OC_HASH_INDEX(client_cbs_by_token, OC_MAX_NUM_CONCURRENT_REQUESTS + 1);
 #endif /* OC_CLIENT */
 
-OC_LIST(timed_callbacks);
+/* Number of hash buckets for timed and periodic observe callbacks, which are
+ * looked up by (callback, data). Must be a power of 2. */
+#ifndef OC_EVENT_CALLBACK_HASH_SIZE
+#define OC_EVENT_CALLBACK_HASH_SIZE (64)
+#endif /* OC_EVENT_CALLBACK_HASH_SIZE */
+
+/* Size of the buffer that the request payload is parsed into. Without
+ * dynamic allocation it holds all nodes, strings and arrays of a payload and
+ * is static, as requests are dispatched one at a time. Otherwise it is on the
+ * stack and larger payloads continue in allocated blocks. */
+#ifndef OC_REP_ARENA_SIZE
+#ifdef OC_DYNAMIC_ALLOCATION
+#define OC_REP_ARENA_SIZE (512)
+#else  /* OC_DYNAMIC_ALLOCATION */
+#define OC_REP_ARENA_SIZE                                                      \
+  (OC_MAX_NUM_REP_OBJECTS * sizeof(oc_rep_t) + OC_MAX_APP_DATA_SIZE)
+#endif /* !OC_DYNAMIC_ALLOCATION */
+#endif /* OC_REP_ARENA_SIZE */
+
+#ifdef OC_DYNAMIC_ALLOCATION
+/* Largest arena buffer allowed on the stack of the dispatcher, which runs on
+ * small stacks such as the 8 KB Zephyr main thread. */
+#ifndef OC_REP_ARENA_MAX_STACK_SIZE
+#define OC_REP_ARENA_MAX_STACK_SIZE (1024)
+#endif /* OC_REP_ARENA_MAX_STACK_SIZE */
+#if OC_REP_ARENA_SIZE > OC_REP_ARENA_MAX_STACK_SIZE
+#error "OC_REP_ARENA_SIZE exceeds OC_REP_ARENA_MAX_STACK_SIZE"
+#endif /* OC_REP_ARENA_SIZE > OC_REP_ARENA_MAX_STACK_SIZE */
+#else  /* OC_DYNAMIC_ALLOCATION */
+static uint64_t rep_arena_buffer[OC_REP_ARENA_SIZE / sizeof(uint64_t)];
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+static oc_event_callback_t *event_callbacks[OC_EVENT_CALLBACK_HASH_SIZE];
+/* callbacks removed while their timer event was already queued */
+OC_LIST(removed_callbacks);
 OC_MEMB(event_callbacks_s, oc_event_callback_t,
         1 + WELLKNOWNCORE * OC_MAX_NUM_DEVICES + OC_MAX_APP_RESOURCES +
           OC_MAX_NUM_CONCURRENT_REQUESTS * 2);
@@ -520,10 +572,29 @@ allocate_events(void)
   }
 }
 
+static void
+set_process_priorities(void)
+{
+  oc_process_set_priority(&message_buffer_handler,
+                          OC_PROCESS_PRIORITY_NETWORK);
+  oc_process_set_priority(&coap_engine, OC_PROCESS_PRIORITY_NETWORK);
+  oc_process_set_priority(&oc_network_events, OC_PROCESS_PRIORITY_NETWORK);
+#ifdef OC_TCP
+  oc_process_set_priority(&oc_session_events, OC_PROCESS_PRIORITY_NETWORK);
+#endif /* OC_TCP */
+#ifdef OC_OSCORE
+  oc_process_set_priority(&oc_oscore_handler, OC_PROCESS_PRIORITY_SECURITY);
+#endif /* OC_OSCORE */
+#ifdef OC_SECURITY
+  oc_process_set_priority(&oc_tls_handler, OC_PROCESS_PRIORITY_SECURITY);
+#endif /* OC_SECURITY */
+}
+
 static void
 start_processes(void)
 {
   allocate_events();
+  set_process_priorities();
   oc_process_start(&oc_etimer_process, NULL);
   oc_process_start(&timed_callback_events, NULL);
   oc_process_start(&coap_engine, NULL);
@@ -541,11 +612,17 @@ start_processes(void)
 #ifdef OC_TCP
   oc_process_start(&oc_session_events, NULL);
 #endif /* OC_TCP */
+#ifdef OC_WORKER_POOL
+  oc_process_start(&oc_worker_process, NULL);
+#endif /* OC_WORKER_POOL */
 }
 
 static void
 stop_processes(void)
 {
+#ifdef OC_WORKER_POOL
+  oc_process_exit(&oc_worker_process);
+#endif /* OC_WORKER_POOL */
 #ifdef OC_TCP
   oc_process_exit(&oc_session_events);
 #endif /* OC_TCP */
@@ -572,21 +649,14 @@ stop_processes(void)
 oc_resource_t *
 oc_ri_get_app_resource_by_uri(const char *uri, size_t uri_len, size_t device)
 {
-  if (!uri || uri_len == 0)
+  if (!uri || uri_len == 0 || device >= num_app_indexes)
     return NULL;
-  int skip = 0;
-  if (uri[0] != '/')
-    skip = 1;
-  oc_resource_t *res = oc_ri_get_app_resources();
-  while (res != NULL) {
-    if (oc_string_len(res->uri) == (uri_len + skip) &&
-        strncmp(uri, oc_string(res->uri) + skip, uri_len) == 0 &&
-        res->device == device)
-      return res;
-    res = res->next;
+  if (uri[0] == '/') {
+    uri++;
+    uri_len--;
   }
-
-  return res;
+  return (oc_resource_t *)oc_uri_trie_find(app_resources_by_uri[device], uri,
+                                           uri_len);
 }
 
 static void
@@ -609,20 +679,65 @@ oc_ri_init(void)
 
 #ifdef OC_SERVER
   oc_list_init(app_resources);
-  oc_list_init(observe_callbacks);
 #endif
 
 #ifdef OC_CLIENT
   oc_list_init(client_cbs);
 #endif
 
-  oc_list_init(timed_callbacks);
+  memset(event_callbacks, 0, sizeof(event_callbacks));
+  oc_list_init(removed_callbacks);
 
   oc_process_init();
   start_processes();
+#ifdef OC_WORKER_POOL
+  oc_worker_init();
+#endif /* OC_WORKER_POOL */
 }
 
 #ifdef OC_SERVER
+static bool
+index_app_resource(oc_resource_t *resource)
+{
+  if (oc_string_len(resource->uri) == 0) {
+    return false;
+  }
+#ifdef OC_DYNAMIC_ALLOCATION
+  if (resource->device >= num_app_indexes) {
+    size_t num = resource->device + 1;
+    oc_uri_trie_node_t **indexes = (oc_uri_trie_node_t **)realloc(
+      app_resources_by_uri, num * sizeof(oc_uri_trie_node_t *));
+    if (!indexes) {
+      return false;
+    }
+    memset(indexes + num_app_indexes, 0,
+           (num - num_app_indexes) * sizeof(oc_uri_trie_node_t *));
+    app_resources_by_uri = indexes;
+    num_app_indexes = num;
+  }
+#else  /* OC_DYNAMIC_ALLOCATION */
+  if (resource->device >= num_app_indexes) {
+    return false;
+  }
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  return oc_uri_trie_add(&app_uri_nodes_s,
+                         &app_resources_by_uri[resource->device],
+                         oc_string(resource->uri) + 1,
+                         oc_string_len(resource->uri) - 1, resource);
+}
+
+static void
+unindex_app_resource(oc_resource_t *resource)
+{
+  if (resource->device < num_app_indexes &&
+      oc_string_len(resource->uri) > 0) {
+    oc_uri_trie_remove(&app_uri_nodes_s,
+                       &app_resources_by_uri[resource->device],
+                       oc_string(resource->uri) + 1,
+                       oc_string_len(resource->uri) - 1, resource);
+  }
+}
+
 oc_resource_t *
 oc_ri_alloc_resource(void)
 {
@@ -645,10 +760,17 @@ oc_ri_delete_resource(oc_resource_t *resource)
   if (oc_list_remove2(app_resources, resource) == NULL) {
     return true;
   }
+  unindex_app_resource(resource);
 
   if (resource->num_observers > 0) {
     coap_remove_observer_by_resource(resource);
   }
+  oc_response_cache_invalidate(resource);
+  oc_notify_conditions_remove(resource);
+  oc_discovery_invalidate_views();
+#ifdef OC_BLOCK_WISE
+  oc_blockwise_remove_stream(resource);
+#endif /* OC_BLOCK_WISE */
 
   oc_ri_free_resource_properties(resource);
   oc_memb_free(&app_resources_s, resource);
@@ -671,8 +793,15 @@ oc_ri_add_resource(oc_resource_t *resource)
       resource->observe_period_seconds == 0)
     valid = false;
 
+  /* the URI has to be unique on the device */
+  if (valid && !index_app_resource(resource)) {
+    OC_ERR("could not index resource %s", oc_string_checked(resource->uri));
+    valid = false;
+  }
+
   if (valid) {
     oc_list_add(app_resources, resource);
+    oc_discovery_invalidate_views();
   }
 
   return valid;
@@ -697,87 +826,128 @@ oc_ri_free_resource_properties(oc_resource_t *resource)
   }
 }
 
-void
-oc_ri_remove_timed_event_callback(void *cb_data, oc_trigger_t event_callback)
+static oc_event_callback_t **
+event_callback_bucket(void *cb_data, oc_trigger_t event_callback)
 {
-  oc_event_callback_t *event_cb =
-    (oc_event_callback_t *)oc_list_head(timed_callbacks);
+  uintptr_t h = (uintptr_t)cb_data ^ ((uintptr_t)event_callback >> 4);
+  h ^= h >> 7;
+  h ^= h >> 15;
+  return &event_callbacks[h & (OC_EVENT_CALLBACK_HASH_SIZE - 1)];
+}
 
-  while (event_cb != NULL) {
-    if (event_cb->data == cb_data && event_cb->callback == event_callback) {
-      OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
-      oc_etimer_stop(&event_cb->timer);
-      OC_PROCESS_CONTEXT_END(&timed_callback_events);
-      oc_list_remove(timed_callbacks, event_cb);
-      oc_memb_free(&event_callbacks_s, event_cb);
-      break;
-    }
+static oc_event_callback_t *
+find_event_callback(void *cb_data, oc_trigger_t event_callback)
+{
+  oc_event_callback_t *event_cb =
+    *event_callback_bucket(cb_data, event_callback);
+  while (event_cb != NULL &&
+         (event_cb->data != cb_data || event_cb->callback != event_callback)) {
     event_cb = event_cb->next;
   }
+  return event_cb;
 }
 
-void
-oc_ri_add_timed_event_callback_ticks(void *cb_data, oc_trigger_t event_callback,
-                                     oc_clock_time_t ticks)
+static oc_event_callback_t *
+add_event_callback(void *cb_data, oc_trigger_t event_callback,
+                   oc_clock_time_t ticks)
 {
   oc_event_callback_t *event_cb =
     (oc_event_callback_t *)oc_memb_alloc(&event_callbacks_s);
+  if (!event_cb) {
+    return NULL;
+  }
+  event_cb->data = cb_data;
+  event_cb->callback = event_callback;
+  OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
+  oc_etimer_set(&event_cb->timer, ticks);
+  OC_PROCESS_CONTEXT_END(&timed_callback_events);
 
+  oc_event_callback_t **bucket = event_callback_bucket(cb_data, event_callback);
+  event_cb->next = *bucket;
+  *bucket = event_cb;
+  return event_cb;
+}
+
+static void
+unhash_event_callback(oc_event_callback_t *event_cb)
+{
+  oc_event_callback_t **p =
+    event_callback_bucket(event_cb->data, event_cb->callback);
+  while (*p != NULL && *p != event_cb) {
+    p = &(*p)->next;
+  }
+  if (*p != NULL) {
+    *p = event_cb->next;
+  }
+  event_cb->next = NULL;
+}
+
+static void
+free_event_callback(oc_event_callback_t *event_cb)
+{
+  unhash_event_callback(event_cb);
+  if (oc_etimer_expired(&event_cb->timer)) {
+    /* The timer event is queued and still refers to this callback, so it is
+     * released when the event is delivered. */
+    event_cb->callback = NULL;
+    oc_list_add(removed_callbacks, event_cb);
+    return;
+  }
+  oc_etimer_stop(&event_cb->timer);
+  oc_memb_free(&event_callbacks_s, event_cb);
+}
+
+void
+oc_ri_remove_timed_event_callback(void *cb_data, oc_trigger_t event_callback)
+{
+  oc_event_callback_t *event_cb = find_event_callback(cb_data, event_callback);
   if (event_cb) {
-    event_cb->data = cb_data;
-    event_cb->callback = event_callback;
-    OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
-    oc_etimer_set(&event_cb->timer, ticks);
-    OC_PROCESS_CONTEXT_END(&timed_callback_events);
-    oc_list_add(timed_callbacks, event_cb);
-  } else {
+    free_event_callback(event_cb);
+  }
+}
+
+void
+oc_ri_add_timed_event_callback_ticks(void *cb_data, oc_trigger_t event_callback,
+                                     oc_clock_time_t ticks)
+{
+  if (!add_event_callback(cb_data, event_callback, ticks)) {
     OC_WRN("insufficient memory to add timed event callback");
   }
 }
 
+/* Timers expire in deadline order and each posts its own event, so only the
+ * callback the event refers to has to run. */
 static void
-poll_event_callback_timers(oc_list_t list, struct oc_memb *cb_pool)
+run_event_callback(struct oc_etimer *timer)
 {
-  oc_event_callback_t *event_cb = (oc_event_callback_t *)oc_list_head(list),
-                      *next;
-
-  while (event_cb != NULL) {
-    next = event_cb->next;
-
-    if (oc_etimer_expired(&event_cb->timer)) {
-      if (event_cb->callback(event_cb->data) == OC_EVENT_DONE) {
-        oc_list_remove(list, event_cb);
-        oc_memb_free(cb_pool, event_cb);
-        event_cb = oc_list_head(list);
-        continue;
+  oc_event_callback_t *event_cb =
+    (oc_event_callback_t *)((char *)timer -
+                            offsetof(oc_event_callback_t, timer));
+
+  if (event_cb->callback != NULL) {
+    oc_event_callback_retval_t retval = event_cb->callback(event_cb->data);
+    if (event_cb->callback != NULL) {
+      if (retval == OC_EVENT_DONE) {
+        unhash_event_callback(event_cb);
+        oc_memb_free(&event_callbacks_s, event_cb);
       } else {
         OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
         oc_etimer_restart(&event_cb->timer);
         OC_PROCESS_CONTEXT_END(&timed_callback_events);
-        event_cb = oc_list_head(list);
-        continue;
       }
+      return;
     }
-
-    event_cb = next;
   }
-}
-
-static void
-check_event_callbacks(void)
-{
-#ifdef OC_SERVER
-  poll_event_callback_timers(observe_callbacks, &event_callbacks_s);
-#endif /* OC_SERVER */
-  poll_event_callback_timers(timed_callbacks, &event_callbacks_s);
+  /* removed before or while it ran */
+  oc_list_remove(removed_callbacks, event_cb);
+  oc_memb_free(&event_callbacks_s, event_cb);
 }
 
 #ifdef OC_SERVER
 static oc_event_callback_retval_t
 oc_observe_notification_delayed(void *data)
 {
-  (void)data;
-  coap_notify_observers((oc_resource_t *)data, NULL, NULL);
+  oc_notify_conditions_notify((oc_resource_t *)data, NULL);
   return OC_EVENT_DONE;
 }
 #endif
@@ -795,59 +965,28 @@ periodic_observe_handler(void *data)
   return OC_EVENT_DONE;
 }
 
-static oc_event_callback_t *
-get_periodic_observe_callback(oc_resource_t *resource)
-{
-  oc_event_callback_t *event_cb;
-  bool found = false;
-
-  for (event_cb = (oc_event_callback_t *)oc_list_head(observe_callbacks);
-       event_cb; event_cb = event_cb->next) {
-    if (resource == event_cb->data) {
-      found = true;
-      break;
-    }
-  }
-
-  if (found) {
-    return event_cb;
-  }
-
-  return NULL;
-}
-
 static void
 remove_periodic_observe_callback(oc_resource_t *resource)
 {
-  oc_event_callback_t *event_cb = get_periodic_observe_callback(resource);
+  oc_event_callback_t *event_cb =
+    find_event_callback(resource, periodic_observe_handler);
 
   if (event_cb) {
-    oc_etimer_stop(&event_cb->timer);
-    oc_list_remove(observe_callbacks, event_cb);
-    oc_memb_free(&event_callbacks_s, event_cb);
+    free_event_callback(event_cb);
   }
 }
 
 static bool
 add_periodic_observe_callback(oc_resource_t *resource)
 {
-  oc_event_callback_t *event_cb = get_periodic_observe_callback(resource);
-
-  if (!event_cb) {
-    event_cb = (oc_event_callback_t *)oc_memb_alloc(&event_callbacks_s);
-
-    if (!event_cb) {
-      OC_WRN("insufficient memory to add periodic observe callback");
-      return false;
-    }
-
-    event_cb->data = resource;
-    event_cb->callback = periodic_observe_handler;
-    OC_PROCESS_CONTEXT_BEGIN(&timed_callback_events);
-    oc_etimer_set(&event_cb->timer,
-                  (uint64_t)resource->observe_period_seconds * OC_CLOCK_SECOND);
-    OC_PROCESS_CONTEXT_END(&timed_callback_events);
-    oc_list_add(observe_callbacks, event_cb);
+  if (find_event_callback(resource, periodic_observe_handler)) {
+    return true;
+  }
+  if (!add_event_callback(resource, periodic_observe_handler,
+                          (uint64_t)resource->observe_period_seconds *
+                            OC_CLOCK_SECOND)) {
+    OC_WRN("insufficient memory to add periodic observe callback");
+    return false;
   }
 
   return true;
@@ -857,23 +996,20 @@ add_periodic_observe_callback(oc_resource_t *resource)
 static void
 free_all_event_timers(void)
 {
-#ifdef OC_SERVER
-  oc_event_callback_t *obs_cb =
-    (oc_event_callback_t *)oc_list_pop(observe_callbacks);
-  while (obs_cb != NULL) {
-    oc_etimer_stop(&obs_cb->timer);
-    oc_list_remove(observe_callbacks, obs_cb);
-    oc_memb_free(&event_callbacks_s, obs_cb);
-    obs_cb = oc_list_pop(observe_callbacks);
+  size_t i;
+  for (i = 0; i < OC_EVENT_CALLBACK_HASH_SIZE; i++) {
+    while (event_callbacks[i] != NULL) {
+      oc_event_callback_t *event_cb = event_callbacks[i];
+      event_callbacks[i] = event_cb->next;
+      oc_etimer_stop(&event_cb->timer);
+      oc_memb_free(&event_callbacks_s, event_cb);
+    }
   }
-#endif /* OC_SERVER */
   oc_event_callback_t *event_cb =
-    (oc_event_callback_t *)oc_list_pop(timed_callbacks);
+    (oc_event_callback_t *)oc_list_pop(removed_callbacks);
   while (event_cb != NULL) {
-    oc_etimer_stop(&event_cb->timer);
-    oc_list_remove(timed_callbacks, event_cb);
     oc_memb_free(&event_callbacks_s, event_cb);
-    event_cb = oc_list_pop(timed_callbacks);
+    event_cb = (oc_event_callback_t *)oc_list_pop(removed_callbacks);
   }
 }
 
@@ -911,6 +1047,23 @@ oc_ri_get_interface_mask(char *iface, size_t if_len)
   return iface_mask;
 }
 
+static void
+update_rep_arena_stats(oc_resource_t *resource, const oc_arena_t *arena,
+                       int parse_error)
+{
+  if (!resource) {
+    return;
+  }
+  size_t allocated = oc_arena_allocated(arena);
+  if (allocated > resource->rep_arena_stats.high_water) {
+    resource->rep_arena_stats.high_water = allocated;
+  }
+  if (parse_error == CborErrorOutOfMemory) {
+    OC_WRN("ocri: request payload does not fit in OC_REP_ARENA_SIZE");
+    resource->rep_arena_stats.exhausted++;
+  }
+}
+
 #ifdef OC_BLOCK_WISE
 bool
 oc_ri_invoke_coap_entity_handler(void *request, void *response,
@@ -927,7 +1080,7 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
    *  the request.
    */
   bool method_impl = true, bad_request = false, success = false,
-       forbidden = false, entity_too_large = false;
+       forbidden = false, entity_too_large = false, cached = false;
   bool authorized = true;
 
   /* Parsed CoAP PDU structure. */
@@ -1022,28 +1175,58 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
   request_obj.accept = accept;
   request_obj.uri_path = uri_path;
   request_obj.uri_path_len = uri_path_len;
-#ifndef OC_DYNAMIC_ALLOCATION
-  char rep_objects_alloc[OC_MAX_NUM_REP_OBJECTS];
-  oc_rep_t rep_objects_pool[OC_MAX_NUM_REP_OBJECTS];
-  memset(rep_objects_alloc, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(char));
-  memset(rep_objects_pool, 0, OC_MAX_NUM_REP_OBJECTS * sizeof(oc_rep_t));
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), OC_MAX_NUM_REP_OBJECTS,
-                                 rep_objects_alloc, (void *)rep_objects_pool,
-                                 0 };
-#else  /* !OC_DYNAMIC_ALLOCATION */
-  struct oc_memb rep_objects = { sizeof(oc_rep_t), 0, 0, 0, 0 };
-#endif /* OC_DYNAMIC_ALLOCATION */
-  oc_rep_set_pool(&rep_objects);
+  oc_resource_t *cur_resource = NULL;
 
-  if (payload_len > 0 && (cf == APPLICATION_CBOR || cf == APPLICATION_OSCORE)) {
+  /* Attempt to locate the specific resource object that will handle the
+   * request using the request uri. This is done before parsing the payload,
+   * as the resource decides how its payload is parsed.
+   */
+  /* Check against list of declared core resources.
+   */
+  cur_resource =
+    oc_core_get_resource_by_path(uri_path, uri_path_len, endpoint->device);
+
+#ifdef OC_SERVER
+  /* Check against list of declared application resources.
+   */
+  if (!cur_resource) {
+    cur_resource =
+      oc_ri_get_app_resource_by_uri(uri_path, uri_path_len, endpoint->device);
+  }
+#endif /* OC_SERVER */
+
+  /* The payload is parsed into an arena that is released in one go after the
+   * handler returns. Resources that opted in have their strings parsed in
+   * place. Resources with OC_RAW_PAYLOAD decode request_obj._payload
+   * themselves.
+   */
+#ifdef OC_DYNAMIC_ALLOCATION
+  uint64_t rep_arena_buffer[OC_REP_ARENA_SIZE / sizeof(uint64_t)];
+#endif /* OC_DYNAMIC_ALLOCATION */
+  oc_arena_t rep_arena;
+  oc_arena_init(&rep_arena, rep_arena_buffer, sizeof(rep_arena_buffer));
+  request_obj._rep_arena = &rep_arena;
+  bool zero_copy = cur_resource && (cur_resource->properties & OC_ZERO_COPY);
+  bool raw_payload =
+    cur_resource && (cur_resource->properties & OC_RAW_PAYLOAD);
+
+  if (payload_len > 0 && !raw_payload &&
+      (cf == APPLICATION_CBOR || cf == APPLICATION_OSCORE)) {
     /* Attempt to parse request payload using tinyCBOR via oc_rep helper
      * functions. The result of this parse is a tree of oc_rep_t structures
      * which will reflect the schema of the payload.
      * Any failures while parsing the payload is viewed as an erroneous
      * request and results in a 4.00 response being sent.
      */
-    int parse_error =
-      oc_parse_rep(payload, payload_len, &request_obj.request_payload);
+    int parse_error;
+    if (zero_copy) {
+      parse_error = oc_parse_rep_in_place(payload, payload_len, &rep_arena,
+                                          &request_obj.request_payload);
+    } else {
+      parse_error = oc_parse_rep_in_arena(payload, payload_len, &rep_arena,
+                                          &request_obj.request_payload);
+    }
+    update_rep_arena_stats(cur_resource, &rep_arena, parse_error);
     if (parse_error != 0) {
       OC_WRN("ocri: error parsing request payload; tinyCBOR error code:  %d",
              parse_error);
@@ -1053,47 +1236,12 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
     }
   }
 
-  oc_resource_t *resource, *cur_resource = NULL;
-
-  /* If there were no errors thus far, attempt to locate the specific
-   * resource object that will handle the request using the request uri.
+  /* If there were errors thus far, the request is not handed to a resource.
    */
-  /* Check against list of declared core resources.
-   */
-  if (!bad_request) {
-    int i;
-    int len_resource;
-    for (i = 0; i < OC_NUM_CORE_RESOURCES_PER_DEVICE; i++) {
-      resource = oc_core_get_resource_by_index(i, endpoint->device);
-      if (oc_string_len(resource->uri) == (uri_path_len + 1) &&
-          strncmp((const char *)oc_string(resource->uri) + 1, uri_path,
-                  uri_path_len) == 0) {
-        request_obj.resource = cur_resource = resource;
-        break;
-      }
-      if (oc_uri_contains_wildcard(oc_string(resource->uri))) {
-        len_resource = (int)oc_string_len(resource->uri);
-        // incoming URL should be equal or larger than the one with the wild
-        // card comparison should match to what ever is in front of the last
-        // char.
-        if (((int)(uri_path_len + 1) >= len_resource) &&
-            strncmp((const char *)oc_string(resource->uri) + 1, uri_path,
-                    (size_t)len_resource - 2) == 0) {
-          request_obj.resource = cur_resource = resource;
-          break;
-        }
-      }
-    }
+  if (bad_request) {
+    cur_resource = NULL;
   }
-
-#ifdef OC_SERVER
-  /* Check against list of declared application resources.
-   */
-  if (!cur_resource && !bad_request) {
-    request_obj.resource = cur_resource =
-      oc_ri_get_app_resource_by_uri(uri_path, uri_path_len, endpoint->device);
-  }
-#endif /* OC_SERVER */
+  request_obj.resource = cur_resource;
 
   if (cur_resource) {
     /* If there was no interface selection, pick the "default interface". */
@@ -1118,11 +1266,26 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
 /* Alloc response_state. It also affects request_obj.response.
  */
 #ifdef OC_BLOCK_WISE
+  const oc_blockwise_stream_t *stream = NULL;
+  if (cur_resource && !bad_request && method == OC_GET &&
+      (cur_resource->properties & OC_STREAMED)) {
+    stream = oc_blockwise_get_stream(cur_resource);
+    /* the GET handler, if any, answers what the source cannot */
+    if (stream && (!stream->source || (cur_resource->get_handler.cb &&
+                                       accept != stream->content_format))) {
+      stream = NULL;
+    }
+  }
   if (cur_resource && !bad_request) {
     if (!(*response_state)) {
       OC_DBG("creating new block-wise response state");
-      *response_state = oc_blockwise_alloc_response_buffer(
-        uri_path, uri_path_len, endpoint, method, OC_BLOCKWISE_SERVER);
+      if (stream) {
+        *response_state = oc_blockwise_alloc_stream_response(
+          uri_path, uri_path_len, endpoint, method);
+      } else {
+        *response_state = oc_blockwise_alloc_response_buffer(
+          uri_path, uri_path_len, endpoint, method, OC_BLOCKWISE_SERVER);
+      }
       if (!(*response_state)) {
         OC_ERR("failure to alloc response state");
         bad_request = true;
@@ -1136,6 +1299,12 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
         (*response_state)->return_content_type = accept;
         response_buffer.buffer = (*response_state)->buffer;
         response_buffer.buffer_size = OC_MAX_APP_DATA_SIZE;
+        if (stream) {
+          /* the engine pulls the blocks from the source */
+          (*response_state)->return_content_type = stream->content_format;
+          response_buffer.buffer = NULL;
+          response_buffer.buffer_size = 0;
+        }
       }
     }
   }
@@ -1176,7 +1345,24 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
          * its handler for the requested method. If it has not
          * implemented that method, then return a 4.05 response.
          */
-        if (method == OC_GET && cur_resource->get_handler.cb) {
+#ifdef OC_BLOCK_WISE
+        if (stream) {
+          response_buffer.code =
+            (accept == 0 || accept == stream->content_format)
+              ? oc_status_code(OC_STATUS_OK)
+              : oc_status_code(OC_STATUS_NOT_ACCEPTABLE);
+        } else
+#endif /* OC_BLOCK_WISE */
+#ifdef OC_WORKER_POOL
+          if ((cur_resource->properties & OC_POOLED) &&
+              oc_worker_dispatch(&request_obj, method, iface_mask)) {
+          /* answered through a separate response, or with 5.03 */
+        } else
+#endif /* OC_WORKER_POOL */
+          if (method == OC_GET && (cur_resource->properties & OC_CACHED) &&
+              oc_response_cache_lookup(&request_obj, &response_buffer)) {
+          cached = true;
+        } else if (method == OC_GET && cur_resource->get_handler.cb) {
           cur_resource->get_handler.cb(&request_obj, iface_mask,
                                        cur_resource->get_handler.user_data);
         } else if (method == OC_POST && cur_resource->post_handler.cb) {
@@ -1198,12 +1384,10 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
   oc_blockwise_scrub_buffers(false);
 #endif
 
-  if (request_obj.request_payload) {
-    /* To the extent that the request payload was parsed, free the
-     * payload structure (and return its memory to the pool).
-     */
-    oc_free_rep(request_obj.request_payload);
-  }
+  /* To the extent that the request payload was parsed, release the payload
+   * structure with its arena.
+   */
+  oc_arena_reset(&rep_arena);
 
   if (forbidden) {
     OC_WRN("ocri: Forbidden request");
@@ -1243,6 +1427,15 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
     success = true;
   }
 
+  if (success && (cur_resource->properties & OC_CACHED)) {
+    if (method != OC_GET) {
+      oc_response_cache_invalidate(cur_resource);
+    } else if (!cached && response_obj.separate_response == NULL &&
+               response_buffer.code == oc_status_code(OC_STATUS_OK)) {
+      oc_response_cache_store(&request_obj, &response_buffer);
+    }
+  }
+
 #ifdef OC_SERVER
   /* If a GET request was successfully processed, then check its
    *  observe option.
@@ -1275,6 +1468,9 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
               set_observe_option = false;
             }
           }
+          if (set_observe_option) {
+            oc_notify_conditions_observed(cur_resource);
+          }
         }
 
         if (set_observe_option) {
@@ -1394,9 +1590,32 @@ oc_ri_invoke_coap_entity_handler(void *request, void *response, uint8_t *buffer,
 }
 
 #ifdef OC_CLIENT
+static bool
+index_client_cb(oc_client_cb_t *cb)
+{
+  if (!oc_hash_index_add(&client_cbs_by_mid, cb, oc_hash_u16(cb->mid))) {
+    return false;
+  }
+  if (!oc_hash_index_add(&client_cbs_by_token, cb,
+                         oc_hash_bytes(cb->token, cb->token_len))) {
+    oc_hash_index_remove(&client_cbs_by_mid, cb, oc_hash_u16(cb->mid));
+    return false;
+  }
+  return true;
+}
+
+static void
+unindex_client_cb(oc_client_cb_t *cb)
+{
+  oc_hash_index_remove(&client_cbs_by_mid, cb, oc_hash_u16(cb->mid));
+  oc_hash_index_remove(&client_cbs_by_token, cb,
+                       oc_hash_bytes(cb->token, cb->token_len));
+}
+
 static void
 free_client_cb(oc_client_cb_t *cb)
 {
+  unindex_client_cb(cb);
   oc_list_remove(client_cbs, cb);
 #ifdef OC_BLOCK_WISE
   oc_blockwise_scrub_buffers_for_client_cb(cb);
@@ -1445,17 +1664,17 @@ notify_client_cb_503(oc_client_cb_t *cb)
 void
 oc_ri_free_client_cbs_by_mid(uint16_t mid)
 {
-  oc_client_cb_t *cb = (oc_client_cb_t *)oc_list_head(client_cbs), *next;
+  uint32_t hash = oc_hash_u16(mid), pos;
+  oc_client_cb_t *cb = oc_hash_index_first(&client_cbs_by_mid, hash, &pos);
   while (cb != NULL) {
-    next = cb->next;
     if (!cb->multicast && !cb->discovery && cb->ref_count == 0 &&
         cb->mid == mid) {
       cb->ref_count = 1;
       notify_client_cb_503(cb);
-      cb = (oc_client_cb_t *)oc_list_head(client_cbs);
+      cb = oc_hash_index_first(&client_cbs_by_mid, hash, &pos);
       continue;
     }
-    cb = next;
+    cb = oc_hash_index_next(&client_cbs_by_mid, hash, &pos);
   }
 }
 
@@ -1479,11 +1698,12 @@ oc_ri_free_client_cbs_by_endpoint(oc_endpoint_t *endpoint)
 oc_client_cb_t *
 oc_ri_find_client_cb_by_mid(uint16_t mid)
 {
-  oc_client_cb_t *cb = oc_list_head(client_cbs);
+  uint32_t hash = oc_hash_u16(mid), pos;
+  oc_client_cb_t *cb = oc_hash_index_first(&client_cbs_by_mid, hash, &pos);
   while (cb) {
     if (cb->mid == mid)
       break;
-    cb = cb->next;
+    cb = oc_hash_index_next(&client_cbs_by_mid, hash, &pos);
   }
   return cb;
 }
@@ -1491,15 +1711,40 @@ oc_ri_find_client_cb_by_mid(uint16_t mid)
 oc_client_cb_t *
 oc_ri_find_client_cb_by_token(uint8_t *token, uint8_t token_len)
 {
-  oc_client_cb_t *cb = oc_list_head(client_cbs);
+  uint32_t hash = oc_hash_bytes(token, token_len), pos;
+  oc_client_cb_t *cb = oc_hash_index_first(&client_cbs_by_token, hash, &pos);
   while (cb != NULL) {
     if (cb->token_len == token_len && memcmp(cb->token, token, token_len) == 0)
       break;
-    cb = cb->next;
+    cb = oc_hash_index_next(&client_cbs_by_token, hash, &pos);
   }
   return cb;
 }
 
+void
+oc_ri_set_client_cb_mid(oc_client_cb_t *cb, uint16_t mid)
+{
+  oc_hash_index_remove(&client_cbs_by_mid, cb, oc_hash_u16(cb->mid));
+  cb->mid = mid;
+  if (!oc_hash_index_add(&client_cbs_by_mid, cb, oc_hash_u16(cb->mid))) {
+    OC_ERR("could not index client cb %p by MID %u", (void *)cb, cb->mid);
+  }
+}
+
+void
+oc_ri_set_client_cb_token(oc_client_cb_t *cb, const uint8_t *token,
+                          uint8_t token_len)
+{
+  oc_hash_index_remove(&client_cbs_by_token, cb,
+                       oc_hash_bytes(cb->token, cb->token_len));
+  memcpy(cb->token, token, token_len);
+  cb->token_len = token_len;
+  if (!oc_hash_index_add(&client_cbs_by_token, cb,
+                         oc_hash_bytes(cb->token, cb->token_len))) {
+    OC_ERR("could not index client cb %p by token", (void *)cb);
+  }
+}
+
 bool
 oc_ri_is_client_cb_valid(oc_client_cb_t *client_cb)
 {
@@ -1726,6 +1971,8 @@ free_all_client_cbs(void)
     free_client_cb(cb);
     cb = oc_list_pop(client_cbs);
   }
+  oc_hash_index_clear(&client_cbs_by_mid);
+  oc_hash_index_clear(&client_cbs_by_token);
 }
 
 oc_client_cb_t *
@@ -1761,6 +2008,13 @@ oc_ri_alloc_client_cb(const char *uri, oc_endpoint_t *endpoint,
   if (query && strlen(query) > 0) {
     oc_new_string(&cb->query, query, strlen(query));
   }
+  if (!index_client_cb(cb)) {
+    OC_WRN("insufficient memory to index client callback");
+    oc_free_string(&cb->uri);
+    oc_free_string(&cb->query);
+    oc_memb_free(&client_cbs_s, cb);
+    return NULL;
+  }
   // if ((handler.response != NULL) && (handler.discovery_all != NULL) &&
   //    (handler.discovery != NULL)) {
   oc_list_add(client_cbs, cb);
@@ -1773,16 +2027,26 @@ oc_ri_alloc_client_cb(const char *uri, oc_endpoint_t *endpoint,
 void
 oc_ri_shutdown(void)
 {
+#ifdef OC_WORKER_POOL
+  oc_worker_shutdown();
+#endif /* OC_WORKER_POOL */
 #ifdef OC_SERVER
   coap_free_all_observers();
+  oc_notify_conditions_free_all();
 #endif /* OC_SERVER */
   coap_free_all_transactions();
+#ifdef OC_REQUEST_HISTORY
+  coap_dedup_free_all();
+#endif /* OC_REQUEST_HISTORY */
+  oc_response_cache_clear();
+  oc_discovery_invalidate_views();
   free_all_event_timers();
 #ifdef OC_CLIENT
   free_all_client_cbs();
 #endif /* OC_CLIENT */
 #ifdef OC_BLOCK_WISE
   oc_blockwise_scrub_buffers(true);
+  oc_blockwise_free_streams();
 #endif /* OC_BLOCK_WISE */
 
   while (oc_main_poll() != 0)
@@ -1794,6 +2058,11 @@ oc_ri_shutdown(void)
 
 #ifdef OC_SERVER
   oc_ri_delete_all_app_resources();
+#ifdef OC_DYNAMIC_ALLOCATION
+  free(app_resources_by_uri);
+  app_resources_by_uri = NULL;
+  num_app_indexes = 0;
+#endif /* OC_DYNAMIC_ALLOCATION */
 #endif /* OC_SERVER */
 
   oc_random_destroy();
@@ -1801,12 +2070,11 @@ oc_ri_shutdown(void)
 
 OC_PROCESS_THREAD(timed_callback_events, ev, data)
 {
-  (void)data;
   OC_PROCESS_BEGIN();
   while (1) {
     OC_PROCESS_YIELD();
     if (ev == OC_PROCESS_EVENT_TIMER) {
-      check_event_callbacks();
+      run_event_callback((struct oc_etimer *)data);
     }
   }
   OC_PROCESS_END();
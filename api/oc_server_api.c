@@ -29,6 +29,9 @@
 #endif /* OC_DYNAMIC_ALLOCATION */
 
 #include "oc_core_res.h"
+#include "oc_discovery.h"
+#include "oc_notify_conditions_internal.h"
+#include "oc_response_cache_internal.h"
 
 static size_t query_iterator;
 
@@ -292,6 +295,7 @@ oc_resource_bind_resource_interface(oc_resource_t *resource,
   }
 
   resource->interfaces |= iface_mask;
+  oc_discovery_invalidate_views();
 }
 
 void
@@ -299,6 +303,7 @@ oc_resource_bind_resource_type(oc_resource_t *resource, const char *type)
 {
   if (resource) {
     oc_string_array_add_item(resource->types, (char *)type);
+    oc_discovery_invalidate_views();
   } else {
     OC_ERR("oc_resource_bind_resource_type: resource is NULL");
   }
@@ -324,6 +329,7 @@ oc_resource_bind_content_type(oc_resource_t *resource,
 {
   if (resource) {
     resource->content_type = content_type;
+    oc_discovery_invalidate_views();
   } else {
     OC_ERR("oc_resource_bind_content_type: resource is NULL");
   }
@@ -349,6 +355,7 @@ oc_resource_set_discoverable(oc_resource_t *resource, bool state)
     resource->properties |= OC_DISCOVERABLE;
   else
     resource->properties &= ~OC_DISCOVERABLE;
+  oc_discovery_invalidate_views();
 }
 
 void
@@ -365,6 +372,69 @@ oc_resource_set_observable(oc_resource_t *resource, bool state)
     resource->properties &= ~(OC_OBSERVABLE | OC_PERIODIC);
 }
 
+void
+oc_resource_set_worker_pool(oc_resource_t *resource, bool state)
+{
+  if (resource == NULL) {
+    OC_ERR("oc_resource_set_worker_pool: resource is NULL");
+    return;
+  }
+
+  if (state)
+    resource->properties |= OC_POOLED;
+  else
+    resource->properties &= ~OC_POOLED;
+}
+
+void
+oc_resource_set_response_cache(oc_resource_t *resource, bool state)
+{
+  if (resource == NULL) {
+    OC_ERR("oc_resource_set_response_cache: resource is NULL");
+    return;
+  }
+
+  if (state) {
+    resource->properties |= OC_CACHED;
+  } else {
+    resource->properties &= ~OC_CACHED;
+    oc_response_cache_invalidate(resource);
+  }
+}
+
+void
+oc_resource_set_zero_copy_payload(oc_resource_t *resource, bool state)
+{
+  if (resource == NULL) {
+    OC_ERR("oc_resource_set_zero_copy_payload: resource is NULL");
+    return;
+  }
+
+  if (state)
+    resource->properties |= OC_ZERO_COPY;
+  else
+    resource->properties &= ~OC_ZERO_COPY;
+}
+
+bool
+oc_resource_get_rep_arena_stats(const oc_resource_t *resource,
+                                oc_rep_arena_stats_t *stats)
+{
+  if (!resource || !stats) {
+    return false;
+  }
+  *stats = resource->rep_arena_stats;
+  return true;
+}
+
+void
+oc_resource_reset_rep_arena_stats(oc_resource_t *resource)
+{
+  if (resource) {
+    memset(&resource->rep_arena_stats, 0, sizeof(resource->rep_arena_stats));
+  }
+}
+
 void
 oc_resource_set_periodic_observable(oc_resource_t *resource, uint16_t seconds)
 {
@@ -387,6 +457,7 @@ oc_resource_set_function_block_instance(oc_resource_t *resource,
   }
 
   resource->fb_instance = instance;
+  oc_discovery_invalidate_views();
 }
 
 void
@@ -610,6 +681,14 @@ oc_send_empty_separate_response(oc_separate_response_t *handle,
 int
 oc_notify_observers(oc_resource_t *resource)
 {
-  return coap_notify_observers(resource, NULL, NULL);
+  oc_response_cache_invalidate(resource);
+  return oc_notify_conditions_notify(resource, NULL);
+}
+
+int
+oc_notify_observers_value(oc_resource_t *resource, double value)
+{
+  oc_response_cache_invalidate(resource);
+  return oc_notify_conditions_notify(resource, &value);
 }
 #endif /* OC_SERVER */
@@ -0,0 +1,387 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "oc_config.h"
+
+#ifdef OC_WORKER_POOL
+
+#if !defined(OC_DYNAMIC_ALLOCATION) || !defined(OC_BLOCK_WISE)
+#error "OC_WORKER_POOL requires OC_DYNAMIC_ALLOCATION and OC_BLOCK_WISE"
+#endif
+
+#include "oc_worker_internal.h"
+#include "messaging/coap/oc_coap.h"
+#include "messaging/coap/separate.h"
+#include "oc_api.h"
+#include "oc_rep.h"
+#include "oc_signal_event_loop.h"
+#include "port/oc_log.h"
+#include "util/oc_arena.h"
+#include "util/oc_list.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A pooled request is copied into a job on the event loop thread, which
+ * answers the client with an empty ACK through the separate response
+ * machinery. A worker runs the handler into the job's own buffer; the
+ * encoder state is thread local. Finished jobs are handed back to
+ * oc_worker_process, which sends the separate response from the event loop.
+ * Only the pending and done lists are shared, everything else about a job
+ * belongs to one thread at a time.
+ */
+typedef struct oc_worker_job_s
+{
+  struct oc_worker_job_s *next;
+  oc_separate_response_t separate_response;
+  oc_request_handler_t handler;
+  oc_resource_t *resource;
+  oc_method_t method;
+  oc_interface_mask_t iface_mask;
+  oc_endpoint_t origin;
+  oc_content_format_t content_format;
+  oc_content_format_t accept;
+  char *query;
+  size_t query_len;
+  char *uri_path;
+  size_t uri_path_len;
+  uint8_t *payload;
+  size_t payload_len;
+  oc_response_buffer_t response_buffer;
+} oc_worker_job_t;
+
+OC_LIST(pending_jobs);
+OC_LIST(done_jobs);
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_cv = PTHREAD_COND_INITIALIZER;
+static pthread_t workers[OC_WORKER_THREADS];
+static int num_workers;
+static bool terminate;
+/* owned by the event loop thread */
+static int jobs_in_flight;
+
+static oc_request_handler_t *
+get_handler(oc_resource_t *resource, oc_method_t method)
+{
+  oc_request_handler_t *handler = NULL;
+  switch (method) {
+  case OC_GET:
+    handler = &resource->get_handler;
+    break;
+  case OC_POST:
+    handler = &resource->post_handler;
+    break;
+  case OC_PUT:
+    handler = &resource->put_handler;
+    break;
+  case OC_DELETE:
+    handler = &resource->delete_handler;
+    break;
+  default:
+    break;
+  }
+  return (handler && handler->cb) ? handler : NULL;
+}
+
+static oc_worker_job_t *
+new_job(const oc_request_t *request, size_t response_size)
+{
+  size_t size = sizeof(oc_worker_job_t) + request->query_len + 1 +
+                request->uri_path_len + 1 + request->_payload_len +
+                response_size;
+  oc_worker_job_t *job = (oc_worker_job_t *)calloc(1, size);
+  if (!job) {
+    return NULL;
+  }
+  uint8_t *data = (uint8_t *)(job + 1);
+  job->response_buffer.buffer = data;
+  job->response_buffer.buffer_size = response_size;
+  data += response_size;
+  job->query = (char *)data;
+  job->query_len = request->query_len;
+  if (request->query_len > 0) {
+    memcpy(job->query, request->query, request->query_len);
+  }
+  data += request->query_len + 1;
+  job->uri_path = (char *)data;
+  job->uri_path_len = request->uri_path_len;
+  if (request->uri_path_len > 0) {
+    memcpy(job->uri_path, request->uri_path, request->uri_path_len);
+  }
+  data += request->uri_path_len + 1;
+  job->payload = data;
+  job->payload_len = request->_payload_len;
+  if (request->_payload_len > 0) {
+    memcpy(job->payload, request->_payload, request->_payload_len);
+  }
+  return job;
+}
+
+static void
+free_job(oc_worker_job_t *job)
+{
+  oc_separate_response_t *handle = &job->separate_response;
+  if (handle->active) {
+    coap_separate_t *cur = oc_list_head(handle->requests), *next;
+    while (cur != NULL) {
+      next = cur->next;
+      coap_separate_clear(handle, cur);
+      cur = next;
+    }
+    handle->active = 0;
+  }
+  free(job);
+}
+
+/* runs on a worker thread */
+static void
+run_job(oc_worker_job_t *job)
+{
+  oc_arena_t rep_arena;
+  oc_arena_init(&rep_arena, NULL, 0);
+
+  oc_response_t response_obj;
+  memset(&response_obj, 0, sizeof(response_obj));
+  response_obj.response_buffer = &job->response_buffer;
+
+  oc_request_t request_obj;
+  memset(&request_obj, 0, sizeof(request_obj));
+  request_obj.origin = &job->origin;
+  request_obj.resource = job->resource;
+  if (job->query_len > 0) {
+    request_obj.query = job->query;
+    request_obj.query_len = job->query_len;
+  }
+  request_obj.uri_path = job->uri_path;
+  request_obj.uri_path_len = job->uri_path_len;
+  request_obj._payload = job->payload;
+  request_obj._payload_len = job->payload_len;
+  request_obj._rep_arena = &rep_arena;
+  request_obj.content_format = job->content_format;
+  request_obj.accept = job->accept;
+  request_obj.response = &response_obj;
+
+  /* the payload was found well formed before the request was dispatched */
+  if (job->payload_len > 0 && (job->content_format == APPLICATION_CBOR ||
+                               job->content_format == APPLICATION_OSCORE)) {
+    oc_parse_rep_in_arena(job->payload, (int)job->payload_len, &rep_arena,
+                          &request_obj.request_payload);
+  }
+
+  oc_rep_new(job->response_buffer.buffer,
+             (int)job->response_buffer.buffer_size);
+  job->handler.cb(&request_obj, job->iface_mask, job->handler.user_data);
+
+  if (response_obj.separate_response != NULL) {
+    OC_WRN("oc_worker: pooled handlers cannot defer their response");
+    job->response_buffer.code = 0;
+  }
+  oc_arena_reset(&rep_arena);
+}
+
+static void *
+worker_thread(void *data)
+{
+  (void)data;
+  pthread_mutex_lock(&jobs_lock);
+  while (!terminate) {
+    oc_worker_job_t *job = (oc_worker_job_t *)oc_list_pop(pending_jobs);
+    if (!job) {
+      pthread_cond_wait(&jobs_cv, &jobs_lock);
+      continue;
+    }
+    pthread_mutex_unlock(&jobs_lock);
+
+    run_job(job);
+
+    pthread_mutex_lock(&jobs_lock);
+    oc_list_add(done_jobs, job);
+    pthread_mutex_unlock(&jobs_lock);
+    oc_process_poll(&oc_worker_process);
+    _oc_signal_event_loop();
+    pthread_mutex_lock(&jobs_lock);
+  }
+  pthread_mutex_unlock(&jobs_lock);
+  return NULL;
+}
+
+static oc_status_t
+status_from_code(int code)
+{
+  int i;
+  for (i = 0; i < __NUM_OC_STATUS_CODES__; i++) {
+    if (oc_status_code((oc_status_t)i) == code) {
+      return (oc_status_t)i;
+    }
+  }
+  return OC_STATUS_INTERNAL_SERVER_ERROR;
+}
+
+static void
+send_job_response(oc_worker_job_t *job)
+{
+  oc_separate_response_t *handle = &job->separate_response;
+  if (!handle->active || oc_list_head(handle->requests) == NULL) {
+    /* the separate response could not be set up, the request was dropped */
+    return;
+  }
+  oc_response_buffer_t *response_buffer = &job->response_buffer;
+  if (response_buffer->code == OC_IGNORE) {
+    return;
+  }
+
+  oc_status_t status = status_from_code(response_buffer->code);
+  oc_set_separate_response_buffer(handle);
+  if (response_buffer->response_length > 0 &&
+      status != OC_STATUS_INTERNAL_SERVER_ERROR) {
+    memcpy(handle->response_state->buffer, response_buffer->buffer,
+           response_buffer->response_length);
+    handle->response_state->payload_size =
+      (uint32_t)response_buffer->response_length;
+    oc_send_separate_response(handle, status);
+  } else {
+    oc_send_empty_separate_response(handle, status);
+  }
+
+  /* as for a request handled on the event loop, a successful update
+   * notifies the observers of the resource */
+  if ((job->method == OC_PUT || job->method == OC_POST) &&
+      (job->origin.flags & MULTICAST) == 0 &&
+      response_buffer->code < oc_status_code(OC_STATUS_BAD_REQUEST)) {
+    oc_notify_observers(job->resource);
+  }
+}
+
+static void
+process_done_jobs(void)
+{
+  pthread_mutex_lock(&jobs_lock);
+  oc_worker_job_t *job = (oc_worker_job_t *)oc_list_pop(done_jobs);
+  while (job != NULL) {
+    pthread_mutex_unlock(&jobs_lock);
+    send_job_response(job);
+    free_job(job);
+    jobs_in_flight--;
+    pthread_mutex_lock(&jobs_lock);
+    job = (oc_worker_job_t *)oc_list_pop(done_jobs);
+  }
+  pthread_mutex_unlock(&jobs_lock);
+}
+
+OC_PROCESS(oc_worker_process, "Worker pool");
+OC_PROCESS_THREAD(oc_worker_process, ev, data)
+{
+  (void)ev;
+  (void)data;
+  OC_PROCESS_POLLHANDLER(process_done_jobs());
+  OC_PROCESS_BEGIN();
+  while (oc_process_is_running(&oc_worker_process)) {
+    OC_PROCESS_YIELD();
+  }
+  OC_PROCESS_END();
+}
+
+int
+oc_worker_init(void)
+{
+  terminate = false;
+  jobs_in_flight = 0;
+  oc_list_init(pending_jobs);
+  oc_list_init(done_jobs);
+  for (num_workers = 0; num_workers < OC_WORKER_THREADS; num_workers++) {
+    if (pthread_create(&workers[num_workers], NULL, worker_thread, NULL) !=
+        0) {
+      OC_ERR("oc_worker: failed to start worker thread");
+      oc_worker_shutdown();
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void
+oc_worker_shutdown(void)
+{
+  int i;
+  pthread_mutex_lock(&jobs_lock);
+  terminate = true;
+  pthread_cond_broadcast(&jobs_cv);
+  pthread_mutex_unlock(&jobs_lock);
+  for (i = 0; i < num_workers; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  num_workers = 0;
+
+  oc_worker_job_t *job;
+  while ((job = (oc_worker_job_t *)oc_list_pop(pending_jobs)) != NULL) {
+    free_job(job);
+  }
+  while ((job = (oc_worker_job_t *)oc_list_pop(done_jobs)) != NULL) {
+    free_job(job);
+  }
+  jobs_in_flight = 0;
+}
+
+bool
+oc_worker_dispatch(oc_request_t *request, oc_method_t method,
+                   oc_interface_mask_t iface_mask)
+{
+  oc_request_handler_t *handler = get_handler(request->resource, method);
+  if (!handler) {
+    return false;
+  }
+
+  oc_worker_job_t *job = NULL;
+  if (jobs_in_flight < OC_WORKER_MAX_JOBS && num_workers > 0) {
+    job = new_job(request, OC_MAX_APP_DATA_SIZE);
+  }
+  if (!job) {
+    OC_WRN("oc_worker: pool saturated, rejecting request");
+    request->response->response_buffer->max_age = OC_WORKER_RETRY_AFTER;
+    oc_send_response(request, OC_STATUS_SERVICE_UNAVAILABLE);
+    return true;
+  }
+
+  job->handler = *handler;
+  job->resource = request->resource;
+  job->method = method;
+  job->iface_mask = iface_mask;
+  memcpy(&job->origin, request->origin, sizeof(oc_endpoint_t));
+  job->origin.next = NULL;
+  job->content_format = request->content_format;
+  job->accept = request->accept;
+  oc_indicate_separate_response(request, &job->separate_response);
+  jobs_in_flight++;
+
+  pthread_mutex_lock(&jobs_lock);
+  oc_list_add(pending_jobs, job);
+  pthread_cond_signal(&jobs_cv);
+  pthread_mutex_unlock(&jobs_lock);
+  return true;
+}
+
+int
+oc_worker_jobs_in_flight(void)
+{
+  return jobs_in_flight;
+}
+
+#else  /* OC_WORKER_POOL */
+typedef int dummy_declaration;
+#endif /* !OC_WORKER_POOL */
@@ -0,0 +1,96 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef OC_WORKER_INTERNAL_H
+#define OC_WORKER_INTERNAL_H
+
+#ifdef OC_WORKER_POOL
+
+#include "oc_ri.h"
+#include "util/oc_process.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of threads running pooled request handlers.
+ */
+#ifndef OC_WORKER_THREADS
+#define OC_WORKER_THREADS (4)
+#endif /* OC_WORKER_THREADS */
+
+/**
+ * Maximum number of pooled requests in flight, queued or running. Further
+ * requests to pooled resources are answered with 5.03.
+ */
+#ifndef OC_WORKER_MAX_JOBS
+#define OC_WORKER_MAX_JOBS (16)
+#endif /* OC_WORKER_MAX_JOBS */
+
+/**
+ * Max-Age in seconds of the 5.03 response sent when the pool is saturated,
+ * i.e. when the client may retry.
+ */
+#ifndef OC_WORKER_RETRY_AFTER
+#define OC_WORKER_RETRY_AFTER (1)
+#endif /* OC_WORKER_RETRY_AFTER */
+
+OC_PROCESS_NAME(oc_worker_process);
+
+/**
+ * @brief start the worker threads
+ *
+ * @return 0 on success
+ */
+int oc_worker_init(void);
+
+/**
+ * @brief stop the worker threads and drop the requests in flight
+ */
+void oc_worker_shutdown(void);
+
+/**
+ * @brief hand a request to the worker pool
+ *
+ * Copies what the handler needs out of the request and marks the request for
+ * a separate response. When the pool is saturated the request is answered
+ * with 5.03 instead.
+ *
+ * @param request the request, on the event loop thread
+ * @param method the request method
+ * @param iface_mask the interface selected by the request
+ * @return true if the request was handled, false if the resource has no
+ *         handler for the method
+ */
+bool oc_worker_dispatch(oc_request_t *request, oc_method_t method,
+                        oc_interface_mask_t iface_mask);
+
+/**
+ * @brief number of pooled requests that have not been answered yet
+ */
+int oc_worker_jobs_in_flight(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_WORKER_POOL */
+
+#endif /* OC_WORKER_INTERNAL_H */
@@ -27,6 +27,19 @@
 #include "oc_helpers.h"
 #include "oc_ri.h"
 #include "port/linux/oc_config.h"
+#include "util/oc_process.h"
+
+extern "C" {
+#include "oc_blockwise.h"
+#include "oc_rep.h"
+
+#ifdef OC_BLOCK_WISE
+extern bool oc_ri_invoke_coap_entity_handler(
+  void *request, void *response, oc_blockwise_state_t **request_state,
+  oc_blockwise_state_t **response_state, uint16_t block2_size,
+  oc_endpoint_t *endpoint);
+#endif /* OC_BLOCK_WISE */
+}
 
 #define RESOURCE_URI "/LightResourceURI"
 #define RESOURCE_NAME "roomlights"
@@ -222,3 +235,135 @@ TEST_F(TestOcRi, RIinterfacestring_P)
   interface = get_interface_string(OC_IF_PM);
   EXPECT_STREQ("if.pm", interface);
 }
+
+static int timed_calls[4];
+
+static oc_event_callback_retval_t
+count_timed_callback(void *data)
+{
+  timed_calls[(intptr_t)data]++;
+  return timed_calls[(intptr_t)data] < 3 ? OC_EVENT_CONTINUE : OC_EVENT_DONE;
+}
+
+static oc_event_callback_retval_t
+remove_self_callback(void *data)
+{
+  timed_calls[(intptr_t)data]++;
+  oc_ri_remove_timed_event_callback(data, remove_self_callback);
+  return OC_EVENT_CONTINUE;
+}
+
+static void
+run_timed_callbacks(void)
+{
+  for (int i = 0; i < 10; i++) {
+    oc_etimer_request_poll();
+    while (oc_process_run()) {
+    }
+  }
+}
+
+TEST_F(TestOcRi, RITimedEventCallbacks_P)
+{
+  memset(timed_calls, 0, sizeof(timed_calls));
+  oc_ri_add_timed_event_callback_ticks((void *)0, count_timed_callback, 0);
+  oc_ri_add_timed_event_callback_ticks((void *)1, count_timed_callback, 0);
+  oc_ri_add_timed_event_callback_ticks((void *)2, count_timed_callback, 0);
+  oc_ri_add_timed_event_callback_ticks((void *)3, remove_self_callback, 0);
+  oc_ri_remove_timed_event_callback((void *)1, count_timed_callback);
+
+  run_timed_callbacks();
+  // repeated until done, cancelled ones never run
+  EXPECT_EQ(3, timed_calls[0]);
+  EXPECT_EQ(0, timed_calls[1]);
+  EXPECT_EQ(3, timed_calls[2]);
+  EXPECT_EQ(1, timed_calls[3]);
+}
+
+static oc_event_callback_retval_t
+remove_partner_callback(void *data)
+{
+  timed_calls[(intptr_t)data]++;
+  oc_ri_remove_timed_event_callback((void *)((intptr_t)data ^ 1),
+                                    remove_partner_callback);
+  return OC_EVENT_DONE;
+}
+
+TEST_F(TestOcRi, RIRemoveExpiredTimedEventCallback_P)
+{
+  memset(timed_calls, 0, sizeof(timed_calls));
+  // both expire in the same poll, the first one to run cancels the other
+  // while its timer event is already queued
+  oc_ri_add_timed_event_callback_ticks((void *)0, remove_partner_callback, 0);
+  oc_ri_add_timed_event_callback_ticks((void *)1, remove_partner_callback, 0);
+
+  run_timed_callbacks();
+  EXPECT_EQ(1, timed_calls[0] + timed_calls[1]);
+}
+
+#ifdef OC_BLOCK_WISE
+
+static std::string put_name;
+
+static void
+onPut(oc_request_t *request, oc_interface_mask_t iface_mask, void *user_data)
+{
+  (void)iface_mask;
+  (void)user_data;
+  char *name = NULL;
+  size_t name_len = 0;
+  if (oc_rep_get_string(request->request_payload, "name", &name, &name_len)) {
+    put_name.assign(name, name_len);
+  }
+  oc_send_response(request, OC_STATUS_CHANGED);
+}
+
+TEST_F(TestOcRi, RIRepArenaStats_P)
+{
+  oc_resource_t *res = oc_new_resource(RESOURCE_NAME, RESOURCE_URI, 1, 0);
+  oc_resource_set_request_handler(res, OC_PUT, onPut, NULL);
+  ASSERT_TRUE(oc_ri_add_resource(res));
+  oc_endpoint_t endpoint;
+  memset(&endpoint, 0, sizeof(endpoint));
+  endpoint.flags = IPV6;
+
+  oc_blockwise_state_t *request_state = oc_blockwise_alloc_request_buffer(
+    RESOURCE_URI, strlen(RESOURCE_URI), &endpoint, OC_PUT, OC_BLOCKWISE_SERVER);
+  ASSERT_NE(nullptr, request_state);
+  oc_rep_new(request_state->buffer, OC_MAX_APP_DATA_SIZE);
+  oc_rep_begin_root_object();
+  oc_rep_set_text_string(root, name, "Dave");
+  int64_t values[3] = { 1, 2, 3 };
+  oc_rep_set_int_array(root, values, values, 3);
+  oc_rep_end_root_object();
+  request_state->payload_size = oc_rep_get_encoded_payload_size();
+  ASSERT_GT(request_state->payload_size, 0u);
+
+  coap_packet_t request;
+  coap_packet_t response;
+  coap_udp_init_message(&request, COAP_TYPE_CON, COAP_PUT, 1);
+  coap_udp_init_message(&response, COAP_TYPE_ACK, CHANGED_2_04, 1);
+  coap_set_header_uri_path(&request, RESOURCE_URI, strlen(RESOURCE_URI));
+  coap_set_header_content_format(&request, APPLICATION_CBOR);
+  oc_blockwise_state_t *response_state = NULL;
+  put_name.clear();
+  EXPECT_TRUE(oc_ri_invoke_coap_entity_handler(
+    &request, &response, &request_state, &response_state, 64, &endpoint));
+  EXPECT_EQ("Dave", put_name);
+
+  oc_rep_arena_stats_t stats;
+  ASSERT_TRUE(oc_resource_get_rep_arena_stats(res, &stats));
+  EXPECT_GE(stats.high_water, 2 * sizeof(oc_rep_t) + 3 * sizeof(int64_t));
+  EXPECT_EQ(0u, stats.exhausted);
+  oc_resource_reset_rep_arena_stats(res);
+  ASSERT_TRUE(oc_resource_get_rep_arena_stats(res, &stats));
+  EXPECT_EQ(0u, stats.high_water);
+
+  if (response_state) {
+    oc_blockwise_free_response_buffer(response_state);
+  }
+  oc_blockwise_free_request_buffer(request_state);
+  oc_ri_delete_resource(res);
+}
+
+#endif /* OC_BLOCK_WISE */
@@ -0,0 +1,132 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "util/oc_arena.h"
+}
+
+static bool
+is_aligned(const void *p)
+{
+  return ((uintptr_t)p % 8) == 0;
+}
+
+TEST(TestArena, AllocatesFromBuffer)
+{
+  uint64_t buffer[8];
+  oc_arena_t arena;
+  oc_arena_init(&arena, buffer, sizeof(buffer));
+  uint8_t *a = (uint8_t *)oc_arena_alloc(&arena, 3);
+  uint8_t *b = (uint8_t *)oc_arena_alloc(&arena, 16);
+  ASSERT_NE(nullptr, a);
+  ASSERT_NE(nullptr, b);
+  EXPECT_TRUE(is_aligned(a));
+  EXPECT_TRUE(is_aligned(b));
+  EXPECT_EQ(a + 8, b);
+  EXPECT_GE(b, (uint8_t *)buffer);
+  EXPECT_LT(b, (uint8_t *)buffer + sizeof(buffer));
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(0, b[i]);
+  }
+}
+
+TEST(TestArena, UnalignedBufferIsAligned)
+{
+  uint64_t buffer[8];
+  oc_arena_t arena;
+  oc_arena_init(&arena, (uint8_t *)buffer + 1, sizeof(buffer) - 1);
+  void *p = oc_arena_alloc(&arena, 1);
+  ASSERT_NE(nullptr, p);
+  EXPECT_TRUE(is_aligned(p));
+}
+
+TEST(TestArena, ResetReusesBuffer)
+{
+  uint64_t buffer[8];
+  oc_arena_t arena;
+  oc_arena_init(&arena, buffer, sizeof(buffer));
+  uint8_t *first = (uint8_t *)oc_arena_alloc(&arena, 8);
+  ASSERT_NE(nullptr, first);
+  first[0] = 0xAA;
+  oc_arena_alloc(&arena, 24);
+  oc_arena_reset(&arena);
+  uint8_t *again = (uint8_t *)oc_arena_alloc(&arena, 8);
+  EXPECT_EQ(first, again);
+  EXPECT_EQ(0, again[0]);
+}
+
+TEST(TestArena, CountsAllocatedBytes)
+{
+  uint64_t buffer[2];
+  oc_arena_t arena;
+  oc_arena_init(&arena, buffer, sizeof(buffer));
+  EXPECT_EQ(0u, oc_arena_allocated(&arena));
+  oc_arena_alloc(&arena, 3);
+  EXPECT_EQ(8u, oc_arena_allocated(&arena));
+  oc_arena_alloc(&arena, 8);
+  EXPECT_EQ(16u, oc_arena_allocated(&arena));
+#ifdef OC_DYNAMIC_ALLOCATION
+  oc_arena_alloc(&arena, 100);
+  EXPECT_EQ(120u, oc_arena_allocated(&arena));
+#endif /* OC_DYNAMIC_ALLOCATION */
+  oc_arena_reset(&arena);
+  EXPECT_EQ(0u, oc_arena_allocated(&arena));
+}
+
+#ifdef OC_DYNAMIC_ALLOCATION
+
+TEST(TestArena, GrowsPastBuffer)
+{
+  uint64_t buffer[2];
+  oc_arena_t arena;
+  oc_arena_init(&arena, buffer, sizeof(buffer));
+  std::vector<uint8_t *> blocks;
+  for (int i = 0; i < 4; i++) {
+    uint8_t *p = (uint8_t *)oc_arena_alloc(&arena, OC_ARENA_BLOCK_SIZE / 2);
+    ASSERT_NE(nullptr, p);
+    EXPECT_TRUE(is_aligned(p));
+    p[OC_ARENA_BLOCK_SIZE / 2 - 1] = (uint8_t)i;
+    blocks.push_back(p);
+  }
+  uint8_t *large = (uint8_t *)oc_arena_alloc(&arena, 4 * OC_ARENA_BLOCK_SIZE);
+  ASSERT_NE(nullptr, large);
+  large[4 * OC_ARENA_BLOCK_SIZE - 1] = 0xFF;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(i, blocks[i][OC_ARENA_BLOCK_SIZE / 2 - 1]);
+  }
+  oc_arena_reset(&arena);
+  EXPECT_EQ(nullptr, arena.blocks);
+  EXPECT_EQ((uint8_t *)buffer, (uint8_t *)oc_arena_alloc(&arena, 8));
+}
+
+#else  /* OC_DYNAMIC_ALLOCATION */
+
+TEST(TestArena, FailsWhenExhausted)
+{
+  uint64_t buffer[2];
+  oc_arena_t arena;
+  oc_arena_init(&arena, buffer, sizeof(buffer));
+  EXPECT_NE(nullptr, oc_arena_alloc(&arena, 16));
+  EXPECT_EQ(nullptr, oc_arena_alloc(&arena, 1));
+}
+
+#endif /* !OC_DYNAMIC_ALLOCATION */
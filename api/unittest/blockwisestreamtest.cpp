@@ -0,0 +1,286 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "oc_api.h"
+#include "oc_blockwise.h"
+#include "oc_core_res.h"
+#include "oc_ri.h"
+#include "port/oc_connectivity.h"
+
+#ifdef OC_BLOCK_WISE
+extern bool oc_ri_invoke_coap_entity_handler(
+  void *request, void *response, oc_blockwise_state_t **request_state,
+  oc_blockwise_state_t **response_state, uint16_t block2_size,
+  oc_endpoint_t *endpoint);
+#endif /* OC_BLOCK_WISE */
+}
+
+#ifdef OC_BLOCK_WISE
+
+struct sink_call
+{
+  uint32_t offset;
+  std::string data;
+  bool more;
+};
+
+static std::vector<sink_call> sink_calls;
+static bool sink_result;
+
+static bool
+sink(oc_resource_t *resource, const oc_endpoint_t *origin, const char *query,
+     size_t query_len, uint32_t offset, const uint8_t *block, size_t block_len,
+     bool more, void *user_data)
+{
+  (void)resource;
+  (void)origin;
+  (void)query;
+  (void)query_len;
+  (void)user_data;
+  sink_calls.push_back(
+    { offset, std::string((const char *)block, block_len), more });
+  return sink_result;
+}
+
+static const size_t source_len = 100;
+
+static int
+source(oc_resource_t *resource, const char *query, size_t query_len,
+       uint32_t offset, uint8_t *block, size_t block_size, bool *more,
+       void *user_data)
+{
+  (void)resource;
+  (void)query;
+  (void)query_len;
+  (void)user_data;
+  size_t len = 0;
+  while (len < block_size && offset + len < source_len) {
+    block[len] = (uint8_t)(offset + len);
+    len++;
+  }
+  *more = offset + len < source_len;
+  return (int)len;
+}
+
+static void
+on_put(oc_request_t *request, oc_interface_mask_t iface_mask, void *user_data)
+{
+  (void)iface_mask;
+  (void)user_data;
+  oc_send_response(request, OC_STATUS_CHANGED);
+}
+
+class TestBlockwiseStream : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    oc_ri_init();
+    sink_calls.clear();
+    sink_result = true;
+    memset(&endpoint_, 0, sizeof(endpoint_));
+    endpoint_.flags = IPV6;
+    resource_ = oc_new_resource("stream", "/stream", 1, 0);
+    oc_resource_set_request_handler(resource_, OC_PUT, on_put, NULL);
+    oc_ri_add_resource(resource_);
+  }
+
+  void TearDown() override
+  {
+    oc_ri_delete_resource(resource_);
+    oc_ri_shutdown();
+  }
+
+  oc_blockwise_state_t *request()
+  {
+    return oc_blockwise_alloc_stream_request("stream", 6, &endpoint_, OC_PUT);
+  }
+
+  static uint8_t write(oc_blockwise_state_t *state, uint32_t offset,
+                       const char *data, bool more)
+  {
+    return oc_blockwise_stream_write(state, offset, (const uint8_t *)data,
+                                     (uint32_t)strlen(data), more);
+  }
+
+  oc_endpoint_t endpoint_;
+  oc_resource_t *resource_;
+};
+
+TEST_F(TestBlockwiseStream, SinkGetsBlocksInOrder)
+{
+  ASSERT_TRUE(oc_resource_set_block_sink(resource_, sink, NULL));
+  EXPECT_TRUE(resource_->properties & OC_STREAMED);
+  EXPECT_EQ(resource_, oc_blockwise_find_stream("stream", 6, 0)->resource);
+
+  oc_blockwise_state_t *state = request();
+  ASSERT_NE(nullptr, state);
+  EXPECT_TRUE(state->streamed);
+#ifdef OC_DYNAMIC_ALLOCATION
+  EXPECT_EQ(nullptr, state->buffer);
+#endif /* OC_DYNAMIC_ALLOCATION */
+
+  EXPECT_EQ(0, write(state, 0, "abcd", true));
+  /* a retransmitted block is acknowledged without reaching the sink */
+  EXPECT_EQ(0, write(state, 0, "abcd", true));
+  EXPECT_EQ(REQUEST_ENTITY_INCOMPLETE_4_08, write(state, 8, "ijkl", false));
+  EXPECT_EQ(0, write(state, 4, "efgh", false));
+
+  ASSERT_EQ(2u, sink_calls.size());
+  EXPECT_EQ(0u, sink_calls[0].offset);
+  EXPECT_EQ("abcd", sink_calls[0].data);
+  EXPECT_TRUE(sink_calls[0].more);
+  EXPECT_EQ(4u, sink_calls[1].offset);
+  EXPECT_EQ("efgh", sink_calls[1].data);
+  EXPECT_FALSE(sink_calls[1].more);
+  oc_blockwise_free_request_buffer(state);
+}
+
+TEST_F(TestBlockwiseStream, SinkAborts)
+{
+  ASSERT_TRUE(oc_resource_set_block_sink(resource_, sink, NULL));
+  oc_blockwise_state_t *state = request();
+  ASSERT_NE(nullptr, state);
+  sink_result = false;
+  EXPECT_EQ(BAD_REQUEST_4_00, write(state, 0, "abcd", true));
+  oc_blockwise_free_request_buffer(state);
+}
+
+TEST_F(TestBlockwiseStream, SourceIsPulledPerBlock)
+{
+  ASSERT_TRUE(oc_resource_set_block_source(resource_, APPLICATION_OCTET_STREAM,
+                                           source, NULL));
+  oc_blockwise_state_t *state =
+    oc_blockwise_alloc_stream_response("stream", 6, &endpoint_, OC_GET);
+  ASSERT_NE(nullptr, state);
+
+  uint8_t block[32];
+  std::vector<uint8_t> payload;
+  bool more = true;
+  uint32_t offset = 0;
+  while (more) {
+    int len = oc_blockwise_stream_read(state, offset, block, sizeof(block),
+                                       &more);
+    ASSERT_GE(len, 0);
+    EXPECT_EQ(offset + (uint32_t)len, state->next_block_offset);
+    payload.insert(payload.end(), block, block + len);
+    offset += (uint32_t)len;
+  }
+  ASSERT_EQ(source_len, payload.size());
+  for (size_t i = 0; i < payload.size(); i++) {
+    EXPECT_EQ((uint8_t)i, payload[i]);
+  }
+  oc_blockwise_free_response_buffer(state);
+}
+
+TEST_F(TestBlockwiseStream, RemovedStream)
+{
+  ASSERT_TRUE(oc_resource_set_block_sink(resource_, sink, NULL));
+  ASSERT_TRUE(oc_resource_set_block_source(resource_, APPLICATION_OCTET_STREAM,
+                                           source, NULL));
+  oc_blockwise_state_t *state = request();
+  ASSERT_NE(nullptr, state);
+
+  EXPECT_TRUE(oc_resource_set_block_sink(resource_, NULL, NULL));
+  EXPECT_NE(nullptr, oc_blockwise_get_stream(resource_));
+  EXPECT_EQ(NOT_FOUND_4_04, write(state, 0, "abcd", true));
+  EXPECT_TRUE(oc_resource_set_block_source(
+    resource_, APPLICATION_OCTET_STREAM, NULL, NULL));
+  EXPECT_EQ(nullptr, oc_blockwise_get_stream(resource_));
+  EXPECT_FALSE(resource_->properties & OC_STREAMED);
+  EXPECT_TRUE(sink_calls.empty());
+  oc_blockwise_free_request_buffer(state);
+}
+
+TEST_F(TestBlockwiseStream, GetIsAnsweredFromSource)
+{
+  /* the request is matched against the core resources first */
+  oc_core_init();
+  oc_add_device("myhname", "1.0.0", "//", "000001", NULL, NULL);
+  EXPECT_NE(nullptr, oc_blockwise_find_stream("a/swu", 5, 0));
+  EXPECT_NE(nullptr, oc_blockwise_find_stream("fp/g", 4, 0));
+
+  ASSERT_TRUE(oc_resource_set_block_source(resource_, APPLICATION_OCTET_STREAM,
+                                           source, NULL));
+  for (uint16_t accept : { 0, (int)APPLICATION_OCTET_STREAM,
+                           (int)APPLICATION_CBOR }) {
+    coap_packet_t request;
+    coap_packet_t response;
+    coap_udp_init_message(&request, COAP_TYPE_CON, COAP_GET, 1);
+    coap_udp_init_message(&response, COAP_TYPE_ACK, CONTENT_2_05, 1);
+    coap_set_header_uri_path(&request, "stream", 6);
+    if (accept != 0) {
+      coap_set_header_accept(&request, accept);
+    }
+    oc_blockwise_state_t *request_state = NULL;
+    oc_blockwise_state_t *response_state = NULL;
+    EXPECT_TRUE(oc_ri_invoke_coap_entity_handler(
+      &request, &response, &request_state, &response_state, 64, &endpoint_));
+    ASSERT_NE(nullptr, response_state);
+    EXPECT_TRUE(response_state->streamed);
+    EXPECT_EQ(0u, response_state->payload_size);
+    EXPECT_EQ(APPLICATION_OCTET_STREAM, response_state->return_content_type);
+    EXPECT_EQ(accept == APPLICATION_CBOR ? NOT_ACCEPTABLE_4_06 : CONTENT_2_05,
+              response.code);
+    oc_blockwise_free_response_buffer(response_state);
+  }
+
+  oc_connectivity_shutdown(0);
+  oc_blockwise_free_streams();
+  oc_core_shutdown();
+}
+
+TEST_F(TestBlockwiseStream, GetHandlerAnswersOtherAccept)
+{
+  /* /fp/g keeps its GET handler, which answers 4.00 to any Accept option
+   * other than link-format */
+  oc_core_init();
+  oc_add_device("myhname", "1.0.0", "//", "000001", NULL, NULL);
+
+  for (uint16_t accept : { 0, (int)APPLICATION_CBOR,
+                           (int)APPLICATION_LINK_FORMAT }) {
+    coap_packet_t request;
+    coap_packet_t response;
+    coap_udp_init_message(&request, COAP_TYPE_CON, COAP_GET, 1);
+    coap_udp_init_message(&response, COAP_TYPE_ACK, CONTENT_2_05, 1);
+    coap_set_header_uri_path(&request, "fp/g", 4);
+    if (accept != 0) {
+      coap_set_header_accept(&request, accept);
+    }
+    oc_blockwise_state_t *request_state = NULL;
+    oc_blockwise_state_t *response_state = NULL;
+    EXPECT_TRUE(oc_ri_invoke_coap_entity_handler(
+      &request, &response, &request_state, &response_state, 64, &endpoint_));
+    ASSERT_NE(nullptr, response_state);
+    bool link_format = (accept == APPLICATION_LINK_FORMAT);
+    EXPECT_EQ(link_format, response_state->streamed);
+    EXPECT_EQ(link_format ? CONTENT_2_05 : BAD_REQUEST_4_00, response.code);
+    oc_blockwise_free_response_buffer(response_state);
+  }
+
+  oc_connectivity_shutdown(0);
+  oc_blockwise_free_streams();
+  oc_core_shutdown();
+}
+
+#endif /* OC_BLOCK_WISE */
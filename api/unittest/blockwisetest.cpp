@@ -0,0 +1,160 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "oc_blockwise.h"
+#include "oc_ri.h"
+}
+
+#ifdef OC_BLOCK_WISE
+
+class TestBlockwise : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    oc_ri_init();
+    memset(&a_, 0, sizeof(a_));
+    a_.flags = IPV6;
+    a_.addr.ipv6.port = 5683;
+    b_ = a_;
+    b_.addr.ipv6.port = 5684;
+  }
+
+  void TearDown() override { oc_ri_shutdown(); }
+
+  static oc_blockwise_state_t *response(const char *href, oc_endpoint_t *ep,
+                                        oc_blockwise_role_t role)
+  {
+    return oc_blockwise_alloc_response_buffer(href, strlen(href), ep, OC_GET,
+                                              role);
+  }
+
+  static oc_blockwise_state_t *find(const char *href, oc_endpoint_t *ep,
+                                    oc_blockwise_role_t role)
+  {
+    return oc_blockwise_find_response_buffer(href, strlen(href), ep, OC_GET,
+                                             NULL, 0, role);
+  }
+
+  static void make_stale(oc_blockwise_state_t *state)
+  {
+    state->last_access -= (oc_clock_time_t)3600 * OC_CLOCK_SECOND;
+  }
+
+  oc_endpoint_t a_;
+  oc_endpoint_t b_;
+};
+
+TEST_F(TestBlockwise, FindByEndpointHrefAndRole)
+{
+  oc_blockwise_state_t *x = response("x", &a_, OC_BLOCKWISE_SERVER);
+  oc_blockwise_state_t *xy = response("xy", &a_, OC_BLOCKWISE_SERVER);
+  oc_blockwise_state_t *xb = response("x", &b_, OC_BLOCKWISE_SERVER);
+  oc_blockwise_state_t *xc = response("x", &a_, OC_BLOCKWISE_CLIENT);
+  ASSERT_NE(nullptr, x);
+  ASSERT_NE(nullptr, xy);
+  ASSERT_NE(nullptr, xb);
+  ASSERT_NE(nullptr, xc);
+
+  EXPECT_EQ(x, find("x", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(xy, find("xy", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(xb, find("x", &b_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(xc, find("x", &a_, OC_BLOCKWISE_CLIENT));
+  EXPECT_EQ(nullptr, find("xyz", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(nullptr, oc_blockwise_find_request_buffer(
+                       "x", 1, &a_, OC_GET, NULL, 0, OC_BLOCKWISE_SERVER));
+
+  oc_new_string(&x->uri_query, "if=a", 4);
+  EXPECT_EQ(nullptr, find("x", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(x, oc_blockwise_find_response_buffer("x", 1, &a_, OC_GET, "if=a",
+                                                 4, OC_BLOCKWISE_SERVER));
+
+  oc_blockwise_free_response_buffer(x);
+  EXPECT_EQ(nullptr, oc_blockwise_find_response_buffer(
+                       "x", 1, &a_, OC_GET, "if=a", 4, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(xb, find("x", &b_, OC_BLOCKWISE_SERVER));
+}
+
+#ifdef OC_CLIENT
+TEST_F(TestBlockwise, ClientIndexesFollowSetters)
+{
+  int cb;
+  uint8_t token[4] = { 1, 2, 3, 4 };
+  oc_blockwise_state_t *state = oc_blockwise_alloc_request_buffer(
+    "x", 1, &a_, OC_POST, OC_BLOCKWISE_CLIENT);
+  ASSERT_NE(nullptr, state);
+  EXPECT_EQ(nullptr, oc_blockwise_find_request_buffer_by_client_cb(&a_, &cb));
+  EXPECT_EQ(nullptr, oc_blockwise_find_request_buffer_by_token(token, 4));
+
+  oc_blockwise_set_mid(state, 7);
+  oc_blockwise_set_token(state, token, sizeof(token));
+  oc_blockwise_set_client_cb(state, &cb);
+  EXPECT_EQ(state, oc_blockwise_find_request_buffer_by_mid(7));
+  EXPECT_EQ(state, oc_blockwise_find_request_buffer_by_token(token, 4));
+  EXPECT_EQ(state, oc_blockwise_find_request_buffer_by_client_cb(&a_, &cb));
+  EXPECT_EQ(nullptr, oc_blockwise_find_request_buffer_by_client_cb(&b_, &cb));
+  EXPECT_EQ(nullptr, oc_blockwise_find_response_buffer_by_mid(7));
+
+  oc_blockwise_set_mid(state, 8);
+  EXPECT_EQ(nullptr, oc_blockwise_find_request_buffer_by_mid(7));
+  EXPECT_EQ(state, oc_blockwise_find_request_buffer_by_mid(8));
+
+  oc_blockwise_scrub_buffers_for_client_cb(&cb);
+  EXPECT_EQ(nullptr, oc_blockwise_find_request_buffer_by_mid(8));
+  EXPECT_EQ(nullptr, oc_blockwise_find_request_buffer_by_token(token, 4));
+}
+#endif /* OC_CLIENT */
+
+TEST_F(TestBlockwise, StaleServerTransferIsEvicted)
+{
+  char href[16];
+  std::vector<oc_blockwise_state_t *> states;
+  oc_blockwise_state_t *client = response("client", &a_, OC_BLOCKWISE_CLIENT);
+  ASSERT_NE(nullptr, client);
+  for (;;) {
+    snprintf(href, sizeof(href), "r%zu", states.size());
+    oc_blockwise_state_t *state = response(href, &a_, OC_BLOCKWISE_SERVER);
+    if (!state) {
+      break;
+    }
+    states.push_back(state);
+  }
+  ASSERT_GT(states.size(), 2u);
+
+  /* nothing is stale, the budget is exhausted */
+  EXPECT_EQ(nullptr, response("new", &a_, OC_BLOCKWISE_SERVER));
+
+  /* a stale client transfer is kept */
+  make_stale(client);
+  EXPECT_EQ(nullptr, response("new", &a_, OC_BLOCKWISE_SERVER));
+
+  make_stale(states[1]);
+  make_stale(states[2]);
+  states[2]->last_access -= OC_CLOCK_SECOND;
+  ASSERT_NE(nullptr, response("new", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(nullptr, find("r2", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(states[1], find("r1", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(states[0], find("r0", &a_, OC_BLOCKWISE_SERVER));
+  EXPECT_EQ(client, find("client", &a_, OC_BLOCKWISE_CLIENT));
+}
+
+#endif /* OC_BLOCK_WISE */
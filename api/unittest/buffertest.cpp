@@ -0,0 +1,132 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "oc_buffer.h"
+}
+
+#if defined(OC_DYNAMIC_ALLOCATION) && !defined(OC_INOUT_BUFFER_SIZE)
+TEST(TestBuffer, SlabReusesPayloads)
+{
+  oc_buffer_trim_slabs();
+  oc_buffer_slab_stats_t before;
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_MTU, &before));
+
+  oc_message_t *msg = oc_allocate_message();
+  ASSERT_NE(nullptr, msg);
+  uint8_t *data = msg->data;
+  oc_message_unref(msg);
+
+  msg = oc_allocate_message();
+  ASSERT_NE(nullptr, msg);
+  EXPECT_EQ(data, msg->data);
+  oc_message_unref(msg);
+
+  oc_buffer_slab_stats_t after;
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_MTU, &after));
+  EXPECT_EQ(before.num_allocs + 2, after.num_allocs);
+  EXPECT_EQ(before.num_heap_allocs + 1, after.num_heap_allocs);
+  EXPECT_EQ(0, after.num_in_use);
+  EXPECT_EQ((size_t)oc_get_mtu_size(), after.block_size);
+}
+
+TEST(TestBuffer, SlabSmallClass)
+{
+  oc_message_t *msg = oc_internal_allocate_outgoing_message_with_size(16);
+  ASSERT_NE(nullptr, msg);
+
+  oc_buffer_slab_stats_t stats;
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_SMALL, &stats));
+  EXPECT_EQ(1, stats.num_in_use);
+  EXPECT_EQ(OC_BUFFER_SLAB_SMALL_SIZE, stats.block_size);
+  oc_message_unref(msg);
+}
+
+TEST(TestBuffer, IncomingSizedFromLength)
+{
+  oc_message_t *msg = oc_allocate_message_with_size(40);
+  ASSERT_NE(nullptr, msg);
+  oc_buffer_slab_stats_t stats;
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_SMALL, &stats));
+  EXPECT_EQ(1, stats.num_in_use);
+  oc_message_unref(msg);
+}
+
+TEST(TestBuffer, ShrinkReceivedMessage)
+{
+  oc_message_t *msg = oc_allocate_message();
+  ASSERT_NE(nullptr, msg);
+  for (int i = 0; i < 40; i++) {
+    msg->data[i] = (uint8_t)i;
+  }
+  msg->length = 40;
+  oc_message_shrink(msg);
+
+  oc_buffer_slab_stats_t small;
+  oc_buffer_slab_stats_t mtu;
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_SMALL, &small));
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_MTU, &mtu));
+  EXPECT_EQ(1, small.num_in_use);
+  EXPECT_EQ(0, mtu.num_in_use);
+  for (int i = 0; i < 40; i++) {
+    EXPECT_EQ(i, msg->data[i]);
+  }
+  oc_message_unref(msg);
+
+  /* a message that needs the MTU class keeps its buffer */
+  msg = oc_allocate_message();
+  ASSERT_NE(nullptr, msg);
+  uint8_t *data = msg->data;
+  msg->length = OC_BUFFER_SLAB_SMALL_SIZE + 1;
+  oc_message_shrink(msg);
+  EXPECT_EQ(data, msg->data);
+  oc_message_unref(msg);
+}
+
+TEST(TestBuffer, SlabHighWaterMarkAndTrim)
+{
+  oc_message_t *msgs[5];
+  oc_buffer_reset_slab_high_water_marks();
+  for (int i = 0; i < 5; i++) {
+    msgs[i] = oc_allocate_message();
+    ASSERT_NE(nullptr, msgs[i]);
+  }
+  for (int i = 0; i < 5; i++) {
+    oc_message_unref(msgs[i]);
+  }
+
+  oc_buffer_slab_stats_t stats;
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_MTU, &stats));
+  EXPECT_EQ(5, stats.high_water_mark);
+  // idle, trimmed back to the reserve
+  EXPECT_EQ(OC_BUFFER_SLAB_MIN_FREE, stats.num_free);
+
+  oc_buffer_trim_slabs();
+  ASSERT_EQ(0, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_MTU, &stats));
+  EXPECT_EQ(0, stats.num_free);
+}
+#endif /* OC_DYNAMIC_ALLOCATION && !OC_INOUT_BUFFER_SIZE */
+
+TEST(TestBuffer, SlabStatsInvalidClass)
+{
+  oc_buffer_slab_stats_t stats;
+  EXPECT_EQ(-1, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_NUM_CLASSES, &stats));
+  EXPECT_EQ(-1, oc_buffer_get_slab_stats(OC_BUFFER_SLAB_MTU, NULL));
+}
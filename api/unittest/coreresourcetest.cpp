@@ -89,9 +89,30 @@ TEST_F(TestCoreResource, CoreGetResource_Wellknown_core)
   oc_core_init_platform(MANUFACTURER_NAME, NULL, NULL);
   oc_add_device("myhname", "1.0.0", "//", "000001", NULL, NULL);
 
-  // char uri[] = "/.well-known/core";
-  // oc_resource_t *res = oc_core_get_resource_by_uri(uri, 0);
+  char uri[] = "/.well-known/core";
+  oc_resource_t *res = oc_core_get_resource_by_uri(uri, 0);
 
-  // ASSERT_NE(res, NULL);
-  // EXPECT_EQ(strlen(uri), oc_string_len(res->uri));
+  ASSERT_NE(nullptr, res);
+  EXPECT_EQ(strlen(uri), oc_string_len(res->uri));
+  EXPECT_EQ(res, oc_core_get_resource_by_index(WELLKNOWNCORE, 0));
+
+  oc_connectivity_shutdown(0);
+}
+
+TEST_F(TestCoreResource, CoreGetResourceByPath)
+{
+  oc_core_init_platform(MANUFACTURER_NAME, NULL, NULL);
+  oc_add_device("myhname", "1.0.0", "//", "000001", NULL, NULL);
+
+  oc_resource_t *sn = oc_core_get_resource_by_index(OC_DEV_SN, 0);
+  oc_resource_t *g = oc_core_get_resource_by_index(OC_KNX_FP_G_X, 0);
+  EXPECT_EQ(sn, oc_core_get_resource_by_path("dev/sn", 6, 0));
+  EXPECT_EQ(nullptr, oc_core_get_resource_by_path("fp/g/", 5, 0));
+  EXPECT_EQ(g, oc_core_get_resource_by_path("fp/g/12", 7, 0));
+  EXPECT_EQ(oc_core_get_resource_by_index(OC_KNX_FP_G, 0),
+            oc_core_get_resource_by_path("fp/g", 4, 0));
+  EXPECT_EQ(nullptr, oc_core_get_resource_by_path("dev/s", 5, 0));
+  EXPECT_EQ(nullptr, oc_core_get_resource_by_path("dev/sn", 6, 1));
+
+  oc_connectivity_shutdown(0);
 }
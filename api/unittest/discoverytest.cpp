@@ -0,0 +1,223 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "api/oc_knx_fp.h"
+#include "oc_api.h"
+#include "oc_core_res.h"
+#include "oc_discovery.h"
+#include "oc_helpers.h"
+}
+
+static void
+get_handler(oc_request_t *request, oc_interface_mask_t iface_mask, void *data)
+{
+  (void)request;
+  (void)iface_mask;
+  (void)data;
+}
+
+class TestWellKnownCore : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    oc_ri_init();
+    oc_core_init();
+    oc_random_init();
+    oc_core_init_platform("Cascoda", NULL, NULL);
+    oc_add_device("myhname", "1.0.0", "//", "000001", NULL, NULL);
+    memset(&endpoint_, 0, sizeof(endpoint_));
+    endpoint_.flags = IPV6;
+  }
+
+  void TearDown() override
+  {
+    oc_connectivity_shutdown(0);
+    oc_core_shutdown();
+    oc_random_destroy();
+    oc_ri_shutdown();
+  }
+
+  std::string discover(const char *query)
+  {
+    uint8_t buffer[OC_MAX_APP_DATA_SIZE];
+    oc_response_buffer_t response_buffer;
+    memset(&response_buffer, 0, sizeof(response_buffer));
+    response_buffer.buffer = buffer;
+    response_buffer.buffer_size = sizeof(buffer);
+    oc_response_t response;
+    memset(&response, 0, sizeof(response));
+    response.response_buffer = &response_buffer;
+
+    oc_resource_t *wk = oc_core_get_resource_by_index(WELLKNOWNCORE, 0);
+    oc_request_t request;
+    memset(&request, 0, sizeof(request));
+    request.origin = &endpoint_;
+    request.resource = wk;
+    request.query = query;
+    request.query_len = query ? strlen(query) : 0;
+    request.accept = APPLICATION_LINK_FORMAT;
+    request.response = &response;
+
+    oc_rep_new(buffer, sizeof(buffer));
+    wk->get_handler.cb(&request, OC_IF_NONE, wk->get_handler.user_data);
+    code_ = response_buffer.code;
+    return std::string((const char *)buffer, response_buffer.response_length);
+  }
+
+  static oc_resource_t *add_point(const char *uri)
+  {
+    oc_resource_t *res = oc_new_resource(NULL, uri, 1, 0);
+    oc_resource_bind_resource_type(res, "urn:knx:dpa.417.61");
+    oc_resource_set_discoverable(res, true);
+    oc_resource_set_request_handler(res, OC_GET, get_handler, NULL);
+    oc_add_resource(res);
+    return res;
+  }
+
+  static void set_got_entry(int index, const char *href,
+                            std::vector<uint32_t> ga)
+  {
+    oc_group_object_table_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.id = index + 1;
+    oc_new_string(&entry.href, href, strlen(href));
+    entry.ga = ga.data();
+    entry.ga_len = (int)ga.size();
+    oc_core_set_group_object_table(index, entry);
+    oc_free_string(&entry.href);
+  }
+
+  oc_endpoint_t endpoint_;
+  int code_;
+};
+
+#ifdef OC_DYNAMIC_ALLOCATION
+
+TEST_F(TestWellKnownCore, ViewIsServedFromCache)
+{
+  std::string first = discover("ep=urn:knx:sn.*");
+  EXPECT_NE(std::string::npos, first.find("urn:knx:sn.000001"));
+
+  /* the serial number is not part of the cache key, so a changed serial
+   * number only shows up once the views are dropped */
+  oc_device_info_t *device = oc_core_get_device_info(0);
+  oc_free_string(&device->serialnumber);
+  oc_new_string(&device->serialnumber, "000002", 6);
+  EXPECT_EQ(first, discover("ep=urn:knx:sn.*"));
+  oc_discovery_invalidate_views();
+  EXPECT_NE(std::string::npos,
+            discover("ep=urn:knx:sn.*").find("urn:knx:sn.000002"));
+}
+
+TEST_F(TestWellKnownCore, ProgrammingModeIsFollowed)
+{
+  oc_device_info_t *device = oc_core_get_device_info(0);
+  device->pm = false;
+  discover("if=urn:knx:if.pm");
+  EXPECT_EQ(oc_status_code(OC_STATUS_BAD_REQUEST), code_);
+  endpoint_.flags = (transport_flags)(IPV6 | MULTICAST);
+  discover("if=urn:knx:if.pm");
+  EXPECT_EQ(OC_IGNORE, code_);
+
+  device->pm = true;
+  EXPECT_NE(std::string::npos,
+            discover("if=urn:knx:if.pm").find("urn:knx:sn.000001"));
+  EXPECT_EQ(oc_status_code(OC_STATUS_OK), code_);
+}
+
+TEST_F(TestWellKnownCore, AddingResourceDropsViews)
+{
+  EXPECT_EQ(std::string::npos, discover(NULL).find("</f/417"));
+
+  oc_resource_t *res = oc_new_resource(NULL, "/p/1", 1, 0);
+  oc_resource_bind_resource_type(res, "urn:knx:dpa.417.61");
+  oc_resource_set_discoverable(res, true);
+  oc_resource_set_request_handler(res, OC_GET, get_handler, NULL);
+  ASSERT_TRUE(oc_add_resource(res));
+  EXPECT_NE(std::string::npos, discover(NULL).find("</f/417"));
+
+  oc_delete_resource(res);
+  EXPECT_EQ(std::string::npos, discover(NULL).find("</f/417"));
+}
+
+TEST_F(TestWellKnownCore, ChangingResourceDropsViews)
+{
+  oc_resource_t *res = oc_new_resource(NULL, "/p/1", 2, 0);
+  oc_resource_bind_resource_type(res, "urn:knx:dpa.417.61");
+  oc_resource_set_discoverable(res, true);
+  oc_resource_set_request_handler(res, OC_GET, get_handler, NULL);
+  ASSERT_TRUE(oc_add_resource(res));
+  EXPECT_NE(std::string::npos, discover(NULL).find("</f/417"));
+
+  oc_resource_set_discoverable(res, false);
+  EXPECT_EQ(std::string::npos, discover(NULL).find("</f/417"));
+  oc_resource_set_discoverable(res, true);
+  EXPECT_NE(std::string::npos, discover(NULL).find("</f/417"));
+
+  EXPECT_EQ(std::string::npos, discover(NULL).find("</f/418"));
+  oc_resource_bind_resource_type(res, "urn:knx:dpa.418.61");
+  EXPECT_NE(std::string::npos, discover(NULL).find("</f/418"));
+
+  oc_delete_resource(res);
+}
+
+#endif /* OC_DYNAMIC_ALLOCATION */
+
+TEST_F(TestWellKnownCore, GroupAddressListsDatapoints)
+{
+  oc_core_get_device_info(0)->lsm_s = LSM_S_LOADED;
+  oc_resource_t *a = add_point("/p/a");
+  oc_resource_t *b = add_point("/p/b");
+  set_got_entry(0, "/p/a", { 1, 2 });
+  set_got_entry(1, "/p/b", { 2 });
+
+  std::string one = discover("d=urn:knx:g.s.1");
+  EXPECT_EQ(oc_status_code(OC_STATUS_OK), code_);
+  EXPECT_NE(std::string::npos, one.find("/p/a>"));
+  EXPECT_EQ(std::string::npos, one.find("/p/b>"));
+
+  std::string two = discover("d=urn:knx:g.s.2");
+  size_t pos_a = two.find("/p/a>");
+  size_t pos_b = two.find("/p/b>");
+  ASSERT_NE(std::string::npos, pos_a);
+  ASSERT_NE(std::string::npos, pos_b);
+  EXPECT_LT(pos_a, pos_b);
+  EXPECT_NE(std::string::npos, two.find(",\n", pos_a));
+  /* the framed lines are reused for the next query */
+  EXPECT_EQ(two, discover("d=urn:knx:g.s.2"));
+
+  discover("d=urn:knx:g.s.3");
+  EXPECT_EQ(oc_status_code(OC_STATUS_BAD_REQUEST), code_);
+
+  /* changing the table or the resources drops the index */
+  set_got_entry(1, "/p/b", { 3 });
+  EXPECT_EQ(std::string::npos, discover("d=urn:knx:g.s.2").find("/p/b>"));
+  EXPECT_NE(std::string::npos, discover("d=urn:knx:g.s.3").find("/p/b>"));
+  oc_delete_resource(b);
+  EXPECT_EQ(std::string::npos, discover("d=urn:knx:g.s.3").find("/p/b>"));
+
+  oc_delete_group_object_table_entry(0);
+  oc_delete_group_object_table_entry(1);
+  oc_delete_resource(a);
+}
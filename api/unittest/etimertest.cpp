@@ -0,0 +1,174 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "util/oc_etimer.h"
+#include "util/oc_process.h"
+}
+
+static std::vector<struct oc_etimer *> fired;
+
+OC_PROCESS(test_etimer_process, "etimer test");
+OC_PROCESS_THREAD(test_etimer_process, ev, data)
+{
+  OC_PROCESS_BEGIN();
+  while (1) {
+    OC_PROCESS_YIELD();
+    if (ev == OC_PROCESS_EVENT_TIMER) {
+      fired.push_back((struct oc_etimer *)data);
+    }
+  }
+  OC_PROCESS_END();
+}
+
+class TestEtimer : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    fired.clear();
+    oc_process_init();
+    oc_process_start(&oc_etimer_process, NULL);
+    oc_process_start(&test_etimer_process, NULL);
+  }
+
+  void TearDown() override
+  {
+    oc_process_exit(&test_etimer_process);
+    oc_process_exit(&oc_etimer_process);
+    oc_process_shutdown();
+  }
+
+  static void set(struct oc_etimer *et, oc_clock_time_t interval)
+  {
+    OC_PROCESS_CONTEXT_BEGIN(&test_etimer_process);
+    oc_etimer_set(et, interval);
+    OC_PROCESS_CONTEXT_END(&test_etimer_process);
+  }
+
+  static void run()
+  {
+    oc_etimer_request_poll();
+    while (oc_process_run()) {
+    }
+  }
+};
+
+TEST_F(TestEtimer, NextExpirationIsExact)
+{
+  struct oc_etimer timers[3] = {};
+  set(&timers[0], 30 * OC_CLOCK_SECOND);
+  set(&timers[1], 10 * OC_CLOCK_SECOND);
+  set(&timers[2], 20 * OC_CLOCK_SECOND);
+
+  EXPECT_TRUE(oc_etimer_pending());
+  EXPECT_EQ(oc_etimer_expiration_time(&timers[1]),
+            oc_etimer_next_expiration_time());
+
+  oc_etimer_stop(&timers[1]);
+  EXPECT_TRUE(oc_etimer_expired(&timers[1]));
+  EXPECT_EQ(oc_etimer_expiration_time(&timers[2]),
+            oc_etimer_next_expiration_time());
+
+  // moving a timer ahead of the others makes it the next one
+  oc_etimer_adjust(&timers[0], -(int)(15 * OC_CLOCK_SECOND));
+  EXPECT_EQ(oc_etimer_expiration_time(&timers[0]),
+            oc_etimer_next_expiration_time());
+
+  oc_etimer_stop(&timers[0]);
+  oc_etimer_stop(&timers[2]);
+  EXPECT_FALSE(oc_etimer_pending());
+  EXPECT_EQ(0, oc_etimer_next_expiration_time());
+}
+
+TEST_F(TestEtimer, FiresInExpirationOrder)
+{
+  const int count = 64;
+  struct oc_etimer timers[count] = {};
+  std::mt19937 rng(1);
+  for (int i = 0; i < count; i++) {
+    set(&timers[i], 1000 + rng() % 1000);
+  }
+  // re-arming a pending timer must not add it twice
+  set(&timers[0], 500);
+  for (int i = 0; i < count; i++) {
+    oc_etimer_adjust(&timers[i], -(int)(10 * OC_CLOCK_SECOND));
+  }
+
+  run();
+  ASSERT_EQ((size_t)count, fired.size());
+  for (int i = 1; i < count; i++) {
+    EXPECT_LE(oc_etimer_expiration_time(fired[i - 1]),
+              oc_etimer_expiration_time(fired[i]));
+  }
+  for (int i = 0; i < count; i++) {
+    EXPECT_TRUE(oc_etimer_expired(&timers[i]));
+  }
+  EXPECT_FALSE(oc_etimer_pending());
+}
+
+TEST_F(TestEtimer, ExitedProcessDropsTimers)
+{
+  struct oc_etimer timers[4] = {};
+  for (int i = 0; i < 4; i++) {
+    set(&timers[i], (i + 1) * OC_CLOCK_SECOND);
+  }
+  oc_process_exit(&test_etimer_process);
+  EXPECT_FALSE(oc_etimer_pending());
+}
+
+TEST_F(TestEtimer, Benchmark10kTimers)
+{
+  using bench_clock = std::chrono::steady_clock;
+  const int count = 10000;
+  std::vector<struct oc_etimer> timers(count);
+  std::mt19937 rng(42);
+
+  bench_clock::time_point start = bench_clock::now();
+  for (int i = 0; i < count; i++) {
+    set(&timers[i], OC_CLOCK_SECOND + rng() % (60 * OC_CLOCK_SECOND));
+  }
+  bench_clock::time_point armed = bench_clock::now();
+
+  // cancel every other timer, as acknowledged retransmissions do
+  for (int i = 0; i < count; i += 2) {
+    oc_etimer_stop(&timers[i]);
+  }
+  bench_clock::time_point stopped = bench_clock::now();
+
+  for (int i = 1; i < count; i += 2) {
+    oc_etimer_adjust(&timers[i], -(int)(120 * OC_CLOCK_SECOND));
+  }
+  bench_clock::time_point expire = bench_clock::now();
+  run();
+  bench_clock::time_point done = bench_clock::now();
+
+  EXPECT_EQ((size_t)count / 2, fired.size());
+  EXPECT_FALSE(oc_etimer_pending());
+
+  auto us = [](bench_clock::time_point a, bench_clock::time_point b) {
+    return std::chrono::duration<double, std::micro>(b - a).count();
+  };
+  printf("[ ETIMER   ] %d timers: set %.0f us, stop %.0f us, fire %.0f us\n",
+         count, us(start, armed), us(armed, stopped), us(expire, done));
+}
@@ -0,0 +1,106 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <list>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "util/oc_hash_index.h"
+}
+
+struct entry
+{
+  uint16_t key;
+  int id;
+};
+
+/* what a scan of the list finds */
+static entry *
+scan(std::list<entry *> &list, uint16_t key)
+{
+  for (entry *e : list) {
+    if (e->key == key) {
+      return e;
+    }
+  }
+  return nullptr;
+}
+
+static entry *
+lookup(oc_hash_index_t *index, uint16_t key)
+{
+  uint32_t hash = oc_hash_u16(key), pos;
+  entry *e = (entry *)oc_hash_index_first(index, hash, &pos);
+  for (; e; e = (entry *)oc_hash_index_next(index, hash, &pos)) {
+    if (e->key == key) {
+      return e;
+    }
+  }
+  return nullptr;
+}
+
+TEST(HashIndex, MatchesListScan)
+{
+  oc_hash_index_t index = {};
+  std::vector<entry> entries(400);
+  std::list<entry *> list;
+  std::mt19937 rng(7);
+
+  for (int round = 0; round < 20000; round++) {
+    entry *e = &entries[rng() % entries.size()];
+    auto it = std::find(list.begin(), list.end(), e);
+    if (it == list.end()) {
+      /* few distinct keys, so that runs of equal keys are common */
+      e->key = (uint16_t)(rng() % 64);
+      e->id = round;
+      ASSERT_TRUE(oc_hash_index_add(&index, e, oc_hash_u16(e->key)));
+      list.push_back(e);
+    } else {
+      oc_hash_index_remove(&index, e, oc_hash_u16(e->key));
+      list.erase(it);
+    }
+    uint16_t key = (uint16_t)(rng() % 64);
+    ASSERT_EQ(scan(list, key), lookup(&index, key)) << "round " << round;
+  }
+  EXPECT_EQ(list.size(), index.count);
+  oc_hash_index_clear(&index);
+  EXPECT_EQ(0u, index.count);
+  EXPECT_EQ(nullptr, lookup(&index, 0));
+}
+
+TEST(HashIndex, RemoveUnknownEntry)
+{
+  oc_hash_index_t index = {};
+  entry a = { 1, 0 }, b = { 1, 1 };
+  ASSERT_TRUE(oc_hash_index_add(&index, &a, oc_hash_u16(a.key)));
+  oc_hash_index_remove(&index, &b, oc_hash_u16(b.key));
+  EXPECT_EQ(1u, index.count);
+  EXPECT_EQ(&a, lookup(&index, 1));
+  oc_hash_index_clear(&index);
+}
+
+TEST(HashIndex, BytesHash)
+{
+  const uint8_t token[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  EXPECT_EQ(oc_hash_bytes(token, sizeof(token)),
+            oc_hash_bytes(token, sizeof(token)));
+  EXPECT_NE(oc_hash_bytes(token, 4), oc_hash_bytes(token, 8));
+}
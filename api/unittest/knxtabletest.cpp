@@ -0,0 +1,213 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "api/oc_knx_fp.h"
+#include "api/oc_knx_table.h"
+#include "oc_helpers.h"
+}
+
+struct row
+{
+  int id;
+  oc_string_t href;
+  oc_string_t key;
+  bool a;
+  oc_cflag_mask_t cflags;
+  int64_t *ga;
+  int ga_len;
+};
+
+static const oc_table_field_t fields[] = {
+  OC_TABLE_FIELD(row, id, OC_TABLE_INT, "id", 0),
+  OC_TABLE_FIELD(row, href, OC_TABLE_TEXT, "href", 11),
+  OC_TABLE_FIELD(row, key, OC_TABLE_BYTES, "key", 107),
+  OC_TABLE_FIELD(row, a, OC_TABLE_BOOL, "a", 97),
+  OC_TABLE_FIELD(row, cflags, OC_TABLE_CFLAGS, "cflags", 8),
+  OC_TABLE_ARRAY(row, ga, ga_len, OC_TABLE_INT64_ARRAY, "ga", 7),
+};
+#define NUM_FIELDS (sizeof(fields) / sizeof(fields[0]))
+
+/* the same row, with key and a nested as on the wire of /fp/gm */
+static const oc_table_field_t nested_fields[] = {
+  OC_TABLE_FIELD(row, id, OC_TABLE_INT, "id", 0),
+  OC_TABLE_NESTED(row, key, OC_TABLE_BYTES, "key", 2, 115, 107),
+  OC_TABLE_NESTED(row, a, OC_TABLE_BOOL, "a", 3, 115, 28, 97),
+};
+#define NUM_NESTED_FIELDS (sizeof(nested_fields) / sizeof(nested_fields[0]))
+
+class TestKnxTable : public testing::Test {
+protected:
+  void SetUp() override { memset(&row_, 0, sizeof(row_)); }
+
+  void TearDown() override { oc_table_free(fields, NUM_FIELDS, &row_); }
+
+  CborError decode(const oc_table_field_t *f, size_t n, size_t len)
+  {
+    CborParser parser;
+    CborValue value;
+    CborError err = cbor_parser_init(buf_, len, 0, &parser, &value);
+    if (err != CborNoError) {
+      return err;
+    }
+    return oc_table_decode(&value, f, n, &row_);
+  }
+
+  uint8_t buf_[256];
+  row row_;
+};
+
+TEST_F(TestKnxTable, DecodeFlat)
+{
+  CborEncoder encoder, map, array;
+  cbor_encoder_init(&encoder, buf_, sizeof(buf_), 0);
+  cbor_encoder_create_map(&encoder, &map, CborIndefiniteLength);
+  cbor_encode_int(&map, 0);
+  cbor_encode_int(&map, 5);
+  cbor_encode_int(&map, 11);
+  cbor_encode_text_stringz(&map, "/p/1");
+  /* unknown keys are skipped, including containers */
+  cbor_encode_int(&map, 42);
+  cbor_encoder_create_array(&map, &array, 2);
+  cbor_encode_int(&array, 1);
+  cbor_encode_int(&array, 2);
+  cbor_encoder_close_container(&map, &array);
+  cbor_encode_text_stringz(&map, "x");
+  cbor_encode_int(&map, 1);
+  cbor_encode_int(&map, 8);
+  cbor_encoder_create_array(&map, &array, 2);
+  cbor_encode_int(&array, 1);
+  cbor_encode_int(&array, 2);
+  cbor_encoder_close_container(&map, &array);
+  cbor_encode_int(&map, 7);
+  cbor_encoder_create_array(&map, &array, 3);
+  cbor_encode_int(&array, 1);
+  cbor_encode_int(&array, 2);
+  cbor_encode_int(&array, 3);
+  cbor_encoder_close_container(&map, &array);
+  ASSERT_EQ(CborNoError, cbor_encoder_close_container(&encoder, &map));
+
+  ASSERT_EQ(CborNoError,
+            decode(fields, NUM_FIELDS,
+                   cbor_encoder_get_buffer_size(&encoder, buf_)));
+  EXPECT_EQ(5, row_.id);
+  EXPECT_STREQ("/p/1", oc_string(row_.href));
+  EXPECT_EQ(OC_CFLAG_READ | OC_CFLAG_WRITE, row_.cflags);
+  ASSERT_EQ(3, row_.ga_len);
+  EXPECT_EQ(1, row_.ga[0]);
+  EXPECT_EQ(3, row_.ga[2]);
+  EXPECT_EQ(0u, oc_string_len(row_.key));
+}
+
+TEST_F(TestKnxTable, DecodeNested)
+{
+  const uint8_t key[] = { 0xDE, 0xAD, 0xBE, 0xEF };
+  CborEncoder encoder, map, s, c;
+  cbor_encoder_init(&encoder, buf_, sizeof(buf_), 0);
+  cbor_encoder_create_map(&encoder, &map, CborIndefiniteLength);
+  cbor_encode_int(&map, 0);
+  cbor_encode_int(&map, 1);
+  cbor_encode_int(&map, 115);
+  cbor_encoder_create_map(&map, &s, CborIndefiniteLength);
+  cbor_encode_int(&s, 107);
+  cbor_encode_byte_string(&s, key, sizeof(key));
+  cbor_encode_int(&s, 28);
+  cbor_encoder_create_map(&s, &c, CborIndefiniteLength);
+  cbor_encode_int(&c, 97);
+  cbor_encode_boolean(&c, true);
+  cbor_encoder_close_container(&s, &c);
+  cbor_encoder_close_container(&map, &s);
+  ASSERT_EQ(CborNoError, cbor_encoder_close_container(&encoder, &map));
+
+  ASSERT_EQ(CborNoError,
+            decode(nested_fields, NUM_NESTED_FIELDS,
+                   cbor_encoder_get_buffer_size(&encoder, buf_)));
+  EXPECT_EQ(1, row_.id);
+  EXPECT_TRUE(row_.a);
+  ASSERT_EQ(sizeof(key), oc_string_len(row_.key));
+  EXPECT_EQ(0, memcmp(key, oc_string(row_.key), sizeof(key)));
+}
+
+TEST_F(TestKnxTable, EncodeDecodeRoundTrip)
+{
+  const uint8_t key[] = { 1, 2, 3 };
+  int64_t ga[] = { 1, 4000, 65535 };
+  row in;
+  memset(&in, 0, sizeof(in));
+  in.id = 7;
+  oc_new_string(&in.href, "/p/7", 4);
+  oc_new_string(&in.key, (const char *)key, sizeof(key));
+  in.a = true;
+  in.cflags = (oc_cflag_mask_t)(OC_CFLAG_READ | OC_CFLAG_INIT);
+  in.ga = ga;
+  in.ga_len = 3;
+
+  CborEncoder encoder, map;
+  cbor_encoder_init(&encoder, buf_, sizeof(buf_), 0);
+  cbor_encoder_create_map(&encoder, &map, CborIndefiniteLength);
+  oc_table_encode(&map, fields, NUM_FIELDS, &in);
+  ASSERT_EQ(CborNoError, cbor_encoder_close_container(&encoder, &map));
+  oc_free_string(&in.href);
+  oc_free_string(&in.key);
+
+  ASSERT_EQ(CborNoError,
+            decode(fields, NUM_FIELDS,
+                   cbor_encoder_get_buffer_size(&encoder, buf_)));
+  EXPECT_EQ(7, row_.id);
+  EXPECT_STREQ("/p/7", oc_string(row_.href));
+  ASSERT_EQ(sizeof(key), oc_string_len(row_.key));
+  EXPECT_EQ(0, memcmp(key, oc_string(row_.key), sizeof(key)));
+  EXPECT_TRUE(row_.a);
+  EXPECT_EQ(in.cflags, row_.cflags);
+  ASSERT_EQ(3, row_.ga_len);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(ga[i], row_.ga[i]);
+  }
+}
+
+TEST_F(TestKnxTable, FindInt)
+{
+  CborEncoder encoder, map;
+  cbor_encoder_init(&encoder, buf_, sizeof(buf_), 0);
+  cbor_encoder_create_map(&encoder, &map, CborIndefiniteLength);
+  cbor_encode_int(&map, 11);
+  cbor_encode_text_stringz(&map, "/p/1");
+  cbor_encode_int(&map, 0);
+  cbor_encode_int(&map, 9);
+  ASSERT_EQ(CborNoError, cbor_encoder_close_container(&encoder, &map));
+
+  CborParser parser;
+  CborValue value;
+  ASSERT_EQ(CborNoError,
+            cbor_parser_init(buf_, cbor_encoder_get_buffer_size(&encoder, buf_),
+                             0, &parser, &value));
+  int64_t id = 0;
+  EXPECT_TRUE(oc_table_find_int(&value, 0, &id));
+  EXPECT_EQ(9, id);
+  EXPECT_FALSE(oc_table_find_int(&value, 11, &id));
+  EXPECT_FALSE(oc_table_find_int(&value, 1, &id));
+
+  /* the map is not advanced */
+  EXPECT_TRUE(cbor_value_is_map(&value));
+  CborValue href;
+  EXPECT_TRUE(oc_table_find_string(&value, 11, &href));
+  EXPECT_TRUE(cbor_value_is_text_string(&href));
+}
@@ -0,0 +1,180 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "api/oc_notify_conditions_internal.h"
+#include "oc_api.h"
+#include "oc_ri.h"
+#include "port/oc_clock.h"
+#include "util/oc_etimer.h"
+#include "util/oc_process.h"
+}
+
+/* apitest is linked with --wrap=oc_clock_time, so the stack reads the time
+ * from this clock, which the tests move forward instead of sleeping */
+static oc_clock_time_t clock_offset;
+
+extern "C" oc_clock_time_t __real_oc_clock_time(void);
+
+extern "C" oc_clock_time_t
+__wrap_oc_clock_time(void)
+{
+  return __real_oc_clock_time() + clock_offset;
+}
+
+#ifdef OC_SERVER
+
+static int get_calls;
+
+static void
+on_get(oc_request_t *request, oc_interface_mask_t iface_mask, void *user_data)
+{
+  (void)iface_mask;
+  (void)user_data;
+  get_calls++;
+  oc_send_response(request, OC_STATUS_OK);
+}
+
+class TestNotifyConditions : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    oc_ri_init();
+    get_calls = 0;
+    resource_ = oc_new_resource("sensor", "/sensor", 1, 0);
+    oc_resource_set_observable(resource_, true);
+    oc_resource_set_request_handler(resource_, OC_GET, on_get, NULL);
+    oc_ri_add_resource(resource_);
+    /* notifications are built for a registered observer; none is sent since
+     * no observer is listed */
+    resource_->num_observers = 1;
+  }
+
+  void TearDown() override
+  {
+    resource_->num_observers = 0;
+    oc_ri_delete_resource(resource_);
+    oc_ri_shutdown();
+  }
+
+  static void advance_and_run_timers(uint32_t ms)
+  {
+    clock_offset += (oc_clock_time_t)ms * OC_CLOCK_SECOND / 1000;
+    oc_etimer_request_poll();
+    while (oc_process_run()) {
+    }
+  }
+
+  oc_notify_stats_t stats()
+  {
+    oc_notify_stats_t s;
+    EXPECT_TRUE(oc_resource_get_notify_stats(resource_, &s));
+    return s;
+  }
+
+  oc_resource_t *resource_;
+};
+
+TEST_F(TestNotifyConditions, WithoutConditionsNotifiesRightAway)
+{
+  oc_notify_observers(resource_);
+  oc_notify_observers(resource_);
+  EXPECT_EQ(2, get_calls);
+  oc_notify_stats_t s;
+  EXPECT_FALSE(oc_resource_get_notify_stats(resource_, &s));
+}
+
+TEST_F(TestNotifyConditions, CoalescesWithinPmin)
+{
+  ASSERT_TRUE(oc_resource_set_notify_conditions(resource_, 10000, 0, 0));
+  oc_notify_observers(resource_);
+  EXPECT_EQ(1, get_calls);
+  for (int i = 0; i < 5; i++) {
+    oc_notify_observers(resource_);
+  }
+  /* one notification is deferred to the end of pmin, the others are merged
+   * into it */
+  EXPECT_EQ(1, get_calls);
+  EXPECT_EQ(4u, stats().skipped);
+
+  advance_and_run_timers(5000);
+  EXPECT_EQ(1, get_calls);
+  advance_and_run_timers(10000);
+  EXPECT_EQ(2, get_calls);
+  EXPECT_EQ(2u, stats().sent);
+}
+
+TEST_F(TestNotifyConditions, StepSkipsSmallChanges)
+{
+  ASSERT_TRUE(oc_resource_set_notify_conditions(resource_, 0, 0, 1.0));
+  oc_notify_observers_value(resource_, 10.0);
+  oc_notify_observers_value(resource_, 10.5);
+  oc_notify_observers_value(resource_, 11.2);
+  oc_notify_observers_value(resource_, 10.5);
+  oc_notify_observers_value(resource_, 9.0);
+  EXPECT_EQ(3, get_calls);
+  EXPECT_EQ(3u, stats().sent);
+  EXPECT_EQ(2u, stats().skipped);
+}
+
+TEST_F(TestNotifyConditions, PmaxSendsWithoutChange)
+{
+  ASSERT_TRUE(oc_resource_set_notify_conditions(resource_, 0, 60000, 0));
+  oc_notify_observers(resource_);
+  EXPECT_EQ(1, get_calls);
+  advance_and_run_timers(90000);
+  EXPECT_EQ(2, get_calls);
+
+  /* no more notifications once the observers are gone */
+  resource_->num_observers = 0;
+  advance_and_run_timers(90000);
+  EXPECT_EQ(2, get_calls);
+}
+
+TEST_F(TestNotifyConditions, PmaxStartsWithTheObservation)
+{
+  resource_->num_observers = 0;
+  ASSERT_TRUE(oc_resource_set_notify_conditions(resource_, 0, 60000, 0));
+  advance_and_run_timers(90000);
+  EXPECT_EQ(0, get_calls);
+
+  /* a resource that never changes is still reported after pmax */
+  resource_->num_observers = 1;
+  oc_notify_conditions_observed(resource_);
+  advance_and_run_timers(30000);
+  EXPECT_EQ(0, get_calls);
+  /* a second observer does not restart the period */
+  oc_notify_conditions_observed(resource_);
+  advance_and_run_timers(40000);
+  EXPECT_EQ(1, get_calls);
+}
+
+TEST_F(TestNotifyConditions, InvalidConditions)
+{
+  EXPECT_FALSE(oc_resource_set_notify_conditions(NULL, 0, 0, 0));
+  EXPECT_FALSE(oc_resource_set_notify_conditions(resource_, 100, 50, 0));
+  ASSERT_TRUE(oc_resource_set_notify_conditions(resource_, 10000, 0, 0));
+  /* all zero removes the conditions */
+  ASSERT_TRUE(oc_resource_set_notify_conditions(resource_, 0, 0, 0));
+  oc_notify_stats_t s;
+  EXPECT_FALSE(oc_resource_get_notify_stats(resource_, &s));
+}
+
+#endif /* OC_SERVER */
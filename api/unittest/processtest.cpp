@@ -0,0 +1,144 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <gtest/gtest.h>
+#include <string>
+
+extern "C" {
+#include "util/oc_process.h"
+}
+
+static std::string delivered;
+
+#define TEST_EVENT (OC_PROCESS_EVENT_MAX + 1)
+
+OC_PROCESS(test_app_process, "app");
+OC_PROCESS_THREAD(test_app_process, ev, data)
+{
+  OC_PROCESS_BEGIN();
+  while (1) {
+    OC_PROCESS_YIELD();
+    if (ev == TEST_EVENT || ev == OC_PROCESS_EVENT_TIMER) {
+      delivered += (char)(intptr_t)data;
+    }
+  }
+  OC_PROCESS_END();
+}
+
+OC_PROCESS(test_net_process, "net");
+OC_PROCESS_THREAD(test_net_process, ev, data)
+{
+  OC_PROCESS_BEGIN();
+  while (1) {
+    OC_PROCESS_YIELD();
+    if (ev == TEST_EVENT) {
+      delivered += (char)(intptr_t)data;
+    }
+  }
+  OC_PROCESS_END();
+}
+
+class TestProcess : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    delivered.clear();
+    oc_process_init();
+    oc_process_set_priority(&test_net_process, OC_PROCESS_PRIORITY_NETWORK);
+    oc_process_start(&test_app_process, NULL);
+    oc_process_start(&test_net_process, NULL);
+  }
+
+  void TearDown() override
+  {
+    oc_process_exit(&test_app_process);
+    oc_process_exit(&test_net_process);
+    oc_process_set_priority(&test_net_process,
+                            OC_PROCESS_PRIORITY_APPLICATION);
+    oc_process_shutdown();
+  }
+
+  static void post(struct oc_process *p, oc_process_event_t ev, char tag)
+  {
+    EXPECT_EQ(OC_PROCESS_ERR_OK,
+              oc_process_post(p, ev, (oc_process_data_t)(intptr_t)tag));
+  }
+};
+
+TEST_F(TestProcess, HigherPriorityFirst)
+{
+  post(&test_app_process, TEST_EVENT, 'a');
+  post(&test_app_process, OC_PROCESS_EVENT_TIMER, 't');
+  post(&test_net_process, TEST_EVENT, 'n');
+
+  EXPECT_EQ(3, oc_process_nevents());
+  EXPECT_EQ(0, oc_process_run());
+  EXPECT_EQ("nta", delivered);
+}
+
+TEST_F(TestProcess, QuotaBoundsOneRun)
+{
+  oc_process_set_quota(OC_PROCESS_PRIORITY_NETWORK, 2);
+  for (char c = '0'; c < '5'; c++) {
+    post(&test_net_process, TEST_EVENT, c);
+  }
+  post(&test_app_process, TEST_EVENT, 'a');
+
+  // lower levels are still served while a higher one is busy
+  EXPECT_EQ(3, oc_process_run());
+  EXPECT_EQ("01a", delivered);
+  while (oc_process_run()) {
+  }
+  EXPECT_EQ("01a234", delivered);
+  oc_process_set_quota(OC_PROCESS_PRIORITY_NETWORK, 16);
+}
+
+TEST_F(TestProcess, QueueGrowsInOrder)
+{
+  std::string expected;
+  for (int i = 0; i < 100; i++) {
+    char c = (char)('!' + i % 90);
+    post(&test_app_process, TEST_EVENT, c);
+    expected += c;
+  }
+  while (oc_process_run()) {
+  }
+  EXPECT_EQ(expected, delivered);
+}
+
+TEST_F(TestProcess, QueueStats)
+{
+  oc_process_reset_queue_stats();
+  for (int i = 0; i < 3; i++) {
+    post(&test_net_process, TEST_EVENT, 'n');
+  }
+  oc_process_queue_stats_t stats;
+  ASSERT_EQ(0, oc_process_get_queue_stats(OC_PROCESS_PRIORITY_NETWORK, &stats));
+  EXPECT_EQ(3u, stats.depth);
+  EXPECT_EQ(3u, stats.max_depth);
+  EXPECT_EQ(0u, stats.delivered);
+
+  oc_process_run();
+  ASSERT_EQ(0, oc_process_get_queue_stats(OC_PROCESS_PRIORITY_NETWORK, &stats));
+  EXPECT_EQ(0u, stats.depth);
+  EXPECT_EQ(3u, stats.max_depth);
+  EXPECT_EQ(3u, stats.delivered);
+  EXPECT_EQ(0u, stats.drops);
+
+  EXPECT_EQ(-1, oc_process_get_queue_stats(OC_PROCESS_NUM_PRIORITIES, &stats));
+}
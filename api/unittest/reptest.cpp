@@ -408,6 +408,119 @@ TEST(TestRep, OCRepSetGetTextString)
   oc_free_rep(rep);
 }
 
+TEST(TestRep, OCRepParseInPlace)
+{
+  uint8_t buf[1024];
+  oc_rep_new(&buf[0], 1024);
+
+  oc_rep_begin_root_object();
+  oc_rep_set_text_string(root, hal9000, "Dave");
+  oc_rep_set_int(root, answer, 42);
+  int64_t ints[3] = { 1, 2, 3 };
+  oc_rep_set_int_array(root, ints, ints, 3);
+  oc_rep_end_root_object();
+  EXPECT_EQ(CborNoError, oc_rep_get_cbor_errno());
+
+  const uint8_t *payload = oc_rep_get_encoder_buf();
+  int payload_len = oc_rep_get_encoded_payload_size();
+  EXPECT_NE(payload_len, -1);
+  /* the pool must not be touched while parsing in an arena */
+  oc_rep_set_pool(NULL);
+  uint64_t arena_buffer[64];
+  oc_arena_t arena;
+  oc_arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+  oc_rep_t *rep = NULL;
+  ASSERT_EQ(CborNoError,
+            oc_parse_rep_in_place(payload, payload_len, &arena, &rep));
+  ASSERT_TRUE(rep != NULL);
+
+  /* the string points into the payload and is not terminated */
+  char *hal9000_out = NULL;
+  size_t str_len;
+  EXPECT_TRUE(oc_rep_get_string(rep, "hal9000", &hal9000_out, &str_len));
+  EXPECT_EQ(4, str_len);
+  EXPECT_EQ(0, memcmp("Dave", hal9000_out, str_len));
+  EXPECT_GE((const uint8_t *)hal9000_out, payload);
+  EXPECT_LT((const uint8_t *)hal9000_out, payload + payload_len);
+
+  /* the JSON output of the string stops at its length */
+  char json[128];
+  oc_rep_to_json(rep, json, sizeof(json), false);
+  EXPECT_NE(nullptr, strstr(json, "\"hal9000\":\"Dave\","));
+
+  int64_t answer = 0;
+  EXPECT_TRUE(oc_rep_get_int(rep, "answer", &answer));
+  EXPECT_EQ(42, answer);
+  int64_t *ints_out = NULL;
+  size_t ints_len = 0;
+  EXPECT_TRUE(oc_rep_get_int_array(rep, "ints", &ints_out, &ints_len));
+  ASSERT_EQ(3, ints_len);
+  EXPECT_EQ(3, ints_out[2]);
+
+  /* nodes come from the arena buffer */
+  EXPECT_GE((uint8_t *)rep, (uint8_t *)arena_buffer);
+  EXPECT_LT((uint8_t *)rep, (uint8_t *)arena_buffer + sizeof(arena_buffer));
+  oc_arena_reset(&arena);
+}
+
+TEST(TestRep, OCRepParseInArena)
+{
+  uint8_t buf[1024];
+  oc_rep_new(&buf[0], 1024);
+
+  oc_rep_begin_root_object();
+  oc_rep_set_text_string(root, hal9000, "Dave");
+  oc_rep_set_object(root, crew);
+  oc_rep_set_text_string(crew, pilot, "Frank");
+  oc_rep_close_object(root, crew);
+  const char *names[2] = { "Dave", "Frank" };
+  oc_rep_set_array(root, names);
+  oc_rep_add_text_string(names, names[0]);
+  oc_rep_add_text_string(names, names[1]);
+  oc_rep_close_array(root, names);
+  oc_rep_end_root_object();
+  EXPECT_EQ(CborNoError, oc_rep_get_cbor_errno());
+
+  const uint8_t *payload = oc_rep_get_encoder_buf();
+  int payload_len = oc_rep_get_encoded_payload_size();
+  EXPECT_NE(payload_len, -1);
+  /* the pool and the string memory are not touched */
+  oc_rep_set_pool(NULL);
+  uint64_t arena_buffer[128];
+  oc_arena_t arena;
+  oc_arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+  oc_rep_t *rep = NULL;
+  ASSERT_EQ(CborNoError,
+            oc_parse_rep_in_arena(payload, payload_len, &arena, &rep));
+  ASSERT_TRUE(rep != NULL);
+  const uint8_t *arena_end = (uint8_t *)arena_buffer + sizeof(arena_buffer);
+
+  /* strings are copied into the arena and terminated */
+  char *hal9000_out = NULL;
+  size_t str_len;
+  EXPECT_TRUE(oc_rep_get_string(rep, "hal9000", &hal9000_out, &str_len));
+  EXPECT_STREQ("Dave", hal9000_out);
+  EXPECT_GE((uint8_t *)hal9000_out, (uint8_t *)arena_buffer);
+  EXPECT_LT((uint8_t *)hal9000_out, arena_end);
+
+  oc_rep_t *crew = NULL;
+  EXPECT_TRUE(oc_rep_get_object(rep, "crew", &crew));
+  char *pilot = NULL;
+  EXPECT_TRUE(oc_rep_get_string(crew, "pilot", &pilot, &str_len));
+  EXPECT_STREQ("Frank", pilot);
+
+  oc_string_array_t names_out;
+  size_t names_len = 0;
+  EXPECT_TRUE(oc_rep_get_string_array(rep, "names", &names_out, &names_len));
+  ASSERT_EQ(2, names_len);
+  EXPECT_STREQ("Frank", oc_string_array_get_item(names_out, 1));
+  EXPECT_GE((uint8_t *)oc_string_array_get_item(names_out, 1),
+            (uint8_t *)arena_buffer);
+  EXPECT_LT((uint8_t *)oc_string_array_get_item(names_out, 1), arena_end);
+  EXPECT_GT(oc_arena_allocated(&arena), 0u);
+  oc_arena_reset(&arena);
+}
+
 /*
  * TODO is there a max byte array length? If so consider adding a test that
  * equals and exceeds the max array length.
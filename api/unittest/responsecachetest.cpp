@@ -0,0 +1,134 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "api/oc_response_cache_internal.h"
+}
+
+class TestResponseCache : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    memset(resources_, 0, sizeof(resources_));
+    memset(buffer_, 0, sizeof(buffer_));
+    memset(&out_, 0, sizeof(out_));
+    out_.buffer = buffer_;
+    out_.buffer_size = sizeof(buffer_);
+  }
+
+  void TearDown() override { oc_response_cache_clear(); }
+
+  static oc_request_t request(oc_resource_t *resource, const char *query)
+  {
+    oc_request_t r;
+    memset(&r, 0, sizeof(r));
+    r.resource = resource;
+    r.query = query;
+    r.query_len = query ? (int)strlen(query) : 0;
+    r.accept = APPLICATION_CBOR;
+    return r;
+  }
+
+  static void store(const oc_request_t *r, uint8_t value)
+  {
+    uint8_t payload[2] = { 0x18, value };
+    oc_response_buffer_t rb;
+    memset(&rb, 0, sizeof(rb));
+    rb.buffer = payload;
+    rb.buffer_size = sizeof(payload);
+    rb.response_length = sizeof(payload);
+    rb.content_format = APPLICATION_CBOR;
+    rb.code = CONTENT_2_05;
+    oc_response_cache_store(r, &rb);
+  }
+
+  oc_resource_t resources_[OC_RESPONSE_CACHE_SIZE + 1];
+  uint8_t buffer_[16];
+  oc_response_buffer_t out_;
+};
+
+#ifdef OC_DYNAMIC_ALLOCATION
+
+TEST_F(TestResponseCache, HitCopiesResponse)
+{
+  oc_request_t r = request(&resources_[0], "if=x");
+  EXPECT_FALSE(oc_response_cache_lookup(&r, &out_));
+  store(&r, 42);
+  ASSERT_TRUE(oc_response_cache_lookup(&r, &out_));
+  EXPECT_EQ(2u, out_.response_length);
+  EXPECT_EQ(42, buffer_[1]);
+  EXPECT_EQ(APPLICATION_CBOR, out_.content_format);
+  EXPECT_EQ(CONTENT_2_05, out_.code);
+}
+
+TEST_F(TestResponseCache, KeyedOnQueryAndAccept)
+{
+  oc_request_t r = request(&resources_[0], "if=x");
+  store(&r, 1);
+  oc_request_t other_query = request(&resources_[0], "if=y");
+  EXPECT_FALSE(oc_response_cache_lookup(&other_query, &out_));
+  oc_request_t no_query = request(&resources_[0], NULL);
+  EXPECT_FALSE(oc_response_cache_lookup(&no_query, &out_));
+  oc_request_t other_accept = r;
+  other_accept.accept = APPLICATION_JSON;
+  EXPECT_FALSE(oc_response_cache_lookup(&other_accept, &out_));
+  oc_request_t other_resource = request(&resources_[1], "if=x");
+  EXPECT_FALSE(oc_response_cache_lookup(&other_resource, &out_));
+}
+
+TEST_F(TestResponseCache, Invalidate)
+{
+  oc_request_t a = request(&resources_[0], NULL);
+  oc_request_t b = request(&resources_[1], NULL);
+  store(&a, 1);
+  store(&b, 2);
+  oc_response_cache_invalidate(&resources_[0]);
+  EXPECT_FALSE(oc_response_cache_lookup(&a, &out_));
+  ASSERT_TRUE(oc_response_cache_lookup(&b, &out_));
+  EXPECT_EQ(2, buffer_[1]);
+}
+
+TEST_F(TestResponseCache, LeastRecentlyUsedIsDropped)
+{
+  for (int i = 0; i < OC_RESPONSE_CACHE_SIZE; i++) {
+    oc_request_t r = request(&resources_[i], NULL);
+    store(&r, (uint8_t)i);
+  }
+  oc_request_t first = request(&resources_[0], NULL);
+  EXPECT_TRUE(oc_response_cache_lookup(&first, &out_));
+
+  oc_request_t extra = request(&resources_[OC_RESPONSE_CACHE_SIZE], NULL);
+  store(&extra, 99);
+  oc_request_t second = request(&resources_[1], NULL);
+  EXPECT_FALSE(oc_response_cache_lookup(&second, &out_));
+  EXPECT_TRUE(oc_response_cache_lookup(&first, &out_));
+  EXPECT_TRUE(oc_response_cache_lookup(&extra, &out_));
+}
+
+TEST_F(TestResponseCache, TooLargeForBuffer)
+{
+  oc_request_t r = request(&resources_[0], NULL);
+  store(&r, 1);
+  out_.buffer_size = 1;
+  EXPECT_FALSE(oc_response_cache_lookup(&r, &out_));
+}
+
+#endif /* OC_DYNAMIC_ALLOCATION */
@@ -0,0 +1,195 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+
+extern "C" {
+#include "api/oc_knx_fp.h"
+#include "oc_api.h"
+#include "oc_blockwise.h"
+#include "oc_core_res.h"
+#include "oc_knx.h"
+#include "port/oc_connectivity.h"
+
+#ifdef OC_BLOCK_WISE
+extern bool oc_ri_invoke_coap_entity_handler(
+  void *request, void *response, oc_blockwise_state_t **request_state,
+  oc_blockwise_state_t **response_state, uint16_t block2_size,
+  oc_endpoint_t *endpoint);
+#endif /* OC_BLOCK_WISE */
+}
+
+#ifdef OC_BLOCK_WISE
+
+struct received
+{
+  bool called;
+  std::string on;
+  bool terminated;
+};
+
+static received plain_received;
+static received zero_copy_received;
+
+/* the value of the s-mode message is {1: "on", 2: 5} */
+static void
+record(received *r, oc_request_t *request)
+{
+  r->called = true;
+  oc_rep_t *value = request->request_payload;
+  if (value == NULL || value->type != OC_REP_OBJECT) {
+    return;
+  }
+  for (oc_rep_t *rep = value->value.object; rep != NULL; rep = rep->next) {
+    if (rep->iname == 1 && rep->type == OC_REP_STRING) {
+      const char *s = oc_string(rep->value.string);
+      size_t len = oc_string_len(rep->value.string);
+      r->on.assign(s, len);
+      r->terminated = strlen(s) == len;
+    }
+  }
+}
+
+/* /.knx hands its own user data to the handlers, so each resource has its
+ * own handler */
+static void
+plain_put(oc_request_t *request, oc_interface_mask_t iface_mask,
+          void *user_data)
+{
+  (void)iface_mask;
+  (void)user_data;
+  record(&plain_received, request);
+}
+
+static void
+zero_copy_put(oc_request_t *request, oc_interface_mask_t iface_mask,
+              void *user_data)
+{
+  (void)iface_mask;
+  (void)user_data;
+  record(&zero_copy_received, request);
+}
+
+class TestSMode : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    plain_received = received();
+    zero_copy_received = received();
+    oc_ri_init();
+    oc_core_init();
+    oc_add_device("myhname", "1.0.0", "//", "000001", NULL, NULL);
+    oc_device_info_t *device = oc_core_get_device_info(0);
+    device->ia = 1;
+    device->iid = 1;
+    device->lsm_s = LSM_S_LOADED;
+
+    plain_ = add_resource("/p/1", plain_put);
+    zero_copy_ = add_resource("/p/2", zero_copy_put);
+    oc_resource_set_zero_copy_payload(zero_copy_, true);
+    add_group_object(0, "/p/1");
+    add_group_object(1, "/p/2");
+  }
+
+  void TearDown() override
+  {
+    oc_delete_group_object_table();
+    oc_ri_delete_resource(plain_);
+    oc_ri_delete_resource(zero_copy_);
+    oc_connectivity_shutdown(0);
+    oc_core_shutdown();
+    oc_ri_shutdown();
+  }
+
+  static oc_resource_t *add_resource(const char *uri,
+                                     oc_request_callback_t put)
+  {
+    oc_resource_t *resource = oc_new_resource(uri, uri, 1, 0);
+    oc_resource_set_request_handler(resource, OC_PUT, put, NULL);
+    oc_ri_add_resource(resource);
+    return resource;
+  }
+
+  static void add_group_object(int index, const char *href)
+  {
+    uint32_t ga[] = { 1 };
+    oc_group_object_table_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.id = index + 1;
+    oc_new_string(&entry.href, href, strlen(href));
+    entry.cflags = OC_CFLAG_WRITE;
+    entry.ga = ga;
+    entry.ga_len = 1;
+    oc_core_set_group_object_table(index, entry);
+    oc_free_string(&entry.href);
+  }
+
+  static void post_knx(const uint8_t *payload, size_t payload_len)
+  {
+    oc_endpoint_t endpoint;
+    memset(&endpoint, 0, sizeof(endpoint));
+    endpoint.flags = IPV6;
+    coap_packet_t request;
+    coap_packet_t response;
+    coap_udp_init_message(&request, COAP_TYPE_NON, COAP_POST, 1);
+    coap_udp_init_message(&response, COAP_TYPE_NON, CHANGED_2_04, 1);
+    coap_set_header_uri_path(&request, ".knx", 4);
+    coap_set_header_content_format(&request, APPLICATION_CBOR);
+    coap_set_header_accept(&request, APPLICATION_CBOR);
+    /* as the engine does, the payload is handed over in a request buffer */
+    oc_blockwise_state_t *request_state = oc_blockwise_alloc_request_buffer(
+      ".knx", 4, &endpoint, OC_POST, OC_BLOCKWISE_SERVER);
+    ASSERT_NE(nullptr, request_state);
+    ASSERT_TRUE(oc_blockwise_handle_block(request_state, 0, payload,
+                                          (uint32_t)payload_len));
+    request_state->payload_size = (uint32_t)payload_len;
+    oc_blockwise_state_t *response_state = NULL;
+    oc_ri_invoke_coap_entity_handler(&request, &response, &request_state,
+                                     &response_state, 64, &endpoint);
+    if (request_state != NULL) {
+      oc_blockwise_free_request_buffer(request_state);
+    }
+    if (response_state != NULL) {
+      oc_blockwise_free_response_buffer(response_state);
+    }
+  }
+
+  oc_resource_t *plain_;
+  oc_resource_t *zero_copy_;
+};
+
+TEST_F(TestSMode, ObjectValueIsTerminatedUnlessZeroCopy)
+{
+  /* {4: 1, 5: {6: "w", 7: 1, 1: {1: "on", 2: 5}}}; "on" is followed by the
+   * key 2, not by a NUL */
+  uint8_t payload[] = { 0xa2, 0x04, 0x01, 0x05, 0xa3, 0x06, 0x61, 0x77, 0x07,
+                        0x01, 0x01, 0xa2, 0x01, 0x62, 0x6f, 0x6e, 0x02, 0x05 };
+  post_knx(payload, sizeof(payload));
+
+  ASSERT_TRUE(plain_received.called);
+  EXPECT_EQ("on", plain_received.on);
+  EXPECT_TRUE(plain_received.terminated);
+
+  ASSERT_TRUE(zero_copy_received.called);
+  EXPECT_EQ("on", zero_copy_received.on);
+  EXPECT_FALSE(zero_copy_received.terminated);
+}
+
+#endif /* OC_BLOCK_WISE */
@@ -0,0 +1,155 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "util/oc_uri_trie.h"
+}
+
+OC_MEMB(test_nodes_s, oc_uri_trie_node_t, 64);
+
+class TestUriTrie : public testing::Test {
+protected:
+  void TearDown() override { oc_uri_trie_clear(&test_nodes_s, &root_); }
+
+  bool add(const char *key, int *value)
+  {
+    return oc_uri_trie_add(&test_nodes_s, &root_, key, strlen(key), value);
+  }
+
+  void remove(const char *key, int *value)
+  {
+    oc_uri_trie_remove(&test_nodes_s, &root_, key, strlen(key), value);
+  }
+
+  void *find(const char *path)
+  {
+    return oc_uri_trie_find(root_, path, strlen(path));
+  }
+
+  oc_uri_trie_node_t *root_ = nullptr;
+  int a_ = 0, b_ = 0, c_ = 0, d_ = 0;
+};
+
+TEST_F(TestUriTrie, Exact)
+{
+  EXPECT_EQ(nullptr, find("dev/sn"));
+  ASSERT_TRUE(add("dev/sn", &a_));
+  ASSERT_TRUE(add("dev/sa", &b_));
+  ASSERT_TRUE(add("dev", &c_));
+  EXPECT_EQ(&a_, find("dev/sn"));
+  EXPECT_EQ(&b_, find("dev/sa"));
+  EXPECT_EQ(&c_, find("dev"));
+  EXPECT_EQ(nullptr, find("dev/"));
+  EXPECT_EQ(nullptr, find("de"));
+  EXPECT_EQ(nullptr, find("dev/snx"));
+  EXPECT_EQ(nullptr, find(""));
+}
+
+TEST_F(TestUriTrie, Wildcard)
+{
+  ASSERT_TRUE(add("fp/g/*", &a_));
+  ASSERT_TRUE(add("fp/gm/*", &b_));
+  ASSERT_TRUE(add("fp/g", &c_));
+  ASSERT_TRUE(add("fp/g/7", &d_));
+  EXPECT_EQ(nullptr, find("fp/g/"));
+  EXPECT_EQ(&a_, find("fp/g/1"));
+  EXPECT_EQ(&a_, find("fp/g/12/x"));
+  EXPECT_EQ(&a_, find("fp/g/71"));
+  EXPECT_EQ(&d_, find("fp/g/7"));
+  EXPECT_EQ(&c_, find("fp/g"));
+  EXPECT_EQ(&b_, find("fp/gm/3"));
+  EXPECT_EQ(nullptr, find("fp/gx"));
+  EXPECT_EQ(nullptr, find("fp/"));
+}
+
+TEST_F(TestUriTrie, LongestWildcardWins)
+{
+  ASSERT_TRUE(add("p/*", &a_));
+  ASSERT_TRUE(add("p/netip/*", &b_));
+  EXPECT_EQ(&a_, find("p/o_1_1"));
+  EXPECT_EQ(&b_, find("p/netip/ttl"));
+  EXPECT_EQ(&a_, find("p/netip"));
+}
+
+TEST_F(TestUriTrie, KeysLongerThanLabel)
+{
+  std::vector<std::string> keys;
+  std::vector<int> values(20);
+  for (size_t i = 0; i < values.size(); i++) {
+    keys.push_back("a/very/long/path/to/a/datapoint/" + std::to_string(i));
+    ASSERT_TRUE(add(keys.back().c_str(), &values[i]));
+  }
+  for (size_t i = 0; i < values.size(); i++) {
+    EXPECT_EQ(&values[i], find(keys[i].c_str()));
+  }
+  EXPECT_EQ(nullptr, find("a/very/long/path/to/a/datapoint/"));
+  EXPECT_EQ(nullptr, find("a/very/long/path/to/a/datapoint/20"));
+}
+
+TEST_F(TestUriTrie, DuplicateKeyIsRejected)
+{
+  ASSERT_TRUE(add("p/a", &a_));
+  EXPECT_FALSE(add("p/a", &b_));
+  EXPECT_TRUE(add("p/a", &a_));
+  EXPECT_TRUE(add("p/a*", &b_));
+  EXPECT_EQ(&a_, find("p/a"));
+  EXPECT_EQ(&b_, find("p/ab"));
+}
+
+TEST_F(TestUriTrie, Remove)
+{
+  ASSERT_TRUE(add("fp/g/*", &a_));
+  ASSERT_TRUE(add("fp/gm", &b_));
+  ASSERT_TRUE(add("fp/r", &c_));
+
+  remove("fp/gm", &a_);
+  EXPECT_EQ(&b_, find("fp/gm"));
+  remove("fp/gm", &b_);
+  EXPECT_EQ(nullptr, find("fp/gm"));
+  EXPECT_EQ(&a_, find("fp/g/1"));
+  EXPECT_EQ(&c_, find("fp/r"));
+
+  remove("fp/g/*", &a_);
+  EXPECT_EQ(nullptr, find("fp/g/1"));
+  EXPECT_EQ(&c_, find("fp/r"));
+  remove("fp/r", &c_);
+  EXPECT_EQ(nullptr, root_);
+
+  ASSERT_TRUE(add("fp/gm", &d_));
+  EXPECT_EQ(&d_, find("fp/gm"));
+}
+
+#ifndef OC_DYNAMIC_ALLOCATION
+TEST_F(TestUriTrie, NodesAreReleased)
+{
+  for (int round = 0; round < 100; round++) {
+    ASSERT_TRUE(add("a/very/long/path/to/a/datapoint/1", &a_));
+    ASSERT_TRUE(add("a/very/long/path/to/a/datapoint/2", &b_));
+    ASSERT_TRUE(add("a/very/long/path/*", &c_));
+    remove("a/very/long/path/to/a/datapoint/1", &a_);
+    remove("a/very/long/path/*", &c_);
+    remove("a/very/long/path/to/a/datapoint/2", &b_);
+    ASSERT_EQ(nullptr, root_);
+  }
+}
+#endif /* !OC_DYNAMIC_ALLOCATION */
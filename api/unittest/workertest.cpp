@@ -0,0 +1,172 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#ifdef OC_WORKER_POOL
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+
+extern "C" {
+#include "api/oc_worker_internal.h"
+#include "messaging/coap/oc_coap.h"
+#include "oc_api.h"
+#include "oc_rep.h"
+}
+
+static std::mutex gate_lock;
+static std::condition_variable gate_cv;
+static bool gate_open;
+static std::atomic<int> handled;
+static std::thread::id handler_thread;
+
+static void
+pooled_get(oc_request_t *request, oc_interface_mask_t iface_mask,
+           void *user_data)
+{
+  (void)iface_mask;
+  (void)user_data;
+  std::unique_lock<std::mutex> lock(gate_lock);
+  gate_cv.wait(lock, [] { return gate_open; });
+  handler_thread = std::this_thread::get_id();
+  oc_rep_begin_root_object();
+  oc_rep_i_set_int(root, 1, 42);
+  oc_rep_end_root_object();
+  oc_send_response(request, OC_STATUS_OK);
+  handled++;
+}
+
+class TestWorker : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    gate_open = true;
+    handled = 0;
+    memset(&resource_, 0, sizeof(resource_));
+    resource_.properties = OC_POOLED;
+    resource_.get_handler.cb = pooled_get;
+    oc_process_init();
+    oc_process_start(&oc_worker_process, NULL);
+    ASSERT_EQ(0, oc_worker_init());
+  }
+
+  void TearDown() override
+  {
+    open_gate();
+    oc_worker_shutdown();
+    oc_process_exit(&oc_worker_process);
+    oc_process_shutdown();
+  }
+
+  static void open_gate()
+  {
+    std::lock_guard<std::mutex> lock(gate_lock);
+    gate_open = true;
+    gate_cv.notify_all();
+  }
+
+  /* deliver finished jobs the way the event loop does */
+  static bool wait_idle()
+  {
+    auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (oc_worker_jobs_in_flight() > 0) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        return false;
+      }
+      oc_process_run();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+  struct call
+  {
+    oc_endpoint_t origin;
+    uint8_t buffer[64];
+    oc_response_buffer_t response_buffer;
+    oc_response_t response;
+    oc_request_t request;
+  };
+
+  bool dispatch(call *c, oc_method_t method)
+  {
+    memset(c, 0, sizeof(*c));
+    c->response_buffer.buffer = c->buffer;
+    c->response_buffer.buffer_size = sizeof(c->buffer);
+    c->response.response_buffer = &c->response_buffer;
+    c->request.response = &c->response;
+    c->request.origin = &c->origin;
+    c->request.resource = &resource_;
+    oc_rep_new(c->buffer, sizeof(c->buffer));
+    return oc_worker_dispatch(&c->request, method, OC_IF_NONE);
+  }
+
+  oc_resource_t resource_;
+};
+
+TEST_F(TestWorker, HandlerRunsOnPool)
+{
+  call c;
+  ASSERT_TRUE(dispatch(&c, OC_GET));
+  EXPECT_NE(nullptr, c.response.separate_response);
+  EXPECT_EQ(1, oc_worker_jobs_in_flight());
+
+  /* the event loop keeps its own encoder state meanwhile */
+  uint8_t buffer[16];
+  oc_rep_new(buffer, sizeof(buffer));
+  ASSERT_TRUE(wait_idle());
+  EXPECT_EQ(0, oc_rep_get_encoded_payload_size());
+  EXPECT_EQ(1, handled);
+  EXPECT_NE(std::this_thread::get_id(), handler_thread);
+}
+
+TEST_F(TestWorker, NoHandlerForMethod)
+{
+  call c;
+  EXPECT_FALSE(dispatch(&c, OC_PUT));
+  EXPECT_EQ(0, oc_worker_jobs_in_flight());
+}
+
+TEST_F(TestWorker, SaturatedPoolRejects)
+{
+  gate_open = false;
+  static call calls[OC_WORKER_MAX_JOBS + 1];
+  for (int i = 0; i < OC_WORKER_MAX_JOBS; i++) {
+    ASSERT_TRUE(dispatch(&calls[i], OC_GET));
+    EXPECT_NE(nullptr, calls[i].response.separate_response);
+  }
+
+  call *rejected = &calls[OC_WORKER_MAX_JOBS];
+  ASSERT_TRUE(dispatch(rejected, OC_GET));
+  EXPECT_EQ(nullptr, rejected->response.separate_response);
+  EXPECT_EQ(oc_status_code(OC_STATUS_SERVICE_UNAVAILABLE),
+            rejected->response_buffer.code);
+  EXPECT_EQ((uint32_t)OC_WORKER_RETRY_AFTER,
+            rejected->response_buffer.max_age);
+
+  open_gate();
+  ASSERT_TRUE(wait_idle());
+  EXPECT_EQ(OC_WORKER_MAX_JOBS, handled);
+}
+
+#endif /* OC_WORKER_POOL */
@@ -562,6 +562,12 @@ main(int argc, char *argv[])
   sa.sa_handler = handle_signal;
   /* install Ctrl-C */
   sigaction(SIGINT, &sa, NULL);
+  /* oc_clock_time() is monotonic, wait on the same clock */
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cv, &attr);
+  pthread_condattr_destroy(&attr);
 #endif
 
   for (int i = 0; i < argc; i++) {
@@ -302,6 +302,30 @@ int oc_main_init(const oc_handler_t *handler);
  */
 oc_clock_time_t oc_main_poll(void);
 
+#ifdef OC_EXTERNAL_POLL
+/**
+ * Get the file descriptor to wait on from an external event loop (epoll,
+ * libuv, asio, ...), when the stack is built with OC_EXTERNAL_POLL and runs
+ * without network threads.
+ *
+ * Wait for the descriptor to become readable and call oc_main_poll(). The
+ * descriptor also becomes readable when the next timed event is due, so the
+ * value returned by oc_main_poll() does not need to be handled. The
+ * signal_event_loop callback of oc_handler_t is optional in this mode.
+ *
+ * Example:
+ * ```
+ * struct pollfd pfd = { oc_main_get_poll_fd(), POLLIN, 0 };
+ * while (poll(&pfd, 1, -1) >= 0) {
+ *   oc_main_poll();
+ * }
+ * ```
+ *
+ * @return the file descriptor, -1 if the stack is not initialized
+ */
+int oc_main_get_poll_fd(void);
+#endif /* OC_EXTERNAL_POLL */
+
 /**
  * Shutdown and free all stack related resources
  */
@@ -734,6 +758,174 @@ void oc_resource_set_observable(oc_resource_t *resource, bool state);
 void oc_resource_set_periodic_observable(oc_resource_t *resource,
                                          uint16_t seconds);
 
+/**
+ * Run the request handlers of the resource on the worker pool instead of the
+ * event loop thread.
+ *
+ * Meant for handlers that block, e.g. on a bus write or a database lookup.
+ * The request is acknowledged right away and the handler's response is sent
+ * later as a separate response. When all workers are busy the request is
+ * answered with 5.03 Service Unavailable.
+ *
+ * A pooled handler runs concurrently with the stack: it may decode the
+ * request and encode its response with the oc_rep API and answer with
+ * oc_send_response(), but must not call other stack functions. The response
+ * is always sent as CBOR. The resource must not be deleted while requests
+ * to it are in flight.
+ *
+ * @note without OC_WORKER_POOL the flag is ignored and the handlers run on
+ *       the event loop thread.
+ *
+ * @param[in] resource the resource
+ * @param[in] state true to run the handlers on the worker pool
+ */
+void oc_resource_set_worker_pool(oc_resource_t *resource, bool state);
+
+/**
+ * Cache the responses of the GET handler of the resource.
+ *
+ * A GET request with the same query and Accept option as an earlier one is
+ * answered with the earlier response, without calling the handler. Access
+ * control is checked as usual. The cached responses are dropped when the
+ * resource is changed through a PUT, POST or DELETE request, when
+ * oc_notify_observers() is called for it, and when the device fingerprint
+ * changes.
+ *
+ * Only for resources whose GET response depends on nothing but their state,
+ * the query and the Accept option; a resource that changes for other reasons
+ * must call oc_notify_observers().
+ *
+ * @param[in] resource the resource
+ * @param[in] state true to cache the GET responses
+ */
+void oc_resource_set_response_cache(oc_resource_t *resource, bool state);
+
+/**
+ * Parse the request payloads of the resource without copying them.
+ *
+ * The text and byte string values of the oc_rep_t tree handed to the
+ * handlers point into the request payload and are NOT NUL terminated, so
+ * they must be read with oc_string() and oc_string_len() together. The tree
+ * is released in one go after the handler returns; a handler that keeps a
+ * value must copy it. This also applies to the value of s-mode messages that
+ * /.knx passes to the resource; without it, /.knx passes a terminated copy.
+ *
+ * @param[in] resource the resource
+ * @param[in] state true to parse the request payloads in place
+ */
+void oc_resource_set_zero_copy_payload(oc_resource_t *resource, bool state);
+
+/**
+ * Read how much memory the request payloads of the resource needed.
+ *
+ * Request payloads are parsed into an arena of OC_REP_ARENA_SIZE bytes that
+ * is released after the response. The high water mark shows how large the
+ * arena needs to be for this resource; without OC_DYNAMIC_ALLOCATION a
+ * payload that does not fit is rejected and counted as exhausted.
+ *
+ * @param[in] resource the resource
+ * @param[out] stats the statistics
+ *
+ * @return false if the resource or stats is NULL
+ */
+bool oc_resource_get_rep_arena_stats(const oc_resource_t *resource,
+                                     oc_rep_arena_stats_t *stats);
+
+/**
+ * Reset the request payload arena statistics of the resource.
+ *
+ * @param[in] resource the resource
+ */
+void oc_resource_reset_rep_arena_stats(oc_resource_t *resource);
+
+/**
+ * Counters of the notifications of a resource with notify conditions.
+ */
+typedef struct oc_notify_stats_s
+{
+  uint32_t sent;    /**< notifications sent to the observers */
+  uint32_t skipped; /**< changes that were coalesced or below the step */
+} oc_notify_stats_t;
+
+/**
+ * Limit how often the observers of a resource are notified, with the
+ * notification conditions of CoRE dynamic linking.
+ *
+ * - pmin: a change within pmin of the last notification is not sent right
+ *   away. One notification is sent when pmin has passed and reports the
+ *   state at that time, so further changes in the meantime are coalesced.
+ * - pmax: when no notification was sent for pmax, one is sent anyway. The
+ *   first period starts when the resource gets an observer.
+ * - step: a change reported with oc_notify_observers_value() is not sent
+ *   when the value differs from the last notified value by less than step.
+ *
+ * Notifications after PUT and POST requests and oc_notify_observers() are
+ * subject to pmin and pmax. Setting all three to 0 removes the conditions.
+ *
+ * @param[in] resource the resource
+ * @param[in] pmin_ms minimum period in milliseconds, 0 for none
+ * @param[in] pmax_ms maximum period in milliseconds, 0 for none
+ * @param[in] step minimum change of the value, 0 for any change
+ *
+ * @return false if the resource is NULL, pmax is less than pmin or out of
+ *         memory
+ */
+bool oc_resource_set_notify_conditions(oc_resource_t *resource,
+                                       uint32_t pmin_ms, uint32_t pmax_ms,
+                                       double step);
+
+/**
+ * Read the notification counters of a resource.
+ *
+ * @param[in] resource the resource
+ * @param[out] stats the counters
+ *
+ * @return false if the resource has no notify conditions
+ */
+bool oc_resource_get_notify_stats(const oc_resource_t *resource,
+                                  oc_notify_stats_t *stats);
+
+/**
+ * Stream the payload of block-wise PUT and POST requests to a sink.
+ *
+ * Every block is passed to the sink when it arrives and answered with 2.31
+ * Continue, so the payload is never held in memory as a whole. After the
+ * last block, the request handler of the resource is called without payload
+ * to send the response. Requests that fit in a single message are not
+ * streamed and reach the request handler as usual.
+ *
+ * @param[in] resource the resource
+ * @param[in] sink the sink, NULL to stop streaming requests
+ * @param[in] user_data context pointer that is passed to the sink
+ *
+ * @return false if the resource is NULL, out of memory or block-wise
+ *         transfers are not supported
+ */
+bool oc_resource_set_block_sink(oc_resource_t *resource,
+                                oc_block_sink_cb_t sink, void *user_data);
+
+/**
+ * Stream the response to GET requests from a source.
+ *
+ * The response is produced one block at a time by the source, when the
+ * client asks for the block. A request whose Accept option is missing or
+ * differs from content_format goes to the GET handler of the resource, if it
+ * has one. Without a GET handler, a request without Accept option is
+ * streamed and one with another Accept option gets 4.06 Not Acceptable.
+ *
+ * @param[in] resource the resource
+ * @param[in] content_format the content format of the response
+ * @param[in] source the source, NULL to stop streaming responses
+ * @param[in] user_data context pointer that is passed to the source
+ *
+ * @return false if the resource is NULL, out of memory or block-wise
+ *         transfers are not supported
+ */
+bool oc_resource_set_block_source(oc_resource_t *resource,
+                                  oc_content_format_t content_format,
+                                  oc_block_source_cb_t source,
+                                  void *user_data);
+
 /**
  * Specify a request_callback for GET, PUT, POST, and DELETE methods
  *
@@ -1240,6 +1432,22 @@ void oc_send_empty_separate_response(oc_separate_response_t *handle,
  */
 int oc_notify_observers(oc_resource_t *resource);
 
+/**
+ * Notify the observers of a change to a numeric property of a resource.
+ *
+ * Like oc_notify_observers(), but the value is compared against the step set
+ * with oc_resource_set_notify_conditions().
+ *
+ * @param[in] resource the oc_resource_t that has a modified property
+ * @param[in] value the new value of the property
+ *
+ * @return
+ *  - the number observers notified on success
+ *  - `0` when the notification was skipped or deferred, on failure or when
+ *    there are no registered observers
+ */
+int oc_notify_observers_value(oc_resource_t *resource, double value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -50,6 +50,10 @@ typedef struct oc_blockwise_state_s
   uint32_t next_block_offset; /**< offset in buffer to the next block */
   uint8_t ref_count; /**< reference counter, e.g. indicator if the block is
                         still in use */
+  bool streamed;     /**< blocks are passed to the sink or source of the
+                        resource, there is no buffer */
+  bool is_response;  /**< the state is in the list of responses */
+  oc_clock_time_t last_access; /**< last lookup, for expiry and eviction */
 #ifdef OC_DYNAMIC_ALLOCATION
 #ifdef OC_APP_DATA_BUFFER_POOL
   void *block;
@@ -68,6 +72,21 @@ typedef struct oc_blockwise_state_s
 #endif                           /* OC_CLIENT */
 } oc_blockwise_state_t;
 
+/**
+ * @brief the sink and source of a resource with streamed transfers
+ *
+ */
+typedef struct oc_blockwise_stream_s
+{
+  struct oc_blockwise_stream_s *next;
+  oc_resource_t *resource;            /**< the resource */
+  oc_block_sink_cb_t sink;            /**< receives the request blocks */
+  void *sink_data;                    /**< user data of the sink */
+  oc_block_source_cb_t source;        /**< produces the response blocks */
+  void *source_data;                  /**< user data of the source */
+  oc_content_format_t content_format; /**< content format of the source */
+} oc_blockwise_stream_t;
+
 /**
  * @brief the blockwise request state
  *
@@ -209,6 +228,32 @@ oc_blockwise_state_t *oc_blockwise_alloc_response_buffer(
   const char *href, size_t href_len, oc_endpoint_t *endpoint,
   oc_method_t method, oc_blockwise_role_t role);
 
+/**
+ * @brief allocate the state of a streamed request, without buffer
+ *
+ * @param href the href
+ * @param href_len the href length
+ * @param endpoint the endpoint
+ * @param method the CoAP method
+ * @return oc_blockwise_state_t*
+ */
+oc_blockwise_state_t *oc_blockwise_alloc_stream_request(
+  const char *href, size_t href_len, oc_endpoint_t *endpoint,
+  oc_method_t method);
+
+/**
+ * @brief allocate the state of a streamed response, without buffer
+ *
+ * @param href the href
+ * @param href_len the href length
+ * @param endpoint the endpoint
+ * @param method the CoAP method
+ * @return oc_blockwise_state_t*
+ */
+oc_blockwise_state_t *oc_blockwise_alloc_stream_response(
+  const char *href, size_t href_len, oc_endpoint_t *endpoint,
+  oc_method_t method);
+
 /**
  * @brief free the request buffer
  *
@@ -223,6 +268,35 @@ void oc_blockwise_free_request_buffer(oc_blockwise_state_t *buffer);
  */
 void oc_blockwise_free_response_buffer(oc_blockwise_state_t *buffer);
 
+/**
+ * @brief set the message id of a client side transfer
+ *
+ * The transfer is found by oc_blockwise_find_request_buffer_by_mid() or
+ * oc_blockwise_find_response_buffer_by_mid() under the new message id.
+ *
+ * @param buffer the block transfer
+ * @param mid the message id
+ */
+void oc_blockwise_set_mid(oc_blockwise_state_t *buffer, uint16_t mid);
+
+/**
+ * @brief set the token of a client side transfer
+ *
+ * @param buffer the block transfer
+ * @param token the token
+ * @param token_len the token length
+ */
+void oc_blockwise_set_token(oc_blockwise_state_t *buffer, const uint8_t *token,
+                            uint8_t token_len);
+
+/**
+ * @brief set the client callback of a client side transfer
+ *
+ * @param buffer the block transfer
+ * @param client_cb the callback
+ */
+void oc_blockwise_set_client_cb(oc_blockwise_state_t *buffer, void *client_cb);
+
 /**
  * @brief send the block
  *
@@ -252,6 +326,69 @@ bool oc_blockwise_handle_block(oc_blockwise_state_t *buffer,
                                const uint8_t *incoming_block,
                                uint32_t incoming_block_size);
 
+/**
+ * @brief get the sink and source of a resource
+ *
+ * @param resource the resource
+ * @return oc_blockwise_stream_t* NULL if its transfers are not streamed
+ */
+oc_blockwise_stream_t *oc_blockwise_get_stream(const oc_resource_t *resource);
+
+/**
+ * @brief find the sink and source of a resource by its path
+ *
+ * @param href the path, without leading slash
+ * @param href_len the path length
+ * @param device the device index
+ * @return oc_blockwise_stream_t* NULL if its transfers are not streamed
+ */
+oc_blockwise_stream_t *oc_blockwise_find_stream(const char *href,
+                                                size_t href_len,
+                                                size_t device);
+
+/**
+ * @brief pass a block of a streamed request to the sink of the resource
+ *
+ * A block before the next expected one is a duplicate and is skipped.
+ *
+ * @param buffer the streamed request state
+ * @param block_offset the offset of the block
+ * @param block the block
+ * @param block_len the block length
+ * @param more true when more blocks follow
+ * @return uint8_t 0 when the block was taken, otherwise the CoAP response
+ * code
+ */
+uint8_t oc_blockwise_stream_write(oc_blockwise_state_t *buffer,
+                                  uint32_t block_offset, const uint8_t *block,
+                                  uint32_t block_len, bool more);
+
+/**
+ * @brief pull a block of a streamed response from the source of the resource
+ *
+ * @param buffer the streamed response state
+ * @param block_offset the offset of the block
+ * @param block where the block is written
+ * @param block_size the size of the block
+ * @param more set to true when more blocks follow
+ * @return int the length of the block, or -1 on error
+ */
+int oc_blockwise_stream_read(oc_blockwise_state_t *buffer,
+                             uint32_t block_offset, uint8_t *block,
+                             uint32_t block_size, bool *more);
+
+/**
+ * @brief remove the sink and source of a resource
+ *
+ * @param resource the resource
+ */
+void oc_blockwise_remove_stream(const oc_resource_t *resource);
+
+/**
+ * @brief remove the sinks and sources of all resources
+ */
+void oc_blockwise_free_streams(void);
+
 /**
  * @brief free all blocks that are handled (ref_count = 0)
  *
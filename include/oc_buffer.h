@@ -25,6 +25,7 @@
 #include "util/oc_memb.h"
 #include "util/oc_process.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,6 +33,47 @@ extern "C" {
 
 OC_PROCESS_NAME(message_buffer_handler);
 
+#ifndef OC_BUFFER_SLAB_SMALL_SIZE
+/**
+ * @brief payload size (bytes) of the small slab class, big enough for ACKs
+ * and typical s-mode messages
+ */
+#define OC_BUFFER_SLAB_SMALL_SIZE (256)
+#endif /* OC_BUFFER_SLAB_SMALL_SIZE */
+
+#ifndef OC_BUFFER_SLAB_MIN_FREE
+/**
+ * @brief number of free payload blocks kept per slab class when the stack is
+ * idle
+ */
+#define OC_BUFFER_SLAB_MIN_FREE (2)
+#endif /* OC_BUFFER_SLAB_MIN_FREE */
+
+/**
+ * @brief size classes of the message payload slab
+ *
+ * Only used with OC_DYNAMIC_ALLOCATION and without OC_INOUT_BUFFER_SIZE.
+ */
+typedef enum {
+  OC_BUFFER_SLAB_SMALL = 0, ///< payloads up to OC_BUFFER_SLAB_SMALL_SIZE
+  OC_BUFFER_SLAB_MTU,       ///< payloads up to the MTU size
+  OC_BUFFER_SLAB_LARGE,     ///< blockwise/TCP payloads, larger than the MTU
+  OC_BUFFER_SLAB_NUM_CLASSES
+} oc_buffer_slab_class_t;
+
+/**
+ * @brief usage statistics of a slab class
+ */
+typedef struct oc_buffer_slab_stats_t
+{
+  size_t block_size;      ///< current payload size of the class in bytes
+  size_t num_in_use;      ///< blocks currently handed out
+  size_t num_free;        ///< blocks cached on the free list
+  size_t high_water_mark; ///< maximum number of blocks in use at once
+  size_t num_allocs;      ///< total number of allocations from the class
+  size_t num_heap_allocs; ///< allocations that had to go to the heap
+} oc_buffer_slab_stats_t;
+
 /**
  * @brief function to allocate a message
  *
@@ -39,6 +81,28 @@ OC_PROCESS_NAME(message_buffer_handler);
  */
 oc_message_t *oc_allocate_message(void);
 
+/**
+ * @brief allocate an incoming message for a received packet of known size
+ *
+ * The payload buffer is taken from the smallest slab class that holds size
+ * bytes, capped at OC_PDU_SIZE.
+ *
+ * @param size the length of the received packet in bytes
+ * @return oc_message_t* the allocated message
+ */
+oc_message_t *oc_allocate_message_with_size(size_t size);
+
+/**
+ * @brief move the payload of a received message to the smallest slab class
+ * that holds its length
+ *
+ * For messages received into a full size buffer, before they are queued.
+ * The message must not grow afterwards.
+ *
+ * @param message the message
+ */
+void oc_message_shrink(oc_message_t *message);
+
 /**
  * @brief set callback for memory availability
  *
@@ -62,6 +126,18 @@ oc_message_t *oc_allocate_message_from_pool(struct oc_memb *pool);
  */
 oc_message_t *oc_internal_allocate_outgoing_message(void);
 
+/**
+ * @brief allocate message with a payload buffer of at least size bytes
+ * internal function
+ *
+ * Only use this when the final length of the message is known up front, e.g.
+ * for empty ACK/RST messages. The size is capped at OC_PDU_SIZE.
+ *
+ * @param size the required payload size in bytes
+ * @return oc_message_t* the CoAP message
+ */
+oc_message_t *oc_internal_allocate_outgoing_message_with_size(size_t size);
+
 /**
  * @brief add reference (for tracking in use)
  *
@@ -76,6 +152,27 @@ void oc_message_add_ref(oc_message_t *message);
  */
 void oc_message_unref(oc_message_t *message);
 
+/**
+ * @brief retrieve the usage statistics of a payload slab class
+ *
+ * @param slab_class the slab class
+ * @param stats [out] the statistics
+ * @return int 0 = success, -1 if the slab is not in use for this build
+ */
+int oc_buffer_get_slab_stats(oc_buffer_slab_class_t slab_class,
+                             oc_buffer_slab_stats_t *stats);
+
+/**
+ * @brief reset the high water marks of all slab classes to the number of
+ * blocks currently in use
+ */
+void oc_buffer_reset_slab_high_water_marks(void);
+
+/**
+ * @brief release all cached (free) payload blocks to the heap
+ */
+void oc_buffer_trim_slabs(void);
+
 /**
  * @brief receive (CoAP) message
  *
@@ -217,6 +217,28 @@ oc_client_cb_t *oc_ri_find_client_cb_by_token(uint8_t *token,
  */
 oc_client_cb_t *oc_ri_find_client_cb_by_mid(uint16_t mid);
 
+/**
+ * @brief change the message id (mid) of a client callback
+ *
+ * The callbacks are indexed by mid, so it must not be assigned directly.
+ *
+ * @param cb the client callback info
+ * @param mid the new message id
+ */
+void oc_ri_set_client_cb_mid(oc_client_cb_t *cb, uint16_t mid);
+
+/**
+ * @brief change the token of a client callback
+ *
+ * The callbacks are indexed by token, so it must not be assigned directly.
+ *
+ * @param cb the client callback info
+ * @param token the new token
+ * @param token_len the token length
+ */
+void oc_ri_set_client_cb_token(oc_client_cb_t *cb, const uint8_t *token,
+                               uint8_t token_len);
+
 /**
  * @brief free the client callback information by endpoint
  *
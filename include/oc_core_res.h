@@ -284,6 +284,20 @@ oc_resource_t *oc_core_get_resource_by_index(int type, size_t device);
  */
 oc_resource_t *oc_core_get_resource_by_uri(const char *uri, size_t device);
 
+/**
+ * @brief retrieve the resource that serves a request path
+ *
+ * A resource with a URI ending in '*' serves all paths starting with the URI
+ * without the '*', unless a resource has the exact path.
+ *
+ * @param path the path, without leading '/'
+ * @param path_len the length of the path
+ * @param device the device index
+ * @return oc_resource_t* the resource handle, NULL if none serves the path
+ */
+oc_resource_t *oc_core_get_resource_by_path(const char *path, size_t path_len,
+                                            size_t device);
+
 /**
  * @brief Ensure that the given URI starts with a forward slash
  *
@@ -20,12 +20,23 @@
 #ifndef OC_DISCOVERY_H
 #define OC_DISCOVERY_H
 
+#include "oc_ri.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Number of rendered /.well-known/core responses kept for answering repeated
+ * discovery requests. When the cache is full the least recently used
+ * response is dropped.
+ */
+#ifndef OC_WKCORE_VIEW_CACHE_SIZE
+#define OC_WKCORE_VIEW_CACHE_SIZE (8)
+#endif /* OC_WKCORE_VIEW_CACHE_SIZE */
+
 /**
  * @brief create a resource that is discoverable.
  *
@@ -65,6 +76,16 @@ bool oc_add_resource_to_wk(oc_resource_t *resource, oc_request_t *request,
                            size_t device_index, size_t *response_length,
                            int matches);
 
+/**
+ * @brief drop the rendered /.well-known/core responses and the group address
+ * index, e.g. when resources are added or deleted or the endpoints of the
+ * device changed
+ *
+ * Changes to the programming mode, individual address and load state are
+ * picked up without calling this function.
+ */
+void oc_discovery_invalidate_views(void);
+
 #ifdef __cplusplus
 }
 #endif
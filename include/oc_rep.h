@@ -23,6 +23,7 @@
 
 #include "deps/tinycbor/src/cbor.h"
 #include "oc_helpers.h"
+#include "util/oc_arena.h"
 #include "util/oc_memb.h"
 #include <oc_config.h>
 #include <stdbool.h>
@@ -32,8 +33,15 @@
 extern "C" {
 #endif
 
-extern CborEncoder g_encoder, root_map, links_array;
-extern int g_err;
+#ifdef OC_WORKER_POOL
+/* handlers on the worker pool encode concurrently with the event loop */
+#define OC_REP_THREAD_LOCAL __thread
+#else /* OC_WORKER_POOL */
+#define OC_REP_THREAD_LOCAL
+#endif /* !OC_WORKER_POOL */
+
+extern OC_REP_THREAD_LOCAL CborEncoder g_encoder, root_map, links_array;
+extern OC_REP_THREAD_LOCAL int g_err;
 
 /*
   The macros are based on stringizing operator (also known as Stringify)
@@ -1410,6 +1418,39 @@ int oc_parse_rep(const uint8_t *payload, int payload_size,
 // internal function
 void oc_free_rep(oc_rep_t *rep);
 
+/**
+ * @brief parse a payload into an arena
+ *
+ * The oc_rep_t nodes, strings and arrays are all allocated from the arena,
+ * nothing is taken from the rep pool or the string memory. The result stays
+ * valid until the arena is reset and must not be passed to oc_free_rep().
+ *
+ * @param payload the CBOR payload
+ * @param payload_size the size of the payload
+ * @param arena the arena holding the result
+ * @param value_list the parsed payload
+ * @return 0 on success, otherwise a tinyCBOR error code
+ */
+int oc_parse_rep_in_arena(const uint8_t *payload, int payload_size,
+                          oc_arena_t *arena, oc_rep_t **value_list);
+
+/**
+ * @brief parse a payload into an arena without copying its strings
+ *
+ * As oc_parse_rep_in_arena(), but text and byte string values refer to the
+ * payload and are not terminated, use oc_string_len() for their length; keys
+ * are copied and terminated. The result also stays valid only as long as
+ * the payload does.
+ *
+ * @param payload the CBOR payload
+ * @param payload_size the size of the payload
+ * @param arena the arena holding the result
+ * @param value_list the parsed payload
+ * @return 0 on success, otherwise a tinyCBOR error code
+ */
+int oc_parse_rep_in_place(const uint8_t *payload, int payload_size,
+                          oc_arena_t *arena, oc_rep_t **value_list);
+
 /**
  * Read an integer from an `oc_rep_t`
  *
@@ -52,7 +52,12 @@ typedef enum {
   OC_OBSERVABLE = (1 << 1),   /**< observable */
   OC_SECURE = (1 << 4),       /**< secure */
   OC_PERIODIC = (1 << 6),     /**< periodical update */
-  OC_SECURE_MCAST = (1 << 8)  /**< secure multi cast (OSCORE) */
+  OC_SECURE_MCAST = (1 << 8), /**< secure multi cast (OSCORE) */
+  OC_POOLED = (1 << 9),       /**< handlers run on the worker pool */
+  OC_CACHED = (1 << 10),      /**< GET responses are cached */
+  OC_STREAMED = (1 << 11),    /**< block-wise transfers are streamed */
+  OC_ZERO_COPY = (1 << 12),   /**< request payloads are parsed in place */
+  OC_RAW_PAYLOAD = (1 << 13)  /**< request payloads are left to the handlers */
 } oc_resource_properties_t;
 
 /**
@@ -311,6 +316,8 @@ typedef struct oc_request_t
   oc_rep_t *request_payload; /**< request payload structure */
   const uint8_t *_payload;   /**< payload of the request */
   size_t _payload_len;       /**< payload size */
+  oc_arena_t *_rep_arena;    /**< arena of request_payload, released after
+                                the handler */
   oc_content_format_t
     content_format; /**< content format (of the payload in the request) */
   oc_content_format_t
@@ -361,6 +368,60 @@ typedef struct oc_properties_cb_t
   void *user_data;
 } oc_properties_cb_t;
 
+/**
+ * @brief block sink callback, receives a streamed request payload
+ *
+ * Called for every block of a block-wise PUT or POST request, in order, as
+ * soon as the block arrives.
+ *
+ * @param resource the resource
+ * @param origin the endpoint of the client
+ * @param query the query of the request
+ * @param query_len the query length
+ * @param offset the offset of the block in the payload
+ * @param block the block
+ * @param block_len the block length
+ * @param more true when more blocks follow
+ * @param user_data the user data
+ * @return false to abort the transfer
+ */
+typedef bool (*oc_block_sink_cb_t)(oc_resource_t *resource,
+                                   const oc_endpoint_t *origin,
+                                   const char *query, size_t query_len,
+                                   uint32_t offset, const uint8_t *block,
+                                   size_t block_len, bool more,
+                                   void *user_data);
+
+/**
+ * @brief block source callback, produces a streamed response payload
+ *
+ * Called for every block of the response to a GET request, when the client
+ * asks for it. The same offset can be asked for more than once.
+ *
+ * @param resource the resource
+ * @param query the query of the request
+ * @param query_len the query length
+ * @param offset the offset of the block in the payload
+ * @param block where the block is written
+ * @param block_size the size of the block
+ * @param more set to true when more blocks follow
+ * @param user_data the user data
+ * @return the length of the block, or -1 on error
+ */
+typedef int (*oc_block_source_cb_t)(oc_resource_t *resource, const char *query,
+                                    size_t query_len, uint32_t offset,
+                                    uint8_t *block, size_t block_size,
+                                    bool *more, void *user_data);
+
+/**
+ * @brief how much of the request payload arena a resource needed
+ */
+typedef struct oc_rep_arena_stats_s
+{
+  size_t high_water;  /**< most bytes the payload of a request took */
+  uint32_t exhausted; /**< payloads that did not fit in the arena */
+} oc_rep_arena_stats_t;
+
 /**
  * @brief resource structure
  *
@@ -386,6 +447,7 @@ struct oc_resource_s
   uint8_t num_observers;               /**< amount of observers */
   uint16_t observe_period_seconds;     /**< observe period in seconds */
   uint8_t fb_instance; /**< function block instance, default = 0 */
+  oc_rep_arena_stats_t rep_arena_stats; /**< request payload arena use */
 };
 
 typedef struct oc_link_s oc_link_t;
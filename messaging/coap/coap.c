@@ -46,6 +46,7 @@
  * This file is part of the Contiki operating system.
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -81,9 +82,13 @@ coap_log_2(uint16_t value)
   return (result - 1);
 }
 /*---------------------------------------------------------------------------*/
-static uint32_t
+static inline uint32_t
 coap_parse_int_option(uint8_t *bytes, size_t length)
 {
+  /* Content-Format, Accept and Block values are mostly a single byte */
+  if (length == 1) {
+    return bytes[0];
+  }
   uint32_t var = 0;
   size_t i = 0;
 
@@ -377,15 +382,16 @@ coap_serialize_signal_options(void *packet, uint8_t *option_array)
 }
 #endif /* OC_TCP */
 /*---------------------------------------------------------------------------*/
-/* It just calculates size of option when option_array is NULL */
+/* It just calculates size of option when option_array is NULL. Deltas start
+ * from option number current_number. */
 static size_t
-coap_serialize_options(void *packet, uint8_t *option_array, bool inner,
-                       bool outer, bool oscore)
+coap_serialize_options(void *packet, uint8_t *option_array,
+                       unsigned int current_number, bool inner, bool outer,
+                       bool oscore)
 {
   (void)oscore;
   coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
   uint8_t *option = option_array;
-  unsigned int current_number = 0;
   size_t option_length = 0;
 
   if (option) {
@@ -545,7 +551,164 @@ coap_parse_signal_options(void *packet, unsigned int option_number,
 }
 #endif /* OC_TCP */
 /*---------------------------------------------------------------------------*/
+/*- Option table ------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+/* how the value of an option is stored in coap_packet_t */
+typedef enum {
+  COAP_OPTION_KIND_UNKNOWN = 0,
+  COAP_OPTION_KIND_UINT16,         /* integer at 'field' */
+  COAP_OPTION_KIND_UINT32,         /* integer at 'field' */
+  COAP_OPTION_KIND_CONTENT_FORMAT, /* UINT16, must be a supported format */
+  COAP_OPTION_KIND_ACCEPT,         /* UINT16, must be a supported format */
+  COAP_OPTION_KIND_STRING,         /* pointer into the message at 'field' */
+  COAP_OPTION_KIND_MULTI,   /* like STRING, repeats merged with 'arg' */
+  COAP_OPTION_KIND_OPAQUE,  /* bytes copied to 'field', at most 'arg' */
+  COAP_OPTION_KIND_BLOCK1,  /* Block1 number, more flag, size and offset */
+  COAP_OPTION_KIND_BLOCK2,  /* Block2 number, more flag, size and offset */
+  COAP_OPTION_KIND_OSCORE,  /* parsed by coap_parse_oscore_option() */
+  COAP_OPTION_KIND_IGNORED, /* accepted, value not used */
+} coap_option_kind_t;
+
+/* OSCORE classes (RFC 8613 section 4.1): E options are allowed in the inner
+ * message, U options in the outer message */
+#define COAP_OPTION_E (1 << 0)
+#define COAP_OPTION_U (1 << 1)
+/* OPAQUE values longer than 'arg' are truncated instead of rejected */
+#define COAP_OPTION_TRUNCATE (1 << 2)
+
+/* the length field of an OPAQUE option is a uint8_t instead of a size_t */
+#define COAP_OPTION_LEN8 (1 << 3)
+
+/* kept at 8 bytes so that the table stays small and indexing is a shift */
+typedef struct
+{
+  uint8_t kind;
+  uint8_t flags;
+  uint8_t arg;        /* MULTI: separator, OPAQUE: maximum length */
+  uint16_t field;     /* offset of the value in coap_packet_t */
+  uint16_t len_field; /* offset of the length of the value */
+} coap_option_desc_t;
+
+#define PKT_FIELD(f) ((uint16_t)offsetof(coap_packet_t, f))
+#define PKT_SIZE(f) ((uint8_t)sizeof(((coap_packet_t *)0)->f))
+
+#define INT_OPTION(k, f, flg)                                                  \
+  {                                                                            \
+    (k), (flg), 0, PKT_FIELD(f), 0                                             \
+  }
+#define STRING_OPTION(k, f, flg, sep)                                          \
+  {                                                                            \
+    (k), (flg), (uint8_t)(sep), PKT_FIELD(f), PKT_FIELD(f##_len)               \
+  }
+#define OPAQUE_OPTION(f, flg)                                                  \
+  {                                                                            \
+    COAP_OPTION_KIND_OPAQUE,                                                   \
+      (flg) | (PKT_SIZE(f##_len) == 1 ? COAP_OPTION_LEN8 : 0), PKT_SIZE(f),    \
+      PKT_FIELD(f), PKT_FIELD(f##_len)                                         \
+  }
+#define KIND_OPTION(k, flg)                                                    \
+  {                                                                            \
+    (k), (flg), 0, 0, 0                                                        \
+  }
+
+#define COAP_OPTION_TABLE_SIZE (64)
+
+/* options numbered below COAP_OPTION_TABLE_SIZE, indexed by number; options
+ * that are not listed are unknown, like If-Match and Location-Path which are
+ * not supported */
+static const coap_option_desc_t coap_option_table[COAP_OPTION_TABLE_SIZE] = {
+  [COAP_OPTION_URI_HOST] =
+    STRING_OPTION(COAP_OPTION_KIND_STRING, uri_host, COAP_OPTION_U, 0),
+  [COAP_OPTION_ETAG] =
+    OPAQUE_OPTION(etag, COAP_OPTION_E | COAP_OPTION_TRUNCATE),
+  [COAP_OPTION_OBSERVE] = INT_OPTION(COAP_OPTION_KIND_UINT32, observe,
+                                     COAP_OPTION_E | COAP_OPTION_U),
+  [COAP_OPTION_URI_PORT] =
+    INT_OPTION(COAP_OPTION_KIND_UINT16, uri_port, COAP_OPTION_U),
+#ifdef OC_OSCORE
+  [COAP_OPTION_OSCORE] = KIND_OPTION(COAP_OPTION_KIND_OSCORE, COAP_OPTION_U),
+#endif /* OC_OSCORE */
+  [COAP_OPTION_URI_PATH] =
+    STRING_OPTION(COAP_OPTION_KIND_MULTI, uri_path, COAP_OPTION_E, '/'),
+  [COAP_OPTION_CONTENT_FORMAT] = INT_OPTION(COAP_OPTION_KIND_CONTENT_FORMAT,
+                                            content_format, COAP_OPTION_E),
+  [COAP_OPTION_MAX_AGE] = INT_OPTION(COAP_OPTION_KIND_UINT32, max_age,
+                                     COAP_OPTION_E | COAP_OPTION_U),
+  [COAP_OPTION_URI_QUERY] =
+    STRING_OPTION(COAP_OPTION_KIND_MULTI, uri_query, COAP_OPTION_E, '&'),
+  [COAP_OPTION_ACCEPT] =
+    INT_OPTION(COAP_OPTION_KIND_ACCEPT, accept, COAP_OPTION_E),
+  [COAP_OPTION_BLOCK2] = KIND_OPTION(COAP_OPTION_KIND_BLOCK2, COAP_OPTION_E),
+  [COAP_OPTION_BLOCK1] = KIND_OPTION(COAP_OPTION_KIND_BLOCK1, COAP_OPTION_E),
+  [COAP_OPTION_SIZE2] =
+    INT_OPTION(COAP_OPTION_KIND_UINT32, size2, COAP_OPTION_E),
+  [COAP_OPTION_PROXY_URI] =
+    STRING_OPTION(COAP_OPTION_KIND_MULTI, proxy_uri, COAP_OPTION_U, '\0'),
+  [COAP_OPTION_SIZE1] =
+    INT_OPTION(COAP_OPTION_KIND_UINT32, size1, COAP_OPTION_E),
+};
+
+/* options numbered from COAP_OPTION_TABLE_SIZE */
+static const struct
+{
+  uint16_t number;
+  coap_option_desc_t desc;
+} coap_option_table_high[] = {
+  { COAP_OPTION_ECHO, OPAQUE_OPTION(echo, COAP_OPTION_E) },
+  { OCF_OPTION_ACCEPT_CONTENT_FORMAT_VER,
+    KIND_OPTION(COAP_OPTION_KIND_IGNORED, COAP_OPTION_E) },
+  { OCF_OPTION_CONTENT_FORMAT_VER,
+    KIND_OPTION(COAP_OPTION_KIND_IGNORED, COAP_OPTION_E) },
+};
+
+static const coap_option_desc_t *
+coap_find_option(unsigned int number)
+{
+  if (number < COAP_OPTION_TABLE_SIZE) {
+    return &coap_option_table[number];
+  }
+  size_t i;
+  for (i = 0; i < sizeof(coap_option_table_high) /
+                    sizeof(coap_option_table_high[0]);
+       i++) {
+    if (coap_option_table_high[i].number == number) {
+      return &coap_option_table_high[i].desc;
+    }
+  }
+  return NULL;
+}
+
+static bool
+coap_content_format_supported(uint16_t format, bool accept)
+{
+  switch (format) {
+  case APPLICATION_VND_OCF_CBOR:
+    return accept;
+  case APPLICATION_OSCORE:
+  case APPLICATION_CBOR:
+  case APPLICATION_LINK_FORMAT:
+  case APPLICATION_OCTET_STREAM:
+  case APPLICATION_JSON:
+  case APPLICATION_PKCS10:
+  case APPLICATION_PKCS7_CMC_REQUEST:
+  case APPLICATION_PKCS7_CMC_RESPONSE:
+  case APPLICATION_PKCS7_SGK:
+    return true;
+  default:
+    return false;
+  }
+}
 
+static void
+coap_parse_block_option(uint32_t value, uint32_t *num, uint8_t *more,
+                        uint16_t *size, uint32_t *offset)
+{
+  *more = (value & 0x08) >> 3;
+  *size = (uint16_t)(16 << (value & 0x07));
+  *offset = (value & ~0x0000000F) << (value & 0x07);
+  *num = value >> 4;
+}
+/*---------------------------------------------------------------------------*/
 coap_status_t
 coap_oscore_parse_options(void *packet, uint8_t *data, uint32_t data_len,
                           uint8_t *current_option, bool inner, bool outer,
@@ -553,15 +716,18 @@ coap_oscore_parse_options(void *packet, uint8_t *data, uint32_t data_len,
 {
   (void)oscore;
   coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  uint8_t *const end = data + data_len;
 
   /* parse options */
   memset(coap_pkt->options, 0, sizeof(coap_pkt->options));
 
   unsigned int option_number = 0;
-  unsigned int option_delta = 0;
-  size_t option_length = 0;
+  /* the classes of options allowed in this message; at least one of inner and
+   * outer is set */
+  const uint8_t classes =
+    (inner ? COAP_OPTION_E : 0) | (outer ? COAP_OPTION_U : 0);
 
-  while (current_option < data + data_len) {
+  while (current_option < end) {
     /* payload marker 0xFF, currently only checking for 0xF* because rest is
      * reserved */
     if ((current_option[0] & 0xF0) == 0xF0) {
@@ -571,51 +737,47 @@ coap_oscore_parse_options(void *packet, uint8_t *data, uint32_t data_len,
       if (coap_pkt->transport_type == COAP_TRANSPORT_UDP &&
           coap_pkt->payload_len > (uint32_t)OC_MAX_APP_DATA_SIZE) {
         coap_pkt->payload_len = (uint32_t)OC_MAX_APP_DATA_SIZE;
-        /* null-terminate payload */
       }
+      /* null-terminate payload */
       coap_pkt->payload[coap_pkt->payload_len] = '\0';
-
-      OC_DBG("Got payload:");
-      OC_LOGbytes(coap_pkt->payload, coap_pkt->payload_len);
       break;
     }
 
-    option_delta = current_option[0] >> 4;
-    option_length = current_option[0] & 0x0F;
+    unsigned int option_delta = current_option[0] >> 4;
+    size_t option_length = current_option[0] & 0x0F;
     ++current_option;
 
-    if (option_delta == 13) {
-      option_delta += current_option[0];
-      ++current_option;
-    } else if (option_delta == 14) {
-      option_delta += 255;
-      option_delta += current_option[0] << 8;
-      ++current_option;
-      option_delta += current_option[0];
-      ++current_option;
-    }
-
-    if (option_length == 13) {
-      option_length += current_option[0];
-      ++current_option;
-    } else if (option_length == 14) {
-      option_length += 255;
-      uint64_t option_shift = current_option[0];
-      option_length += option_shift << 8;
-      ++current_option;
-      option_length += current_option[0];
-      ++current_option;
+    /* most options fit delta and length in the first byte */
+    if (option_delta >= 13 || option_length >= 13) {
+      /* extended delta and length: 13 adds one byte, 14 adds two */
+      size_t ext = (option_delta == 13) + 2 * (option_delta == 14) +
+                   (option_length == 13) + 2 * (option_length == 14);
+      if (ext > (size_t)(end - current_option)) {
+        return BAD_OPTION_4_02;
+      }
+      if (option_delta == 13) {
+        option_delta += current_option[0];
+        ++current_option;
+      } else if (option_delta == 14) {
+        option_delta += 255 + (current_option[0] << 8) + current_option[1];
+        current_option += 2;
+      }
+      if (option_length == 13) {
+        option_length += current_option[0];
+        ++current_option;
+      } else if (option_length == 14) {
+        option_length += 255 + ((size_t)current_option[0] << 8) +
+                         current_option[1];
+        current_option += 2;
+      }
     }
 
     option_number += option_delta;
 
     if (option_number <= COAP_OPTION_ECHO) {
-      OC_DBG("OPTION %u (delta %u, len %zu):", option_number, option_delta,
-             option_length);
       SET_OPTION(coap_pkt, option_number);
     }
-    if (current_option + option_length > data + data_len) {
-      OC_WRN("Unsupported option");
+    if (option_length > (size_t)(end - current_option)) {
       OC_ERR("Unsupported option");
       return BAD_OPTION_4_02;
     }
@@ -628,256 +790,95 @@ coap_oscore_parse_options(void *packet, uint8_t *data, uint32_t data_len,
       continue;
     }
 #endif /* OC_TCP */
-    switch (option_number) {
-#if defined(OC_OSCORE)
-      //&& defined(OC_SECURITY)
-    case COAP_OPTION_OSCORE:
-      if (!outer || !oscore) {
-        return BAD_OPTION_4_02;
-      }
-      coap_parse_oscore_option(coap_pkt, current_option, option_length);
-      break;
-#endif /* OC_OSCORE && OC_SECURITY */
-    case COAP_OPTION_CONTENT_FORMAT:
-      if (!inner) {
+
+    const coap_option_desc_t *desc =
+      option_number < COAP_OPTION_TABLE_SIZE
+        ? &coap_option_table[option_number]
+        : coap_find_option(option_number);
+    if (!desc || desc->kind == COAP_OPTION_KIND_UNKNOWN) {
+      /* check if critical (odd) */
+      if (option_number & 1) {
+        OC_WRN("Unsupported critical option %u", option_number);
         return BAD_OPTION_4_02;
       }
-      coap_pkt->content_format =
+      current_option += option_length;
+      continue;
+    }
+    if ((desc->flags & classes) == 0) {
+      return BAD_OPTION_4_02;
+    }
+
+    uint8_t *field = (uint8_t *)coap_pkt + desc->field;
+    switch (desc->kind) {
+    case COAP_OPTION_KIND_UINT16:
+      *(uint16_t *)field =
         (uint16_t)coap_parse_int_option(current_option, option_length);
-      OC_DBG("  Content-Format [%u]", coap_pkt->content_format);
-      if (coap_pkt->content_format != APPLICATION_OSCORE &&
-          coap_pkt->content_format != APPLICATION_CBOR &&
-          coap_pkt->content_format != APPLICATION_LINK_FORMAT &&
-          coap_pkt->content_format != APPLICATION_OCTET_STREAM &&
-          coap_pkt->content_format != APPLICATION_JSON &&
-          coap_pkt->content_format != APPLICATION_PKCS10 &&
-          coap_pkt->content_format != APPLICATION_PKCS7_CMC_REQUEST &&
-          coap_pkt->content_format != APPLICATION_PKCS7_CMC_RESPONSE &&
-          coap_pkt->content_format != APPLICATION_PKCS7_SGK)
-        return UNSUPPORTED_MEDIA_TYPE_4_15;
       break;
-    case COAP_OPTION_MAX_AGE:
-      coap_pkt->max_age = coap_parse_int_option(current_option, option_length);
-      OC_DBG("  Max-Age [%lu]", (unsigned long)coap_pkt->max_age);
+    case COAP_OPTION_KIND_UINT32:
+      *(uint32_t *)field = coap_parse_int_option(current_option, option_length);
       break;
-    case COAP_OPTION_ETAG:
-      if (!inner) {
-        return BAD_OPTION_4_02;
-      }
-      coap_pkt->etag_len = (uint8_t)MIN(COAP_ETAG_LEN, option_length);
-      memcpy(coap_pkt->etag, current_option, coap_pkt->etag_len);
-      OC_DBG("  ETag %u [0x%02X%02X%02X%02X%02X%02X%02X%02X]",
-             coap_pkt->etag_len, coap_pkt->etag[0], coap_pkt->etag[1],
-             coap_pkt->etag[2], coap_pkt->etag[3], coap_pkt->etag[4],
-             coap_pkt->etag[5], coap_pkt->etag[6],
-             coap_pkt->etag[7]); /*FIXME always prints 8 bytes */
-      break;
-    case COAP_OPTION_ACCEPT:
-      if (!inner) {
-        return BAD_OPTION_4_02;
-      }
-      coap_pkt->accept =
+    case COAP_OPTION_KIND_CONTENT_FORMAT:
+    case COAP_OPTION_KIND_ACCEPT: {
+      uint16_t format =
         (uint16_t)coap_parse_int_option(current_option, option_length);
-      OC_DBG("  Accept [%u]", coap_pkt->accept);
-      if (coap_pkt->accept != APPLICATION_VND_OCF_CBOR &&
-          coap_pkt->accept != APPLICATION_CBOR &&
-          coap_pkt->accept != APPLICATION_OSCORE &&
-          coap_pkt->accept != APPLICATION_LINK_FORMAT &&
-          coap_pkt->accept != APPLICATION_OCTET_STREAM &&
-          coap_pkt->accept != APPLICATION_JSON &&
-          coap_pkt->accept != APPLICATION_PKCS10 &&
-          coap_pkt->accept != APPLICATION_PKCS7_CMC_RESPONSE &&
-          coap_pkt->accept != APPLICATION_PKCS7_CMC_REQUEST &&
-          coap_pkt->accept != APPLICATION_PKCS7_SGK)
-        return NOT_ACCEPTABLE_4_06;
-      break;
-    case COAP_OPTION_PROXY_URI:
-      if (!outer) {
-        return BAD_OPTION_4_02;
+      bool accept = (desc->kind == COAP_OPTION_KIND_ACCEPT);
+      *(uint16_t *)field = format;
+      if (!coap_content_format_supported(format, accept)) {
+        return accept ? NOT_ACCEPTABLE_4_06 : UNSUPPORTED_MEDIA_TYPE_4_15;
       }
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final
-       * packet field should be const string -> cast to string */
-      coap_merge_multi_option((char **)&(coap_pkt->proxy_uri),
-                              &(coap_pkt->proxy_uri_len), current_option,
-                              option_length, '\0');
-      OC_DBG("Proxy-Uri [%.*s]", (int)coap_pkt->proxy_uri_len,
-             coap_pkt->proxy_uri);
-      break;
-#if 0
-    case COAP_OPTION_IF_MATCH:
-      if (!inner) {
-	return BAD_OPTION_4_02;
-      }
-      /* TODO support multiple ETags */
-      coap_pkt->if_match_len = MIN(COAP_ETAG_LEN, option_length);
-      memcpy(coap_pkt->if_match, current_option,
-             coap_pkt->if_match_len);
-      OC_DBG("If-Match %u", coap_pkt->if_match_len);
-      OC_LOGbytes(coap_pkt->if_match, coap_pkt->if_match_len);
-      break;
-    case COAP_OPTION_IF_NONE_MATCH:
-      if (!inner) {
-	return BAD_OPTION_4_02;
-      }
-      coap_pkt->if_none_match = 1;
-      OC_DBG("If-None-Match");
-      break;
-    case COAP_OPTION_PROXY_SCHEME:
-      if (!outer) {
-	return BAD_OPTION_4_02;
-      }
-#if COAP_PROXY_OPTION_PROCESSING
-      coap_pkt->proxy_scheme = (char *)current_option;
-      coap_pkt->proxy_scheme_len = option_length;
-#endif
-      OC_DBG("Proxy-Scheme NOT IMPLEMENTED [%.*s]",
-             (int)coap_pkt->proxy_scheme_len, coap_pkt->proxy_scheme);
-      return PROXYING_NOT_SUPPORTED_5_05;
-      break;
-#endif
-    case COAP_OPTION_URI_HOST:
-      if (!outer) {
-        return BAD_OPTION_4_02;
-      }
-      coap_pkt->uri_host = (char *)current_option;
-      coap_pkt->uri_host_len = option_length;
-      OC_DBG("Uri-Host [%.*s]", (int)coap_pkt->uri_host_len,
-             coap_pkt->uri_host);
-      break;
-    case COAP_OPTION_URI_PORT:
-      if (!outer) {
-        return BAD_OPTION_4_02;
-      }
-      coap_pkt->uri_port =
-        (uint16_t)coap_parse_int_option(current_option, option_length);
-      OC_DBG("  Uri-Port [%u]", coap_pkt->uri_port);
-      break;
-    case COAP_OPTION_URI_PATH:
-      if (!inner) {
-        return BAD_OPTION_4_02;
-      }
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final
-       * packet field should be const string -> cast to string */
-      coap_merge_multi_option((char **)&(coap_pkt->uri_path),
-                              &(coap_pkt->uri_path_len), current_option,
-                              option_length, '/');
-      OC_DBG("  Uri-Path [%.*s]", (int)coap_pkt->uri_path_len,
-             coap_pkt->uri_path);
+    } break;
+    case COAP_OPTION_KIND_STRING:
+      *(const char **)field = (const char *)current_option;
+      *(size_t *)((uint8_t *)coap_pkt + desc->len_field) = option_length;
       break;
-    case COAP_OPTION_URI_QUERY:
-      if (!inner) {
-        return BAD_OPTION_4_02;
-      }
+    case COAP_OPTION_KIND_MULTI:
       /* coap_merge_multi_option() operates in-place on the IPBUF, but final
        * packet field should be const string -> cast to string */
-      coap_merge_multi_option((char **)&(coap_pkt->uri_query),
-                              &(coap_pkt->uri_query_len), current_option,
-                              option_length, '&');
-      OC_DBG("  Uri-Query [%.*s]", (int)coap_pkt->uri_query_len,
-             coap_pkt->uri_query);
+      coap_merge_multi_option((char **)field,
+                              (size_t *)((uint8_t *)coap_pkt + desc->len_field),
+                              current_option, option_length, (char)desc->arg);
       break;
-#if 0
-    case COAP_OPTION_LOCATION_PATH:
-      if (!inner) {
-	return BAD_OPTION_4_02;
-      }
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-      coap_merge_multi_option(
-          (char **)&(coap_pkt->location_path),
-          &(coap_pkt->location_path_len),
-          current_option, option_length,
-          '/');
-      OC_DBG("Location-Path [%.*s]", (int)coap_pkt->location_path_len,
-    coap_pkt->location_path);
-      break;
-    case COAP_OPTION_LOCATION_QUERY:
-      if (!inner) {
-	return BAD_OPTION_4_02;
-      }
-      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-      coap_merge_multi_option(
-          (char **)&(coap_pkt->location_query),
-          &(coap_pkt->location_query_len),
-          current_option, option_length,
-          '&');
-      OC_DBG("Location-Query [%.*s]", (int)coap_pkt->location_query_len,
-             coap_pkt->location_query);
-      break;
-#endif
-    case COAP_OPTION_OBSERVE:
-      coap_pkt->observe = coap_parse_int_option(current_option, option_length);
-      OC_DBG("  Observe [%lu]", (unsigned long)coap_pkt->observe);
-      break;
-    case COAP_OPTION_BLOCK2:
-      if (!inner) {
-        return BAD_OPTION_4_02;
+    case COAP_OPTION_KIND_OPAQUE: {
+      size_t len = option_length;
+      if (len > desc->arg) {
+        if (!(desc->flags & COAP_OPTION_TRUNCATE)) {
+          return BAD_OPTION_4_02;
+        }
+        len = desc->arg;
       }
-      coap_pkt->block2_num =
-        coap_parse_int_option(current_option, option_length);
-      coap_pkt->block2_more = (coap_pkt->block2_num & 0x08) >> 3;
-      coap_pkt->block2_size = 16 << (coap_pkt->block2_num & 0x07);
-      coap_pkt->block2_offset = (coap_pkt->block2_num & ~0x0000000F)
-                                << (coap_pkt->block2_num & 0x07);
-      coap_pkt->block2_num >>= 4;
-      OC_DBG("  Block2 [%lu%s (%u B/blk)]", (unsigned long)coap_pkt->block2_num,
-             coap_pkt->block2_more ? "+" : "", coap_pkt->block2_size);
-      break;
-    case COAP_OPTION_BLOCK1:
-      if (!inner) {
-        return BAD_OPTION_4_02;
+      memcpy(field, current_option, len);
+      uint8_t *len_field = (uint8_t *)coap_pkt + desc->len_field;
+      if (desc->flags & COAP_OPTION_LEN8) {
+        *len_field = (uint8_t)len;
+      } else {
+        *(size_t *)len_field = len;
       }
-      coap_pkt->block1_num =
-        coap_parse_int_option(current_option, option_length);
-      coap_pkt->block1_more = (coap_pkt->block1_num & 0x08) >> 3;
-      coap_pkt->block1_size = 16 << (coap_pkt->block1_num & 0x07);
-      coap_pkt->block1_offset = (coap_pkt->block1_num & ~0x0000000F)
-                                << (coap_pkt->block1_num & 0x07);
-      coap_pkt->block1_num >>= 4;
-      OC_DBG("  Block1 [%lu%s (%u B/blk)]", (unsigned long)coap_pkt->block1_num,
-             coap_pkt->block1_more ? "+" : "", coap_pkt->block1_size);
+    } break;
+    case COAP_OPTION_KIND_BLOCK1:
+      coap_parse_block_option(
+        coap_parse_int_option(current_option, option_length),
+        &coap_pkt->block1_num, &coap_pkt->block1_more, &coap_pkt->block1_size,
+        &coap_pkt->block1_offset);
       break;
-    case COAP_OPTION_SIZE2:
-      if (!inner) {
-        return BAD_OPTION_4_02;
-      }
-      coap_pkt->size2 = coap_parse_int_option(current_option, option_length);
-      OC_DBG("  Size2 [%lu]", (unsigned long)coap_pkt->size2);
+    case COAP_OPTION_KIND_BLOCK2:
+      coap_parse_block_option(
+        coap_parse_int_option(current_option, option_length),
+        &coap_pkt->block2_num, &coap_pkt->block2_more, &coap_pkt->block2_size,
+        &coap_pkt->block2_offset);
       break;
-    case COAP_OPTION_SIZE1:
-      if (!inner) {
-        return BAD_OPTION_4_02;
-      }
-      coap_pkt->size1 = coap_parse_int_option(current_option, option_length);
-      OC_DBG("  Size1 [%lu]", (unsigned long)coap_pkt->size1);
-      break;
-    case COAP_OPTION_ECHO:
-      if (!inner || option_length > COAP_ECHO_LEN) {
-        // Echo options must be OSCORE-encrypted for the deduplication to work
+#ifdef OC_OSCORE
+    case COAP_OPTION_KIND_OSCORE:
+      if (!oscore) {
         return BAD_OPTION_4_02;
       }
-      memcpy(coap_pkt->echo, current_option, option_length);
-      coap_pkt->echo_len = option_length;
-      // OC_DBG("  Echo [%lu]", (unsigned long)coap_pkt->echo);
+      coap_parse_oscore_option(coap_pkt, current_option, option_length);
       break;
-    case OCF_OPTION_CONTENT_FORMAT_VER:
-    case OCF_OPTION_ACCEPT_CONTENT_FORMAT_VER: {
-      if (!inner) {
-        return BAD_OPTION_4_02;
-      }
-      // uint16_t version =
-      //  (uint16_t)coap_parse_int_option(current_option, option_length);
-      // OC_DBG("  Content-format/accept-Version: [%u]", version);
-    } break;
+#endif /* OC_OSCORE */
     default:
-      OC_DBG("  unknown (%u)", option_number);
-      /* check if critical (odd) */
-      if (option_number & 1) {
-        OC_WRN("Unsupported critical option");
-        return BAD_OPTION_4_02;
-      }
+      break;
     }
     current_option += option_length;
-  } /* for */
+  }
   OC_DBG("-Done parsing-------");
 
   return COAP_NO_ERROR;
@@ -1076,7 +1077,7 @@ coap_oscore_serialize_message(void *packet, uint8_t *buffer, bool inner,
 
   /* CoAP header option serialize first to know total length about options */
   option_length_calculation =
-    coap_serialize_options(coap_pkt, NULL, inner, outer, oscore);
+    coap_serialize_options(coap_pkt, NULL, 0, inner, outer, oscore);
   header_length_calculation += option_length_calculation;
 
   /* according to spec  COAP_PAYLOAD_MARKER_LEN should be included
@@ -1158,7 +1159,8 @@ coap_oscore_serialize_message(void *packet, uint8_t *buffer, bool inner,
     }
   }
 
-  option_length = coap_serialize_options(packet, option, inner, outer, oscore);
+  option_length =
+    coap_serialize_options(packet, option, 0, inner, outer, oscore);
   option += option_length;
 
   /* Pack payload */
@@ -1215,6 +1217,63 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   return coap_oscore_serialize_message(packet, buffer, true, true, false);
 }
 /*---------------------------------------------------------------------------*/
+uint8_t *
+coap_serialize_notification_body(void *packet, size_t *body_len)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  /* options numbered before Observe would have to be written in front of it */
+  if (IS_OPTION(coap_pkt, COAP_OPTION_URI_HOST) ||
+      IS_OPTION(coap_pkt, COAP_OPTION_ETAG)) {
+    return NULL;
+  }
+
+  /* Observe is written per observer by coap_serialize_notification() */
+  uint8_t *observe_bits =
+    &coap_pkt->options[COAP_OPTION_OBSERVE / OPTION_MAP_SIZE];
+  uint8_t saved_bits = *observe_bits;
+  *observe_bits &= (uint8_t) ~(1 << (COAP_OPTION_OBSERVE % OPTION_MAP_SIZE));
+  uint8_t options[COAP_MAX_HEADER_SIZE];
+  size_t option_length = coap_serialize_options(
+    coap_pkt, NULL, COAP_OPTION_OBSERVE, true, true, false);
+  if (option_length + COAP_PAYLOAD_MARKER_LEN <= sizeof(options)) {
+    coap_serialize_options(coap_pkt, options, COAP_OPTION_OBSERVE, true, true,
+                           false);
+  }
+  *observe_bits = saved_bits;
+  if (option_length + COAP_PAYLOAD_MARKER_LEN > sizeof(options)) {
+    OC_WRN("Serialized header length %u exceeds COAP_MAX_HEADER_SIZE %u",
+           (unsigned int)option_length, COAP_MAX_HEADER_SIZE);
+    return NULL;
+  }
+
+  /* place the options and the payload marker in the headroom in front of the
+   * payload */
+  if (coap_pkt->payload_len > 0) {
+    options[option_length++] = 0xFF;
+  }
+  uint8_t *body = coap_pkt->payload - option_length;
+  memcpy(body, options, option_length);
+  *body_len = option_length + coap_pkt->payload_len;
+  return body;
+}
+/*---------------------------------------------------------------------------*/
+size_t
+coap_serialize_notification(void *packet, const uint8_t *body, size_t body_len,
+                            uint8_t *buffer)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  coap_pkt->buffer = buffer;
+  coap_pkt->version = 1;
+  coap_udp_set_header_fields(coap_pkt);
+  size_t length = COAP_HEADER_LEN;
+  memcpy(buffer + length, coap_pkt->token, coap_pkt->token_len);
+  length += coap_pkt->token_len;
+  length += coap_serialize_int_option(COAP_OPTION_OBSERVE, 0, buffer + length,
+                                      coap_pkt->observe);
+  memcpy(buffer + length, body, body_len);
+  return length + body_len;
+}
+/*---------------------------------------------------------------------------*/
 coap_status_t
 coap_udp_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 {
@@ -240,6 +240,27 @@ void coap_udp_init_message(void *packet, coap_message_type_t type, uint8_t code,
 size_t coap_serialize_message(void *packet, uint8_t *buffer);
 size_t coap_oscore_serialize_message(void *packet, uint8_t *buffer, bool inner,
                                      bool outer, bool oscore);
+
+/**
+ * Serialize the part of a notification that is the same for every observer
+ * of a resource: the options numbered after Observe, the payload marker and
+ * the payload. The payload is not copied; the options are written into the
+ * COAP_MAX_HEADER_SIZE bytes of headroom that must precede it.
+ *
+ * \param body_len set to the length of the body
+ * \return the start of the body, NULL if packet has options numbered before
+ *         Observe or they do not fit
+ */
+uint8_t *coap_serialize_notification_body(void *packet, size_t *body_len);
+
+/**
+ * Serialize a UDP notification: the header, token and Observe option of
+ * packet followed by a copy of a body from
+ * coap_serialize_notification_body(). The result is the same as
+ * coap_serialize_message() of the complete notification.
+ */
+size_t coap_serialize_notification(void *packet, const uint8_t *body,
+                                   size_t body_len, uint8_t *buffer);
 void coap_send_message(oc_message_t *message);
 coap_status_t coap_oscore_parse_options(void *packet, uint8_t *data,
                                         uint32_t data_len,
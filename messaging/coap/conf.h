@@ -84,6 +84,12 @@ extern "C" {
   (OC_MAX_APP_RESOURCES + OC_MAX_NUM_CONCURRENT_REQUESTS)
 #endif /* COAP_MAX_OBSERVERS */
 
+/* Number of buffers for building notifications; with dynamic allocation more
+ * are taken from the heap when notifications are built in a nested way */
+#ifndef COAP_NOTIFICATION_BUFFERS
+#define COAP_NOTIFICATION_BUFFERS (2)
+#endif /* COAP_NOTIFICATION_BUFFERS */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to
  * check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL 5
@@ -130,16 +130,17 @@ typedef enum {
   CONTENT_2_05 = 69,  /* OK */
   CONTINUE_2_31 = 95, /* CONTINUE */
 
-  BAD_REQUEST_4_00 = 128,              /* BAD_REQUEST */
-  UNAUTHORIZED_4_01 = 129,             /* UNAUTHORIZED */
-  BAD_OPTION_4_02 = 130,               /* BAD_OPTION */
-  FORBIDDEN_4_03 = 131,                /* FORBIDDEN */
-  NOT_FOUND_4_04 = 132,                /* NOT_FOUND */
-  METHOD_NOT_ALLOWED_4_05 = 133,       /* METHOD_NOT_ALLOWED */
-  NOT_ACCEPTABLE_4_06 = 134,           /* NOT_ACCEPTABLE */
-  PRECONDITION_FAILED_4_12 = 140,      /* BAD_REQUEST */
-  REQUEST_ENTITY_TOO_LARGE_4_13 = 141, /* REQUEST_ENTITY_TOO_LARGE */
-  UNSUPPORTED_MEDIA_TYPE_4_15 = 143,   /* UNSUPPORTED_MEDIA_TYPE */
+  BAD_REQUEST_4_00 = 128,               /* BAD_REQUEST */
+  UNAUTHORIZED_4_01 = 129,              /* UNAUTHORIZED */
+  BAD_OPTION_4_02 = 130,                /* BAD_OPTION */
+  FORBIDDEN_4_03 = 131,                 /* FORBIDDEN */
+  NOT_FOUND_4_04 = 132,                 /* NOT_FOUND */
+  METHOD_NOT_ALLOWED_4_05 = 133,        /* METHOD_NOT_ALLOWED */
+  NOT_ACCEPTABLE_4_06 = 134,            /* NOT_ACCEPTABLE */
+  REQUEST_ENTITY_INCOMPLETE_4_08 = 136, /* REQUEST_ENTITY_INCOMPLETE */
+  PRECONDITION_FAILED_4_12 = 140,       /* BAD_REQUEST */
+  REQUEST_ENTITY_TOO_LARGE_4_13 = 141,  /* REQUEST_ENTITY_TOO_LARGE */
+  UNSUPPORTED_MEDIA_TYPE_4_15 = 143,    /* UNSUPPORTED_MEDIA_TYPE */
 
   INTERNAL_SERVER_ERROR_5_00 = 160,  /* INTERNAL_SERVER_ERROR */
   NOT_IMPLEMENTED_5_01 = 161,        /* NOT_IMPLEMENTED */
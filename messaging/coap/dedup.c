@@ -0,0 +1,188 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "dedup.h"
+
+#ifdef OC_REQUEST_HISTORY
+
+#include "coap.h"
+#include "constants.h"
+#include "oc_buffer.h"
+#include "port/oc_clock.h"
+#include "port/oc_log.h"
+#include "util/oc_hash_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* the entries form a ring in the order the requests were received */
+static coap_dedup_entry_t entries[OC_REQUEST_HISTORY_SIZE];
+static size_t oldest;
+static size_t count;
+OC_HASH_INDEX(entries_by_key, OC_REQUEST_HISTORY_SIZE);
+
+static void
+set_key(coap_dedup_entry_t *key, const oc_endpoint_t *endpoint, uint16_t mid)
+{
+  memset(key->address, 0, sizeof(key->address));
+  if (endpoint->flags & IPV4) {
+    memcpy(key->address, endpoint->addr.ipv4.address,
+           sizeof(endpoint->addr.ipv4.address));
+    key->port = endpoint->addr.ipv4.port;
+  } else {
+    memcpy(key->address, endpoint->addr.ipv6.address,
+           sizeof(endpoint->addr.ipv6.address));
+    key->port = endpoint->addr.ipv6.port;
+  }
+  key->mid = mid;
+  key->device = endpoint->device;
+
+  uint8_t buf[sizeof(key->address) + 2 * sizeof(uint16_t) + sizeof(size_t)];
+  size_t len = 0;
+  memcpy(buf, key->address, sizeof(key->address));
+  len += sizeof(key->address);
+  memcpy(buf + len, &key->port, sizeof(key->port));
+  len += sizeof(key->port);
+  memcpy(buf + len, &key->mid, sizeof(key->mid));
+  len += sizeof(key->mid);
+  memcpy(buf + len, &key->device, sizeof(key->device));
+  len += sizeof(key->device);
+  key->hash = oc_hash_bytes(buf, len);
+}
+
+static bool
+same_key(const coap_dedup_entry_t *a, const coap_dedup_entry_t *b)
+{
+  return a->mid == b->mid && a->port == b->port && a->device == b->device &&
+         memcmp(a->address, b->address, sizeof(a->address)) == 0;
+}
+
+static void
+free_response(coap_dedup_entry_t *entry)
+{
+#ifdef OC_DYNAMIC_ALLOCATION
+  free(entry->response);
+#endif /* OC_DYNAMIC_ALLOCATION */
+  entry->response = NULL;
+  entry->response_len = 0;
+}
+
+static void
+remove_oldest(void)
+{
+  coap_dedup_entry_t *entry = &entries[oldest];
+  oc_hash_index_remove(&entries_by_key, entry, entry->hash);
+  free_response(entry);
+  oldest = (oldest + 1) % OC_REQUEST_HISTORY_SIZE;
+  count--;
+}
+
+coap_dedup_entry_t *
+coap_dedup_find(const oc_endpoint_t *endpoint, uint16_t mid)
+{
+  coap_dedup_entry_t key;
+  set_key(&key, endpoint, mid);
+  oc_clock_time_t now = oc_clock_time();
+  uint32_t pos;
+  coap_dedup_entry_t *entry = (coap_dedup_entry_t *)oc_hash_index_first(
+    &entries_by_key, key.hash, &pos);
+  for (; entry; entry = (coap_dedup_entry_t *)oc_hash_index_next(
+                  &entries_by_key, key.hash, &pos)) {
+    if (same_key(entry, &key) && entry->expires > now) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+coap_dedup_entry_t *
+coap_dedup_add(const oc_endpoint_t *endpoint, uint16_t mid, bool confirmable)
+{
+  oc_clock_time_t now = oc_clock_time();
+  while (count > 0 && entries[oldest].expires <= now) {
+    remove_oldest();
+  }
+  if (count == OC_REQUEST_HISTORY_SIZE) {
+    remove_oldest();
+  }
+
+  coap_dedup_entry_t *entry =
+    &entries[(oldest + count) % OC_REQUEST_HISTORY_SIZE];
+  set_key(entry, endpoint, mid);
+  entry->expires =
+    now +
+    (oc_clock_time_t)(confirmable ? OC_EXCHANGE_LIFETIME : OC_NON_LIFETIME) *
+      OC_CLOCK_SECOND;
+  if (!oc_hash_index_add(&entries_by_key, entry, entry->hash)) {
+    OC_ERR("could not index request for duplicate detection");
+    return NULL;
+  }
+  count++;
+  return entry;
+}
+
+void
+coap_dedup_set_response(coap_dedup_entry_t *entry, const uint8_t *data,
+                        size_t len)
+{
+  free_response(entry);
+#ifdef OC_DYNAMIC_ALLOCATION
+  entry->response = (uint8_t *)malloc(len);
+  if (entry->response) {
+    memcpy(entry->response, data, len);
+    entry->response_len = len;
+  }
+#else  /* OC_DYNAMIC_ALLOCATION */
+  (void)data;
+  (void)len;
+#endif /* !OC_DYNAMIC_ALLOCATION */
+}
+
+void
+coap_dedup_resend_response(const coap_dedup_entry_t *entry,
+                           const oc_endpoint_t *endpoint)
+{
+  if (entry->response_len == 0) {
+    return;
+  }
+  OC_DBG("resending response to duplicate request: mid=%u", entry->mid);
+  oc_message_t *message =
+    oc_internal_allocate_outgoing_message_with_size(entry->response_len);
+  if (message) {
+    memcpy(&message->endpoint, endpoint, sizeof(*endpoint));
+    memcpy(message->data, entry->response, entry->response_len);
+    message->length = entry->response_len;
+    coap_send_message(message);
+    if (message->ref_count == 0) {
+      oc_message_unref(message);
+    }
+  }
+}
+
+void
+coap_dedup_free_all(void)
+{
+  while (count > 0) {
+    remove_oldest();
+  }
+  oc_hash_index_clear(&entries_by_key);
+  oldest = 0;
+}
+
+#else  /* OC_REQUEST_HISTORY */
+typedef int dummy_declaration;
+#endif /* !OC_REQUEST_HISTORY */
@@ -0,0 +1,100 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+/**
+ * Duplicate detection for incoming CoAP requests (RFC 7252 section 4.5).
+ *
+ * A request is identified by the device it was received on, the address and
+ * port of its sender and its message ID. Entries are kept for
+ * EXCHANGE_LIFETIME (confirmable) or NON_LIFETIME (non-confirmable), or until
+ * they are pushed out by newer requests. For a confirmable request the
+ * serialized piggybacked response is kept as well, so that a retransmission
+ * of the request is answered with the same response instead of being
+ * processed twice or ignored.
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "oc_config.h"
+#include "oc_endpoint.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The number of requests that are remembered. When the cache is full the
+ * oldest request is forgotten, so this should cover the requests a device can
+ * receive within EXCHANGE_LIFETIME, including multicast bursts.
+ */
+#ifndef OC_REQUEST_HISTORY_SIZE
+#define OC_REQUEST_HISTORY_SIZE (128)
+#endif
+
+typedef struct coap_dedup_entry_s
+{
+  oc_clock_time_t expires;
+  uint32_t hash;
+  uint8_t address[16];
+  uint16_t port;
+  uint16_t mid;
+  size_t device;
+  uint8_t *response;
+  size_t response_len;
+} coap_dedup_entry_t;
+
+/**
+ * Find a request that was received before and has not expired.
+ */
+coap_dedup_entry_t *coap_dedup_find(const oc_endpoint_t *endpoint,
+                                    uint16_t mid);
+
+/**
+ * Remember a request, forgetting the oldest one if the cache is full.
+ *
+ * \return the new entry, valid until the next call of coap_dedup_add()
+ */
+coap_dedup_entry_t *coap_dedup_add(const oc_endpoint_t *endpoint,
+                                   uint16_t mid, bool confirmable);
+
+/**
+ * Keep a copy of the serialized response to a confirmable request.
+ */
+void coap_dedup_set_response(coap_dedup_entry_t *entry, const uint8_t *data,
+                             size_t len);
+
+/**
+ * Send the kept response again, to the endpoint of the retransmission.
+ */
+void coap_dedup_resend_response(const coap_dedup_entry_t *entry,
+                                const oc_endpoint_t *endpoint);
+
+/**
+ * Forget all requests.
+ */
+void coap_dedup_free_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEDUP_H */
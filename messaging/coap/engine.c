@@ -74,6 +74,11 @@
 #include "coap_signal.h"
 #endif
 
+#ifdef OC_REQUEST_HISTORY
+#include "dedup.h"
+#endif /* OC_REQUEST_HISTORY */
+#include "seen_senders.h"
+
 OC_PROCESS(coap_engine, "CoAP Engine");
 
 #ifdef OC_BLOCK_WISE
@@ -88,38 +93,12 @@ extern bool oc_ri_invoke_coap_entity_handler(void *request, void *response,
 #endif /* !OC_BLOCK_WISE */
 
 #ifdef OC_REQUEST_HISTORY
-// The size of the array used to de-duplicate CoAP messages.
-// A value of 25 means that the message ID & device counter
-// are compared to the ones in the last 25 messages. If a
-// match is found, the message is dropped as it must be
-// a duplicate.
-#define OC_REQUEST_HISTORY_SIZE (25)
-static uint16_t history[OC_REQUEST_HISTORY_SIZE];
-static uint8_t history_dev[OC_REQUEST_HISTORY_SIZE];
-static uint8_t idx;
-
-#ifndef OC_SEEN_SENDERS_SIZE
-#define OC_SEEN_SENDERS_SIZE (32)
-#endif
-
-#ifndef OC_ECHO_FRESHNESS_TIME
-#define OC_ECHO_FRESHNESS_TIME (10 * OC_CLOCK_CONF_TICKS_PER_SECOND)
-#endif
-
-// cache of previously seen senders - they have responded with a valid Echo
-// response when asked to do so
-static oc_ipv6_addr_t seen_senders[OC_SEEN_SENDERS_SIZE];
-size_t seen_sender_idx = 0;
-
 bool
-oc_coap_check_if_duplicate(uint16_t mid, uint8_t device)
+oc_coap_check_if_duplicate(uint16_t mid, const oc_endpoint_t *endpoint)
 {
-  size_t i;
-  for (i = 0; i < OC_REQUEST_HISTORY_SIZE; i++) {
-    if (history[i] == mid && history_dev[i] == device) {
-      OC_DBG("dropping duplicate request");
-      return true;
-    }
+  if (coap_dedup_find(endpoint, mid)) {
+    OC_DBG("dropping duplicate request");
+    return true;
   }
   return false;
 }
@@ -133,7 +112,8 @@ coap_send_empty_response(coap_message_type_t type, uint16_t mid,
   OC_DBG("CoAP send empty message: mid=%u, code=%u", mid, code);
   coap_packet_t msg[1]; // empty response
   coap_udp_init_message(msg, type, code, mid);
-  oc_message_t *message = oc_internal_allocate_outgoing_message();
+  oc_message_t *message =
+    oc_internal_allocate_outgoing_message_with_size(COAP_MAX_HEADER_SIZE);
   if (message) {
     memcpy(&message->endpoint, endpoint, sizeof(*endpoint));
     if (token && token_len > 0) {
@@ -160,7 +140,8 @@ coap_send_unauth_echo_response(coap_message_type_t type, uint16_t mid,
   coap_packet_t msg[1]; // empty response
   coap_udp_init_message(msg, type, UNAUTHORIZED_4_01, mid);
   OC_WRN("CoAP send Unauthorised Echo Response message: mid=%u", mid);
-  oc_message_t *message = oc_internal_allocate_outgoing_message();
+  oc_message_t *message =
+    oc_internal_allocate_outgoing_message_with_size(COAP_MAX_HEADER_SIZE);
   if (message) {
     memcpy(&message->endpoint, endpoint, sizeof(*endpoint));
     if (token && token_len > 0) {
@@ -228,6 +209,10 @@ coap_receive(oc_message_t *msg)
   oc_client_cb_t *client_cb = 0;
 #endif /* OC_CLIENT */
 
+#ifdef OC_REQUEST_HISTORY
+  coap_dedup_entry_t *request_seen = NULL;
+#endif /* OC_REQUEST_HISTORY */
+
 #ifdef OC_TCP
   if (msg->endpoint.flags & TCP) {
     coap_status_code =
@@ -320,10 +305,9 @@ coap_receive(oc_message_t *msg)
 
           // a little bit naughty - modify the old client callback to refer to
           // the new (retransmitted) packet
-          client_cb->mid = retransmitted_pkt->mid;
-          client_cb->token_len = retransmitted_pkt->token_len;
-          memcpy(client_cb->token, retransmitted_pkt->token,
-                 client_cb->token_len);
+          oc_ri_set_client_cb_mid(client_cb, retransmitted_pkt->mid);
+          oc_ri_set_client_cb_token(client_cb, retransmitted_pkt->token,
+                                    retransmitted_pkt->token_len);
 
           new_transaction->message = oc_internal_allocate_outgoing_message();
           new_transaction->message->endpoint = transaction->message->endpoint;
@@ -375,19 +359,21 @@ coap_receive(oc_message_t *msg)
       } else
 #endif /* OC_TCP */
       {
+#ifdef OC_REQUEST_HISTORY
+        coap_dedup_entry_t *seen =
+          coap_dedup_find(&msg->endpoint, message->mid);
+        if (seen) {
+          OC_DBG("dropping duplicate request");
+          coap_dedup_resend_response(seen, &msg->endpoint);
+          return 0;
+        }
+        request_seen = coap_dedup_add(&msg->endpoint, message->mid,
+                                      message->type == COAP_TYPE_CON);
+#endif /* OC_REQUEST_HISTORY */
         if (message->type == COAP_TYPE_CON) {
           coap_udp_init_message(response, COAP_TYPE_ACK, CONTENT_2_05,
                                 message->mid);
         } else {
-#ifdef OC_REQUEST_HISTORY
-          if (oc_coap_check_if_duplicate(message->mid,
-                                         (uint8_t)msg->endpoint.device)) {
-            return 0;
-          }
-          history[idx] = message->mid;
-          history_dev[idx] = (uint8_t)msg->endpoint.device;
-          idx = (idx + 1) % OC_REQUEST_HISTORY_SIZE;
-#endif /* OC_REQUEST_HISTORY */
           // TODO
           //          if (href_len == 7 && memcmp(href, "oic/res", 7) == 0) {
           //            coap_udp_init_message(response, COAP_TYPE_CON,
@@ -406,15 +392,7 @@ coap_receive(oc_message_t *msg)
         coap_new_transaction(response->mid, NULL, 0, &msg->endpoint);
 
       if (transaction) {
-        bool new_sender = true;
-        for (int i = 0; i < OC_SEEN_SENDERS_SIZE; ++i) {
-          if (memcmp(seen_senders[i].address, msg->endpoint.addr.ipv6.address,
-                     16) == 0 &&
-              seen_senders[i].port == msg->endpoint.addr.ipv6.port) {
-            new_sender = false;
-            break;
-          }
-        }
+        bool new_sender = !coap_seen_sender_check(&msg->endpoint);
 
         bool is_myself = false;
         //
@@ -490,16 +468,57 @@ coap_receive(oc_message_t *msg)
             // message received with fresh echo, add to seen senders list
             OC_DBG("Included Echo is Fresh! Adding endpoint to seen senders "
                    "list...");
-            oc_ipv6_addr_t *entry_ptr = &seen_senders[seen_sender_idx];
-            memcpy(entry_ptr, &msg->endpoint.addr.ipv6, sizeof(oc_ipv6_addr_t));
-            seen_sender_idx = (seen_sender_idx + 1) % OC_SEEN_SENDERS_SIZE;
+            coap_seen_sender_add(&msg->endpoint);
           }
         }
 #ifdef OC_BLOCK_WISE
         const uint8_t *incoming_block;
         uint32_t incoming_block_len =
           (uint32_t)coap_get_payload(message, &incoming_block);
-        if (block1) {
+        if (block1 && (message->code == COAP_PUT ||
+                       message->code == COAP_POST) &&
+            oc_blockwise_find_stream(href, href_len, msg->endpoint.device)) {
+          OC_DBG("streaming block1 to the sink of the resource");
+          request_buffer = oc_blockwise_find_request_buffer(
+            href, href_len, &msg->endpoint, message->code, message->uri_query,
+            message->uri_query_len, OC_BLOCKWISE_SERVER);
+          if (!request_buffer && block1_num == 0) {
+            if (oc_drop_command(msg->endpoint.device)) {
+              OC_WRN("cannot process new request during closing TLS sessions");
+              goto init_reset_message;
+            }
+            request_buffer = oc_blockwise_alloc_stream_request(
+              href, href_len, &msg->endpoint, message->code);
+            if (request_buffer && message->uri_query_len > 0) {
+              oc_new_string(&request_buffer->uri_query, message->uri_query,
+                            message->uri_query_len);
+            }
+          }
+          if (!request_buffer) {
+            OC_ERR("could not create streamed block-wise request state");
+            goto init_reset_message;
+          }
+          uint8_t code = oc_blockwise_stream_write(
+            request_buffer, block1_offset, incoming_block,
+            MIN((uint16_t)incoming_block_len, block1_size), block1_more);
+          if (code != 0) {
+            OC_ERR("streamed block rejected with code %d", (int)code);
+            oc_blockwise_free_request_buffer(request_buffer);
+            request_buffer = NULL;
+            response->code = code;
+            goto send_message;
+          }
+          coap_set_header_block1(response, block1_num, block1_more,
+                                 block1_size);
+          if (block1_more) {
+            response->code = CONTINUE_2_31;
+            goto send_message;
+          }
+          OC_DBG("received all blocks; calling the request handler");
+          oc_blockwise_free_request_buffer(request_buffer);
+          request_buffer = NULL;
+          goto request_handler;
+        } else if (block1) {
           OC_DBG("processing block1 option");
           request_buffer = oc_blockwise_find_request_buffer(
             href, href_len, &msg->endpoint, message->code, message->uri_query,
@@ -554,7 +573,7 @@ coap_receive(oc_message_t *msg)
                 }
                 coap_udp_init_message(response, COAP_TYPE_CON, CONTENT_2_05,
                                       coap_get_mid());
-                transaction->mid = response->mid;
+                coap_set_transaction_mid(transaction, response->mid);
                 coap_set_header_block1(response, block1_num, block1_more,
                                        block1_size);
                 // TODO
@@ -585,7 +604,39 @@ coap_receive(oc_message_t *msg)
             return 0;
           }
 
-          if (response_buffer) {
+          if (response_buffer && response_buffer->streamed) {
+            OC_DBG("pulling next block from the source of the resource");
+            uint8_t *block = transaction->message->data + COAP_MAX_HEADER_SIZE;
+            bool more = false;
+            int block_len = oc_blockwise_stream_read(
+              response_buffer, block2_offset, block, block2_size, &more);
+            if (block_len < 0) {
+              OC_ERR("could not read block from the source");
+              oc_blockwise_free_response_buffer(response_buffer);
+              response_buffer = NULL;
+              response->code = INTERNAL_SERVER_ERROR_5_00;
+              goto send_message;
+            }
+            if (!more) {
+              if (message->type == COAP_TYPE_CON) {
+                coap_send_empty_response(COAP_TYPE_ACK, message->mid, NULL, 0,
+                                         0, &msg->endpoint);
+              }
+              coap_udp_init_message(response, COAP_TYPE_CON, CONTENT_2_05,
+                                    coap_get_mid());
+              coap_set_transaction_mid(transaction, response->mid);
+            }
+            coap_set_header_content_format(
+              response, response_buffer->return_content_type);
+            coap_set_payload(response, block, (uint32_t)block_len);
+            coap_set_header_block2(response, block2_num, more, block2_size);
+            oc_blockwise_response_state_t *response_state =
+              (oc_blockwise_response_state_t *)response_buffer;
+            coap_set_header_etag(response, response_state->etag,
+                                 COAP_ETAG_LEN);
+            response_buffer->ref_count = more;
+            goto send_message;
+          } else if (response_buffer) {
             OC_DBG("continuing ongoing block-wise transfer");
             uint32_t payload_size = 0;
             const void *payload = oc_blockwise_dispatch_block(
@@ -603,7 +654,7 @@ coap_receive(oc_message_t *msg)
                 }
                 coap_udp_init_message(response, COAP_TYPE_CON, CONTENT_2_05,
                                       coap_get_mid());
-                transaction->mid = response->mid;
+                coap_set_transaction_mid(transaction, response->mid);
                 // TODO
                 // coap_set_header_accept(response, APPLICATION_CBOR);
               }
@@ -745,8 +796,33 @@ coap_receive(oc_message_t *msg)
 #endif /* !OC_BLOCK_WISE */
 #ifdef OC_BLOCK_WISE
           uint32_t payload_size = 0;
+          if (response_buffer->streamed) {
+            bool more = false;
+            if (response->code == CONTENT_2_05) {
+              uint8_t *block =
+                transaction->message->data + COAP_MAX_HEADER_SIZE;
+              int block_len = oc_blockwise_stream_read(
+                response_buffer, 0, block, block2_size, &more);
+              if (block_len < 0) {
+                OC_ERR("could not read block from the source");
+                coap_set_status_code(response, INTERNAL_SERVER_ERROR_5_00);
+              } else {
+                coap_set_header_content_format(
+                  response, response_buffer->return_content_type);
+                coap_set_payload(response, block, (uint32_t)block_len);
+                if (block2 || more) {
+                  coap_set_header_block2(response, 0, more, block2_size);
+                  oc_blockwise_response_state_t *response_state =
+                    (oc_blockwise_response_state_t *)response_buffer;
+                  coap_set_header_etag(response, response_state->etag,
+                                       COAP_ETAG_LEN);
+                }
+              }
+            }
+            response_buffer->ref_count = more;
+          }
 #ifdef OC_TCP
-          if (msg->endpoint.flags & TCP) {
+          else if (msg->endpoint.flags & TCP) {
             const void *payload = oc_blockwise_dispatch_block(
               response_buffer, 0, response_buffer->payload_size + 1,
               &payload_size);
@@ -754,8 +830,9 @@ coap_receive(oc_message_t *msg)
               coap_set_payload(response, payload, payload_size);
             }
             response_buffer->ref_count = 0;
-          } else {
+          }
 #endif /* OC_TCP */
+          else {
             const void *payload = oc_blockwise_dispatch_block(
               response_buffer, 0, block2_size, &payload_size);
             if (payload) {
@@ -774,9 +851,7 @@ coap_receive(oc_message_t *msg)
             } else {
               response_buffer->ref_count = 0;
             }
-#ifdef OC_TCP
           }
-#endif /* OC_TCP */
 #endif /* OC_BLOCK_WISE */
         }
 #ifdef OC_BLOCK_WISE
@@ -885,7 +960,7 @@ coap_receive(oc_message_t *msg)
             // coap_set_header_accept(response, APPLICATION_CBOR);
             // coap_set_header_content_format(response,
             // APPLICATION_CBOR);
-            request_buffer->mid = response_mid;
+            oc_blockwise_set_mid(request_buffer, response_mid);
             goto send_message;
           }
         } else {
@@ -909,7 +984,7 @@ coap_receive(oc_message_t *msg)
           if (response_buffer) {
             OC_DBG("created new response buffer for uri %s",
                    oc_string_checked(response_buffer->href));
-            response_buffer->client_cb = client_cb;
+            oc_blockwise_set_client_cb(response_buffer, client_cb);
           }
         }
       } else {
@@ -944,8 +1019,8 @@ coap_receive(oc_message_t *msg)
             if (transaction) {
               coap_udp_init_message(response, COAP_TYPE_CON, client_cb->method,
                                     response_mid);
-              response_buffer->mid = response_mid;
-              client_cb->mid = response_mid;
+              oc_blockwise_set_mid(response_buffer, response_mid);
+              oc_ri_set_client_cb_mid(client_cb, response_mid);
               // TODO: This is still wrong - this code is likely to break down
               // when responding to long requests with type
               // application/link-format - the responses are gonna become
@@ -1051,13 +1126,12 @@ send_message:
           }
           response->token_len = (uint8_t)i;
           if (request_buffer) {
-            memcpy(request_buffer->token, response->token, response->token_len);
-            request_buffer->token_len = response->token_len;
+            oc_blockwise_set_token(request_buffer, response->token,
+                                   response->token_len);
           }
           if (response_buffer) {
-            memcpy(response_buffer->token, response->token,
-                   response->token_len);
-            response_buffer->token_len = response->token_len;
+            oc_blockwise_set_token(response_buffer, response->token,
+                                   response->token_len);
           }
         } else {
           coap_set_token(response, message->token, message->token_len);
@@ -1066,12 +1140,21 @@ send_message:
 #endif /* OC_CLIENT && OC_BLOCK_WISE */
     }
     if (response->token_len > 0) {
-      memcpy(transaction->token, response->token, response->token_len);
-      transaction->token_len = response->token_len;
+      coap_set_transaction_token(transaction, response->token,
+                                 response->token_len);
     }
     transaction->message->length =
       coap_serialize_message(response, transaction->message->data);
     if (transaction->message->length > 0) {
+#ifdef OC_REQUEST_HISTORY
+      /* a protected response has to be protected again, with the partial IV
+       * of the retransmitted request */
+      if (request_seen && response->type == COAP_TYPE_ACK &&
+          !(msg->endpoint.flags & OSCORE_DECRYPTED)) {
+        coap_dedup_set_response(request_seen, transaction->message->data,
+                                transaction->message->length);
+      }
+#endif /* OC_REQUEST_HISTORY */
       coap_send_transaction(transaction);
     } else {
       coap_clear_transaction(transaction);
@@ -1098,7 +1181,7 @@ void
 coap_init_engine(void)
 {
   coap_register_as_transaction_handler();
-  memset(seen_senders, 0, sizeof(seen_senders));
+  coap_seen_senders_reset();
 }
 /*---------------------------------------------------------------------------*/
 OC_PROCESS_THREAD(coap_engine, ev, data)
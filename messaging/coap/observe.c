@@ -50,8 +50,10 @@
 #ifdef OC_SERVER
 
 #include "observe.h"
+#include "util/oc_hash_index.h"
 #include "util/oc_memb.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "oc_buffer.h"
@@ -73,6 +75,55 @@ int32_t observe_counter = 3;
 /*---------------------------------------------------------------------------*/
 OC_LIST(observers_list);
 OC_MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
+/* the observers of each resource, in the order they were added */
+OC_HASH_INDEX(observers_by_resource, COAP_MAX_OBSERVERS);
+
+/* a response to a notification GET, with headroom in front of the payload
+ * for the options that coap_serialize_notification_body() writes there */
+typedef struct
+{
+  uint8_t data[COAP_MAX_HEADER_SIZE + OC_MAX_OBSERVE_SIZE];
+} notification_buffer_t;
+#ifdef OC_DYNAMIC_ALLOCATION
+OC_MEMB_STATIC(notification_buffers, notification_buffer_t,
+               COAP_NOTIFICATION_BUFFERS);
+#else  /* OC_DYNAMIC_ALLOCATION */
+OC_MEMB(notification_buffers, notification_buffer_t, COAP_NOTIFICATION_BUFFERS);
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+static uint32_t
+resource_hash(const oc_resource_t *resource)
+{
+  return oc_hash_bytes((const uint8_t *)&resource, sizeof(resource));
+}
+
+static uint8_t *
+alloc_notification_buffer(void)
+{
+  notification_buffer_t *buffer =
+    (notification_buffer_t *)oc_memb_alloc(&notification_buffers);
+#ifdef OC_DYNAMIC_ALLOCATION
+  if (!buffer) {
+    /* more notifications are being built at once than there are buffers,
+     * e.g. a GET handler that notifies the observers of another resource */
+    buffer = (notification_buffer_t *)malloc(sizeof(notification_buffer_t));
+  }
+#endif /* OC_DYNAMIC_ALLOCATION */
+  return buffer ? buffer->data : NULL;
+}
+
+static void
+free_notification_buffer(uint8_t *data)
+{
+  if (oc_memb_inmemb(&notification_buffers, data)) {
+    oc_memb_free(&notification_buffers, data);
+  }
+#ifdef OC_DYNAMIC_ALLOCATION
+  else {
+    free(data);
+  }
+#endif /* OC_DYNAMIC_ALLOCATION */
+}
 
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
@@ -115,6 +166,11 @@ add_observer(oc_resource_t *resource, oc_endpoint_t *endpoint,
     coap_remove_observer_handle_by_uri(endpoint, uri, (int)uri_len, iface_mask);
 
   coap_observer_t *o = oc_memb_alloc(&observers_memb);
+  if (o && !oc_hash_index_add(&observers_by_resource, o,
+                              resource_hash(resource))) {
+    oc_memb_free(&observers_memb, o);
+    o = NULL;
+  }
 
   if (o) {
     oc_new_string(&o->url, uri, uri_len);
@@ -155,6 +211,12 @@ get_iface_query(oc_interface_mask_t iface_mask)
   return NULL;
 }
 
+oc_list_t
+coap_get_observers(void)
+{
+  return observers_list;
+}
+
 void
 coap_remove_observer(coap_observer_t *o)
 {
@@ -173,6 +235,7 @@ coap_remove_observer(coap_observer_t *o)
 #endif /* OC_BLOCK_WISE */
   o->resource->num_observers--;
   oc_free_string(&o->url);
+  oc_hash_index_remove(&observers_by_resource, o, resource_hash(o->resource));
   oc_list_remove(observers_list, o);
   oc_memb_free(&observers_memb, o);
 }
@@ -186,6 +249,7 @@ coap_free_all_observers(void)
     coap_remove_observer(obs);
     obs = next;
   }
+  oc_hash_index_clear(&observers_by_resource);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -255,10 +319,11 @@ int
 coap_remove_observer_by_resource(const oc_resource_t *rsc)
 {
   int removed = 0;
-  coap_observer_t *obs = (coap_observer_t *)oc_list_head(observers_list), *next;
+  uint32_t hash = resource_hash(rsc), pos;
+  coap_observer_t *obs = (coap_observer_t *)oc_hash_index_first(
+    &observers_by_resource, hash, &pos);
 
   while (obs) {
-    next = obs->next;
     if ((obs->resource == rsc) &&
         (oc_string(rsc->uri) &&
          oc_string_len(obs->url) == (oc_string_len(rsc->uri) - 1) &&
@@ -266,8 +331,13 @@ coap_remove_observer_by_resource(const oc_resource_t *rsc)
                 oc_string_len(rsc->uri) - 1) == 0)) {
       coap_remove_observer(obs);
       removed++;
+      /* removal reorders the index, start over */
+      obs = (coap_observer_t *)oc_hash_index_first(&observers_by_resource,
+                                                   hash, &pos);
+      continue;
     }
-    obs = next;
+    obs = (coap_observer_t *)oc_hash_index_next(&observers_by_resource, hash,
+                                                &pos);
   }
   return removed;
 }
@@ -319,6 +389,25 @@ coap_remove_observers_on_dos_change(size_t device, bool reset)
 }
 #endif /* OC_SECURITY */
 
+/* Serialize a notification to one observer. When shared is set the part that
+ * is the same for all observers is serialized by the first call and copied by
+ * the following ones. */
+static size_t
+serialize_notification(coap_packet_t *notification, bool shared,
+                       uint8_t **body, size_t *body_len, uint8_t *buffer)
+{
+  if (shared) {
+    if (!*body) {
+      *body = coap_serialize_notification_body(notification, body_len);
+    }
+    if (*body) {
+      return coap_serialize_notification(notification, *body, *body_len,
+                                         buffer);
+    }
+  }
+  return coap_serialize_message(notification, buffer);
+}
+
 int
 coap_notify_observers(oc_resource_t *resource,
                       oc_response_buffer_t *response_buf,
@@ -344,15 +433,13 @@ coap_notify_observers(oc_resource_t *resource,
     oc_blockwise_state_t *response_state = NULL;
 #endif /* OC_BLOCK_WISE */
 
-#ifndef OC_DYNAMIC_ALLOCATION
-    uint8_t buffer[OC_MAX_OBSERVE_SIZE];
-#else  /* !OC_DYNAMIC_ALLOCATION */
-    uint8_t *buffer = malloc(OC_MAX_OBSERVE_SIZE);
+    uint8_t *body = NULL;
+    size_t body_len = 0;
+    uint8_t *buffer = alloc_notification_buffer();
     if (!buffer) {
       OC_WRN("coap_notify_observers: out of memory allocating buffer");
       goto leave_notify_observers;
     } //! buffer
-#endif /* OC_DYNAMIC_ALLOCATION */
 
     oc_request_t request = { 0 };
     oc_response_t response = { 0 };
@@ -361,7 +448,7 @@ coap_notify_observers(oc_resource_t *resource,
     if (!response_buf && resource) {
       OC_DBG("coap_notify_observers: Issue GET request to resource %s\n\n",
              oc_string_checked(resource->uri));
-      response_buffer.buffer = buffer;
+      response_buffer.buffer = buffer + COAP_MAX_HEADER_SIZE;
       response_buffer.buffer_size = OC_MAX_OBSERVE_SIZE;
       response.response_buffer = &response_buffer;
       request.resource = resource;
@@ -381,12 +468,14 @@ coap_notify_observers(oc_resource_t *resource,
       } // response_buf->code == OC_IGNORE
     }   //! response_buf && resource
 
-    /* iterate over observers */
-    obs = (coap_observer_t *)oc_list_head(observers_list);
-    while (obs != NULL) {
+    /* iterate over the observers of the resource */
+    uint32_t hash = resource_hash(resource), pos;
+    for (obs = (coap_observer_t *)oc_hash_index_first(&observers_by_resource,
+                                                      hash, &pos);
+         obs != NULL; obs = (coap_observer_t *)oc_hash_index_next(
+                        &observers_by_resource, hash, &pos)) {
       if ((obs->resource != resource) ||
           (endpoint && oc_endpoint_compare(&obs->endpoint, endpoint) != 0)) {
-        obs = obs->next;
         continue;
       } // obs->resource != resource || endpoint != obs->endpoint
       // if (resource_is_collection && obs->iface_mask != OC_IF_BASELINE) {
@@ -431,6 +520,8 @@ coap_notify_observers(oc_resource_t *resource,
         coap_transaction_t *transaction = NULL;
         if (response_buf) {
           coap_packet_t notification[1];
+          /* only the payload of our own GET has room for the shared body */
+          bool shared = (response_buf == &response_buffer);
           bool is_revert = false;
           uint8_t status_code = CONTENT_2_05;
           // if (obs->iface_mask == OC_IF_STARTUP_REVERT) {
@@ -444,6 +535,7 @@ coap_notify_observers(oc_resource_t *resource,
 #ifdef OC_TCP
           if (obs->endpoint.flags & TCP) {
             coap_tcp_init_message(notification, status_code);
+            shared = false;
           } else
 #endif /* OC_TCP */
           {
@@ -459,6 +551,7 @@ coap_notify_observers(oc_resource_t *resource,
             if (response_buf->response_length > obs->block2_size) {
 #endif /* !OC_TCP */
               notification->type = COAP_TYPE_CON;
+              shared = false;
               response_state = oc_blockwise_find_response_buffer(
                 oc_string(obs->resource->uri) + 1,
                 oc_string_len(obs->resource->uri) - 1, &obs->endpoint, OC_GET,
@@ -536,7 +629,8 @@ coap_notify_observers(oc_resource_t *resource,
             obs->last_mid = transaction->mid;
             notification->mid = transaction->mid;
             transaction->message->length =
-              coap_serialize_message(notification, transaction->message->data);
+              serialize_notification(notification, shared, &body, &body_len,
+                                     transaction->message->data);
             if (transaction->message->length > 0) {
               coap_send_transaction(transaction);
             } else {
@@ -545,14 +639,11 @@ coap_notify_observers(oc_resource_t *resource,
           } // transaction
         }   // response_buf != NULL
       }     //! separate response
-      obs = obs->next;
-    } // iterate over observers
+    }       // iterate over observers
   leave_notify_observers:;
-#ifdef OC_DYNAMIC_ALLOCATION
     if (buffer) {
-      free(buffer);
+      free_notification_buffer(buffer);
     }
-#endif /* OC_DYNAMIC_ALLOCATION */
   }    // num_observers > 0
   else {
     OC_WRN("coap_notify_observers: no observers");
@@ -602,15 +693,16 @@ notify_resource_defaults_observer(oc_resource_t *resource,
     goto leave_notify_observers;
   } // response_buf->code == OC_IGNORE
 
-  /* iterate over observers */
-  obs = (coap_observer_t *)oc_list_head(observers_list);
-  while (obs != NULL) {
+  /* iterate over the observers of the resource */
+  uint32_t hash = resource_hash(resource), pos;
+  for (obs = (coap_observer_t *)oc_hash_index_first(&observers_by_resource,
+                                                    hash, &pos);
+       obs != NULL; obs = (coap_observer_t *)oc_hash_index_next(
+                      &observers_by_resource, hash, &pos)) {
     if (obs->resource != resource) {
-      obs = obs->next;
       continue;
     } // obs->resource != resource || endpoint != obs->endpoint
     if (obs->iface_mask != iface_mask) {
-      obs = obs->next;
       continue;
     }
     if (response.separate_response != NULL) {
@@ -747,8 +839,7 @@ notify_resource_defaults_observer(oc_resource_t *resource,
         } // transaction
       }   // response_buf != NULL
     }     //! separate response
-    obs = obs->next;
-  } // While observers
+  }       // iterate over observers
 leave_notify_observers:;
 #ifdef OC_DYNAMIC_ALLOCATION
   if (buffer) {
@@ -0,0 +1,171 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "seen_senders.h"
+#include "port/oc_clock.h"
+#include "port/oc_log.h"
+#include "util/oc_hash_index.h"
+#include <string.h>
+
+#define NONE (-1)
+
+typedef struct seen_sender_s
+{
+  oc_clock_time_t last_seen;
+  uint32_t hash;
+  uint8_t address[16];
+  uint16_t port;
+  /* recency list, from the most to the least recently seen sender */
+  int16_t newer;
+  int16_t older;
+} seen_sender_t;
+
+static seen_sender_t senders[OC_SEEN_SENDERS_SIZE];
+static int count;
+static int16_t newest = NONE;
+static int16_t oldest = NONE;
+static coap_seen_senders_stats_t stats;
+OC_HASH_INDEX(senders_by_address, OC_SEEN_SENDERS_SIZE);
+
+static void
+set_key(seen_sender_t *key, const oc_endpoint_t *endpoint)
+{
+  memset(key->address, 0, sizeof(key->address));
+  if (endpoint->flags & IPV4) {
+    memcpy(key->address, endpoint->addr.ipv4.address,
+           sizeof(endpoint->addr.ipv4.address));
+    key->port = endpoint->addr.ipv4.port;
+  } else {
+    memcpy(key->address, endpoint->addr.ipv6.address,
+           sizeof(endpoint->addr.ipv6.address));
+    key->port = endpoint->addr.ipv6.port;
+  }
+
+  uint8_t buf[sizeof(key->address) + sizeof(key->port)];
+  memcpy(buf, key->address, sizeof(key->address));
+  memcpy(buf + sizeof(key->address), &key->port, sizeof(key->port));
+  key->hash = oc_hash_bytes(buf, sizeof(buf));
+}
+
+static void
+unlink_sender(int16_t i)
+{
+  seen_sender_t *s = &senders[i];
+  if (s->newer != NONE) {
+    senders[s->newer].older = s->older;
+  } else {
+    newest = s->older;
+  }
+  if (s->older != NONE) {
+    senders[s->older].newer = s->newer;
+  } else {
+    oldest = s->newer;
+  }
+}
+
+static void
+link_newest(int16_t i)
+{
+  senders[i].newer = NONE;
+  senders[i].older = newest;
+  if (newest != NONE) {
+    senders[newest].newer = i;
+  } else {
+    oldest = i;
+  }
+  newest = i;
+}
+
+static int16_t
+find(const seen_sender_t *key)
+{
+  uint32_t pos;
+  seen_sender_t *s = (seen_sender_t *)oc_hash_index_first(&senders_by_address,
+                                                          key->hash, &pos);
+  for (; s; s = (seen_sender_t *)oc_hash_index_next(&senders_by_address,
+                                                    key->hash, &pos)) {
+    if (s->port == key->port &&
+        memcmp(s->address, key->address, sizeof(s->address)) == 0) {
+      return (int16_t)(s - senders);
+    }
+  }
+  return NONE;
+}
+
+bool
+coap_seen_sender_check(const oc_endpoint_t *endpoint)
+{
+  seen_sender_t key;
+  set_key(&key, endpoint);
+  int16_t i = find(&key);
+  oc_clock_time_t now = oc_clock_time();
+  if (i == NONE || now - senders[i].last_seen > OC_SEEN_SENDERS_LIFETIME) {
+    stats.misses++;
+    return false;
+  }
+  stats.hits++;
+  senders[i].last_seen = now;
+  unlink_sender(i);
+  link_newest(i);
+  return true;
+}
+
+void
+coap_seen_sender_add(const oc_endpoint_t *endpoint)
+{
+  seen_sender_t key;
+  set_key(&key, endpoint);
+  int16_t i = find(&key);
+  if (i != NONE) {
+    unlink_sender(i);
+  } else {
+    if (count < OC_SEEN_SENDERS_SIZE) {
+      i = (int16_t)count++;
+    } else {
+      i = oldest;
+      unlink_sender(i);
+      oc_hash_index_remove(&senders_by_address, &senders[i], senders[i].hash);
+      stats.evictions++;
+    }
+    memcpy(senders[i].address, key.address, sizeof(key.address));
+    senders[i].port = key.port;
+    senders[i].hash = key.hash;
+    if (!oc_hash_index_add(&senders_by_address, &senders[i], key.hash)) {
+      OC_ERR("could not index seen sender");
+    }
+  }
+  senders[i].last_seen = oc_clock_time();
+  link_newest(i);
+}
+
+void
+coap_seen_senders_get_stats(coap_seen_senders_stats_t *out)
+{
+  *out = stats;
+}
+
+void
+coap_seen_senders_reset(void)
+{
+  oc_hash_index_clear(&senders_by_address);
+  memset(senders, 0, sizeof(senders));
+  memset(&stats, 0, sizeof(stats));
+  count = 0;
+  newest = NONE;
+  oldest = NONE;
+}
@@ -0,0 +1,95 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+/**
+ * Senders that have proven their freshness with a valid Echo option
+ * (RFC 9175), so that their requests are not challenged again.
+ *
+ * A sender stays trusted while it keeps sending requests: it is forgotten
+ * once it has been idle for longer than OC_SEEN_SENDERS_LIFETIME, or when
+ * the table is full and it is the least recently seen sender.
+ */
+
+#ifndef SEEN_SENDERS_H
+#define SEEN_SENDERS_H
+
+#include "oc_config.h"
+#include "oc_endpoint.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The number of senders that are remembered.
+ */
+#ifndef OC_SEEN_SENDERS_SIZE
+#define OC_SEEN_SENDERS_SIZE (32)
+#endif
+
+/**
+ * How long an Echo value is accepted after it was handed out, in clock
+ * ticks.
+ */
+#ifndef OC_ECHO_FRESHNESS_TIME
+#define OC_ECHO_FRESHNESS_TIME (10 * OC_CLOCK_CONF_TICKS_PER_SECOND)
+#endif
+
+/**
+ * How long an idle sender stays trusted, in clock ticks.
+ */
+#ifndef OC_SEEN_SENDERS_LIFETIME
+#define OC_SEEN_SENDERS_LIFETIME OC_ECHO_FRESHNESS_TIME
+#endif
+
+typedef struct coap_seen_senders_stats_s
+{
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+} coap_seen_senders_stats_t;
+
+/**
+ * Check whether the sender of a request is trusted, and if so mark it as
+ * seen now.
+ */
+bool coap_seen_sender_check(const oc_endpoint_t *endpoint);
+
+/**
+ * Trust a sender that returned a fresh Echo value, evicting the least
+ * recently seen sender if the table is full.
+ */
+void coap_seen_sender_add(const oc_endpoint_t *endpoint);
+
+/**
+ * Get the lookup counters since the last coap_seen_senders_reset().
+ */
+void coap_seen_senders_get_stats(coap_seen_senders_stats_t *stats);
+
+/**
+ * Forget all senders and clear the counters.
+ */
+void coap_seen_senders_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEEN_SENDERS_H */
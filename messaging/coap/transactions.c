@@ -49,6 +49,7 @@
 #include "api/oc_main.h"
 #include "observe.h"
 #include "oc_buffer.h"
+#include "util/oc_hash_index.h"
 #include "util/oc_list.h"
 #include "util/oc_memb.h"
 #include <string.h>
@@ -69,9 +70,34 @@
 /*---------------------------------------------------------------------------*/
 OC_MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
 OC_LIST(transactions_list);
+/* every response and ACK looks its transaction up, by MID or by token */
+OC_HASH_INDEX(transactions_by_mid, COAP_MAX_OPEN_TRANSACTIONS);
+OC_HASH_INDEX(transactions_by_token, COAP_MAX_OPEN_TRANSACTIONS);
 
 static struct oc_process *transaction_handler_process = NULL;
 
+static bool
+index_transaction(coap_transaction_t *t)
+{
+  if (!oc_hash_index_add(&transactions_by_mid, t, oc_hash_u16(t->mid))) {
+    return false;
+  }
+  if (!oc_hash_index_add(&transactions_by_token, t,
+                         oc_hash_bytes(t->token, t->token_len))) {
+    oc_hash_index_remove(&transactions_by_mid, t, oc_hash_u16(t->mid));
+    return false;
+  }
+  return true;
+}
+
+static void
+unindex_transaction(coap_transaction_t *t)
+{
+  oc_hash_index_remove(&transactions_by_mid, t, oc_hash_u16(t->mid));
+  oc_hash_index_remove(&transactions_by_token, t,
+                       oc_hash_bytes(t->token, t->token_len));
+}
+
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -100,9 +126,16 @@ coap_new_transaction(uint16_t mid, uint8_t *token, uint8_t token_len,
       /* save client address */
       memcpy(&t->message->endpoint, endpoint, sizeof(oc_endpoint_t));
 
-      oc_list_add(
-        transactions_list,
-        t); /* list itself makes sure same element is not added twice */
+      if (index_transaction(t)) {
+        oc_list_add(
+          transactions_list,
+          t); /* list itself makes sure same element is not added twice */
+      } else {
+        OC_WRN("insufficient memory to index transaction");
+        oc_message_unref(t->message);
+        oc_memb_free(&transactions_memb, t);
+        t = NULL;
+      }
     } else {
       oc_memb_free(&transactions_memb, t);
       t = NULL;
@@ -114,6 +147,30 @@ coap_new_transaction(uint16_t mid, uint8_t *token, uint8_t token_len,
   return t;
 }
 
+/*---------------------------------------------------------------------------*/
+void
+coap_set_transaction_mid(coap_transaction_t *t, uint16_t mid)
+{
+  oc_hash_index_remove(&transactions_by_mid, t, oc_hash_u16(t->mid));
+  t->mid = mid;
+  if (!oc_hash_index_add(&transactions_by_mid, t, oc_hash_u16(t->mid))) {
+    OC_ERR("could not index transaction %p by MID %u", (void *)t, t->mid);
+  }
+}
+
+void
+coap_set_transaction_token(coap_transaction_t *t, const uint8_t *token,
+                           uint8_t token_len)
+{
+  oc_hash_index_remove(&transactions_by_token, t,
+                       oc_hash_bytes(t->token, t->token_len));
+  memcpy(t->token, token, token_len);
+  t->token_len = token_len;
+  if (!oc_hash_index_add(&transactions_by_token, t,
+                         oc_hash_bytes(t->token, t->token_len))) {
+    OC_ERR("could not index transaction %p by token", (void *)t);
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 coap_send_transaction(coap_transaction_t *t)
@@ -216,6 +273,7 @@ coap_clear_transaction(coap_transaction_t *t)
 
     oc_etimer_stop(&t->retrans_timer);
     oc_message_unref(t->message);
+    unindex_transaction(t);
     oc_list_remove(transactions_list, t);
     oc_memb_free(&transactions_memb, t);
   }
@@ -223,10 +281,11 @@ coap_clear_transaction(coap_transaction_t *t)
 coap_transaction_t *
 coap_get_transaction_by_mid(uint16_t mid)
 {
-  coap_transaction_t *t = NULL;
+  uint32_t hash = oc_hash_u16(mid), pos;
+  coap_transaction_t *t =
+    oc_hash_index_first(&transactions_by_mid, hash, &pos);
 
-  for (t = (coap_transaction_t *)oc_list_head(transactions_list); t;
-       t = t->next) {
+  for (; t; t = oc_hash_index_next(&transactions_by_mid, hash, &pos)) {
     if (t->mid == mid) {
       OC_DBG("Found transaction for MID %u: %p", t->mid, (void *)t);
       return t;
@@ -238,10 +297,11 @@ coap_get_transaction_by_mid(uint16_t mid)
 coap_transaction_t *
 coap_get_transaction_by_token(uint8_t *token, uint8_t token_len)
 {
-  coap_transaction_t *t = NULL;
+  uint32_t hash = oc_hash_bytes(token, token_len), pos;
+  coap_transaction_t *t =
+    oc_hash_index_first(&transactions_by_token, hash, &pos);
 
-  for (t = (coap_transaction_t *)oc_list_head(transactions_list); t;
-       t = t->next) {
+  for (; t; t = oc_hash_index_next(&transactions_by_token, hash, &pos)) {
     if (t->token_len == token_len && memcmp(t->token, token, token_len) == 0) {
       OC_DBG("Found transaction by token %p", (void *)t);
       return t;
@@ -281,6 +341,8 @@ coap_free_all_transactions(void)
     coap_clear_transaction(t);
     t = next;
   }
+  oc_hash_index_clear(&transactions_by_mid);
+  oc_hash_index_clear(&transactions_by_token);
 }
 
 void
@@ -88,6 +88,11 @@ coap_transaction_t *coap_new_transaction(uint16_t mid, uint8_t *token,
                                          uint8_t token_len,
                                          oc_endpoint_t *endpoint);
 
+/* transactions are indexed by MID and token, change them only through these */
+void coap_set_transaction_mid(coap_transaction_t *t, uint16_t mid);
+void coap_set_transaction_token(coap_transaction_t *t, const uint8_t *token,
+                                uint8_t token_len);
+
 void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
@@ -0,0 +1,87 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "dedup.h"
+}
+
+#ifdef OC_REQUEST_HISTORY
+
+class TestDedup : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    memset(&peer_a_, 0, sizeof(peer_a_));
+    peer_a_.flags = IPV6;
+    peer_a_.addr.ipv6.port = 5683;
+    peer_a_.addr.ipv6.address[15] = 1;
+    peer_b_ = peer_a_;
+    peer_b_.addr.ipv6.address[15] = 2;
+  }
+
+  void TearDown() override { coap_dedup_free_all(); }
+
+  oc_endpoint_t peer_a_;
+  oc_endpoint_t peer_b_;
+};
+
+TEST_F(TestDedup, KeyedOnSenderAndMid)
+{
+  ASSERT_NE(nullptr, coap_dedup_add(&peer_a_, 100, true));
+  EXPECT_NE(nullptr, coap_dedup_find(&peer_a_, 100));
+  /* another sender may use the same message ID */
+  EXPECT_EQ(nullptr, coap_dedup_find(&peer_b_, 100));
+  EXPECT_EQ(nullptr, coap_dedup_find(&peer_a_, 101));
+
+  oc_endpoint_t other_port = peer_a_;
+  other_port.addr.ipv6.port = 5684;
+  EXPECT_EQ(nullptr, coap_dedup_find(&other_port, 100));
+  oc_endpoint_t other_device = peer_a_;
+  other_device.device = 1;
+  EXPECT_EQ(nullptr, coap_dedup_find(&other_device, 100));
+}
+
+TEST_F(TestDedup, OldestIsForgottenWhenFull)
+{
+  for (int i = 0; i < OC_REQUEST_HISTORY_SIZE; i++) {
+    ASSERT_NE(nullptr, coap_dedup_add(&peer_a_, (uint16_t)i, false));
+  }
+  EXPECT_NE(nullptr, coap_dedup_find(&peer_a_, 0));
+  ASSERT_NE(nullptr, coap_dedup_add(&peer_b_, 0, false));
+  EXPECT_EQ(nullptr, coap_dedup_find(&peer_a_, 0));
+  EXPECT_NE(nullptr, coap_dedup_find(&peer_a_, 1));
+  EXPECT_NE(nullptr, coap_dedup_find(&peer_b_, 0));
+}
+
+TEST_F(TestDedup, KeepsResponse)
+{
+  const uint8_t ack[] = { 0x60, 0x45, 0x00, 0x64 };
+  coap_dedup_entry_t *entry = coap_dedup_add(&peer_a_, 100, true);
+  ASSERT_NE(nullptr, entry);
+  coap_dedup_set_response(entry, ack, sizeof(ack));
+
+  const coap_dedup_entry_t *seen = coap_dedup_find(&peer_a_, 100);
+  ASSERT_EQ(entry, seen);
+  ASSERT_EQ(sizeof(ack), seen->response_len);
+  EXPECT_EQ(0, memcmp(ack, seen->response, sizeof(ack)));
+}
+
+#endif /* OC_REQUEST_HISTORY */
@@ -0,0 +1,185 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "coap.h"
+#include "observe.h"
+#include "oc_helpers.h"
+}
+
+static void
+init_notification(coap_packet_t *pkt, uint8_t *payload, size_t payload_len,
+                  uint8_t code, uint16_t content_format)
+{
+  coap_udp_init_message(pkt, COAP_TYPE_NON, CONTENT_2_05, 0);
+  coap_set_payload(pkt, payload, payload_len);
+  coap_set_status_code(pkt, code);
+  if (content_format > 0) {
+    coap_set_header_content_format(pkt, (oc_content_format_t)content_format);
+  }
+}
+
+static void
+set_observer(coap_packet_t *pkt, coap_message_type_t type, uint16_t mid,
+             uint8_t token_len, uint32_t observe)
+{
+  uint8_t token[COAP_TOKEN_LEN];
+  for (uint8_t i = 0; i < token_len; i++) {
+    token[i] = (uint8_t)(0xA0 + i);
+  }
+  pkt->type = type;
+  pkt->mid = mid;
+  coap_set_token(pkt, token, token_len);
+  coap_set_header_observe(pkt, observe);
+}
+
+TEST(Notification, SharedBodyMatchesFullMessage)
+{
+  const size_t payload_lens[] = { 0, 1, 40, 300 };
+  const uint16_t formats[] = { 0, APPLICATION_CBOR, APPLICATION_LINK_FORMAT };
+  const uint8_t codes[] = { CONTENT_2_05, NOT_FOUND_4_04 };
+  const uint32_t observes[] = { 0, 1, 255, 256, 70000, 0x1000000 };
+
+  for (size_t payload_len : payload_lens) {
+    for (uint16_t format : formats) {
+      for (uint8_t code : codes) {
+        std::vector<uint8_t> buffer(COAP_MAX_HEADER_SIZE + payload_len + 1);
+        uint8_t *payload = buffer.data() + COAP_MAX_HEADER_SIZE;
+        for (size_t i = 0; i < payload_len; i++) {
+          payload[i] = (uint8_t)i;
+        }
+        coap_packet_t pkt;
+        init_notification(&pkt, payload, payload_len, code, format);
+        set_observer(&pkt, COAP_TYPE_NON, 1, 0, 0);
+        size_t body_len = 0;
+        uint8_t *body = coap_serialize_notification_body(&pkt, &body_len);
+        ASSERT_NE(nullptr, body);
+
+        /* each observer gets its own header, token and Observe value */
+        uint16_t mid = 1;
+        for (uint32_t observe : observes) {
+          for (uint8_t token_len = 0; token_len <= COAP_TOKEN_LEN;
+               token_len++) {
+            coap_message_type_t type = (mid % 2) ? COAP_TYPE_NON
+                                                 : COAP_TYPE_CON;
+            uint8_t expected[OC_PDU_SIZE];
+            uint8_t actual[OC_PDU_SIZE];
+            coap_packet_t full;
+            init_notification(&full, payload, payload_len, code, format);
+            set_observer(&full, type, mid, token_len, observe);
+            size_t expected_len = coap_serialize_message(&full, expected);
+            ASSERT_GT(expected_len, 0u);
+
+            set_observer(&pkt, type, mid, token_len, observe);
+            size_t actual_len =
+              coap_serialize_notification(&pkt, body, body_len, actual);
+            ASSERT_EQ(expected_len, actual_len);
+            EXPECT_EQ(0, memcmp(expected, actual, expected_len));
+            mid++;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(Notification, NoSharedBodyWithETag)
+{
+  uint8_t buffer[COAP_MAX_HEADER_SIZE + 4];
+  uint8_t etag[COAP_ETAG_LEN] = { 1, 2, 3, 4 };
+  coap_packet_t pkt;
+  init_notification(&pkt, buffer + COAP_MAX_HEADER_SIZE, 4, CONTENT_2_05,
+                    APPLICATION_CBOR);
+  coap_set_header_etag(&pkt, etag, sizeof(etag));
+  size_t body_len = 0;
+  EXPECT_EQ(nullptr, coap_serialize_notification_body(&pkt, &body_len));
+}
+
+#ifdef OC_SERVER
+
+class TestObservers : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    memset(&endpoint_, 0, sizeof(endpoint_));
+    endpoint_.flags = IPV6;
+    memset(&a_, 0, sizeof(a_));
+    memset(&b_, 0, sizeof(b_));
+    oc_new_string(&a_.uri, "/a", 2);
+    oc_new_string(&b_.uri, "/b", 2);
+  }
+
+  void TearDown() override
+  {
+    coap_free_all_observers();
+    oc_free_string(&a_.uri);
+    oc_free_string(&b_.uri);
+  }
+
+  void observe(oc_resource_t *resource, uint8_t tag)
+  {
+    coap_packet_t request;
+    coap_packet_t response;
+    coap_udp_init_message(&request, COAP_TYPE_CON, COAP_GET, tag);
+    coap_udp_init_message(&response, COAP_TYPE_ACK, CONTENT_2_05, tag);
+    uint8_t token[2] = { 0xAB, tag };
+    coap_set_token(&request, token, sizeof(token));
+    coap_set_header_observe(&request, 0);
+    coap_set_header_uri_path(&request, oc_string(resource->uri),
+                             oc_string_len(resource->uri));
+#ifdef OC_BLOCK_WISE
+    coap_observe_handler(&request, &response, resource, 1024, &endpoint_,
+                         OC_IF_NONE);
+#else  /* OC_BLOCK_WISE */
+    coap_observe_handler(&request, &response, resource, &endpoint_,
+                         OC_IF_NONE);
+#endif /* !OC_BLOCK_WISE */
+  }
+
+  oc_endpoint_t endpoint_;
+  oc_resource_t a_;
+  oc_resource_t b_;
+};
+
+TEST_F(TestObservers, RemoveByResource)
+{
+  for (uint8_t i = 0; i < 6; i++) {
+    endpoint_.addr.ipv6.port = i;
+    observe((i % 2) ? &b_ : &a_, i);
+  }
+  EXPECT_EQ(3, a_.num_observers);
+  EXPECT_EQ(3, b_.num_observers);
+
+  EXPECT_EQ(3, coap_remove_observer_by_resource(&a_));
+  EXPECT_EQ(0, a_.num_observers);
+  EXPECT_EQ(3, b_.num_observers);
+  EXPECT_EQ(3, oc_list_length(coap_get_observers()));
+  for (coap_observer_t *obs = (coap_observer_t *)oc_list_head(
+         coap_get_observers());
+       obs != NULL; obs = obs->next) {
+    EXPECT_EQ(&b_, obs->resource);
+  }
+  EXPECT_EQ(0, coap_remove_observer_by_resource(&a_));
+  EXPECT_EQ(3, coap_remove_observer_by_resource(&b_));
+}
+
+#endif /* OC_SERVER */
@@ -0,0 +1,483 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <chrono>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "coap.h"
+#ifdef OC_OSCORE
+#include "oscore.h"
+#endif /* OC_OSCORE */
+}
+
+/* room behind the message for the terminating NUL of the payload, and for
+ * extended option headers that run past the end of the message */
+#define SLACK (8)
+
+/* the option parser as it was before it became table driven, kept out of
+ * line so that the benchmark compares like with like */
+static uint32_t
+ref_parse_int_option(uint8_t *bytes, size_t length)
+{
+  uint32_t var = 0;
+  size_t i = 0;
+  while (i < length) {
+    var <<= 8;
+    var |= bytes[i++];
+  }
+  return var;
+}
+
+static void
+ref_merge_multi_option(char **dst, size_t *dst_len, uint8_t *option,
+                       size_t option_len, char separator)
+{
+  if (*dst_len > 0) {
+    (*dst)[*dst_len] = separator;
+    *dst_len += 1;
+    memmove((*dst) + (*dst_len), option, option_len);
+    *dst_len += option_len;
+  } else {
+    *dst = (char *)option;
+    *dst_len = option_len;
+  }
+}
+
+__attribute__((noinline)) static coap_status_t
+ref_parse_options(coap_packet_t *coap_pkt, uint8_t *data, uint32_t data_len,
+                  uint8_t *current_option, bool inner, bool outer, bool oscore)
+{
+  (void)oscore;
+  memset(coap_pkt->options, 0, sizeof(coap_pkt->options));
+
+  unsigned int option_number = 0;
+  unsigned int option_delta = 0;
+  size_t option_length = 0;
+
+  while (current_option < data + data_len) {
+    if ((current_option[0] & 0xF0) == 0xF0) {
+      coap_pkt->payload = ++current_option;
+      coap_pkt->payload_len = data_len - (uint32_t)(coap_pkt->payload - data);
+      if (coap_pkt->transport_type == COAP_TRANSPORT_UDP &&
+          coap_pkt->payload_len > (uint32_t)OC_MAX_APP_DATA_SIZE) {
+        coap_pkt->payload_len = (uint32_t)OC_MAX_APP_DATA_SIZE;
+      }
+      coap_pkt->payload[coap_pkt->payload_len] = '\0';
+      break;
+    }
+
+    option_delta = current_option[0] >> 4;
+    option_length = current_option[0] & 0x0F;
+    ++current_option;
+
+    if (option_delta == 13) {
+      option_delta += current_option[0];
+      ++current_option;
+    } else if (option_delta == 14) {
+      option_delta += 255;
+      option_delta += current_option[0] << 8;
+      ++current_option;
+      option_delta += current_option[0];
+      ++current_option;
+    }
+
+    if (option_length == 13) {
+      option_length += current_option[0];
+      ++current_option;
+    } else if (option_length == 14) {
+      option_length += 255;
+      uint64_t option_shift = current_option[0];
+      option_length += option_shift << 8;
+      ++current_option;
+      option_length += current_option[0];
+      ++current_option;
+    }
+
+    option_number += option_delta;
+
+    if (option_number <= COAP_OPTION_ECHO) {
+      SET_OPTION(coap_pkt, option_number);
+    }
+    if (current_option + option_length > data + data_len) {
+      return BAD_OPTION_4_02;
+    }
+
+    switch (option_number) {
+#ifdef OC_OSCORE
+    case COAP_OPTION_OSCORE:
+      if (!outer || !oscore) {
+        return BAD_OPTION_4_02;
+      }
+      coap_parse_oscore_option(coap_pkt, current_option, option_length);
+      break;
+#endif /* OC_OSCORE */
+    case COAP_OPTION_CONTENT_FORMAT:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->content_format =
+        (uint16_t)ref_parse_int_option(current_option, option_length);
+      if (coap_pkt->content_format != APPLICATION_OSCORE &&
+          coap_pkt->content_format != APPLICATION_CBOR &&
+          coap_pkt->content_format != APPLICATION_LINK_FORMAT &&
+          coap_pkt->content_format != APPLICATION_OCTET_STREAM &&
+          coap_pkt->content_format != APPLICATION_JSON &&
+          coap_pkt->content_format != APPLICATION_PKCS10 &&
+          coap_pkt->content_format != APPLICATION_PKCS7_CMC_REQUEST &&
+          coap_pkt->content_format != APPLICATION_PKCS7_CMC_RESPONSE &&
+          coap_pkt->content_format != APPLICATION_PKCS7_SGK)
+        return UNSUPPORTED_MEDIA_TYPE_4_15;
+      break;
+    case COAP_OPTION_MAX_AGE:
+      coap_pkt->max_age = ref_parse_int_option(current_option, option_length);
+      break;
+    case COAP_OPTION_ETAG:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->etag_len = (uint8_t)MIN(COAP_ETAG_LEN, option_length);
+      memcpy(coap_pkt->etag, current_option, coap_pkt->etag_len);
+      break;
+    case COAP_OPTION_ACCEPT:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->accept =
+        (uint16_t)ref_parse_int_option(current_option, option_length);
+      if (coap_pkt->accept != APPLICATION_VND_OCF_CBOR &&
+          coap_pkt->accept != APPLICATION_CBOR &&
+          coap_pkt->accept != APPLICATION_OSCORE &&
+          coap_pkt->accept != APPLICATION_LINK_FORMAT &&
+          coap_pkt->accept != APPLICATION_OCTET_STREAM &&
+          coap_pkt->accept != APPLICATION_JSON &&
+          coap_pkt->accept != APPLICATION_PKCS10 &&
+          coap_pkt->accept != APPLICATION_PKCS7_CMC_RESPONSE &&
+          coap_pkt->accept != APPLICATION_PKCS7_CMC_REQUEST &&
+          coap_pkt->accept != APPLICATION_PKCS7_SGK)
+        return NOT_ACCEPTABLE_4_06;
+      break;
+    case COAP_OPTION_PROXY_URI:
+      if (!outer) {
+        return BAD_OPTION_4_02;
+      }
+      ref_merge_multi_option((char **)&(coap_pkt->proxy_uri),
+                             &(coap_pkt->proxy_uri_len), current_option,
+                             option_length, '\0');
+      break;
+    case COAP_OPTION_URI_HOST:
+      if (!outer) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->uri_host = (char *)current_option;
+      coap_pkt->uri_host_len = option_length;
+      break;
+    case COAP_OPTION_URI_PORT:
+      if (!outer) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->uri_port =
+        (uint16_t)ref_parse_int_option(current_option, option_length);
+      break;
+    case COAP_OPTION_URI_PATH:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      ref_merge_multi_option((char **)&(coap_pkt->uri_path),
+                             &(coap_pkt->uri_path_len), current_option,
+                             option_length, '/');
+      break;
+    case COAP_OPTION_URI_QUERY:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      ref_merge_multi_option((char **)&(coap_pkt->uri_query),
+                             &(coap_pkt->uri_query_len), current_option,
+                             option_length, '&');
+      break;
+    case COAP_OPTION_OBSERVE:
+      coap_pkt->observe = ref_parse_int_option(current_option, option_length);
+      break;
+    case COAP_OPTION_BLOCK2:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->block2_num =
+        ref_parse_int_option(current_option, option_length);
+      coap_pkt->block2_more = (coap_pkt->block2_num & 0x08) >> 3;
+      coap_pkt->block2_size = 16 << (coap_pkt->block2_num & 0x07);
+      coap_pkt->block2_offset = (coap_pkt->block2_num & ~0x0000000F)
+                                << (coap_pkt->block2_num & 0x07);
+      coap_pkt->block2_num >>= 4;
+      break;
+    case COAP_OPTION_BLOCK1:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->block1_num =
+        ref_parse_int_option(current_option, option_length);
+      coap_pkt->block1_more = (coap_pkt->block1_num & 0x08) >> 3;
+      coap_pkt->block1_size = 16 << (coap_pkt->block1_num & 0x07);
+      coap_pkt->block1_offset = (coap_pkt->block1_num & ~0x0000000F)
+                                << (coap_pkt->block1_num & 0x07);
+      coap_pkt->block1_num >>= 4;
+      break;
+    case COAP_OPTION_SIZE2:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->size2 = ref_parse_int_option(current_option, option_length);
+      break;
+    case COAP_OPTION_SIZE1:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      coap_pkt->size1 = ref_parse_int_option(current_option, option_length);
+      break;
+    case COAP_OPTION_ECHO:
+      if (!inner || option_length > COAP_ECHO_LEN) {
+        return BAD_OPTION_4_02;
+      }
+      memcpy(coap_pkt->echo, current_option, option_length);
+      coap_pkt->echo_len = option_length;
+      break;
+    case OCF_OPTION_CONTENT_FORMAT_VER:
+    case OCF_OPTION_ACCEPT_CONTENT_FORMAT_VER:
+      if (!inner) {
+        return BAD_OPTION_4_02;
+      }
+      break;
+    default:
+      if (option_number & 1) {
+        return BAD_OPTION_4_02;
+      }
+    }
+    current_option += option_length;
+  }
+  return COAP_NO_ERROR;
+}
+
+static void
+put_option_header(std::vector<uint8_t> &out, unsigned int delta, size_t len)
+{
+  auto nibble = [](size_t v) -> uint8_t {
+    return v < 13 ? (uint8_t)v : (v < 269 ? 13 : 14);
+  };
+  out.push_back((uint8_t)(nibble(delta) << 4 | nibble(len)));
+  for (size_t v : { (size_t)delta, len }) {
+    if (v >= 269) {
+      out.push_back((uint8_t)((v - 269) >> 8));
+      out.push_back((uint8_t)(v - 269));
+    } else if (v >= 13) {
+      out.push_back((uint8_t)(v - 13));
+    }
+  }
+}
+
+/* a random run of options, mostly well formed */
+static std::vector<uint8_t>
+random_options(std::mt19937 &rng)
+{
+  static const unsigned int numbers[] = {
+    1,  3,  4,  5,  6,  7,  8,   9,   11,  12,   14,   15,  17,
+    20, 23, 27, 28, 35, 39, 60,  252, 258, 2049, 2053, 2055, 0
+  };
+  std::vector<uint8_t> out;
+  unsigned int number = 0;
+  int count = (int)(rng() % 8);
+  for (int i = 0; i < count; i++) {
+    unsigned int next = numbers[rng() % (sizeof(numbers) / sizeof(*numbers))];
+    if (next < number) {
+      next = number + (unsigned int)(rng() % 3);
+    }
+    size_t len;
+    switch (rng() % 4) {
+    case 0:
+      len = rng() % 3;
+      break;
+    case 1:
+      len = rng() % 13;
+      break;
+    case 2:
+      len = rng() % 50;
+      break;
+    default:
+      len = rng() % 300;
+      break;
+    }
+    put_option_header(out, next - number, len);
+    for (size_t j = 0; j < len; j++) {
+      /* content formats and other small integers are common */
+      out.push_back((uint8_t)(rng() % 2 ? rng() % 64 : rng()));
+    }
+    number = next;
+  }
+  if (rng() % 2) {
+    out.push_back(0xFF);
+    size_t len = rng() % 20;
+    for (size_t j = 0; j < len; j++) {
+      out.push_back((uint8_t)rng());
+    }
+  }
+  /* damage some of them */
+  if (!out.empty() && rng() % 4 == 0) {
+    out[rng() % out.size()] = (uint8_t)rng();
+  }
+  if (!out.empty() && rng() % 8 == 0) {
+    out.resize(rng() % out.size());
+  }
+  return out;
+}
+
+static long
+offset(const void *p, const uint8_t *base)
+{
+  return p ? (long)((const uint8_t *)p - base) : -1;
+}
+
+static void
+expect_same(const coap_packet_t &a, const uint8_t *a_base,
+            const coap_packet_t &b, const uint8_t *b_base)
+{
+  EXPECT_EQ(0, memcmp(a.options, b.options, sizeof(a.options)));
+  EXPECT_EQ(a.content_format, b.content_format);
+  EXPECT_EQ(a.max_age, b.max_age);
+  EXPECT_EQ(a.etag_len, b.etag_len);
+  EXPECT_EQ(0, memcmp(a.etag, b.etag, a.etag_len));
+  EXPECT_EQ(offset(a.proxy_uri, a_base), offset(b.proxy_uri, b_base));
+  EXPECT_EQ(a.proxy_uri_len, b.proxy_uri_len);
+  EXPECT_EQ(offset(a.uri_host, a_base), offset(b.uri_host, b_base));
+  EXPECT_EQ(a.uri_host_len, b.uri_host_len);
+  EXPECT_EQ(a.uri_port, b.uri_port);
+  EXPECT_EQ(offset(a.uri_path, a_base), offset(b.uri_path, b_base));
+  EXPECT_EQ(a.uri_path_len, b.uri_path_len);
+  EXPECT_EQ(offset(a.uri_query, a_base), offset(b.uri_query, b_base));
+  EXPECT_EQ(a.uri_query_len, b.uri_query_len);
+  EXPECT_EQ(a.observe, b.observe);
+  EXPECT_EQ(a.accept, b.accept);
+  EXPECT_EQ(a.block1_num, b.block1_num);
+  EXPECT_EQ(a.block1_more, b.block1_more);
+  EXPECT_EQ(a.block1_size, b.block1_size);
+  EXPECT_EQ(a.block1_offset, b.block1_offset);
+  EXPECT_EQ(a.block2_num, b.block2_num);
+  EXPECT_EQ(a.block2_more, b.block2_more);
+  EXPECT_EQ(a.block2_size, b.block2_size);
+  EXPECT_EQ(a.block2_offset, b.block2_offset);
+  EXPECT_EQ(a.size1, b.size1);
+  EXPECT_EQ(a.size2, b.size2);
+  EXPECT_EQ(a.echo_len, b.echo_len);
+  EXPECT_EQ(0, memcmp(a.echo, b.echo, a.echo_len));
+  EXPECT_EQ(offset(a.payload, a_base), offset(b.payload, b_base));
+  EXPECT_EQ(a.payload_len, b.payload_len);
+}
+
+TEST(OptionParser, MatchesReferenceParser)
+{
+  std::mt19937 rng(2023);
+  for (int round = 0; round < 200000; round++) {
+    std::vector<uint8_t> options = random_options(rng);
+    bool inner = rng() % 4 != 0;
+    bool outer = !inner || rng() % 2;
+    bool oscore = rng() % 2;
+
+    std::vector<uint8_t> ref_buf(options), buf(options);
+    ref_buf.resize(options.size() + SLACK);
+    buf.resize(options.size() + SLACK);
+    coap_packet_t ref_pkt, pkt;
+    memset(&ref_pkt, 0, sizeof(ref_pkt));
+    memset(&pkt, 0, sizeof(pkt));
+
+    coap_status_t ref_status =
+      ref_parse_options(&ref_pkt, ref_buf.data(), (uint32_t)options.size(),
+                        ref_buf.data(), inner, outer, oscore);
+    coap_status_t status =
+      coap_oscore_parse_options(&pkt, buf.data(), (uint32_t)options.size(),
+                                buf.data(), inner, outer, oscore);
+    ASSERT_EQ(ref_status, status) << "round " << round;
+    if (status == COAP_NO_ERROR) {
+      expect_same(ref_pkt, ref_buf.data(), pkt, buf.data());
+      /* merging repeated options rewrites the message in place */
+      EXPECT_EQ(ref_buf, buf);
+      if (HasFailure()) {
+        FAIL() << "round " << round;
+      }
+    }
+  }
+}
+
+/* run with --gtest_also_run_disabled_tests to compare the table-driven
+ * parser with the reference parser */
+TEST(OptionParser, DISABLED_BenchmarkParse)
+{
+  using bench_clock = std::chrono::steady_clock;
+  /* a typical request: Uri-Path "dev"/"sna", Uri-Query, Content-Format,
+   * Accept, Block2 and a payload */
+  std::vector<uint8_t> msg;
+  put_option_header(msg, COAP_OPTION_URI_PATH, 3);
+  msg.insert(msg.end(), { 'd', 'e', 'v' });
+  put_option_header(msg, 0, 3);
+  msg.insert(msg.end(), { 's', 'n', 'a' });
+  put_option_header(msg, COAP_OPTION_CONTENT_FORMAT - COAP_OPTION_URI_PATH, 1);
+  msg.push_back(APPLICATION_CBOR);
+  put_option_header(msg, COAP_OPTION_URI_QUERY - COAP_OPTION_CONTENT_FORMAT, 4);
+  msg.insert(msg.end(), { 'l', '=', 'a', 'd' });
+  put_option_header(msg, COAP_OPTION_ACCEPT - COAP_OPTION_URI_QUERY, 1);
+  msg.push_back(APPLICATION_CBOR);
+  put_option_header(msg, COAP_OPTION_BLOCK2 - COAP_OPTION_ACCEPT, 1);
+  msg.push_back(0x06);
+  msg.push_back(0xFF);
+  msg.insert(msg.end(), { 0xA1, 0x01, 0x02 });
+
+  /* the best of many short rounds, which is stable on a busy machine */
+  const int count = 20000;
+  const int rounds = 500;
+  std::vector<uint8_t> buf(msg.size() + SLACK);
+  coap_packet_t pkt;
+  auto run = [&](coap_status_t (*parse)(coap_packet_t *, uint8_t *, uint32_t,
+                                        uint8_t *, bool, bool, bool)) {
+    bench_clock::time_point start = bench_clock::now();
+    for (int i = 0; i < count; i++) {
+      memcpy(buf.data(), msg.data(), msg.size());
+      memset(&pkt, 0, sizeof(pkt));
+      EXPECT_EQ(COAP_NO_ERROR, parse(&pkt, buf.data(), (uint32_t)msg.size(),
+                                     buf.data(), true, true, false));
+    }
+    return std::chrono::duration<double, std::nano>(bench_clock::now() -
+                                                    start)
+             .count() /
+           count;
+  };
+  double ref_ns = 0;
+  double ns = 0;
+  for (int round = 0; round < rounds; round++) {
+    double r = run(ref_parse_options);
+    double t = run([](coap_packet_t *p, uint8_t *d, uint32_t l, uint8_t *c,
+                      bool i, bool o, bool s) {
+      return coap_oscore_parse_options(p, d, l, c, i, o, s);
+    });
+    ref_ns = (round == 0 || r < ref_ns) ? r : ref_ns;
+    ns = (round == 0 || t < ns) ? t : ns;
+  }
+  EXPECT_EQ(7u, pkt.uri_path_len);
+  printf("[ OPTIONS  ] best of %d x %d parses: reference %.1f ns, table "
+         "%.1f ns\n",
+         rounds, count, ref_ns, ns);
+}
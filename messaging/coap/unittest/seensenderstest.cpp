@@ -0,0 +1,82 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "seen_senders.h"
+}
+
+class TestSeenSenders : public testing::Test {
+protected:
+  void SetUp() override { coap_seen_senders_reset(); }
+
+  void TearDown() override { coap_seen_senders_reset(); }
+
+  static oc_endpoint_t sender(int n)
+  {
+    oc_endpoint_t ep;
+    memset(&ep, 0, sizeof(ep));
+    ep.flags = IPV6;
+    ep.addr.ipv6.port = 5683;
+    ep.addr.ipv6.address[14] = (uint8_t)(n >> 8);
+    ep.addr.ipv6.address[15] = (uint8_t)n;
+    return ep;
+  }
+};
+
+TEST_F(TestSeenSenders, AddedSenderIsTrusted)
+{
+  oc_endpoint_t a = sender(1);
+  EXPECT_FALSE(coap_seen_sender_check(&a));
+  coap_seen_sender_add(&a);
+  EXPECT_TRUE(coap_seen_sender_check(&a));
+
+  oc_endpoint_t other_port = a;
+  other_port.addr.ipv6.port = 5684;
+  EXPECT_FALSE(coap_seen_sender_check(&other_port));
+
+  coap_seen_senders_stats_t stats;
+  coap_seen_senders_get_stats(&stats);
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(0u, stats.evictions);
+}
+
+TEST_F(TestSeenSenders, LeastRecentlySeenIsEvicted)
+{
+  for (int i = 0; i < OC_SEEN_SENDERS_SIZE; i++) {
+    oc_endpoint_t ep = sender(i);
+    coap_seen_sender_add(&ep);
+  }
+  /* sender 0 is the oldest, but is seen again */
+  oc_endpoint_t first = sender(0);
+  EXPECT_TRUE(coap_seen_sender_check(&first));
+
+  oc_endpoint_t extra = sender(OC_SEEN_SENDERS_SIZE);
+  coap_seen_sender_add(&extra);
+  oc_endpoint_t second = sender(1);
+  EXPECT_FALSE(coap_seen_sender_check(&second));
+  EXPECT_TRUE(coap_seen_sender_check(&first));
+  EXPECT_TRUE(coap_seen_sender_check(&extra));
+
+  coap_seen_senders_stats_t stats;
+  coap_seen_senders_get_stats(&stats);
+  EXPECT_EQ(1u, stats.evictions);
+}
@@ -0,0 +1,92 @@
+/******************************************************************
+ *
+ * Copyright 2023 Cascoda Ltd All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "transactions.h"
+}
+
+class TestTransactions : public testing::Test {
+protected:
+  void SetUp() override { memset(&endpoint_, 0, sizeof(endpoint_)); }
+
+  void TearDown() override { coap_free_all_transactions(); }
+
+  coap_transaction_t *create(uint16_t mid, uint8_t tag)
+  {
+    uint8_t token[8] = { 0xAB, 0, 0, 0, 0, 0, 0, tag };
+    return coap_new_transaction(mid, token, sizeof(token), &endpoint_);
+  }
+
+  static coap_transaction_t *by_token(uint8_t tag)
+  {
+    uint8_t token[8] = { 0xAB, 0, 0, 0, 0, 0, 0, tag };
+    return coap_get_transaction_by_token(token, sizeof(token));
+  }
+
+  oc_endpoint_t endpoint_;
+};
+
+TEST_F(TestTransactions, LookupByMidAndToken)
+{
+  std::vector<coap_transaction_t *> transactions;
+  for (int i = 0; i < 8; i++) {
+    coap_transaction_t *t = create((uint16_t)(1000 + i), (uint8_t)i);
+    ASSERT_NE(nullptr, t);
+    transactions.push_back(t);
+  }
+  for (int i = 0; i < 8; i++) {
+    EXPECT_EQ(transactions[i], coap_get_transaction_by_mid(1000 + i));
+    EXPECT_EQ(transactions[i], by_token((uint8_t)i));
+  }
+  EXPECT_EQ(nullptr, coap_get_transaction_by_mid(999));
+  EXPECT_EQ(nullptr, by_token(99));
+
+  coap_clear_transaction(transactions[3]);
+  EXPECT_EQ(nullptr, coap_get_transaction_by_mid(1003));
+  EXPECT_EQ(nullptr, by_token(3));
+  EXPECT_EQ(transactions[4], coap_get_transaction_by_mid(1004));
+}
+
+TEST_F(TestTransactions, SharedTokenFindsOldest)
+{
+  /* notifications to one observer share its token */
+  coap_transaction_t *first = create(1, 7);
+  coap_transaction_t *second = create(2, 7);
+  ASSERT_NE(nullptr, first);
+  ASSERT_NE(nullptr, second);
+  EXPECT_EQ(first, by_token(7));
+  coap_clear_transaction(first);
+  EXPECT_EQ(second, by_token(7));
+}
+
+TEST_F(TestTransactions, ChangedKeysAreFound)
+{
+  /* responses get their transaction before the token and MID are final */
+  coap_transaction_t *t = coap_new_transaction(5, NULL, 0, &endpoint_);
+  ASSERT_NE(nullptr, t);
+  uint8_t token[8] = { 0xAB, 0, 0, 0, 0, 0, 0, 9 };
+  coap_set_transaction_token(t, token, sizeof(token));
+  coap_set_transaction_mid(t, 6);
+  EXPECT_EQ(t, by_token(9));
+  EXPECT_EQ(t, coap_get_transaction_by_mid(6));
+  EXPECT_EQ(nullptr, coap_get_transaction_by_mid(5));
+}
@@ -16,9 +16,29 @@
 
 #include "port/oc_clock.h"
 #include "port/oc_log.h"
-#include <math.h>
+#include <errno.h>
 #include <time.h>
-#include <unistd.h>
+
+#define NSEC_PER_SEC (1000000000ULL)
+
+/* The stack only measures intervals, so it runs on a clock that NTP and
+ * settimeofday() cannot step. The coarse clock avoids the vDSO time counter
+ * read, at the resolution of the kernel tick.
+ */
+#ifdef OC_CLOCK_MONOTONIC_COARSE
+#define OC_CLOCK_ID CLOCK_MONOTONIC_COARSE
+#else /* OC_CLOCK_MONOTONIC_COARSE */
+#define OC_CLOCK_ID CLOCK_MONOTONIC
+#endif /* !OC_CLOCK_MONOTONIC_COARSE */
+
+static oc_clock_time_t
+timespec_to_ticks(const struct timespec *t)
+{
+  /* round up, a timer must not be seen as expired early */
+  return (oc_clock_time_t)t->tv_sec * OC_CLOCK_SECOND +
+         ((oc_clock_time_t)t->tv_nsec * OC_CLOCK_SECOND + NSEC_PER_SEC - 1) /
+           NSEC_PER_SEC;
+}
 
 void
 oc_clock_init(void)
@@ -28,13 +48,21 @@ oc_clock_init(void)
 oc_clock_time_t
 oc_clock_time(void)
 {
-  oc_clock_time_t time = 0;
   struct timespec t;
-  if (clock_gettime(CLOCK_REALTIME, &t) != -1) {
-    time = (oc_clock_time_t)t.tv_sec * OC_CLOCK_SECOND +
-           (oc_clock_time_t)ceil(t.tv_nsec / (1.e09 / OC_CLOCK_SECOND));
+  if (clock_gettime(OC_CLOCK_ID, &t) == -1) {
+    return 0;
   }
-  return time;
+  return timespec_to_ticks(&t);
+}
+
+oc_clock_time_t
+oc_clock_wall_time(void)
+{
+  struct timespec t;
+  if (clock_gettime(CLOCK_REALTIME, &t) == -1) {
+    return 0;
+  }
+  return timespec_to_ticks(&t);
 }
 
 unsigned long
@@ -50,5 +78,9 @@ oc_clock_seconds(void)
 void
 oc_clock_wait(oc_clock_time_t t)
 {
-  usleep(t * 1.e03);
+  struct timespec ts;
+  ts.tv_sec = (time_t)(t / OC_CLOCK_SECOND);
+  ts.tv_nsec = (long)(((t % OC_CLOCK_SECOND) * NSEC_PER_SEC) / OC_CLOCK_SECOND);
+  while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {
+  }
 }
@@ -21,12 +21,24 @@
 #ifdef OC_TCP
 #include "tcpadapter.h"
 #endif
+#ifdef OC_IO_URING
+#include "uringadapter.h"
+#endif /* OC_IO_URING */
+#ifdef OC_EXTERNAL_POLL
+#ifdef OC_IO_URING
+#error "OC_EXTERNAL_POLL and OC_IO_URING cannot be enabled together"
+#endif /* OC_IO_URING */
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif /* OC_EXTERNAL_POLL */
 #include "oc_buffer.h"
 #include "oc_core_res.h"
 #include "oc_endpoint.h"
 #include "api/oc_knx_fp.h"
 #include "oc_network_monitor.h"
 #include "port/oc_assert.h"
+#include "port/oc_clock.h"
 #include "port/oc_connectivity.h"
 #include <arpa/inet.h>
 #include <assert.h>
@@ -364,9 +376,75 @@ configure_mcast_socket(int mcast_sock, int sa_family)
   return ret;
 }
 
+/* Build the endpoint advertised for an RTM_NEWADDR/RTM_DELADDR message.
+ * Returns false if the address is not to be advertised.
+ */
+static bool
+endpoint_from_ifaddr(struct nlmsghdr *msg, unsigned char family, uint16_t port,
+                     bool secure, bool tcp, oc_endpoint_t *ep)
+{
+  memset(ep, 0, sizeof(oc_endpoint_t));
+  struct ifaddrmsg *addrmsg = (struct ifaddrmsg *)NLMSG_DATA(msg);
+  if (addrmsg->ifa_family != family || addrmsg->ifa_scope >= RT_SCOPE_HOST) {
+    return false;
+  }
+  ep->interface_index = addrmsg->ifa_index;
+  bool include = true;
+  struct rtattr *attr = (struct rtattr *)IFA_RTA(addrmsg);
+  int att_len = IFA_PAYLOAD(msg);
+  while (RTA_OK(attr, att_len)) {
+    if (attr->rta_type == IFA_ADDRESS) {
+#ifdef OC_IPV4
+      if (family == AF_INET) {
+        memcpy(ep->addr.ipv4.address, RTA_DATA(attr), 4);
+        ep->flags = IPV4;
+      } else
+#endif /* OC_IPV4 */
+        if (family == AF_INET6) {
+          memcpy(ep->addr.ipv6.address, RTA_DATA(attr), 16);
+          ep->flags = IPV6;
+        }
+    } else if (attr->rta_type == IFA_FLAGS) {
+      if (*(uint32_t *)(RTA_DATA(attr)) & IFA_F_TEMPORARY) {
+        include = false;
+      }
+    }
+    attr = RTA_NEXT(attr, att_len);
+  }
+  if (!include) {
+    return false;
+  }
+
+  if (addrmsg->ifa_scope == RT_SCOPE_LINK && family == AF_INET6) {
+    ep->addr.ipv6.scope = addrmsg->ifa_index;
+  }
+  if (secure) {
+    ep->flags |= SECURED;
+  }
+#ifdef OC_IPV4
+  if (family == AF_INET) {
+    ep->addr.ipv4.port = port;
+  } else
+#endif /* OC_IPV4 */
+    if (family == AF_INET6) {
+      ep->addr.ipv6.port = port;
+    }
+#ifdef OC_TCP
+  if (tcp) {
+    ep->flags |= TCP;
+  }
+#else
+  (void)tcp;
+#endif /* OC_TCP */
+  return true;
+}
+
+/* Add one endpoint per interface for the addresses of the given family. If
+ * if_index is non-zero, only addresses of that interface are considered.
+ */
 static void
 get_interface_addresses(ip_context_t *dev, unsigned char family, uint16_t port,
-                        bool secure, bool tcp)
+                        bool secure, bool tcp, int if_index)
 {
   struct
   {
@@ -432,61 +510,14 @@ get_interface_addresses(ip_context_t *dev, unsigned char family, uint16_t port,
         done = true;
         break;
       }
-      oc_endpoint_t ep;
-      memset(&ep, 0, sizeof(oc_endpoint_t));
-      bool include = false;
       struct ifaddrmsg *addrmsg = (struct ifaddrmsg *)NLMSG_DATA(response);
-      if (addrmsg->ifa_scope < RT_SCOPE_HOST) {
-        if ((int)addrmsg->ifa_index == prev_interface_index) {
-          goto next_ifaddr;
-        }
-        ep.interface_index = addrmsg->ifa_index;
-        include = true;
-        struct rtattr *attr = (struct rtattr *)IFA_RTA(addrmsg);
-        int att_len = IFA_PAYLOAD(response);
-        while (RTA_OK(attr, att_len)) {
-          if (attr->rta_type == IFA_ADDRESS) {
-#ifdef OC_IPV4
-            if (family == AF_INET) {
-              memcpy(ep.addr.ipv4.address, RTA_DATA(attr), 4);
-              ep.flags = IPV4;
-            } else
-#endif /* OC_IPV4 */
-              if (family == AF_INET6) {
-                memcpy(ep.addr.ipv6.address, RTA_DATA(attr), 16);
-                ep.flags = IPV6;
-              }
-          } else if (attr->rta_type == IFA_FLAGS) {
-            if (*(uint32_t *)(RTA_DATA(attr)) & IFA_F_TEMPORARY) {
-              include = false;
-            }
-          }
-          attr = RTA_NEXT(attr, att_len);
-        }
+      if ((int)addrmsg->ifa_index == prev_interface_index ||
+          (if_index != 0 && (int)addrmsg->ifa_index != if_index)) {
+        goto next_ifaddr;
       }
-      if (include) {
+      oc_endpoint_t ep;
+      if (endpoint_from_ifaddr(response, family, port, secure, tcp, &ep)) {
         prev_interface_index = addrmsg->ifa_index;
-        if (addrmsg->ifa_scope == RT_SCOPE_LINK && family == AF_INET6) {
-          ep.addr.ipv6.scope = addrmsg->ifa_index;
-        }
-        if (secure) {
-          ep.flags |= SECURED;
-        }
-#ifdef OC_IPV4
-        if (family == AF_INET) {
-          ep.addr.ipv4.port = port;
-        } else
-#endif /* OC_IPV4 */
-          if (family == AF_INET6) {
-            ep.addr.ipv6.port = port;
-          }
-#ifdef OC_TCP
-        if (tcp) {
-          ep.flags |= TCP;
-        }
-#else
-        (void)tcp;
-#endif /* OC_TCP */
         oc_endpoint_t *new_ep = oc_memb_alloc(&device_eps);
         if (!new_ep) {
           close(nl_sock);
@@ -514,34 +545,124 @@ free_endpoints_list(ip_context_t *dev)
   }
 }
 
+/* The sockets of a device for which endpoints are advertised */
+typedef struct
+{
+  unsigned char family;
+  uint16_t port;
+  bool secure;
+  bool tcp;
+} endpoint_kind_t;
+
+#define MAX_ENDPOINT_KINDS (8)
+
 static void
-refresh_endpoints_list(ip_context_t *dev)
+add_endpoint_kind(endpoint_kind_t *kinds, int *num_kinds, unsigned char family,
+                  uint16_t port, bool secure, bool tcp)
 {
-  free_endpoints_list(dev);
+  kinds[*num_kinds].family = family;
+  kinds[*num_kinds].port = port;
+  kinds[*num_kinds].secure = secure;
+  kinds[*num_kinds].tcp = tcp;
+  (*num_kinds)++;
+}
 
-  get_interface_addresses(dev, AF_INET6, dev->port, false, false);
+static int
+get_endpoint_kinds(ip_context_t *dev, endpoint_kind_t *kinds)
+{
+  int n = 0;
+  add_endpoint_kind(kinds, &n, AF_INET6, dev->port, false, false);
 #ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET6, dev->dtls_port, true, false);
+  add_endpoint_kind(kinds, &n, AF_INET6, dev->dtls_port, true, false);
 #endif /* OC_SECURITY */
 #ifdef OC_IPV4
-  get_interface_addresses(dev, AF_INET, dev->port4, false, false);
+  add_endpoint_kind(kinds, &n, AF_INET, dev->port4, false, false);
 #ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET, dev->dtls4_port, true, false);
+  add_endpoint_kind(kinds, &n, AF_INET, dev->dtls4_port, true, false);
 #endif /* OC_SECURITY */
 #endif /* OC_IPV4 */
 
 #ifdef OC_TCP
-  get_interface_addresses(dev, AF_INET6, dev->tcp.port, false, true);
+  add_endpoint_kind(kinds, &n, AF_INET6, dev->tcp.port, false, true);
 #ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET6, dev->tcp.tls_port, true, true);
+  add_endpoint_kind(kinds, &n, AF_INET6, dev->tcp.tls_port, true, true);
 #endif /* OC_SECURITY */
 #ifdef OC_IPV4
-  get_interface_addresses(dev, AF_INET, dev->tcp.port4, false, true);
+  add_endpoint_kind(kinds, &n, AF_INET, dev->tcp.port4, false, true);
 #ifdef OC_SECURITY
-  get_interface_addresses(dev, AF_INET, dev->tcp.tls4_port, true, true);
+  add_endpoint_kind(kinds, &n, AF_INET, dev->tcp.tls4_port, true, true);
 #endif /* OC_SECURITY */
 #endif /* OC_IPV4 */
 #endif /* OC_TCP */
+  return n;
+}
+
+static void
+refresh_endpoints_list(ip_context_t *dev)
+{
+  endpoint_kind_t kinds[MAX_ENDPOINT_KINDS];
+  int i, num_kinds = get_endpoint_kinds(dev, kinds);
+
+  free_endpoints_list(dev);
+
+  for (i = 0; i < num_kinds; i++) {
+    get_interface_addresses(dev, kinds[i].family, kinds[i].port,
+                            kinds[i].secure, kinds[i].tcp, 0);
+  }
+}
+
+static bool
+endpoint_addr_equal(const oc_endpoint_t *a, const oc_endpoint_t *b)
+{
+#ifdef OC_IPV4
+  if (a->flags & IPV4) {
+    return memcmp(a->addr.ipv4.address, b->addr.ipv4.address, 4) == 0;
+  }
+#endif /* OC_IPV4 */
+  return memcmp(a->addr.ipv6.address, b->addr.ipv6.address, 16) == 0;
+}
+
+/* Apply a single RTM_NEWADDR/RTM_DELADDR message to the endpoint list of a
+ * device, instead of rebuilding the whole list. An interface keeps the
+ * endpoint it has until that address is removed, in which case only that
+ * interface is queried for a replacement.
+ */
+static void
+update_endpoints_list(ip_context_t *dev, struct nlmsghdr *msg)
+{
+  endpoint_kind_t kinds[MAX_ENDPOINT_KINDS];
+  int i, num_kinds = get_endpoint_kinds(dev, kinds);
+
+  for (i = 0; i < num_kinds; i++) {
+    oc_endpoint_t ep;
+    if (!endpoint_from_ifaddr(msg, kinds[i].family, kinds[i].port,
+                              kinds[i].secure, kinds[i].tcp, &ep)) {
+      continue;
+    }
+    oc_endpoint_t *cur = oc_list_head(dev->eps);
+    while (cur != NULL && (cur->interface_index != ep.interface_index ||
+                           cur->flags != ep.flags)) {
+      cur = cur->next;
+    }
+
+    if (msg->nlmsg_type == RTM_NEWADDR) {
+      if (!cur) {
+        oc_endpoint_t *new_ep = oc_memb_alloc(&device_eps);
+        if (!new_ep) {
+          OC_ERR("endpoint alloc failed");
+          return;
+        }
+        memcpy(new_ep, &ep, sizeof(oc_endpoint_t));
+        oc_list_add(dev->eps, new_ep);
+      }
+    } else if (cur && endpoint_addr_equal(cur, &ep)) {
+      oc_list_remove(dev->eps, cur);
+      oc_memb_free(&device_eps, cur);
+      get_interface_addresses(dev, kinds[i].family, kinds[i].port,
+                              kinds[i].secure, kinds[i].tcp,
+                              (int)ep.interface_index);
+    }
+  }
 }
 
 oc_endpoint_t *
@@ -562,14 +683,119 @@ oc_connectivity_get_endpoints(size_t device)
   return oc_list_head(dev->eps);
 }
 
+/* Multicast groups are (re)joined once the interface changes have settled
+ * for OC_IFCHANGE_DEBOUNCE_MS, so a burst of address events on the same
+ * interface costs one re-subscription. Only touched by the network thread of
+ * the 0th logical device.
+ */
+typedef struct
+{
+  int if_index;
+  unsigned char family;
+#ifdef OC_IPV4
+  struct in_addr addr4;
+#endif /* OC_IPV4 */
+} pending_mcast_t;
+
+static pending_mcast_t pending_mcast[OC_IFCHANGE_MAX_PENDING];
+static int num_pending_mcast;
+static bool pending_mcast_overflow;
+static oc_clock_time_t pending_mcast_deadline;
+
+static void
+schedule_mcast_subscription(struct ifaddrmsg *ifa, struct rtattr *addr)
+{
+  int i;
+  for (i = 0; i < num_pending_mcast; i++) {
+    if (pending_mcast[i].if_index == (int)ifa->ifa_index &&
+        pending_mcast[i].family == ifa->ifa_family) {
+      break;
+    }
+  }
+  if (i == num_pending_mcast) {
+    if (num_pending_mcast < OC_IFCHANGE_MAX_PENDING) {
+      pending_mcast[i].if_index = (int)ifa->ifa_index;
+      pending_mcast[i].family = ifa->ifa_family;
+      num_pending_mcast++;
+    } else {
+      pending_mcast_overflow = true;
+    }
+  }
+#ifdef OC_IPV4
+  if (i < OC_IFCHANGE_MAX_PENDING && ifa->ifa_family == AF_INET) {
+    memcpy(&pending_mcast[i].addr4, RTA_DATA(addr), sizeof(struct in_addr));
+  }
+#else  /* OC_IPV4 */
+  (void)addr;
+#endif /* !OC_IPV4 */
+  pending_mcast_deadline =
+    oc_clock_time() + (OC_IFCHANGE_DEBOUNCE_MS * OC_CLOCK_SECOND) / 1000;
+}
+
+static int
+apply_mcast_subscriptions(void)
+{
+  int ret = 0, i, j, num_devices = oc_core_get_num_devices();
+  for (i = 0; i < num_devices; i++) {
+    ip_context_t *dev = get_ip_context_for_device(i);
+    if (!dev) {
+      continue;
+    }
+    if (pending_mcast_overflow) {
+      /* too many interfaces changed, rejoin on all of them */
+      ret += configure_mcast_socket(dev->mcast_sock, AF_INET6);
+#ifdef OC_IPV4
+      ret += configure_mcast_socket(dev->mcast4_sock, AF_INET);
+#endif /* OC_IPV4 */
+      continue;
+    }
+    for (j = 0; j < num_pending_mcast; j++) {
+#ifdef OC_IPV4
+      if (pending_mcast[j].family == AF_INET) {
+        ret += add_mcast_sock_to_ipv4_mcast_group(
+          dev->mcast4_sock, &pending_mcast[j].addr4, pending_mcast[j].if_index);
+      } else
+#endif /* OC_IPV4 */
+      {
+        ret += add_mcast_sock_to_ipv6_mcast_group(dev->mcast_sock,
+                                                  pending_mcast[j].if_index);
+      }
+    }
+  }
+  num_pending_mcast = 0;
+  pending_mcast_overflow = false;
+  return ret;
+}
+
+/* Apply the pending multicast subscriptions if their debounce window has
+ * passed. Returns the number of milliseconds until they are due, or -1 if
+ * there are none.
+ */
+static int
+process_pending_mcast_subscriptions(void)
+{
+  if (num_pending_mcast == 0 && !pending_mcast_overflow) {
+    return -1;
+  }
+  oc_clock_time_t now = oc_clock_time();
+  if (now < pending_mcast_deadline) {
+    return (int)(((pending_mcast_deadline - now) * 1000 + OC_CLOCK_SECOND - 1) /
+                 OC_CLOCK_SECOND);
+  }
+  if (apply_mcast_subscriptions() < 0) {
+    OC_WRN("caught errors while joining multicast groups");
+  }
+  return -1;
+}
+
 /* Called after network interface up/down events.
- * This function reconfigures IPv6/v4 multicast sockets for
- * all logical devices.
+ * This function updates the endpoint lists of all logical devices and
+ * schedules the reconfiguration of the IPv6/v4 multicast sockets.
  */
 static int
 process_interface_change_event(void)
 {
-  int ret = 0, i, num_devices = oc_core_get_num_devices();
+  int i, num_devices = oc_core_get_num_devices();
   struct nlmsghdr *response = NULL;
 
   int guess = 512, response_len;
@@ -596,108 +822,67 @@ process_interface_change_event(void)
     return -1;
   }
 
-  bool if_state_changed = false;
-
   while (NLMSG_OK(response, response_len)) {
-    if (response->nlmsg_type == RTM_NEWADDR) {
+    if (response->nlmsg_type == RTM_NEWADDR ||
+        response->nlmsg_type == RTM_DELADDR) {
       struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(response);
-      if (ifa) {
+      bool added = (response->nlmsg_type == RTM_NEWADDR);
 #ifdef OC_NETWORK_MONITOR
-        if (add_ip_interface(ifa->ifa_index)) {
-          oc_network_interface_event(NETWORK_INTERFACE_UP);
-        }
+      if (added && add_ip_interface(ifa->ifa_index)) {
+        oc_network_interface_event(NETWORK_INTERFACE_UP);
+      } else if (!added && remove_ip_interface(ifa->ifa_index)) {
+        oc_network_interface_event(NETWORK_INTERFACE_DOWN);
+      }
 #endif /* OC_NETWORK_MONITOR */
+      if (added) {
         struct rtattr *attr = (struct rtattr *)IFA_RTA(ifa);
         int att_len = IFA_PAYLOAD(response);
         while (RTA_OK(attr, att_len)) {
           if (attr->rta_type == IFA_ADDRESS) {
 #ifdef OC_IPV4
             if (ifa->ifa_family == AF_INET) {
-              for (i = 0; i < num_devices; i++) {
-                ip_context_t *dev = get_ip_context_for_device(i);
-                ret += add_mcast_sock_to_ipv4_mcast_group(
-                  dev->mcast4_sock, RTA_DATA(attr), ifa->ifa_index);
-              }
+              schedule_mcast_subscription(ifa, attr);
             } else
 #endif /* OC_IPV4 */
               if (ifa->ifa_family == AF_INET6 &&
                   ifa->ifa_scope == RT_SCOPE_LINK) {
-                for (i = 0; i < num_devices; i++) {
-                  ip_context_t *dev = get_ip_context_for_device(i);
-                  ret += add_mcast_sock_to_ipv6_mcast_group(dev->mcast_sock,
-                                                            ifa->ifa_index);
-                }
+                schedule_mcast_subscription(ifa, attr);
               }
           }
           attr = RTA_NEXT(attr, att_len);
         }
       }
-      if_state_changed = true;
-    } else if (response->nlmsg_type == RTM_DELADDR) {
-      struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(response);
-      if (ifa) {
-#ifdef OC_NETWORK_MONITOR
-        if (remove_ip_interface(ifa->ifa_index)) {
-          oc_network_interface_event(NETWORK_INTERFACE_DOWN);
+
+      for (i = 0; i < num_devices; i++) {
+        ip_context_t *dev = get_ip_context_for_device(i);
+        /* lists that were never populated are built on first use */
+        if (!dev || oc_list_length(dev->eps) == 0) {
+          continue;
         }
-#endif /* OC_NETWORK_MONITOR */
+        oc_network_event_handler_mutex_lock();
+        update_endpoints_list(dev, response);
+        oc_network_event_handler_mutex_unlock();
       }
-      if_state_changed = true;
     }
     response = NLMSG_NEXT(response, response_len);
   }
 
-  if (if_state_changed) {
-    for (i = 0; i < num_devices; i++) {
-      ip_context_t *dev = get_ip_context_for_device(i);
-      oc_network_event_handler_mutex_lock();
-      refresh_endpoints_list(dev);
-      oc_network_event_handler_mutex_unlock();
-    }
-  }
-
-  return ret;
+  return 0;
 }
 
 static int
-recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
-         oc_endpoint_t *endpoint, bool multicast, oc_ipv6_addr_t *mcast_dest)
+parse_recv_msg(struct msghdr *msg, oc_endpoint_t *endpoint, bool multicast,
+               oc_ipv6_addr_t *mcast_dest)
 {
-  struct sockaddr_storage client;
-  struct iovec iovec[1];
-  struct msghdr msg;
-  char msg_control[CMSG_LEN(sizeof(struct sockaddr_storage))];
-
-  iovec[0].iov_base = recv_buf;
-  iovec[0].iov_len = (size_t)recv_buf_size;
-
-  msg.msg_name = &client;
-  msg.msg_namelen = sizeof(client);
-
-  msg.msg_iov = iovec;
-  msg.msg_iovlen = 1;
-
-  msg.msg_control = msg_control;
-  msg.msg_controllen = sizeof(msg_control);
-
-  msg.msg_flags = 0;
-
-  int ret = recvmsg(sock, &msg, 0);
-
-  if (ret < 0 || (msg.msg_flags & MSG_TRUNC) || (msg.msg_flags & MSG_CTRUNC)) {
-    OC_ERR("recvmsg returned with an error: %d", errno);
-    return -1;
-  }
-
   struct cmsghdr *cmsg;
-  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != 0; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+  for (cmsg = CMSG_FIRSTHDR(msg); cmsg != 0; cmsg = CMSG_NXTHDR(msg, cmsg)) {
     if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
-      if (msg.msg_namelen != sizeof(struct sockaddr_in6)) {
+      if (msg->msg_namelen != sizeof(struct sockaddr_in6)) {
         OC_ERR("ancillary data contains invalid source address");
         return -1;
       }
       /* Set source address of packet in endpoint structure */
-      struct sockaddr_in6 *c6 = (struct sockaddr_in6 *)&client;
+      struct sockaddr_in6 *c6 = (struct sockaddr_in6 *)msg->msg_name;
       memcpy(endpoint->addr.ipv6.address, c6->sin6_addr.s6_addr,
              sizeof(c6->sin6_addr.s6_addr));
       endpoint->addr.ipv6.scope = c6->sin6_scope_id;
@@ -723,12 +908,12 @@ recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
     }
 #ifdef OC_IPV4
     else if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_PKTINFO) {
-      if (msg.msg_namelen != sizeof(struct sockaddr_in)) {
+      if (msg->msg_namelen != sizeof(struct sockaddr_in)) {
         OC_ERR("ancillary data contains invalid source address");
         return -1;
       }
       struct in_pktinfo *pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
-      struct sockaddr_in *c4 = (struct sockaddr_in *)&client;
+      struct sockaddr_in *c4 = (struct sockaddr_in *)msg->msg_name;
       memcpy(endpoint->addr.ipv4.address, &c4->sin_addr.s_addr,
              sizeof(c4->sin_addr.s_addr));
       endpoint->addr.ipv4.port = ntohs(c4->sin_port);
@@ -743,6 +928,43 @@ recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
 #endif /* OC_IPV4 */
   }
 
+  return 0;
+}
+
+static int
+recv_msg(int sock, uint8_t *recv_buf, int recv_buf_size,
+         oc_endpoint_t *endpoint, bool multicast, oc_ipv6_addr_t *mcast_dest)
+{
+  struct sockaddr_storage client;
+  struct iovec iovec[1];
+  struct msghdr msg;
+  char msg_control[CMSG_LEN(sizeof(struct sockaddr_storage))];
+
+  iovec[0].iov_base = recv_buf;
+  iovec[0].iov_len = (size_t)recv_buf_size;
+
+  msg.msg_name = &client;
+  msg.msg_namelen = sizeof(client);
+
+  msg.msg_iov = iovec;
+  msg.msg_iovlen = 1;
+
+  msg.msg_control = msg_control;
+  msg.msg_controllen = sizeof(msg_control);
+
+  msg.msg_flags = 0;
+
+  int ret = recvmsg(sock, &msg, 0);
+
+  if (ret < 0 || (msg.msg_flags & MSG_TRUNC) || (msg.msg_flags & MSG_CTRUNC)) {
+    OC_ERR("recvmsg returned with an error: %d", errno);
+    return -1;
+  }
+
+  if (parse_recv_msg(&msg, endpoint, multicast, mcast_dest) < 0) {
+    return -1;
+  }
+
   return ret;
 }
 
@@ -851,12 +1073,113 @@ oc_udp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
   return ADAPTER_STATUS_NONE;
 }
 
-static void *
-network_event_thread(void *data)
+#ifdef OC_IO_URING
+enum {
+  URING_TAG_SHUTDOWN = 0,
+  URING_TAG_IFCHANGE,
+  URING_TAG_SERVER,
+  URING_TAG_MCAST,
+  URING_TAG_SECURE
+};
+
+static void
+uring_event_handler(ip_context_t *dev, uint32_t tag, struct msghdr *msg,
+                    const uint8_t *payload, size_t len)
 {
-  ip_context_t *dev = (ip_context_t *)data;
+  if (tag == URING_TAG_SHUTDOWN) {
+    char buf;
+    // write to pipe shall not block - so read the byte we wrote
+    if (read(dev->shutdown_pipe[0], &buf, 1) < 0) {
+      // intentionally left blank
+    }
+    return;
+  }
 
-  fd_set setfds;
+  if (tag == URING_TAG_IFCHANGE) {
+    if (process_interface_change_event() < 0) {
+      OC_WRN("caught errors while handling a network interface change");
+    }
+    return;
+  }
+
+  if (len > (size_t)OC_PDU_SIZE) {
+    OC_ERR("dropping oversized datagram of %zd bytes", len);
+    return;
+  }
+
+  oc_message_t *message = oc_allocate_message_with_size(len);
+  if (!message) {
+    return;
+  }
+  message->endpoint.device = dev->device;
+
+  if (parse_recv_msg(msg, &message->endpoint, tag == URING_TAG_MCAST,
+                     &message->mcast_dest) < 0) {
+    oc_message_unref(message);
+    return;
+  }
+  memcpy(message->data, payload, len);
+  message->length = len;
+
+  switch (tag) {
+  case URING_TAG_MCAST:
+    message->endpoint.flags = IPV6 | MULTICAST;
+    break;
+  case URING_TAG_SECURE:
+    message->endpoint.flags = IPV6 | SECURED;
+    message->encrypted = 1;
+    break;
+  default:
+    message->endpoint.flags = IPV6;
+    break;
+  }
+
+  //#ifdef OC_DEBUG
+  PRINT("Incoming message of size %zd bytes from ", message->length);
+  PRINTipaddr(message->endpoint);
+  PRINT("\n\n");
+  //#endif /* OC_DEBUG */
+
+  oc_network_event(message);
+}
+
+static void
+network_event_loop_uring(ip_context_t *dev)
+{
+  /* Monitor network interface changes on the platform from only the 0th logical
+   * device
+   */
+  if ((dev->device == 0 &&
+       oc_uring_add_poll_fd(dev, ifchange_sock, URING_TAG_IFCHANGE) < 0) ||
+      oc_uring_add_poll_fd(dev, dev->shutdown_pipe[0], URING_TAG_SHUTDOWN) <
+        0 ||
+      oc_uring_add_recv_socket(dev, dev->server_sock, URING_TAG_SERVER) < 0 ||
+      oc_uring_add_recv_socket(dev, dev->mcast_sock, URING_TAG_MCAST) < 0) {
+    OC_ERR("arming io_uring receive requests");
+    return;
+  }
+#ifdef OC_OSCORE
+  if (oc_uring_add_recv_socket(dev, dev->secure_sock, URING_TAG_SECURE) < 0) {
+    OC_ERR("arming io_uring receive requests");
+    return;
+  }
+#endif /* OC_OSCORE */
+
+  while (dev->terminate != 1) {
+    int timeout_ms = -1;
+    if (dev->device == 0) {
+      timeout_ms = process_pending_mcast_subscriptions();
+    }
+    if (oc_uring_wait(dev, uring_event_handler, timeout_ms) < 0) {
+      break;
+    }
+  }
+}
+#endif /* OC_IO_URING */
+
+static void
+init_rfds(ip_context_t *dev)
+{
   FD_ZERO(&dev->rfds);
   /* Monitor network interface changes on the platform from only the 0th logical
    * device
@@ -870,12 +1193,89 @@ network_event_thread(void *data)
 #ifdef OC_TCP
   oc_tcp_add_socks_to_fd_set(dev);
 #endif /* OC_TCP */
+}
+
+static void
+process_socket_events(ip_context_t *dev, fd_set *setfds, int n)
+{
+  int i;
+  for (i = 0; i < n; i++) {
+    if (dev->device == 0) {
+      if (FD_ISSET(ifchange_sock, setfds)) {
+        if (process_interface_change_event() < 0) {
+          OC_WRN("caught errors while handling a network interface change");
+        }
+        FD_CLR(ifchange_sock, setfds);
+        continue;
+      }
+    }
+
+    oc_message_t *message = oc_allocate_message();
+
+    if (!message) {
+      break;
+    }
+
+    message->endpoint.device = dev->device;
+
+    if (oc_udp_receive_message(dev, setfds, message) ==
+        ADAPTER_STATUS_RECEIVE) {
+      goto common;
+    }
+#ifdef OC_TCP
+    if (oc_tcp_receive_message(dev, setfds, message) ==
+        ADAPTER_STATUS_RECEIVE) {
+      goto common;
+    }
+#endif /* OC_TCP */
+
+    oc_message_unref(message);
+    continue;
+
+  common:
+    /* the packet was read into a full size buffer */
+    oc_message_shrink(message);
+    //#ifdef OC_DEBUG
+    PRINT("Incoming message of size %zd bytes from ", message->length);
+    PRINTipaddr(message->endpoint);
+    PRINT("\n\n");
+    //#endif /* OC_DEBUG */
+
+    oc_network_event(message);
+  }
+}
+
+static void *
+network_event_thread(void *data)
+{
+  ip_context_t *dev = (ip_context_t *)data;
+
+#ifdef OC_IO_URING
+  if (dev->uring) {
+    network_event_loop_uring(dev);
+    pthread_exit(NULL);
+    return NULL;
+  }
+#endif /* OC_IO_URING */
+
+  fd_set setfds;
+  init_rfds(dev);
 
-  int i, n;
+  int n;
 
   while (dev->terminate != 1) {
+    struct timeval timeout, *select_timeout = NULL;
+    if (dev->device == 0) {
+      int timeout_ms = process_pending_mcast_subscriptions();
+      if (timeout_ms >= 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+        select_timeout = &timeout;
+      }
+    }
+
     setfds = ip_context_rfds_fd_copy(dev);
-    n = select(FD_SETSIZE, &setfds, NULL, NULL, NULL);
+    n = select(FD_SETSIZE, &setfds, NULL, NULL, select_timeout);
 
     if (FD_ISSET(dev->shutdown_pipe[0], &setfds)) {
       char buf;
@@ -889,56 +1289,205 @@ network_event_thread(void *data)
       break;
     }
 
-    for (i = 0; i < n; i++) {
-      if (dev->device == 0) {
-        if (FD_ISSET(ifchange_sock, &setfds)) {
-          if (process_interface_change_event() < 0) {
-            OC_WRN("caught errors while handling a network interface change");
-          }
-          FD_CLR(ifchange_sock, &setfds);
-          continue;
-        }
-      }
+    process_socket_events(dev, &setfds, n);
+  }
+  pthread_exit(NULL);
+  return NULL;
+}
 
-      oc_message_t *message = oc_allocate_message();
+#ifdef OC_EXTERNAL_POLL
+/* Without network threads, the sockets of all devices are collected in one
+ * epoll instance, together with an eventfd for oc_signal_event_loop() and a
+ * timerfd for the next scheduled event. The host event loop waits on the
+ * epoll descriptor and calls oc_main_poll().
+ */
+#define POLL_MAX_EVENTS (16)
+#define POLL_DEVICE_NONE (UINT32_MAX)
 
-      if (!message) {
-        break;
-      }
+static int poll_epoll_fd = -1;
+static int poll_event_fd = -1;
+static int poll_timer_fd = -1;
+static int poll_signalled;
+static int poll_mcast_timeout_ms = -1;
 
-      message->endpoint.device = dev->device;
+static int
+poll_add_fd(uint32_t device, int fd)
+{
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = ((uint64_t)device << 32) | (uint32_t)fd;
+  return epoll_ctl(poll_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
 
-      if (oc_udp_receive_message(dev, &setfds, message) ==
-          ADAPTER_STATUS_RECEIVE) {
-        goto common;
-      }
-#ifdef OC_TCP
-      if (oc_tcp_receive_message(dev, &setfds, message) ==
-          ADAPTER_STATUS_RECEIVE) {
-        goto common;
+static void
+poll_close_fds(void)
+{
+  if (poll_timer_fd >= 0) {
+    close(poll_timer_fd);
+    poll_timer_fd = -1;
+  }
+  if (poll_event_fd >= 0) {
+    close(poll_event_fd);
+    poll_event_fd = -1;
+  }
+  if (poll_epoll_fd >= 0) {
+    close(poll_epoll_fd);
+    poll_epoll_fd = -1;
+  }
+  poll_signalled = 0;
+  poll_mcast_timeout_ms = -1;
+}
+
+static int
+poll_init_fds(void)
+{
+  if (poll_epoll_fd >= 0) {
+    return 0;
+  }
+  poll_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  poll_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  poll_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (poll_epoll_fd < 0 || poll_event_fd < 0 || poll_timer_fd < 0 ||
+      poll_add_fd(POLL_DEVICE_NONE, poll_event_fd) < 0 ||
+      poll_add_fd(POLL_DEVICE_NONE, poll_timer_fd) < 0) {
+    OC_ERR("creating poll file descriptors %d", errno);
+    poll_close_fds();
+    return -1;
+  }
+  return 0;
+}
+
+static int
+poll_add_device(ip_context_t *dev)
+{
+  if (poll_init_fds() < 0) {
+    return -1;
+  }
+  init_rfds(dev);
+  /* the shutdown pipe is only needed to wake up a network thread */
+  FD_CLR(dev->shutdown_pipe[0], &dev->rfds);
+  int fd;
+  for (fd = 0; fd < FD_SETSIZE; fd++) {
+    if (FD_ISSET(fd, &dev->rfds) && poll_add_fd((uint32_t)dev->device, fd) < 0) {
+      OC_ERR("adding socket to poll set %d", errno);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int
+oc_connectivity_get_poll_fd(void)
+{
+  return poll_epoll_fd;
+}
+
+void
+oc_connectivity_signal_poll_fd(void)
+{
+  if (poll_event_fd < 0) {
+    return;
+  }
+  /* one pending wakeup is enough, skip the system call for the others */
+  if (__atomic_exchange_n(&poll_signalled, 1, __ATOMIC_ACQ_REL) == 0) {
+    uint64_t one = 1;
+    if (write(poll_event_fd, &one, sizeof(one)) < 0) {
+      OC_WRN("cannot signal poll eventfd %d", errno);
+    }
+  }
+}
+
+void
+oc_connectivity_poll(void)
+{
+  if (poll_epoll_fd < 0) {
+    return;
+  }
+
+  uint64_t value;
+  __atomic_store_n(&poll_signalled, 0, __ATOMIC_RELEASE);
+  if (read(poll_event_fd, &value, sizeof(value)) < 0) {
+    // nothing signalled
+  }
+  if (read(poll_timer_fd, &value, sizeof(value)) < 0) {
+    // timer not expired
+  }
+
+  struct epoll_event events[POLL_MAX_EVENTS];
+  int i, n = epoll_wait(poll_epoll_fd, events, POLL_MAX_EVENTS, 0);
+
+  ip_context_t *dev = oc_list_head(ip_contexts);
+  while (dev != NULL) {
+    fd_set setfds;
+    int count = 0;
+    FD_ZERO(&setfds);
+    for (i = 0; i < n; i++) {
+      if ((uint32_t)(events[i].data.u64 >> 32) == (uint32_t)dev->device) {
+        FD_SET((int)(uint32_t)events[i].data.u64, &setfds);
+        count++;
       }
-#endif /* OC_TCP */
+    }
+    if (count > 0) {
+      process_socket_events(dev, &setfds, count);
+    }
+    dev = dev->next;
+  }
 
-      oc_message_unref(message);
-      continue;
+  poll_mcast_timeout_ms = process_pending_mcast_subscriptions();
+}
 
-    common:
-      //#ifdef OC_DEBUG
-      PRINT("Incoming message of size %zd bytes from ", message->length);
-      PRINTipaddr(message->endpoint);
-      PRINT("\n\n");
-      //#endif /* OC_DEBUG */
+void
+oc_connectivity_set_poll_timer(oc_clock_time_t next_event)
+{
+  if (poll_timer_fd < 0) {
+    return;
+  }
 
-      oc_network_event(message);
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  bool armed = false;
+  if (next_event != 0) {
+    oc_clock_time_t now = oc_clock_time();
+    oc_clock_time_t ticks = (next_event > now) ? next_event - now : 0;
+    its.it_value.tv_sec = (time_t)(ticks / OC_CLOCK_SECOND);
+    its.it_value.tv_nsec =
+      (long)((ticks % OC_CLOCK_SECOND) * (1000000000 / OC_CLOCK_SECOND));
+    armed = true;
+  }
+  if (poll_mcast_timeout_ms >= 0) {
+    struct timespec mcast = { poll_mcast_timeout_ms / 1000,
+                              (poll_mcast_timeout_ms % 1000) * 1000000L };
+    if (!armed || mcast.tv_sec < its.it_value.tv_sec ||
+        (mcast.tv_sec == its.it_value.tv_sec &&
+         mcast.tv_nsec < its.it_value.tv_nsec)) {
+      its.it_value = mcast;
     }
+    armed = true;
+  }
+  if (armed && its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+    /* already due, a zero value would disarm the timer */
+    its.it_value.tv_nsec = 1;
+  }
+  if (timerfd_settime(poll_timer_fd, 0, &its, NULL) < 0) {
+    OC_WRN("arming poll timer %d", errno);
   }
-  pthread_exit(NULL);
-  return NULL;
 }
+#endif /* OC_EXTERNAL_POLL */
 
 static int
-send_msg(int sock, struct sockaddr_storage *receiver, oc_message_t *message)
+send_msg(ip_context_t *dev, int sock, struct sockaddr_storage *receiver,
+         oc_message_t *message)
 {
+#ifdef OC_IO_URING
+  /* queued sends hold a reference until completion, which needs a pool */
+  if (dev->uring && message->pool) {
+    return oc_uring_send_msg(dev, sock, receiver, message);
+  }
+#else  /* OC_IO_URING */
+  (void)dev;
+#endif /* !OC_IO_URING */
+
   char msg_control[CMSG_LEN(sizeof(struct sockaddr_storage))];
   struct iovec iovec[1];
   struct msghdr msg;
@@ -1090,13 +1639,16 @@ oc_send_buffer(oc_message_t *message)
   }
 #endif /* !OC_IPV4 */
 
-  return send_msg(send_sock, &receiver, message);
+  return send_msg(dev, send_sock, &receiver, message);
 }
 
 void
 oc_send_discovery_request(oc_message_t *message)
 {
   struct ifaddrs *ifs = NULL, *iface = NULL;
+#ifdef OC_IO_URING
+  ip_context_t *batch_dev = NULL;
+#endif /* OC_IO_URING */
   if (getifaddrs(&ifs) < 0) {
     OC_ERR("querying interfaces: %d", errno);
     goto done;
@@ -1111,6 +1663,14 @@ oc_send_discovery_request(oc_message_t *message)
 #define IN6_IS_ADDR_MC_REALM_LOCAL(addr)                                       \
   IN6_IS_ADDR_MULTICAST(addr) && ((((const uint8_t *)(addr))[1] & 0x0f) == 0x03)
 
+#ifdef OC_IO_URING
+  /* submit the copies for all interfaces with a single system call */
+  if (dev && dev->uring) {
+    batch_dev = dev;
+    oc_uring_send_batch_begin(batch_dev);
+  }
+#endif /* OC_IO_URING */
+
   for (iface = ifs; iface != NULL; iface = iface->ifa_next) {
     if (!(iface->ifa_flags & IFF_UP) || (iface->ifa_flags & IFF_LOOPBACK))
       continue;
@@ -1162,6 +1722,11 @@ oc_send_discovery_request(oc_message_t *message)
 #endif /* !OC_IPV4 */
   }
 done:
+#ifdef OC_IO_URING
+  if (batch_dev) {
+    oc_uring_send_batch_end(batch_dev);
+  }
+#endif /* OC_IO_URING */
 #undef IN6_IS_ADDR_MC_REALM_LOCAL
   freeifaddrs(ifs);
 }
@@ -1596,11 +2161,23 @@ oc_connectivity_init(size_t device)
     ifchange_initialized = true;
   }
 
+#ifdef OC_IO_URING
+  if (oc_uring_connectivity_init(dev) != 0) {
+    OC_WRN("io_uring not available, falling back to select()");
+  }
+#endif /* OC_IO_URING */
+
+#ifdef OC_EXTERNAL_POLL
+  if (poll_add_device(dev) < 0) {
+    return -1;
+  }
+#else  /* OC_EXTERNAL_POLL */
   if (pthread_create(&dev->event_thread, NULL, &network_event_thread, dev) !=
       0) {
     OC_ERR("creating network polling thread");
     return -1;
   }
+#endif /* !OC_EXTERNAL_POLL */
 
   oc_add_network_interface_event_callback(register_multicasts);
   OC_DBG("Successfully initialized connectivity for device %zd", device);
@@ -1612,12 +2189,23 @@ void
 oc_connectivity_shutdown(size_t device)
 {
   ip_context_t *dev = get_ip_context_for_device(device);
+#ifndef OC_EXTERNAL_POLL
   dev->terminate = 1;
   if (write(dev->shutdown_pipe[1], "\n", 1) < 0) {
     OC_WRN("cannot wakeup network thread");
   }
 
   pthread_join(dev->event_thread, NULL);
+#endif /* !OC_EXTERNAL_POLL */
+
+  if (device == 0) {
+    num_pending_mcast = 0;
+    pending_mcast_overflow = false;
+  }
+
+#ifdef OC_IO_URING
+  oc_uring_connectivity_shutdown(dev);
+#endif /* OC_IO_URING */
 
   close(dev->server_sock);
   close(dev->mcast_sock);
@@ -1649,6 +2237,12 @@ oc_connectivity_shutdown(size_t device)
   oc_list_remove(ip_contexts, dev);
   oc_memb_free(&ip_context_s, dev);
 
+#ifdef OC_EXTERNAL_POLL
+  if (oc_list_length(ip_contexts) == 0) {
+    poll_close_fds();
+  }
+#endif /* OC_EXTERNAL_POLL */
+
   OC_DBG("oc_connectivity_shutdown for device %zd", device);
 }
 
@@ -1815,6 +2409,11 @@ ip_context_rfds_fd_set(ip_context_t *dev, int sockfd)
   pthread_mutex_lock(&dev->rfds_mutex);
   FD_SET(sockfd, &dev->rfds);
   pthread_mutex_unlock(&dev->rfds_mutex);
+#ifdef OC_EXTERNAL_POLL
+  if (poll_epoll_fd >= 0) {
+    poll_add_fd((uint32_t)dev->device, sockfd);
+  }
+#endif /* OC_EXTERNAL_POLL */
 }
 
 void
@@ -1823,6 +2422,11 @@ ip_context_rfds_fd_clr(ip_context_t *dev, int sockfd)
   pthread_mutex_lock(&dev->rfds_mutex);
   FD_CLR(sockfd, &dev->rfds);
   pthread_mutex_unlock(&dev->rfds_mutex);
+#ifdef OC_EXTERNAL_POLL
+  if (poll_epoll_fd >= 0) {
+    epoll_ctl(poll_epoll_fd, EPOLL_CTL_DEL, sockfd, NULL);
+  }
+#endif /* OC_EXTERNAL_POLL */
 }
 
 fd_set
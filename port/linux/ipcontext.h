@@ -100,6 +100,9 @@ typedef struct ip_context_t
   pthread_mutex_t rfds_mutex;
   fd_set rfds;
   int shutdown_pipe[2];
+#ifdef OC_IO_URING
+  struct oc_uring_context_t *uring;
+#endif /* OC_IO_URING */
 } ip_context_t;
 
 /**
@@ -27,7 +27,13 @@ extern "C" {
 #endif
 
 typedef uint64_t oc_clock_time_t;
+/* Tick rate of oc_clock_time(), at most 1000000000 */
+#ifndef OC_CLOCK_CONF_TICKS_PER_SECOND
 #define OC_CLOCK_CONF_TICKS_PER_SECOND CLOCKS_PER_SEC
+#endif /* OC_CLOCK_CONF_TICKS_PER_SECOND */
+/* Read the coarse monotonic clock, which is cheaper but only has the
+ * resolution of the kernel tick */
+// #define OC_CLOCK_MONOTONIC_COARSE
 
 /* Security Layer */
 /* Max inactivity timeout before tearing down DTLS connection */
@@ -105,6 +111,14 @@ typedef uint64_t oc_clock_time_t;
 /* Maximum number of interfaces for IP adapter */
 #define OC_MAX_IP_INTERFACES (3)
 
+/* Time to collect network interface changes before rejoining multicast
+ * groups, in milliseconds */
+#define OC_IFCHANGE_DEBOUNCE_MS (200)
+
+/* Maximum number of interfaces tracked for multicast rejoining, more changes
+ * within one debounce window rejoin on all interfaces */
+#define OC_IFCHANGE_MAX_PENDING (16)
+
 /* Maximum number of callbacks for Network interface event monitoring */
 #define OC_MAX_NETWORK_INTERFACE_CBS (4)
 
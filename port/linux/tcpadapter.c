@@ -35,6 +35,7 @@
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <stdlib.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #ifdef OC_TCP
@@ -43,20 +44,39 @@
 
 #define TLS_HEADER_SIZE 5
 
-#define DEFAULT_RECEIVE_SIZE                                                   \
-  (COAP_TCP_DEFAULT_HEADER_LEN + COAP_TCP_MAX_EXTENDED_LENGTH_LEN)
-
 #define LIMIT_RETRY_CONNECT 5
 
 #define TCP_CONNECT_TIMEOUT 5
 
+/* Number of hash buckets for the endpoint lookup of sessions, power of 2 */
+#ifndef OC_TCP_SESSION_HASH_SIZE
+#define OC_TCP_SESSION_HASH_SIZE (64)
+#endif /* OC_TCP_SESSION_HASH_SIZE */
+
+/* Maximum number of messages coalesced into one writev() per session */
+#ifndef OC_TCP_MAX_TX_QUEUE
+#define OC_TCP_MAX_TX_QUEUE (16)
+#endif /* OC_TCP_MAX_TX_QUEUE */
+
+/* The largest frame accepted on a session */
+#define MAX_FRAME_SIZE ((size_t)(OC_MAX_APP_DATA_SIZE + COAP_MAX_HEADER_SIZE))
+
 typedef struct tcp_session
 {
   struct tcp_session *next;
+  struct tcp_session *hash_next;
   ip_context_t *dev;
   oc_endpoint_t endpoint;
   int sock;
+  bool hashed;
   tcp_csm_state_t csm_state;
+  /* received bytes not yet framed into messages */
+  uint8_t *rx_buf;
+  size_t rx_len;
+  size_t rx_size;
+  /* messages waiting to be written by the network thread */
+  oc_message_t *tx_queue[OC_TCP_MAX_TX_QUEUE];
+  size_t tx_count;
 } tcp_session_t;
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -64,8 +84,79 @@ OC_LIST(session_list);
 OC_LIST(free_session_list_async);
 OC_MEMB(tcp_session_s, tcp_session_t, OC_MAX_TCP_PEERS);
 
+/* sessions hashed by remote endpoint, and indexed by socket */
+static tcp_session_t *session_buckets[OC_TCP_SESSION_HASH_SIZE];
+static tcp_session_t *session_by_sock[FD_SETSIZE];
+
 static void signal_network_thread(ip_context_t *dev);
 
+static unsigned
+endpoint_hash(const oc_endpoint_t *endpoint)
+{
+  /* FNV-1a over the fields compared by oc_endpoint_compare() */
+  uint32_t hash = 2166136261u;
+  const uint8_t *addr = endpoint->addr.ipv6.address;
+  size_t i, len = 16;
+  uint16_t port = endpoint->addr.ipv6.port;
+#ifdef OC_IPV4
+  if (endpoint->flags & IPV4) {
+    addr = endpoint->addr.ipv4.address;
+    len = 4;
+    port = endpoint->addr.ipv4.port;
+  }
+#endif /* OC_IPV4 */
+  for (i = 0; i < len; i++) {
+    hash = (hash ^ addr[i]) * 16777619u;
+  }
+  hash = (hash ^ (port & 0xff)) * 16777619u;
+  hash = (hash ^ (port >> 8)) * 16777619u;
+  hash = (hash ^ (uint32_t)endpoint->device) * 16777619u;
+  return hash & (OC_TCP_SESSION_HASH_SIZE - 1);
+}
+
+static void
+hash_session(tcp_session_t *session)
+{
+  unsigned bucket = endpoint_hash(&session->endpoint);
+  session->hash_next = session_buckets[bucket];
+  session_buckets[bucket] = session;
+  if (session->sock >= 0 && session->sock < FD_SETSIZE) {
+    session_by_sock[session->sock] = session;
+  }
+  session->hashed = true;
+}
+
+static void
+unhash_session(tcp_session_t *session)
+{
+  if (!session->hashed) {
+    return;
+  }
+  tcp_session_t **p = &session_buckets[endpoint_hash(&session->endpoint)];
+  while (*p != NULL && *p != session) {
+    p = &(*p)->hash_next;
+  }
+  if (*p) {
+    *p = session->hash_next;
+  }
+  session->hash_next = NULL;
+  if (session->sock >= 0 && session->sock < FD_SETSIZE &&
+      session_by_sock[session->sock] == session) {
+    session_by_sock[session->sock] = NULL;
+  }
+  session->hashed = false;
+}
+
+static void
+drop_tx_queue(tcp_session_t *session)
+{
+  size_t i;
+  for (i = 0; i < session->tx_count; i++) {
+    oc_message_unref(session->tx_queue[i]);
+  }
+  session->tx_count = 0;
+}
+
 static int
 configure_tcp_socket(int sock, struct sockaddr_storage *sock_info)
 {
@@ -163,6 +254,7 @@ static void
 free_tcp_session_async_locked(tcp_session_t *session)
 {
   oc_list_remove(session_list, session);
+  unhash_session(session);
   oc_list_add(free_session_list_async, session);
 
   signal_network_thread(session->dev);
@@ -176,6 +268,9 @@ free_tcp_session(tcp_session_t *session)
 {
   oc_list_remove(session_list, session);
   oc_list_remove(free_session_list_async, session);
+  unhash_session(session);
+  drop_tx_queue(session);
+  free(session->rx_buf);
 
   if (!oc_session_events_is_ongoing()) {
     oc_session_end_event(&session->endpoint);
@@ -212,11 +307,25 @@ static int
 add_new_session(int sock, ip_context_t *dev, oc_endpoint_t *endpoint,
                 tcp_csm_state_t state)
 {
+  if (sock >= FD_SETSIZE) {
+    OC_ERR("TCP session socket %d cannot be monitored", sock);
+    return -1;
+  }
   tcp_session_t *session = oc_memb_alloc(&tcp_session_s);
   if (!session) {
     OC_ERR("could not allocate new TCP session object");
     return -1;
   }
+  /* room for a full frame plus the start of the next pipelined one */
+  session->rx_size = 2 * MAX_FRAME_SIZE;
+  session->rx_buf = (uint8_t *)malloc(session->rx_size);
+  if (!session->rx_buf) {
+    OC_ERR("could not allocate TCP session receive buffer");
+    oc_memb_free(&tcp_session_s, session);
+    return -1;
+  }
+  session->rx_len = 0;
+  session->tx_count = 0;
 
   endpoint->interface_index = get_interface_index(sock);
 
@@ -227,6 +336,7 @@ add_new_session(int sock, ip_context_t *dev, oc_endpoint_t *endpoint,
   session->csm_state = state;
 
   oc_list_add(session_list, session);
+  hash_session(session);
 
   if (!(endpoint->flags & SECURED)) {
     oc_session_start_event((oc_endpoint_t *)endpoint);
@@ -282,10 +392,10 @@ accept_new_session(ip_context_t *dev, int fd, fd_set *setfds,
 static tcp_session_t *
 find_session_by_endpoint(oc_endpoint_t *endpoint)
 {
-  tcp_session_t *session = oc_list_head(session_list);
+  tcp_session_t *session = session_buckets[endpoint_hash(endpoint)];
   while (session != NULL &&
          oc_endpoint_compare(&session->endpoint, endpoint) != 0) {
-    session = session->next;
+    session = session->hash_next;
   }
 
   if (!session) {
@@ -307,33 +417,185 @@ find_session_by_endpoint(oc_endpoint_t *endpoint)
 static tcp_session_t *
 get_ready_to_read_session(fd_set *setfds)
 {
-  tcp_session_t *session = oc_list_head(session_list);
-  while (session != NULL && !FD_ISSET(session->sock, setfds)) {
-    session = session->next;
+  /* walk the set bits of the fd_set a word at a time */
+  const unsigned long *words = (const unsigned long *)setfds;
+  const int bits = (int)(8 * sizeof(unsigned long));
+  size_t i;
+  for (i = 0; i < sizeof(fd_set) / sizeof(unsigned long); i++) {
+    unsigned long word = words[i];
+    while (word != 0) {
+      int fd = (int)i * bits + __builtin_ctzl(word);
+      if (fd < FD_SETSIZE && session_by_sock[fd] != NULL) {
+        return session_by_sock[fd];
+      }
+      word &= word - 1;
+    }
   }
 
-  if (!session) {
-    OC_ERR("could not find any open ready-to-read session");
-    return NULL;
+  OC_ERR("could not find any open ready-to-read session");
+  return NULL;
+}
+
+/* Number of bytes needed before the length of a frame is known */
+static size_t
+get_header_length(const uint8_t *data, oc_endpoint_t *endpoint)
+{
+  if (endpoint->flags & SECURED) {
+    return TLS_HEADER_SIZE;
+  }
+  switch (data[0] >> 4) {
+  case 13:
+    return 2;
+  case 14:
+    return 3;
+  case 15:
+    return 5;
+  default:
+    return 1;
   }
-  return session;
 }
 
 static size_t
-get_total_length_from_header(oc_message_t *message, oc_endpoint_t *endpoint)
+get_total_length_from_header(const uint8_t *data, oc_endpoint_t *endpoint)
 {
   size_t total_length = 0;
   if (endpoint->flags & SECURED) {
     //[3][4] bytes in tls header are tls payload length
-    total_length =
-      TLS_HEADER_SIZE + (size_t)((message->data[3] << 8) | message->data[4]);
+    total_length = TLS_HEADER_SIZE + (size_t)((data[3] << 8) | data[4]);
   } else {
-    total_length = coap_tcp_get_packet_size(message->data);
+    total_length = coap_tcp_get_packet_size(data);
   }
 
   return total_length;
 }
 
+static void
+copy_frame(tcp_session_t *session, const uint8_t *data, size_t len,
+           oc_message_t *message)
+{
+  memcpy(message->data, data, len);
+  message->length = len;
+  memcpy(&message->endpoint, &session->endpoint, sizeof(oc_endpoint_t));
+  if (message->endpoint.flags & SECURED) {
+    message->encrypted = 1;
+  }
+}
+
+/* Split the receive buffer into complete frames. All but the last frame are
+ * handed to the stack directly, the last one is copied into message so the
+ * caller delivers it, which keeps the order. Returns the number of frames,
+ * or -1 if the peer announced an oversized frame.
+ */
+static int
+frame_messages(tcp_session_t *session, oc_message_t *message)
+{
+  size_t offset = 0, prev_offset = 0, prev_len = 0;
+  int frames = 0;
+
+  while (session->rx_len - offset > 0) {
+    const uint8_t *data = session->rx_buf + offset;
+    size_t avail = session->rx_len - offset;
+    if (avail < get_header_length(data, &session->endpoint)) {
+      break;
+    }
+    size_t total_length =
+      get_total_length_from_header(data, &session->endpoint);
+    if (total_length > MAX_FRAME_SIZE) {
+      OC_ERR("total receive length(%zd) is bigger than max pdu size(%zd)",
+             total_length, MAX_FRAME_SIZE);
+      return -1;
+    }
+    if (avail < total_length) {
+      break;
+    }
+    if (frames > 0) {
+      oc_message_t *prev = oc_allocate_message();
+      if (prev) {
+        copy_frame(session, session->rx_buf + prev_offset, prev_len, prev);
+        oc_network_event(prev);
+      } else {
+        OC_WRN("dropping TCP frame, out of message buffers");
+      }
+    }
+    prev_offset = offset;
+    prev_len = total_length;
+    offset += total_length;
+    frames++;
+  }
+
+  if (frames > 0) {
+    copy_frame(session, session->rx_buf + prev_offset, prev_len, message);
+  }
+  if (offset > 0) {
+    session->rx_len -= offset;
+    memmove(session->rx_buf, session->rx_buf + offset, session->rx_len);
+  }
+  return frames;
+}
+
+/* Write all queued messages of a session with as few sendmsg() calls as
+ * possible. Called with the mutex held, which serializes writers. The
+ * senders of queued messages were already told they were sent, so a failed
+ * write ends the session.
+ */
+static int
+flush_session_locked(tcp_session_t *session)
+{
+  struct iovec iov[OC_TCP_MAX_TX_QUEUE];
+  size_t i, first = 0, count = session->tx_count;
+  int ret = 0;
+
+  for (i = 0; i < count; i++) {
+    iov[i].iov_base = session->tx_queue[i]->data;
+    iov[i].iov_len = session->tx_queue[i]->length;
+  }
+
+  while (first < count) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov[first];
+    msg.msg_iovlen = count - first;
+    /* no SIGPIPE when the peer closed the session */
+    ssize_t sent = sendmsg(session->sock, &msg, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      OC_ERR("sendmsg() returned errno %d, closing TCP session", errno);
+      free_tcp_session_async_locked(session);
+      ret = -1;
+      break;
+    }
+    OC_DBG("Sent %zd bytes", sent);
+    /* skip what was written, a partial write resumes mid-message */
+    while (first < count && (size_t)sent >= iov[first].iov_len) {
+      sent -= (ssize_t)iov[first].iov_len;
+      first++;
+    }
+    if (first < count) {
+      iov[first].iov_base = (uint8_t *)iov[first].iov_base + sent;
+      iov[first].iov_len -= (size_t)sent;
+    }
+  }
+
+  drop_tx_queue(session);
+  return ret;
+}
+
+static void
+flush_sessions_locked(ip_context_t *dev)
+{
+  tcp_session_t *session = oc_list_head(session_list);
+  while (session != NULL) {
+    /* a failed flush moves the session off the list */
+    tcp_session_t *next = session->next;
+    if (session->dev == dev && session->tx_count > 0) {
+      flush_session_locked(session);
+    }
+    session = next;
+  }
+}
+
 adapter_receive_state_t
 oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
 {
@@ -391,6 +653,7 @@ oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
       ret_with_code(ADAPTER_STATUS_ERROR);
     }
     FD_CLR(dev->tcp.connect_pipe[0], fds);
+    flush_sessions_locked(dev);
     ret_with_code(ADAPTER_STATUS_NONE);
   }
 
@@ -400,55 +663,35 @@ oc_tcp_receive_message(ip_context_t *dev, fd_set *fds, oc_message_t *message)
     OC_DBG("could not find TCP session socket in fd set");
     ret_with_code(ADAPTER_STATUS_NONE);
   }
+  FD_CLR(session->sock, fds);
 
-  // receive message.
-  size_t total_length = 0;
-  size_t want_read = DEFAULT_RECEIVE_SIZE;
-  message->length = 0;
-  do {
-    int count =
-      recv(session->sock, message->data + message->length, want_read, 0);
-    if (count < 0) {
-      OC_ERR("recv error! %d", errno);
-
-      free_tcp_session(session);
-
-      ret_with_code(ADAPTER_STATUS_ERROR);
-    } else if (count == 0) {
-      OC_DBG("peer closed TCP session\n");
+  // receive whatever is available, possibly several pipelined messages.
+  ssize_t count = recv(session->sock, session->rx_buf + session->rx_len,
+                       session->rx_size - session->rx_len, 0);
+  if (count < 0) {
+    OC_ERR("recv error! %d", errno);
 
-      free_tcp_session(session);
+    free_tcp_session(session);
 
-      ret_with_code(ADAPTER_STATUS_NONE);
-    }
+    ret_with_code(ADAPTER_STATUS_ERROR);
+  } else if (count == 0) {
+    OC_DBG("peer closed TCP session\n");
 
-    OC_DBG("recv(): %d bytes.", count);
-    message->length += (size_t)count;
-    want_read -= (size_t)count;
-
-    if (total_length == 0) {
-      total_length = get_total_length_from_header(message, &session->endpoint);
-      if (total_length >
-          (unsigned)(OC_MAX_APP_DATA_SIZE + COAP_MAX_HEADER_SIZE)) {
-        OC_ERR("total receive length(%ld) is bigger than max pdu size(%ld)",
-               total_length, (OC_MAX_APP_DATA_SIZE + COAP_MAX_HEADER_SIZE));
-        OC_ERR("It may occur buffer overflow.");
-        ret_with_code(ADAPTER_STATUS_ERROR);
-      }
-      OC_DBG("tcp packet total length : %ld bytes.", total_length);
+    free_tcp_session(session);
 
-      want_read = total_length - (size_t)count;
-    }
-  } while (total_length > message->length);
+    ret_with_code(ADAPTER_STATUS_NONE);
+  }
 
-  memcpy(&message->endpoint, &session->endpoint, sizeof(oc_endpoint_t));
+  OC_DBG("recv(): %zd bytes.", count);
+  session->rx_len += (size_t)count;
 
-  if (message->endpoint.flags & SECURED) {
-    message->encrypted = 1;
+  int frames = frame_messages(session, message);
+  if (frames < 0) {
+    OC_ERR("It may occur buffer overflow.");
+    free_tcp_session(session);
+    ret_with_code(ADAPTER_STATUS_ERROR);
   }
-
-  FD_CLR(session->sock, fds);
-  ret = ADAPTER_STATUS_RECEIVE;
+  ret = (frames > 0) ? ADAPTER_STATUS_RECEIVE : ADAPTER_STATUS_NONE;
 
 oc_tcp_receive_message_done:
   pthread_mutex_unlock(&mutex);
@@ -468,19 +711,6 @@ oc_tcp_end_session(ip_context_t *dev, oc_endpoint_t *endpoint)
   pthread_mutex_unlock(&mutex);
 }
 
-static int
-get_session_socket(oc_endpoint_t *endpoint)
-{
-  int sock = -1;
-  tcp_session_t *session = find_session_by_endpoint(endpoint);
-  if (!session) {
-    return -1;
-  }
-
-  sock = session->sock;
-  return sock;
-}
-
 static int
 connect_nonb(int sockfd, const struct sockaddr *r, int r_len, int nsec)
 {
@@ -613,28 +843,47 @@ oc_tcp_send_buffer(ip_context_t *dev, oc_message_t *message,
                    const struct sockaddr_storage *receiver)
 {
   pthread_mutex_lock(&mutex);
-  int send_sock = get_session_socket(&message->endpoint);
+  tcp_session_t *session = find_session_by_endpoint(&message->endpoint);
 
   size_t bytes_sent = 0;
-  if (send_sock < 0) {
+  if (!session) {
     if (message->endpoint.flags & ACCEPTED) {
       OC_ERR("connection was closed");
       goto oc_tcp_send_buffer_done;
     }
-    if ((send_sock = initiate_new_session(dev, &message->endpoint, receiver)) <
-        0) {
+    if (initiate_new_session(dev, &message->endpoint, receiver) < 0) {
       OC_ERR("could not initiate new TCP session");
       goto oc_tcp_send_buffer_done;
     }
+    session = find_session_by_endpoint(&message->endpoint);
+    if (!session) {
+      goto oc_tcp_send_buffer_done;
+    }
   }
 
-  send_sock = get_session_socket(&message->endpoint);
-  if (send_sock < 0) {
+  if (message->pool) {
+    /* queue for the network thread, which coalesces all messages queued
+     * until it runs into one writev() */
+    if (session->tx_count == OC_TCP_MAX_TX_QUEUE &&
+        flush_session_locked(session) < 0) {
+      goto oc_tcp_send_buffer_done;
+    }
+    oc_message_add_ref(message);
+    session->tx_queue[session->tx_count++] = message;
+    if (session->tx_count == 1) {
+      signal_network_thread(dev);
+    }
+    bytes_sent = message->length;
     goto oc_tcp_send_buffer_done;
   }
 
+  /* messages outside a pool cannot be referenced, send them right away after
+   * whatever is queued */
+  if (session->tx_count > 0 && flush_session_locked(session) < 0) {
+    goto oc_tcp_send_buffer_done;
+  }
   do {
-    ssize_t send_len = send(send_sock, message->data + bytes_sent,
+    ssize_t send_len = send(session->sock, message->data + bytes_sent,
                             message->length - bytes_sent, MSG_NOSIGNAL);
     if (send_len < 0) {
       OC_WRN("send() returned errno %d", errno);
@@ -0,0 +1,801 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "uringadapter.h"
+#include "ipadapter.h"
+#include "oc_buffer.h"
+#include "port/oc_log.h"
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef OC_IO_URING
+
+#ifdef OC_TCP
+#error "OC_IO_URING does not support OC_TCP, use the select() based backend"
+#endif /* OC_TCP */
+
+/* depth of the receive ring: recv sockets + poll fds, with headroom for
+ * re-arming */
+#define URING_RECV_ENTRIES (16)
+
+/* buffer group id of the provided receive buffers */
+#define URING_RECV_BGID (0)
+
+/* same sizes as used by recv_msg() / send_msg() in ipadapter.c */
+#define URING_RECV_CONTROL_LEN CMSG_LEN(sizeof(struct sockaddr_storage))
+#define URING_SEND_CONTROL_LEN                                                 \
+  (CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int)))
+
+/* user_data layout: low 32 bits carry the tag, bit 32 marks poll requests */
+#define URING_UD_POLL (1ULL << 32)
+
+/* user_data of the multishot probe at init, no socket is armed yet */
+#define URING_UD_PROBE (0xffffffffULL)
+#define URING_UD_PROBE_CANCEL (URING_UD_POLL | URING_UD_PROBE)
+
+/* free_slots is a 32 bit mask indexed by slot */
+_Static_assert(OC_URING_SEND_SLOTS <= 32,
+               "OC_URING_SEND_SLOTS must fit the free_slots bit mask");
+
+typedef struct
+{
+  int fd;
+  unsigned entries;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr;
+  size_t sq_size;
+  void *cq_ptr;
+  size_t cq_size;
+  size_t sqes_size;
+  unsigned pending;
+} uring_t;
+
+typedef struct
+{
+  oc_message_t *message;
+  struct sockaddr_storage receiver;
+  struct iovec iov;
+  struct msghdr msg;
+  uint8_t control[URING_SEND_CONTROL_LEN];
+} uring_send_slot_t;
+
+struct oc_uring_context_t
+{
+  /* owned by the network thread */
+  uring_t recv;
+  struct io_uring_buf_ring *buf_ring;
+  size_t buf_ring_size;
+  uint8_t *bufs;
+  size_t buf_size;
+  struct msghdr recv_msg;
+  int recv_fds[URING_RECV_ENTRIES];
+  uint32_t recv_tags[URING_RECV_ENTRIES];
+  int num_recv_fds;
+  /* owned by the sending thread(s), serialized by send_mutex */
+  uring_t send;
+  pthread_mutex_t send_mutex;
+  uring_send_slot_t slots[OC_URING_SEND_SLOTS];
+  uint32_t free_slots;
+  bool batching;
+  struct io_uring_sqe *last_sqe;
+};
+
+static int
+sys_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+sys_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                unsigned flags, void *arg, size_t argsz)
+{
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      arg, argsz);
+}
+
+static int
+sys_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void
+uring_free(uring_t *ring)
+{
+  if (ring->sqes) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) {
+    munmap(ring->cq_ptr, ring->cq_size);
+  }
+  if (ring->sq_ptr) {
+    munmap(ring->sq_ptr, ring->sq_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+static int
+uring_init(uring_t *ring, unsigned entries)
+{
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  memset(ring, 0, sizeof(*ring));
+
+  ring->fd = sys_uring_setup(entries, &p);
+  if (ring->fd < 0) {
+    OC_WRN("io_uring_setup failed %d", errno);
+    ring->fd = -1;
+    return -1;
+  }
+
+  ring->entries = p.sq_entries;
+  ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_size > ring->sq_size) {
+      ring->sq_size = ring->cq_size;
+    }
+    ring->cq_size = ring->sq_size;
+  }
+
+  ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ptr == MAP_FAILED) {
+    ring->sq_ptr = NULL;
+    goto error;
+  }
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ptr = ring->sq_ptr;
+  } else {
+    ring->cq_ptr =
+      mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED) {
+      ring->cq_ptr = NULL;
+      goto error;
+    }
+  }
+  ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    goto error;
+  }
+
+  uint8_t *sq = (uint8_t *)ring->sq_ptr;
+  uint8_t *cq = (uint8_t *)ring->cq_ptr;
+  ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+  ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  return 0;
+
+error:
+  OC_WRN("mapping io_uring failed %d", errno);
+  uring_free(ring);
+  return -1;
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(uring_t *ring)
+{
+  unsigned tail = *ring->sq_tail;
+  unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  if (tail - head >= ring->entries) {
+    return NULL;
+  }
+  unsigned index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ring->pending++;
+  return sqe;
+}
+
+static int
+uring_submit_timeout(uring_t *ring, unsigned min_complete, int timeout_ms)
+{
+  unsigned flags = (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0;
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  void *argp = NULL;
+  size_t argsz = 0;
+  if (ring->pending == 0 && min_complete == 0) {
+    return 0;
+  }
+  if (min_complete > 0 && timeout_ms >= 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+    argp = &arg;
+    argsz = sizeof(arg);
+    flags |= IORING_ENTER_EXT_ARG;
+  }
+  int ret;
+  do {
+    ret = sys_uring_enter(ring->fd, ring->pending, min_complete, flags, argp,
+                          argsz);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    return (errno == ETIME) ? 0 : -1;
+  }
+  ring->pending -= ((unsigned)ret < ring->pending) ? (unsigned)ret
+                                                   : ring->pending;
+  return 0;
+}
+
+static int
+uring_submit(uring_t *ring, unsigned min_complete)
+{
+  return uring_submit_timeout(ring, min_complete, -1);
+}
+
+/* --------------------------- receive side ------------------------------- */
+
+static uint8_t *
+recv_buffer(struct oc_uring_context_t *ctx, unsigned bid)
+{
+  return ctx->bufs + (size_t)bid * ctx->buf_size;
+}
+
+static void
+recycle_recv_buffer(struct oc_uring_context_t *ctx, unsigned bid)
+{
+  unsigned short tail = ctx->buf_ring->tail;
+  struct io_uring_buf *buf =
+    &ctx->buf_ring->bufs[tail & (OC_URING_RECV_BUFFERS - 1)];
+  buf->addr = (uint64_t)(uintptr_t)recv_buffer(ctx, bid);
+  buf->len = (uint32_t)ctx->buf_size;
+  buf->bid = (uint16_t)bid;
+  __atomic_store_n(&ctx->buf_ring->tail, (unsigned short)(tail + 1),
+                   __ATOMIC_RELEASE);
+}
+
+static int
+setup_recv_buffers(struct oc_uring_context_t *ctx)
+{
+  ctx->buf_size = sizeof(struct io_uring_recvmsg_out) +
+                  sizeof(struct sockaddr_storage) + URING_RECV_CONTROL_LEN +
+                  (size_t)OC_PDU_SIZE;
+  /* keep every buffer aligned for the cmsghdr inside it */
+  ctx->buf_size = (ctx->buf_size + 15) & ~(size_t)15;
+  ctx->bufs = (uint8_t *)malloc(ctx->buf_size * OC_URING_RECV_BUFFERS);
+  if (!ctx->bufs) {
+    return -1;
+  }
+
+  ctx->buf_ring_size = OC_URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+  void *ring = mmap(NULL, ctx->buf_ring_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring == MAP_FAILED) {
+    return -1;
+  }
+  ctx->buf_ring = (struct io_uring_buf_ring *)ring;
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)ring;
+  reg.ring_entries = OC_URING_RECV_BUFFERS;
+  reg.bgid = URING_RECV_BGID;
+  if (sys_uring_register(ctx->recv.fd, IORING_REGISTER_PBUF_RING, &reg, 1) <
+      0) {
+    OC_WRN("registering io_uring buffer ring failed %d", errno);
+    return -1;
+  }
+
+  ctx->buf_ring->tail = 0;
+  unsigned i;
+  for (i = 0; i < OC_URING_RECV_BUFFERS; i++) {
+    recycle_recv_buffer(ctx, i);
+  }
+
+  /* template for multishot recvmsg: only name and control lengths are used */
+  memset(&ctx->recv_msg, 0, sizeof(ctx->recv_msg));
+  ctx->recv_msg.msg_namelen = sizeof(struct sockaddr_storage);
+  ctx->recv_msg.msg_controllen = URING_RECV_CONTROL_LEN;
+  return 0;
+}
+
+static int
+arm_recv(struct oc_uring_context_t *ctx, int sock, uint32_t tag)
+{
+  struct io_uring_sqe *sqe = uring_get_sqe(&ctx->recv);
+  if (!sqe) {
+    return -1;
+  }
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = sock;
+  sqe->addr = (uint64_t)(uintptr_t)&ctx->recv_msg;
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_RECV_BGID;
+  sqe->user_data = tag;
+  return 0;
+}
+
+static int
+arm_poll(struct oc_uring_context_t *ctx, int fd, uint32_t tag)
+{
+  struct io_uring_sqe *sqe = uring_get_sqe(&ctx->recv);
+  if (!sqe) {
+    return -1;
+  }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = URING_UD_POLL | tag;
+  return 0;
+}
+
+static int
+find_recv_fd(struct oc_uring_context_t *ctx, uint64_t user_data)
+{
+  int i;
+  for (i = 0; i < ctx->num_recv_fds; i++) {
+    if (ctx->recv_tags[i] == (uint32_t)user_data) {
+      return ctx->recv_fds[i];
+    }
+  }
+  return -1;
+}
+
+int
+oc_uring_add_recv_socket(ip_context_t *dev, int sock, uint32_t tag)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  if (ctx->num_recv_fds >= URING_RECV_ENTRIES / 2 ||
+      arm_recv(ctx, sock, tag) < 0) {
+    return -1;
+  }
+  ctx->recv_fds[ctx->num_recv_fds] = sock;
+  ctx->recv_tags[ctx->num_recv_fds] = tag;
+  ctx->num_recv_fds++;
+  return 0;
+}
+
+int
+oc_uring_add_poll_fd(ip_context_t *dev, int fd, uint32_t tag)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  if (ctx->num_recv_fds >= URING_RECV_ENTRIES / 2 ||
+      arm_poll(ctx, fd, tag) < 0) {
+    return -1;
+  }
+  ctx->recv_fds[ctx->num_recv_fds] = fd;
+  ctx->recv_tags[ctx->num_recv_fds] = tag;
+  ctx->num_recv_fds++;
+  return 0;
+}
+
+static void
+handle_recv_completion(ip_context_t *dev, struct io_uring_cqe *cqe,
+                       oc_uring_handler_t handler)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  bool poll = (cqe->user_data & URING_UD_POLL) != 0;
+  uint32_t tag = (uint32_t)cqe->user_data;
+
+  if (cqe->res >= 0) {
+    if (poll) {
+      handler(dev, tag, NULL, NULL, 0);
+    } else if (cqe->flags & IORING_CQE_F_BUFFER) {
+      unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+      uint8_t *buf = recv_buffer(ctx, bid);
+      struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buf;
+      uint8_t *name = buf + sizeof(*out);
+      uint8_t *control = name + ctx->recv_msg.msg_namelen;
+      uint8_t *payload = control + ctx->recv_msg.msg_controllen;
+
+      if ((out->flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+          out->namelen > ctx->recv_msg.msg_namelen) {
+        OC_ERR("io_uring recvmsg returned a truncated message");
+      } else {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = name;
+        msg.msg_namelen = out->namelen;
+        msg.msg_control = control;
+        msg.msg_controllen = out->controllen;
+        msg.msg_flags = (int)out->flags;
+        handler(dev, tag, &msg, payload, out->payloadlen);
+      }
+      recycle_recv_buffer(ctx, bid);
+    }
+  } else if (cqe->res != -ENOBUFS) {
+    OC_ERR("io_uring %s returned an error: %d", poll ? "poll" : "recvmsg",
+           -cqe->res);
+  }
+
+  if (!(cqe->flags & IORING_CQE_F_MORE)) {
+    /* multishot request terminated. Re-arm it when it ran out of buffers,
+     * not on a hard error, which would fail again right away. */
+    int fd = find_recv_fd(ctx, cqe->user_data);
+    if (cqe->res < 0 && cqe->res != -ENOBUFS) {
+      OC_ERR("io_uring %s on fd %d terminated, not re-armed",
+             poll ? "poll" : "recvmsg", fd);
+    } else if (fd >= 0) {
+      if (poll) {
+        arm_poll(ctx, fd, tag);
+      } else {
+        arm_recv(ctx, fd, tag);
+      }
+    }
+  }
+}
+
+int
+oc_uring_wait(ip_context_t *dev, oc_uring_handler_t handler, int timeout_ms)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  uring_t *ring = &ctx->recv;
+
+  if (uring_submit_timeout(ring, 1, timeout_ms) < 0) {
+    OC_ERR("io_uring_enter failed %d", errno);
+    return -1;
+  }
+
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    handle_recv_completion(dev, cqe, handler);
+    head++;
+    if (head == tail) {
+      /* pick up completions that arrived while dispatching */
+      __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+      tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    }
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* Kernels before 6.0 reject multishot recvmsg with -EINVAL. Receive one
+ * datagram on a socket pair to find out, then cancel the request.
+ */
+static bool
+probe_multishot_recv(struct oc_uring_context_t *ctx)
+{
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0) {
+    return false;
+  }
+  bool supported = false;
+  uint8_t byte = 0;
+  bool armed = arm_recv(ctx, sv[0], (uint32_t)URING_UD_PROBE) == 0 &&
+               send(sv[1], &byte, 1, 0) == 1;
+  bool cancelled = false;
+  uring_t *ring = &ctx->recv;
+  while (armed && uring_submit(ring, 1) == 0) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      if (cqe->user_data != URING_UD_PROBE) {
+        continue;
+      }
+      if (cqe->flags & IORING_CQE_F_BUFFER) {
+        recycle_recv_buffer(ctx, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+      }
+      if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        armed = false;
+      } else if (cqe->res >= 0) {
+        supported = true;
+      }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    if (armed && !cancelled) {
+      struct io_uring_sqe *sqe = uring_get_sqe(ring);
+      if (!sqe) {
+        break;
+      }
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = URING_UD_PROBE;
+      sqe->user_data = URING_UD_PROBE_CANCEL;
+      cancelled = true;
+    }
+  }
+  close(sv[0]);
+  close(sv[1]);
+  return supported && !armed;
+}
+
+/* ----------------------------- send side -------------------------------- */
+
+static void
+reap_send_completions(struct oc_uring_context_t *ctx)
+{
+  uring_t *ring = &ctx->send;
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    uint32_t slot = (uint32_t)cqe->user_data;
+    if (cqe->res < 0) {
+      OC_WRN("io_uring sendmsg returned errno %d", -cqe->res);
+    }
+    if (slot < OC_URING_SEND_SLOTS && ctx->slots[slot].message) {
+      oc_message_unref(ctx->slots[slot].message);
+      ctx->slots[slot].message = NULL;
+      ctx->free_slots |= (1U << slot);
+    }
+    head++;
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int
+get_send_slot(struct oc_uring_context_t *ctx)
+{
+  reap_send_completions(ctx);
+  while (ctx->free_slots == 0) {
+    /* all slots in flight: flush and wait for one of them */
+    ctx->last_sqe = NULL;
+    if (uring_submit(&ctx->send, 1) < 0) {
+      return -1;
+    }
+    reap_send_completions(ctx);
+  }
+  return __builtin_ctz(ctx->free_slots);
+}
+
+static void
+build_send_msg(uring_send_slot_t *slot, const struct sockaddr_storage *receiver,
+               oc_message_t *message)
+{
+  memcpy(&slot->receiver, receiver, sizeof(slot->receiver));
+  memset(&slot->msg, 0, sizeof(slot->msg));
+  memset(slot->control, 0, sizeof(slot->control));
+  slot->iov.iov_base = message->data;
+  slot->iov.iov_len = message->length;
+  slot->msg.msg_name = &slot->receiver;
+  slot->msg.msg_namelen = sizeof(slot->receiver);
+  slot->msg.msg_iov = &slot->iov;
+  slot->msg.msg_iovlen = 1;
+
+  if (message->endpoint.flags & IPV6) {
+    slot->msg.msg_control = slot->control;
+    slot->msg.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&slot->msg);
+    cmsg->cmsg_level = IPPROTO_IPV6;
+    cmsg->cmsg_type = IPV6_PKTINFO;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+    struct in6_pktinfo *pktinfo = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+    pktinfo->ipi6_ifindex = message->endpoint.interface_index;
+    memcpy(&pktinfo->ipi6_addr, message->endpoint.addr_local.ipv6.address, 16);
+
+    const uint8_t *dest = message->endpoint.addr.ipv6.address;
+    if (dest[0] == 0xff) {
+      /* the send may run after the next setsockopt(IPV6_MULTICAST_HOPS) of
+       * oc_send_discovery_request(), so carry the hop limit per packet */
+      slot->msg.msg_controllen += CMSG_SPACE(sizeof(int));
+      cmsg = CMSG_NXTHDR(&slot->msg, cmsg);
+      cmsg->cmsg_level = IPPROTO_IPV6;
+      cmsg->cmsg_type = IPV6_HOPLIMIT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+      int hops = ((dest[1] & 0x0f) <= 0x02) ? 1 : 255;
+      memcpy(CMSG_DATA(cmsg), &hops, sizeof(hops));
+    }
+  }
+#ifdef OC_IPV4
+  else if (message->endpoint.flags & IPV4) {
+    slot->msg.msg_control = slot->control;
+    slot->msg.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&slot->msg);
+    cmsg->cmsg_level = SOL_IP;
+    cmsg->cmsg_type = IP_PKTINFO;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+    struct in_pktinfo *pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
+    pktinfo->ipi_ifindex = message->endpoint.interface_index;
+    memcpy(&pktinfo->ipi_spec_dst, message->endpoint.addr_local.ipv4.address,
+           4);
+  }
+#endif /* OC_IPV4 */
+}
+
+int
+oc_uring_send_msg(ip_context_t *dev, int sock,
+                  const struct sockaddr_storage *receiver,
+                  oc_message_t *message)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  int ret = -1;
+
+  pthread_mutex_lock(&ctx->send_mutex);
+  int index = get_send_slot(ctx);
+  if (index < 0) {
+    goto done;
+  }
+  struct io_uring_sqe *sqe = uring_get_sqe(&ctx->send);
+  if (!sqe) {
+    /* the ring is as deep as the slot array, so this means a batch overran
+     * it; submit what we have and retry */
+    ctx->last_sqe = NULL;
+    uring_submit(&ctx->send, 0);
+    sqe = uring_get_sqe(&ctx->send);
+    if (!sqe) {
+      goto done;
+    }
+  }
+
+  uring_send_slot_t *slot = &ctx->slots[index];
+  build_send_msg(slot, receiver, message);
+  oc_message_add_ref(message);
+  slot->message = message;
+  ctx->free_slots &= ~(1U << index);
+
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = sock;
+  sqe->addr = (uint64_t)(uintptr_t)&slot->msg;
+  sqe->len = 1;
+  sqe->user_data = (uint64_t)index;
+
+  if (ctx->batching) {
+    /* hard links keep the order but do not cancel the rest on failure */
+    sqe->flags |= IOSQE_IO_HARDLINK;
+    ctx->last_sqe = sqe;
+  } else if (uring_submit(&ctx->send, 0) < 0) {
+    OC_WRN("io_uring_enter failed %d", errno);
+    goto done;
+  }
+  ret = (int)message->length;
+
+done:
+  pthread_mutex_unlock(&ctx->send_mutex);
+  return ret;
+}
+
+void
+oc_uring_send_batch_begin(ip_context_t *dev)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  pthread_mutex_lock(&ctx->send_mutex);
+  ctx->batching = true;
+  ctx->last_sqe = NULL;
+}
+
+void
+oc_uring_send_batch_end(ip_context_t *dev)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  if (ctx->last_sqe) {
+    /* the last request of a chain must not link to whatever comes next */
+    ctx->last_sqe->flags &= ~IOSQE_IO_HARDLINK;
+    ctx->last_sqe = NULL;
+  }
+  ctx->batching = false;
+  if (uring_submit(&ctx->send, 0) < 0) {
+    OC_WRN("io_uring_enter failed %d", errno);
+  }
+  pthread_mutex_unlock(&ctx->send_mutex);
+}
+
+/* ---------------------------- life cycle -------------------------------- */
+
+static void
+free_context(struct oc_uring_context_t *ctx)
+{
+  uring_free(&ctx->send);
+  uring_free(&ctx->recv);
+  if (ctx->buf_ring) {
+    munmap(ctx->buf_ring, ctx->buf_ring_size);
+  }
+  free(ctx->bufs);
+  pthread_mutex_destroy(&ctx->send_mutex);
+  free(ctx);
+}
+
+int
+oc_uring_connectivity_init(ip_context_t *dev)
+{
+  dev->uring = NULL;
+  struct oc_uring_context_t *ctx =
+    (struct oc_uring_context_t *)calloc(1, sizeof(*ctx));
+  if (!ctx) {
+    return -1;
+  }
+  ctx->recv.fd = -1;
+  ctx->send.fd = -1;
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&ctx->send_mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  if (uring_init(&ctx->recv, URING_RECV_ENTRIES) < 0 ||
+      uring_init(&ctx->send, OC_URING_SEND_SLOTS) < 0 ||
+      setup_recv_buffers(ctx) < 0) {
+    free_context(ctx);
+    return -1;
+  }
+  if (!probe_multishot_recv(ctx)) {
+    OC_WRN("io_uring multishot recvmsg is not supported");
+    free_context(ctx);
+    return -1;
+  }
+  ctx->free_slots = (OC_URING_SEND_SLOTS >= 32)
+                      ? 0xffffffffU
+                      : ((1U << OC_URING_SEND_SLOTS) - 1);
+
+  dev->uring = ctx;
+  OC_DBG("io_uring backend initialized for device %zd", dev->device);
+  return 0;
+}
+
+void
+oc_uring_connectivity_shutdown(ip_context_t *dev)
+{
+  struct oc_uring_context_t *ctx = dev->uring;
+  if (!ctx) {
+    return;
+  }
+  pthread_mutex_lock(&ctx->send_mutex);
+  uint32_t all = (OC_URING_SEND_SLOTS >= 32)
+                   ? 0xffffffffU
+                   : ((1U << OC_URING_SEND_SLOTS) - 1);
+  uring_submit(&ctx->send, 0);
+  while (ctx->free_slots != all) {
+    if (uring_submit(&ctx->send, 1) < 0) {
+      break;
+    }
+    reap_send_completions(ctx);
+  }
+  pthread_mutex_unlock(&ctx->send_mutex);
+
+  dev->uring = NULL;
+  free_context(ctx);
+}
+
+#endif /* OC_IO_URING */
@@ -0,0 +1,149 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef URING_ADAPTER_H
+#define URING_ADAPTER_H
+
+#include "ipcontext.h"
+#include "port/oc_connectivity.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of receive buffers in the provided buffer ring of a device.
+ * Must be a power of 2.
+ */
+#ifndef OC_URING_RECV_BUFFERS
+#define OC_URING_RECV_BUFFERS (64)
+#endif /* OC_URING_RECV_BUFFERS */
+
+/**
+ * Maximum number of sends in flight per device. Must be a power of 2.
+ */
+#ifndef OC_URING_SEND_SLOTS
+#define OC_URING_SEND_SLOTS (32)
+#endif /* OC_URING_SEND_SLOTS */
+
+/**
+ * Handler for completed receive/poll operations of the network thread.
+ *
+ * For sockets armed with oc_uring_add_recv_socket() msg holds the source
+ * address and ancillary data, and payload/len the received datagram. Both are
+ * only valid during the call. For descriptors armed with oc_uring_add_poll_fd()
+ * msg and payload are NULL and the descriptor is readable.
+ */
+typedef void (*oc_uring_handler_t)(ip_context_t *dev, uint32_t tag,
+                                   struct msghdr *msg, const uint8_t *payload,
+                                   size_t len);
+
+/**
+ * Set up the receive and send rings of a device.
+ *
+ * @param[in] dev the device network context.
+ *
+ * @return 0 on success, -1 if io_uring is not usable on this kernel. In that
+ * case dev->uring stays NULL and the select() based loop must be used.
+ */
+int oc_uring_connectivity_init(ip_context_t *dev);
+
+/**
+ * Wait for all in-flight sends and tear down the rings of a device.
+ *
+ * @param[in] dev the device network context.
+ */
+void oc_uring_connectivity_shutdown(ip_context_t *dev);
+
+/**
+ * Arm a multishot recvmsg on a UDP socket, using the provided buffer ring.
+ *
+ * @param[in] dev the device network context.
+ * @param[in] sock the socket.
+ * @param[in] tag passed to the handler for every datagram of this socket.
+ *
+ * @return 0 on success, -1 if the submission queue is full.
+ */
+int oc_uring_add_recv_socket(ip_context_t *dev, int sock, uint32_t tag);
+
+/**
+ * Arm a multishot poll for readability on a file descriptor.
+ *
+ * @param[in] dev the device network context.
+ * @param[in] fd the file descriptor.
+ * @param[in] tag passed to the handler whenever fd becomes readable.
+ *
+ * @return 0 on success, -1 if the submission queue is full.
+ */
+int oc_uring_add_poll_fd(ip_context_t *dev, int fd, uint32_t tag);
+
+/**
+ * Submit pending requests, block until at least one completes or the timeout
+ * expires and dispatch all available completions. Called from the network
+ * thread only.
+ *
+ * @param[in] dev the device network context.
+ * @param[in] handler called for every received datagram or poll event.
+ * @param[in] timeout_ms maximum time to block, -1 to wait indefinitely.
+ *
+ * @return 0 on success or timeout, -1 on a fatal ring error.
+ */
+int oc_uring_wait(ip_context_t *dev, oc_uring_handler_t handler,
+                  int timeout_ms);
+
+/**
+ * Queue a UDP message for sending.
+ *
+ * The message is referenced until the kernel reports completion, so it must
+ * have been allocated from a message pool.
+ *
+ * @param[in] dev the device network context.
+ * @param[in] sock the socket to send on.
+ * @param[in] receiver the destination address.
+ * @param[in] message the message.
+ *
+ * @return the number of bytes queued, -1 on error.
+ */
+int oc_uring_send_msg(ip_context_t *dev, int sock,
+                      const struct sockaddr_storage *receiver,
+                      oc_message_t *message);
+
+/**
+ * Start collecting sends into one linked batch. Sends queued until
+ * oc_uring_send_batch_end() are submitted with a single system call and
+ * executed in order.
+ *
+ * @param[in] dev the device network context.
+ */
+void oc_uring_send_batch_begin(ip_context_t *dev);
+
+/**
+ * Submit the batch started with oc_uring_send_batch_begin().
+ *
+ * @param[in] dev the device network context.
+ */
+void oc_uring_send_batch_end(ip_context_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* URING_ADAPTER_H */
@@ -90,6 +90,17 @@ void oc_clock_init(void);
  */
 oc_clock_time_t oc_clock_time(void);
 
+/**
+ * Get the current wall clock time.
+ *
+ * oc_clock_time() only measures intervals and may be a monotonic clock that
+ * does not start at a fixed epoch. Use this function where the real time is
+ * needed, e.g. for timestamps shown to users.
+ *
+ * \return The time since the Unix epoch (UTC), measured in system ticks.
+ */
+oc_clock_time_t oc_clock_wall_time(void);
+
 /**
  * Get the current value of the platform seconds.
  *
@@ -233,6 +233,38 @@ void oc_connectivity_subscribe_mcast_ipv6(oc_endpoint_t *address);
  */
 void oc_connectivity_unsubscribe_mcast_ipv6(oc_endpoint_t *address);
 
+#ifdef OC_EXTERNAL_POLL
+/**
+ * @brief file descriptor that becomes readable when the stack has work to do
+ *
+ * Covers the sockets of all devices, the wakeup of oc_signal_event_loop()
+ * and the timer of the next scheduled event.
+ *
+ * @return the file descriptor, -1 if no device is initialized
+ */
+int oc_connectivity_get_poll_fd(void);
+
+/**
+ * @brief read the sockets that are ready, without blocking
+ *
+ * Called by oc_main_poll() when the stack runs without network threads.
+ */
+void oc_connectivity_poll(void);
+
+/**
+ * @brief arm the timer of the poll file descriptor
+ *
+ * @param next_event absolute time of the next event as returned by
+ * oc_main_poll(), 0 if there is none
+ */
+void oc_connectivity_set_poll_timer(oc_clock_time_t next_event);
+
+/**
+ * @brief make the poll file descriptor readable
+ */
+void oc_connectivity_signal_poll_fd(void);
+#endif /* OC_EXTERNAL_POLL */
+
 #ifdef OC_TCP
 /**
  * @brief The CSM states
@@ -19,6 +19,7 @@
  ******************************************************************/
 
 #include <cstdlib>
+#include <ctime>
 #include <gtest/gtest.h>
 #include <string>
 
@@ -47,7 +48,7 @@ TEST_F(TestClock, oc_clock_seconds)
 
 TEST_F(TestClock, oc_clock_wait)
 {
-  oc_clock_time_t wait_time = 1 * (OC_CLOCK_SECOND / 1000);
+  oc_clock_time_t wait_time = 1 * OC_CLOCK_SECOND;
   oc_clock_time_t prev_stamp = oc_clock_time();
   oc_clock_wait(wait_time);
   oc_clock_time_t cur_stamp = oc_clock_time();
@@ -55,3 +56,20 @@ TEST_F(TestClock, oc_clock_wait)
   int seconds = (cur_stamp - prev_stamp) / OC_CLOCK_SECOND;
   EXPECT_EQ(1, seconds);
 }
+
+TEST_F(TestClock, oc_clock_wall_time)
+{
+  // the wall clock counts from the Unix epoch
+  oc_clock_time_t wall = oc_clock_wall_time();
+  EXPECT_NEAR((double)time(NULL), (double)(wall / OC_CLOCK_SECOND), 1.0);
+}
+
+TEST_F(TestClock, oc_clock_time_monotonic)
+{
+  oc_clock_time_t prev = oc_clock_time();
+  for (int i = 0; i < 1000; i++) {
+    oc_clock_time_t cur = oc_clock_time();
+    EXPECT_LE(prev, cur);
+    prev = cur;
+  }
+}
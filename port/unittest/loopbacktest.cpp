@@ -0,0 +1,242 @@
+/******************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+extern "C" {
+#include "oc_buffer.h"
+#include "port/oc_clock.h"
+#include "port/oc_connectivity.h"
+}
+
+/*
+ * Loopback benchmarks for the UDP backend of the Linux port. The numbers are
+ * printed, not asserted; build once with OC_IO_URING_ENABLED=ON and once
+ * without to compare the io_uring and select() backends.
+ */
+
+static const size_t device = 0;
+
+using bench_clock = std::chrono::steady_clock;
+
+class TestLoopback : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    oc_network_event_handler_mutex_init();
+    ASSERT_EQ(0, oc_connectivity_init(device));
+
+    memset(&server_, 0, sizeof(server_));
+    server_.sin6_family = AF_INET6;
+    server_.sin6_addr = in6addr_loopback;
+    oc_endpoint_t *ep = oc_connectivity_get_endpoints(device);
+    while (ep) {
+      if ((ep->flags & IPV6) && !(ep->flags & (SECURED | TCP))) {
+        server_.sin6_port = htons(ep->addr.ipv6.port);
+        break;
+      }
+      ep = ep->next;
+    }
+    ASSERT_NE(nullptr, ep);
+
+    client_ = socket(AF_INET6, SOCK_DGRAM, 0);
+    ASSERT_LE(0, client_);
+    struct sockaddr_in6 local;
+    memset(&local, 0, sizeof(local));
+    local.sin6_family = AF_INET6;
+    local.sin6_addr = in6addr_loopback;
+    ASSERT_EQ(0, bind(client_, (struct sockaddr *)&local, sizeof(local)));
+    socklen_t len = sizeof(local);
+    ASSERT_EQ(0, getsockname(client_, (struct sockaddr *)&local, &len));
+    client_port_ = ntohs(local.sin6_port);
+  }
+
+  void TearDown() override
+  {
+    if (client_ >= 0) {
+      close(client_);
+    }
+    oc_connectivity_shutdown(device);
+    oc_network_event_handler_mutex_destroy();
+  }
+
+  static uint32_t received()
+  {
+    oc_buffer_slab_stats_t stats;
+    oc_buffer_get_slab_stats(OC_BUFFER_SLAB_SMALL, &stats);
+    return stats.num_allocs;
+  }
+
+  /* every small datagram taken off the socket ends up in one small payload
+   * block, allocated from its length or shrunk into after the read */
+  static bool wait_received(uint32_t target, int timeout_ms)
+  {
+    bench_clock::time_point deadline =
+      bench_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while ((int32_t)(received() - target) < 0) {
+      if (bench_clock::now() > deadline) {
+        return false;
+      }
+#ifdef OC_EXTERNAL_POLL
+      /* no network thread, read the sockets from here */
+      struct pollfd pfd = { oc_connectivity_get_poll_fd(), POLLIN, 0 };
+      if (poll(&pfd, 1, 1) > 0) {
+        oc_connectivity_poll();
+      }
+#endif /* OC_EXTERNAL_POLL */
+    }
+    return true;
+  }
+
+  void send_to_server(const uint8_t *data, size_t len)
+  {
+    sendto(client_, data, len, 0, (struct sockaddr *)&server_,
+           sizeof(server_));
+  }
+
+  struct sockaddr_in6 server_;
+  int client_ = -1;
+  uint16_t client_port_ = 0;
+};
+
+TEST_F(TestLoopback, ReceiveLatency)
+{
+  const int rounds = 2000;
+  uint8_t packet[64];
+  memset(packet, 0x42, sizeof(packet));
+  std::vector<double> samples;
+  samples.reserve(rounds);
+
+  uint32_t count = received();
+  for (int i = 0; i < rounds; i++) {
+    bench_clock::time_point start = bench_clock::now();
+    send_to_server(packet, sizeof(packet));
+    ASSERT_TRUE(wait_received(++count, 1000));
+    samples.push_back(
+      std::chrono::duration<double, std::micro>(bench_clock::now() - start)
+        .count());
+  }
+
+  std::sort(samples.begin(), samples.end());
+  printf("[ LOOPBACK ] %s receive latency: p50 %.1f us, p99 %.1f us\n",
+#if defined(OC_IO_URING)
+         "io_uring",
+#elif defined(OC_EXTERNAL_POLL)
+         "external poll",
+#else
+         "select",
+#endif
+         samples[rounds / 2], samples[rounds * 99 / 100]);
+}
+
+TEST_F(TestLoopback, ReceiveThroughput)
+{
+  const int burst = 256;
+  const int bursts = 40;
+  uint8_t packet[64];
+  memset(packet, 0x42, sizeof(packet));
+
+  uint32_t start_count = received();
+  uint32_t sent = 0;
+  bench_clock::time_point start = bench_clock::now();
+  for (int b = 0; b < bursts; b++) {
+    for (int i = 0; i < burst; i++) {
+      send_to_server(packet, sizeof(packet));
+    }
+    sent += burst;
+    /* pace the bursts so the socket buffer does not overflow */
+    wait_received(start_count + sent, 100);
+  }
+  double secs =
+    std::chrono::duration<double>(bench_clock::now() - start).count();
+  uint32_t got = received() - start_count;
+
+  EXPECT_LT(0u, got);
+  printf("[ LOOPBACK ] receive throughput: %u/%u datagrams, %.0f pps\n", got,
+         sent, got / secs);
+}
+
+TEST_F(TestLoopback, SendToClient)
+{
+  const int count = 100;
+  for (int i = 0; i < count; i++) {
+    oc_message_t *message = oc_allocate_message();
+    ASSERT_NE(nullptr, message);
+    memset(&message->endpoint, 0, sizeof(message->endpoint));
+    message->endpoint.device = device;
+    message->endpoint.flags = IPV6;
+    memcpy(message->endpoint.addr.ipv6.address, &in6addr_loopback, 16);
+    message->endpoint.addr.ipv6.port = client_port_;
+    memcpy(message->endpoint.addr_local.ipv6.address, &in6addr_loopback, 16);
+    memset(message->data, i, 32);
+    message->length = 32;
+    EXPECT_EQ(32, oc_send_buffer(message));
+    oc_message_unref(message);
+  }
+
+  int got = 0;
+  uint8_t buf[64];
+  struct pollfd pfd = { client_, POLLIN, 0 };
+  while (got < count && poll(&pfd, 1, 1000) > 0) {
+    ssize_t len = recv(client_, buf, sizeof(buf), 0);
+    ASSERT_EQ(32, len);
+    EXPECT_EQ((uint8_t)got, buf[0]);
+    got++;
+  }
+  EXPECT_EQ(count, got);
+}
+
+#ifdef OC_EXTERNAL_POLL
+TEST_F(TestLoopback, PollFdReadable)
+{
+  int fd = oc_connectivity_get_poll_fd();
+  ASSERT_LE(0, fd);
+
+  /* nothing pending and no timer armed */
+  oc_connectivity_poll();
+  oc_connectivity_set_poll_timer(0);
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  EXPECT_EQ(0, poll(&pfd, 1, 0));
+
+  uint32_t count = received();
+  uint8_t packet[16] = { 0 };
+  send_to_server(packet, sizeof(packet));
+  EXPECT_EQ(1, poll(&pfd, 1, 1000));
+  oc_connectivity_poll();
+  EXPECT_EQ(count + 1, received());
+
+  oc_connectivity_signal_poll_fd();
+  EXPECT_EQ(1, poll(&pfd, 1, 0));
+  oc_connectivity_poll();
+  EXPECT_EQ(0, poll(&pfd, 1, 0));
+
+  /* the timer fires for the next event */
+  oc_connectivity_set_poll_timer(oc_clock_time() + OC_CLOCK_SECOND / 100);
+  EXPECT_EQ(1, poll(&pfd, 1, 1000));
+}
+#endif /* OC_EXTERNAL_POLL */
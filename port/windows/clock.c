@@ -48,6 +48,13 @@ oc_clock_time(void)
   return time;
 }
 
+oc_clock_time_t
+oc_clock_wall_time(void)
+{
+  /* oc_clock_time() already counts from the Unix epoch */
+  return oc_clock_time();
+}
+
 unsigned long
 oc_clock_seconds(void)
 {
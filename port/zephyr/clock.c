@@ -16,4 +16,10 @@ oc_clock_init(void)
 oc_clock_time_t oc_clock_time(void)
 {   
     return k_uptime_get();
-}
\ No newline at end of file
+}
+
+oc_clock_time_t oc_clock_wall_time(void)
+{
+    // No real time clock is known to the port, report the uptime
+    return k_uptime_get();
+}
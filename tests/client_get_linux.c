@@ -44,6 +44,17 @@ signal_event_loop(void)
   pthread_mutex_unlock(&mutex);
 }
 
+static void
+init_cond(void)
+{
+  /* oc_clock_time() is monotonic, wait on the same clock */
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cv, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
 static void
 handle_signal(int signal)
 {
@@ -150,7 +161,7 @@ start_client()
   sigaction(SIGINT, &sa, NULL);
 
   pthread_mutex_init(&mutex, NULL);
-  pthread_cond_init(&cv, NULL);
+  init_cond();
 
   while (quit != true) {
     struct timespec ts;
@@ -258,7 +269,7 @@ start_server(void)
   sigaction(SIGINT, &sa, NULL);
 
   pthread_mutex_init(&mutex, NULL);
-  pthread_cond_init(&cv, NULL);
+  init_cond();
 
   while (quit != true) {
     struct timespec ts;
@@ -325,7 +336,7 @@ main(int argc, const char *argv[])
   sigaction(SIGCHLD, &sa, NULL);
 
   pthread_mutex_init(&mutex, NULL);
-  pthread_cond_init(&cv, NULL);
+  init_cond();
 
   server_pid = fork();
   if (server_pid < 0)
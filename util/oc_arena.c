@@ -0,0 +1,113 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "oc_arena.h"
+#include "oc_config.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* enough for pointers, int64_t and double */
+#define OC_ARENA_ALIGN (8)
+
+struct oc_arena_block_s
+{
+  oc_arena_block_t *next;
+  size_t size;
+  size_t used;
+};
+
+static size_t
+align_up(size_t size)
+{
+  return (size + OC_ARENA_ALIGN - 1) & ~(OC_ARENA_ALIGN - 1);
+}
+
+void
+oc_arena_init(oc_arena_t *arena, void *buffer, size_t size)
+{
+  arena->buffer = (uint8_t *)buffer;
+  arena->size = buffer ? size : 0;
+  arena->used = 0;
+  arena->allocated = 0;
+  arena->blocks = NULL;
+  /* the buffer may start anywhere, skip to the first aligned byte */
+  if (arena->buffer) {
+    size_t skip = align_up((uintptr_t)arena->buffer) - (uintptr_t)arena->buffer;
+    arena->used = skip < arena->size ? skip : arena->size;
+  }
+}
+
+#ifdef OC_DYNAMIC_ALLOCATION
+static void *
+alloc_from_blocks(oc_arena_t *arena, size_t size)
+{
+  oc_arena_block_t *block = arena->blocks;
+  if (block == NULL || block->size - block->used < size) {
+    size_t data_size = size > OC_ARENA_BLOCK_SIZE ? size : OC_ARENA_BLOCK_SIZE;
+    block = (oc_arena_block_t *)malloc(align_up(sizeof(*block)) + data_size);
+    if (block == NULL) {
+      return NULL;
+    }
+    block->size = data_size;
+    block->used = 0;
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+  uint8_t *p = (uint8_t *)block + align_up(sizeof(*block)) + block->used;
+  block->used += size;
+  return p;
+}
+#endif /* OC_DYNAMIC_ALLOCATION */
+
+void *
+oc_arena_alloc(oc_arena_t *arena, size_t size)
+{
+  uint8_t *p = NULL;
+  size = align_up(size > 0 ? size : 1);
+  if (arena->size - arena->used >= size) {
+    p = arena->buffer + arena->used;
+    arena->used += size;
+  }
+#ifdef OC_DYNAMIC_ALLOCATION
+  else {
+    p = (uint8_t *)alloc_from_blocks(arena, size);
+  }
+#endif /* OC_DYNAMIC_ALLOCATION */
+  if (p) {
+    memset(p, 0, size);
+    arena->allocated += size;
+  }
+  return p;
+}
+
+size_t
+oc_arena_allocated(const oc_arena_t *arena)
+{
+  return arena->allocated;
+}
+
+void
+oc_arena_reset(oc_arena_t *arena)
+{
+  while (arena->blocks) {
+    oc_arena_block_t *next = arena->blocks->next;
+    free(arena->blocks);
+    arena->blocks = next;
+  }
+  oc_arena_init(arena, arena->buffer, arena->size);
+}
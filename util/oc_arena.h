@@ -0,0 +1,87 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+/**
+ * \defgroup arena Bump-pointer arena
+ *
+ * An arena hands out memory by advancing a pointer through a buffer and
+ * releases everything it handed out at once. It suits objects that share a
+ * lifetime, e.g. the nodes of a parsed request payload that live until the
+ * handler returns.
+ *
+ * The arena starts with a buffer supplied by its owner. With
+ * OC_DYNAMIC_ALLOCATION it continues in allocated blocks when the buffer is
+ * used up, otherwise an allocation that does not fit fails.
+ */
+
+#ifndef OC_ARENA_H
+#define OC_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Size of the blocks allocated when the buffer of an arena is used up.
+ */
+#ifndef OC_ARENA_BLOCK_SIZE
+#define OC_ARENA_BLOCK_SIZE (1024)
+#endif /* OC_ARENA_BLOCK_SIZE */
+
+typedef struct oc_arena_block_s oc_arena_block_t;
+
+typedef struct oc_arena_s
+{
+  uint8_t *buffer;
+  size_t size;
+  size_t used;
+  size_t allocated; /**< bytes handed out since the last reset */
+  oc_arena_block_t *blocks;
+} oc_arena_t;
+
+/**
+ * Start an arena in buffer, which may be NULL when size is 0.
+ */
+void oc_arena_init(oc_arena_t *arena, void *buffer, size_t size);
+
+/**
+ * Allocate size bytes, zeroed and aligned for any scalar type.
+ *
+ * \return NULL if the arena is exhausted
+ */
+void *oc_arena_alloc(oc_arena_t *arena, size_t size);
+
+/**
+ * Number of bytes handed out since the arena was started or reset, including
+ * the padding for alignment and the bytes taken from allocated blocks.
+ */
+size_t oc_arena_allocated(const oc_arena_t *arena);
+
+/**
+ * Release everything allocated from the arena. The arena can be used again.
+ */
+void oc_arena_reset(oc_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_ARENA_H */
@@ -37,93 +37,202 @@
 #include "oc_etimer.h"
 #include "oc_process.h"
 
-static struct oc_etimer *timerlist;
+/* Pending timers are kept in a pairing heap ordered by expiration time: the
+ * next timer to expire is always the root, inserting is O(1) and removing any
+ * timer is O(log n) amortized. The heap is intrusive, a node links to its
+ * leftmost child, its next sibling and prev, which is the parent for a
+ * leftmost child and the previous sibling otherwise.
+ */
+static struct oc_etimer *timerheap;
 static oc_clock_time_t next_expiration;
 
 OC_PROCESS(oc_etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
-static void
-update_time(void)
+static int
+expires_before(struct oc_etimer *a, struct oc_etimer *b)
+{
+  /* Must compare distances to take wraps into account */
+  oc_clock_time_t ea = a->timer.start + a->timer.interval;
+  oc_clock_time_t eb = b->timer.start + b->timer.interval;
+  return (ea - eb) > ((oc_clock_time_t)-1 >> 1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_heap(struct oc_etimer *t)
+{
+  return t == timerheap || t->prev != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct oc_etimer *
+meld(struct oc_etimer *a, struct oc_etimer *b)
 {
-  oc_clock_time_t tdist;
-  oc_clock_time_t now;
   struct oc_etimer *t;
 
-  if (timerlist == NULL) {
-    next_expiration = 0;
+  if (a == NULL) {
+    return b;
+  }
+  if (b == NULL) {
+    return a;
+  }
+  if (expires_before(b, a)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  /* b becomes the leftmost child of a */
+  b->prev = a;
+  b->sibling = a->child;
+  if (a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+static struct oc_etimer *
+merge_pairs(struct oc_etimer *first)
+{
+  struct oc_etimer *a, *b, *next, *pairs = NULL, *root = NULL;
+
+  /* Meld the siblings pairwise from left to right, stacking the results */
+  while (first != NULL) {
+    a = first;
+    b = a->sibling;
+    next = (b != NULL) ? b->sibling : NULL;
+    a->sibling = a->prev = NULL;
+    if (b != NULL) {
+      b->sibling = b->prev = NULL;
+    }
+    a = meld(a, b);
+    a->sibling = pairs;
+    pairs = a;
+    first = next;
+  }
+
+  /* then meld the stacked pairs from right to left into one heap */
+  while (pairs != NULL) {
+    next = pairs->sibling;
+    pairs->sibling = NULL;
+    root = meld(pairs, root);
+    pairs = next;
+  }
+  if (root != NULL) {
+    root->prev = root->sibling = NULL;
+  }
+  return root;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct oc_etimer *t)
+{
+  t->child = t->sibling = t->prev = NULL;
+  timerheap = meld(timerheap, t);
+  timerheap->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_timer(struct oc_etimer *t)
+{
+  struct oc_etimer *children = merge_pairs(t->child);
+
+  if (t == timerheap) {
+    timerheap = children;
   } else {
-    now = oc_clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for (t = t->next; t != NULL; t = t->next) {
-      if (t->timer.start + t->timer.interval - now < tdist) {
-        tdist = t->timer.start + t->timer.interval - now;
-      }
+    if (t->prev->child == t) {
+      t->prev->child = t->sibling;
+    } else {
+      t->prev->sibling = t->sibling;
     }
-    next_expiration = now + tdist;
+    if (t->sibling != NULL) {
+      t->sibling->prev = t->prev;
+    }
+    timerheap = meld(timerheap, children);
+  }
+  t->child = t->sibling = t->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_process_timers(struct oc_process *p, int all)
+{
+  struct oc_etimer *t, *c, *stack = timerheap, *keep = NULL;
+
+  if (stack == NULL) {
+    return;
+  }
+  /* Take the heap apart, using next as a work list */
+  timerheap = NULL;
+  stack->next = NULL;
+  while (stack != NULL) {
+    t = stack;
+    stack = t->next;
+    for (c = t->child; c != NULL; c = c->sibling) {
+      c->next = stack;
+      stack = c;
+    }
+    t->child = t->sibling = t->prev = NULL;
+    t->next = NULL;
+    if (!all && t->p != p) {
+      t->next = keep;
+      keep = t;
+    }
+  }
+  while (keep != NULL) {
+    t = keep;
+    keep = t->next;
+    t->next = NULL;
+    insert_timer(t);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  if (timerheap == NULL) {
+    next_expiration = 0;
+  } else {
+    next_expiration = timerheap->timer.start + timerheap->timer.interval;
   }
 }
 /*---------------------------------------------------------------------------*/
 OC_PROCESS_THREAD(oc_etimer_process, ev, data)
 {
-  struct oc_etimer *t, *u;
+  struct oc_etimer *t;
 
   OC_PROCESS_BEGIN();
 
-  timerlist = NULL;
+  timerheap = NULL;
 
   while (1) {
     OC_PROCESS_YIELD();
 
     if (ev == OC_PROCESS_EVENT_EXITED) {
-      struct oc_process *p = data;
-
-      while (timerlist != NULL && timerlist->p == p) {
-        timerlist = timerlist->next;
-      }
-
-      if (timerlist != NULL) {
-        t = timerlist;
-        while (t->next != NULL) {
-          if (t->next->p == p) {
-            t->next = t->next->next;
-          } else
-            t = t->next;
-        }
-      }
+      remove_process_timers((struct oc_process *)data, 0);
+      update_time();
+      continue;
+    } else if (ev == OC_PROCESS_EVENT_EXIT) {
+      /* Unlink all pending timers so none is left pointing into the heap */
+      remove_process_timers(NULL, 1);
+      update_time();
       continue;
     } else if (ev != OC_PROCESS_EVENT_POLL) {
       continue;
     }
 
-  again:
-
-    u = NULL;
-
-    for (t = timerlist; t != NULL; t = t->next) {
-      if (oc_timer_expired(&t->timer)) {
-        if (oc_process_post(t->p, OC_PROCESS_EVENT_TIMER, t) ==
-            OC_PROCESS_ERR_OK) {
-
-          /* Reset the process ID of the event timer, to signal that the
-             etimer has expired. This is later checked in the
-             oc_etimer_expired() function. */
-          t->p = OC_PROCESS_NONE;
-          if (u != NULL) {
-            u->next = t->next;
-          } else {
-            timerlist = t->next;
-          }
-          t->next = NULL;
-          update_time();
-          goto again;
-        } else {
-          oc_etimer_request_poll();
-        }
+    while (timerheap != NULL && oc_timer_expired(&timerheap->timer)) {
+      t = timerheap;
+      if (oc_process_post(t->p, OC_PROCESS_EVENT_TIMER, t) !=
+          OC_PROCESS_ERR_OK) {
+        oc_etimer_request_poll();
+        break;
       }
-      u = t;
+      /* Reset the process ID of the event timer, to signal that the
+         etimer has expired. This is later checked in the
+         oc_etimer_expired() function. */
+      t->p = OC_PROCESS_NONE;
+      remove_timer(t);
+      t->next = NULL;
     }
+    update_time();
   }
 
   OC_PROCESS_END();
@@ -139,25 +248,15 @@ oc_etimer_request_poll(void)
 static void
 add_timer(struct oc_etimer *timer)
 {
-  struct oc_etimer *t;
-
   oc_etimer_request_poll();
 
-  if (timer->p != OC_PROCESS_NONE) {
-    for (t = timerlist; t != NULL; t = t->next) {
-      if (t == timer) {
-        /* Timer already on list, bail out. */
-        timer->p = OC_PROCESS_CURRENT();
-        update_time();
-        return;
-      }
-    }
+  if (timer->p != OC_PROCESS_NONE && in_heap(timer)) {
+    /* Timer already pending, its expiration time may have changed. */
+    remove_timer(timer);
   }
 
-  /* Timer not on list. */
   timer->p = OC_PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
+  insert_timer(timer);
 
   update_time();
 }
@@ -195,7 +294,13 @@ oc_etimer_restart(struct oc_etimer *et)
 void
 oc_etimer_adjust(struct oc_etimer *et, int timediff)
 {
-  et->timer.start += timediff;
+  if (in_heap(et)) {
+    remove_timer(et);
+    et->timer.start += timediff;
+    insert_timer(et);
+  } else {
+    et->timer.start += timediff;
+  }
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -220,7 +325,7 @@ oc_etimer_start_time(struct oc_etimer *et)
 int
 oc_etimer_pending(void)
 {
-  return timerlist != NULL;
+  return timerheap != NULL;
 }
 /*---------------------------------------------------------------------------*/
 oc_clock_time_t
@@ -232,26 +337,9 @@ oc_etimer_next_expiration_time(void)
 void
 oc_etimer_stop(struct oc_etimer *et)
 {
-  struct oc_etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if (et == timerlist) {
-    timerlist = timerlist->next;
+  if (in_heap(et)) {
+    remove_timer(et);
     update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for (t = timerlist; t != NULL && t->next != et; t = t->next)
-      ;
-
-    if (t != NULL) {
-      /* We've found the item before the event timer that we are about
-   to remove. We point the items next pointer to the event after
-   the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
   }
 
   /* Remove the next pointer from the item to be removed. */
@@ -74,6 +74,9 @@ struct oc_etimer
   struct oc_timer timer;
   struct oc_etimer *next;
   struct oc_process *p;
+  struct oc_etimer *child;   /**< leftmost child in the timer heap */
+  struct oc_etimer *sibling; /**< next sibling in the timer heap */
+  struct oc_etimer *prev;    /**< parent or previous sibling in the heap */
 };
 
 /**
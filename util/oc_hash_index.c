@@ -0,0 +1,206 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "oc_hash_index.h"
+#include "oc_config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OC_DYNAMIC_ALLOCATION
+#define OC_HASH_INDEX_MIN_CAPACITY (16)
+#endif /* OC_DYNAMIC_ALLOCATION */
+
+static uint32_t
+home_slot(const oc_hash_index_t *index, uint32_t hash)
+{
+  return hash % index->capacity;
+}
+
+static uint32_t
+next_slot(const oc_hash_index_t *index, uint32_t i)
+{
+  return (i + 1 == index->capacity) ? 0 : i + 1;
+}
+
+static void
+insert_slot(oc_hash_index_t *index, void *entry, uint32_t hash)
+{
+  uint32_t i = home_slot(index, hash);
+  while (index->slots[i].entry != NULL) {
+    i = next_slot(index, i);
+  }
+  index->slots[i].entry = entry;
+  index->slots[i].hash = hash;
+  index->count++;
+}
+
+#ifdef OC_DYNAMIC_ALLOCATION
+static bool
+grow(oc_hash_index_t *index)
+{
+  uint32_t capacity = index->capacity ? index->capacity * 2
+                                      : OC_HASH_INDEX_MIN_CAPACITY;
+  oc_hash_slot_t *slots =
+    (oc_hash_slot_t *)calloc(capacity, sizeof(oc_hash_slot_t));
+  if (!slots) {
+    return false;
+  }
+  oc_hash_index_t old = *index;
+  index->slots = slots;
+  index->capacity = capacity;
+  index->count = 0;
+  if (old.slots == NULL) {
+    return true;
+  }
+
+  /* start right after an empty slot so that every run of colliding entries
+   * is moved in probe order, which keeps equal keys in insertion order */
+  uint32_t start = 0;
+  while (old.slots[start].entry != NULL) {
+    start++;
+  }
+  uint32_t i = start;
+  do {
+    i = next_slot(&old, i);
+    if (old.slots[i].entry != NULL) {
+      insert_slot(index, old.slots[i].entry, old.slots[i].hash);
+    }
+  } while (i != start);
+  free(old.slots);
+  return true;
+}
+#endif /* OC_DYNAMIC_ALLOCATION */
+
+bool
+oc_hash_index_add(oc_hash_index_t *index, void *entry, uint32_t hash)
+{
+  /* keep the load at or below 3/4 and at least one slot empty */
+  if ((index->count + 1) * 4 > index->capacity * 3) {
+#ifdef OC_DYNAMIC_ALLOCATION
+    if (!grow(index)) {
+      return false;
+    }
+#else  /* OC_DYNAMIC_ALLOCATION */
+    if (index->count + 1 >= index->capacity) {
+      return false;
+    }
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  }
+  insert_slot(index, entry, hash);
+  return true;
+}
+
+void
+oc_hash_index_remove(oc_hash_index_t *index, const void *entry,
+                     uint32_t hash)
+{
+  if (index->count == 0) {
+    return;
+  }
+  uint32_t i = home_slot(index, hash);
+  while (index->slots[i].entry != entry) {
+    if (index->slots[i].entry == NULL) {
+      return;
+    }
+    i = next_slot(index, i);
+  }
+
+  /* shift the rest of the run back over the hole, so that lookups need no
+   * tombstones; entries keep their relative order */
+  uint32_t j = i;
+  for (;;) {
+    j = next_slot(index, j);
+    if (index->slots[j].entry == NULL) {
+      break;
+    }
+    uint32_t k = home_slot(index, index->slots[j].hash);
+    bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+    if (!stays) {
+      index->slots[i] = index->slots[j];
+      i = j;
+    }
+  }
+  index->slots[i].entry = NULL;
+  index->count--;
+}
+
+void
+oc_hash_index_clear(oc_hash_index_t *index)
+{
+#ifdef OC_DYNAMIC_ALLOCATION
+  free(index->slots);
+  index->slots = NULL;
+  index->capacity = 0;
+#else  /* OC_DYNAMIC_ALLOCATION */
+  memset(index->slots, 0, index->capacity * sizeof(oc_hash_slot_t));
+#endif /* !OC_DYNAMIC_ALLOCATION */
+  index->count = 0;
+}
+
+static void *
+find_from(const oc_hash_index_t *index, uint32_t hash, uint32_t *pos)
+{
+  uint32_t i = *pos;
+  while (index->slots[i].entry != NULL) {
+    if (index->slots[i].hash == hash) {
+      *pos = i;
+      return index->slots[i].entry;
+    }
+    i = next_slot(index, i);
+  }
+  return NULL;
+}
+
+void *
+oc_hash_index_first(const oc_hash_index_t *index, uint32_t hash,
+                    uint32_t *pos)
+{
+  if (index->count == 0) {
+    return NULL;
+  }
+  *pos = home_slot(index, hash);
+  return find_from(index, hash, pos);
+}
+
+void *
+oc_hash_index_next(const oc_hash_index_t *index, uint32_t hash,
+                   uint32_t *pos)
+{
+  *pos = next_slot(index, *pos);
+  return find_from(index, hash, pos);
+}
+
+uint32_t
+oc_hash_u16(uint16_t key)
+{
+  uint32_t h = (uint32_t)key * 0x9E3779B1u;
+  return h ^ (h >> 16);
+}
+
+uint32_t
+oc_hash_bytes(const uint8_t *data, size_t len)
+{
+  /* FNV-1a */
+  uint32_t h = 2166136261u;
+  size_t i;
+  for (i = 0; i < len; i++) {
+    h ^= data[i];
+    h *= 16777619u;
+  }
+  return h ^ (h >> 16);
+}
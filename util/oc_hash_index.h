@@ -0,0 +1,115 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+/**
+ * \defgroup hash_index Open addressed hash index
+ *
+ * A hash index finds the elements of a list by a key without walking the
+ * list. It stores element pointers together with the hash of their key, in
+ * an open addressed table with linear probing. The owner of the list adds
+ * and removes elements as it links and unlinks them, and must remove and
+ * re-add an element whose key changes.
+ *
+ * A lookup visits the elements whose key hash matches, in the order they
+ * were added, so the caller finds the same element a scan of the list
+ * would find when several share a key.
+ *
+ * With OC_DYNAMIC_ALLOCATION the table grows on demand, otherwise it is
+ * sized for twice the number of elements of the list it indexes.
+ */
+
+#ifndef OC_HASH_INDEX_H
+#define OC_HASH_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct oc_hash_slot_s
+{
+  void *entry;
+  uint32_t hash;
+} oc_hash_slot_t;
+
+typedef struct oc_hash_index_s
+{
+  oc_hash_slot_t *slots;
+  uint32_t capacity;
+  uint32_t count;
+} oc_hash_index_t;
+
+/**
+ * Declare a hash index for a list of at most num elements.
+ */
+#ifdef OC_DYNAMIC_ALLOCATION
+#define OC_HASH_INDEX(name, num) static oc_hash_index_t name = { NULL, 0, 0 }
+#else /* OC_DYNAMIC_ALLOCATION */
+#define OC_HASH_INDEX(name, num)                                               \
+  static oc_hash_slot_t name##_slots[2 * (num)];                               \
+  static oc_hash_index_t name = { name##_slots, 2 * (num), 0 }
+#endif /* !OC_DYNAMIC_ALLOCATION */
+
+/**
+ * Add an element under the hash of its key.
+ *
+ * \return false if the table is full and cannot grow
+ */
+bool oc_hash_index_add(oc_hash_index_t *index, void *entry, uint32_t hash);
+
+/**
+ * Remove an element that was added under hash.
+ */
+void oc_hash_index_remove(oc_hash_index_t *index, const void *entry,
+                          uint32_t hash);
+
+/**
+ * Remove all elements, releasing the table if it was allocated.
+ */
+void oc_hash_index_clear(oc_hash_index_t *index);
+
+/**
+ * Iterate the elements added under hash.
+ *
+ * \param pos iterator state, set by oc_hash_index_first()
+ * \return the next candidate element, NULL at the end. The caller compares
+ *         the actual keys.
+ */
+void *oc_hash_index_first(const oc_hash_index_t *index, uint32_t hash,
+                          uint32_t *pos);
+void *oc_hash_index_next(const oc_hash_index_t *index, uint32_t hash,
+                         uint32_t *pos);
+
+/**
+ * Hash a 16 bit key, e.g. a CoAP message ID.
+ */
+uint32_t oc_hash_u16(uint16_t key);
+
+/**
+ * Hash a byte string, e.g. a CoAP token.
+ */
+uint32_t oc_hash_bytes(const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_HASH_INDEX_H */
@@ -34,11 +34,13 @@
 
 #include "oc_process.h"
 #include "oc_buffer.h"
+#include "port/oc_clock.h"
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #ifdef OC_DYNAMIC_ALLOCATION
 #include "port/oc_assert.h"
 #include <stdlib.h>
-#include <string.h>
 #endif /* OC_DYNAMIC_ALLOCATION */
 
 /*
@@ -57,24 +59,59 @@ struct event_data
   oc_process_event_t ev;
   oc_process_data_t data;
   struct oc_process *p;
+  oc_clock_time_t posted;
 };
 
-#ifdef OC_DYNAMIC_ALLOCATION
-static unsigned long OC_PROCESS_NUMEVENTS = 10;
-#else /* OC_DYNAMIC_ALLOCATION */
+/* Initial (dynamic) or fixed (static) number of events per priority level */
 #define OC_PROCESS_NUMEVENTS 10
-#endif /* !OC_DYNAMIC_ALLOCATION */
 
-static oc_process_num_events_t nevents, fevent;
+/* Events delivered per priority level in one oc_process_run() */
+#ifndef OC_PROCESS_QUOTA_NETWORK
+#define OC_PROCESS_QUOTA_NETWORK (16)
+#endif /* OC_PROCESS_QUOTA_NETWORK */
+#ifndef OC_PROCESS_QUOTA_SECURITY
+#define OC_PROCESS_QUOTA_SECURITY (8)
+#endif /* OC_PROCESS_QUOTA_SECURITY */
+#ifndef OC_PROCESS_QUOTA_TIMER
+#define OC_PROCESS_QUOTA_TIMER (8)
+#endif /* OC_PROCESS_QUOTA_TIMER */
+#ifndef OC_PROCESS_QUOTA_APPLICATION
+#define OC_PROCESS_QUOTA_APPLICATION (4)
+#endif /* OC_PROCESS_QUOTA_APPLICATION */
+
+/*
+ * One FIFO ring of events per priority level.
+ */
+struct event_queue
+{
 #ifdef OC_DYNAMIC_ALLOCATION
-static struct event_data *events;
+  struct event_data *events;
 #else  /* OC_DYNAMIC_ALLOCATION */
-static struct event_data events[OC_PROCESS_NUMEVENTS];
+  struct event_data events[OC_PROCESS_NUMEVENTS];
 #endif /* !OC_DYNAMIC_ALLOCATION */
+  oc_process_num_events_t size, first, count;
+  oc_process_queue_stats_t stats;
+};
 
-#if OC_PROCESS_CONF_STATS
-oc_process_num_events_t process_maxevents;
-#endif
+static struct event_queue queues[OC_PROCESS_NUM_PRIORITIES];
+static unsigned int quotas[OC_PROCESS_NUM_PRIORITIES] = {
+  OC_PROCESS_QUOTA_APPLICATION, OC_PROCESS_QUOTA_TIMER,
+  OC_PROCESS_QUOTA_SECURITY, OC_PROCESS_QUOTA_NETWORK
+};
+static oc_process_num_events_t nevents;
+
+/* Events may be posted while another thread holds the network event mutex,
+ * so the queues have their own short-held lock. */
+#if defined(__GNUC__) || defined(__clang__)
+static volatile char queue_lock_flag;
+#define queue_lock()                                                           \
+  while (__atomic_test_and_set(&queue_lock_flag, __ATOMIC_ACQUIRE)) {         \
+  }
+#define queue_unlock() __atomic_clear(&queue_lock_flag, __ATOMIC_RELEASE)
+#else /* __GNUC__ || __clang__ */
+#define queue_lock()
+#define queue_unlock()
+#endif /* !__GNUC__ && !__clang__ */
 
 static volatile unsigned char poll_requested;
 
@@ -194,27 +231,34 @@ void
 oc_process_shutdown(void)
 {
 #ifdef OC_DYNAMIC_ALLOCATION
-  free(events);
+  int i;
+  for (i = 0; i < OC_PROCESS_NUM_PRIORITIES; i++) {
+    free(queues[i].events);
+    queues[i].events = NULL;
+  }
 #endif /* OC_DYNAMIC_ALLOCATION */
 }
 
 void
 oc_process_init(void)
 {
+  int i;
+  for (i = 0; i < OC_PROCESS_NUM_PRIORITIES; i++) {
 #ifdef OC_DYNAMIC_ALLOCATION
-  events = (struct event_data *)calloc(OC_PROCESS_NUMEVENTS,
-                                       sizeof(struct event_data));
-  if (!events) {
-    oc_abort("Insufficient memory");
-  }
+    queues[i].events = (struct event_data *)calloc(OC_PROCESS_NUMEVENTS,
+                                                   sizeof(struct event_data));
+    if (!queues[i].events) {
+      oc_abort("Insufficient memory");
+    }
 #endif /* OC_DYNAMIC_ALLOCATION */
+    queues[i].size = OC_PROCESS_NUMEVENTS;
+    queues[i].first = queues[i].count = 0;
+    memset(&queues[i].stats, 0, sizeof(queues[i].stats));
+  }
 
   lastevent = OC_PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
-#if OC_PROCESS_CONF_STATS
-  process_maxevents = 0;
-#endif /* OC_PROCESS_CONF_STATS */
+  nevents = 0;
 
   oc_process_current = NULL;
   oc_process_list = NULL;
@@ -240,63 +284,85 @@ do_poll(void)
   }
 }
 /*---------------------------------------------------------------------------*/
-/*
- * Process the next event in the event queue and deliver it to
- * listening processes.
- */
-/*---------------------------------------------------------------------------*/
 static void
-do_event(void)
+deliver_event(struct event_data *e)
 {
-  static oc_process_event_t ev;
-  static oc_process_data_t data;
-  static struct oc_process *receiver;
-  static struct oc_process *p;
-
-  /*
-   * If there are any events in the queue, take the first one and walk
-   * through the list of processes to see if the event should be
-   * delivered to any of them. If so, we call the event handler
-   * function for the process. We only process one event at a time and
-   * call the poll handlers in between.
-   */
-
-  if (nevents > 0) {
-
-    /* There are events that we should deliver. */
-    ev = events[fevent].ev;
-
-    data = events[fevent].data;
-    receiver = events[fevent].p;
-
-    /* Since we have seen the new event, we move pointer upwards
-       and decrease the number of events. */
-    fevent = (fevent + 1) % OC_PROCESS_NUMEVENTS;
-    --nevents;
+  struct oc_process *p;
 
-    /* If this is a broadcast event, we deliver it to all events, in
-       order of their priority. */
-    if (receiver == OC_PROCESS_BROADCAST) {
-      for (p = oc_process_list; p != NULL; p = p->next) {
-
-        /* If we have been requested to poll a process, we do this in
-           between processing the broadcast event. */
-        if (poll_requested) {
-          do_poll();
-        }
-        call_process(p, ev, data);
-      }
-    } else {
-      /* This is not a broadcast event, so we deliver it to the
-   specified process. */
-      /* If the event was an INIT event, we should also update the
-   state of the process. */
-      if (ev == OC_PROCESS_EVENT_INIT) {
-        receiver->state = OC_PROCESS_STATE_RUNNING;
+  /* If this is a broadcast event, we deliver it to all events, in
+     order of their priority. */
+  if (e->p == OC_PROCESS_BROADCAST) {
+    for (p = oc_process_list; p != NULL; p = p->next) {
+
+      /* If we have been requested to poll a process, we do this in
+         between processing the broadcast event. */
+      if (poll_requested) {
+        do_poll();
       }
+      call_process(p, e->ev, e->data);
+    }
+  } else {
+    /* This is not a broadcast event, so we deliver it to the
+       specified process. */
+    /* If the event was an INIT event, we should also update the
+       state of the process. */
+    if (e->ev == OC_PROCESS_EVENT_INIT) {
+      e->p->state = OC_PROCESS_STATE_RUNNING;
+    }
+
+    /* Make sure that the process actually is running. */
+    call_process(e->p, e->ev, e->data);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static bool
+pop_event(struct event_queue *q, struct event_data *e,
+          struct oc_process *receiver)
+{
+  bool popped = false;
+
+  queue_lock();
+  if (q->count > 0 &&
+      (receiver == NULL || q->events[q->first].p == receiver)) {
+    *e = q->events[q->first];
+    q->first = (q->first + 1) % q->size;
+    --q->count;
+    --nevents;
+    popped = true;
+  }
+  queue_unlock();
 
-      /* Make sure that the process actually is running. */
-      call_process(receiver, ev, data);
+  if (popped) {
+    oc_clock_time_t wait = oc_clock_time() - e->posted;
+    if (wait > q->stats.max_wait) {
+      q->stats.max_wait = wait;
+    }
+    q->stats.delivered++;
+  }
+  return popped;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Deliver up to the quota of events of one priority level. Consecutive
+ * events for the same receiver are delivered back to back, poll handlers
+ * only run between such batches.
+ */
+/*---------------------------------------------------------------------------*/
+static void
+do_events(struct event_queue *q, unsigned int quota)
+{
+  struct event_data e;
+
+  while (quota > 0 && pop_event(q, &e, NULL)) {
+    struct oc_process *receiver = e.p;
+    do {
+      deliver_event(&e);
+      --quota;
+    } while (receiver != OC_PROCESS_BROADCAST && quota > 0 &&
+             pop_event(q, &e, receiver));
+
+    if (poll_requested) {
+      do_poll();
     }
   }
 }
@@ -304,13 +370,17 @@ do_event(void)
 int
 oc_process_run(void)
 {
+  int i;
+
   /* Process poll events. */
   if (poll_requested) {
     do_poll();
   }
 
-  /* Process one event from the queue */
-  do_event();
+  /* Process events from the queues, the highest priority first */
+  for (i = OC_PROCESS_NUM_PRIORITIES - 1; i >= 0; i--) {
+    do_events(&queues[i], quotas[i]);
+  }
 
   return nevents + poll_requested;
 }
@@ -321,58 +391,122 @@ oc_process_nevents(void)
   return nevents + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
+#ifdef OC_DYNAMIC_ALLOCATION
+static bool
+grow_queue(struct event_queue *q)
+{
+  oc_process_num_events_t i, size = q->size << 1;
+  struct event_data *events =
+    (struct event_data *)calloc(size, sizeof(struct event_data));
+  if (!events) {
+    return false;
+  }
+  /* unwrap the ring into the new array */
+  for (i = 0; i < q->count; i++) {
+    events[i] = q->events[(q->first + i) % q->size];
+  }
+  free(q->events);
+  q->events = events;
+  q->size = size;
+  q->first = 0;
+  return true;
+}
+#endif /* OC_DYNAMIC_ALLOCATION */
+/*---------------------------------------------------------------------------*/
+static oc_process_priority_t
+event_priority(struct oc_process *p, oc_process_event_t ev)
+{
+  if (ev == OC_PROCESS_EVENT_TIMER) {
+    return OC_PROCESS_PRIORITY_TIMER;
+  }
+  if (p == OC_PROCESS_BROADCAST) {
+    return OC_PROCESS_PRIORITY_APPLICATION;
+  }
+  return (oc_process_priority_t)p->priority;
+}
+/*---------------------------------------------------------------------------*/
 int
 oc_process_post(struct oc_process *p, oc_process_event_t ev,
                 oc_process_data_t data)
 {
-  static oc_process_num_events_t snum;
+  struct event_queue *q = &queues[event_priority(p, ev)];
+  oc_process_num_events_t snum;
+  oc_clock_time_t now = oc_clock_time();
 
-  if (nevents == OC_PROCESS_NUMEVENTS) {
+  queue_lock();
+  if (q->count == q->size) {
 #ifdef OC_DYNAMIC_ALLOCATION
-    OC_PROCESS_NUMEVENTS <<= 1;
-    // check this with s-mode
-    struct event_data *new_event;
-    new_event = (struct event_data *)realloc(
-      events, (OC_PROCESS_NUMEVENTS) * sizeof(struct event_data));
-    if (new_event == NULL) {
-      free(events);
-    }
-    events = new_event;
-    if (!events) {
+    if (!grow_queue(q)) {
+      q->stats.drops++;
+      queue_unlock();
       oc_abort("Insufficient memory");
+      return OC_PROCESS_ERR_FULL;
     }
-    oc_process_num_events_t i = fevent, n = nevents - fevent, j = 0;
-    while (i < (OC_PROCESS_NUMEVENTS - n)) {
-      if (i < nevents) {
-        memcpy(&events[OC_PROCESS_NUMEVENTS - n + j], &events[i],
-               sizeof(struct event_data));
-        j++;
-      }
-      memset(&events[i], 0, sizeof(struct event_data));
-      i++;
-    }
-    fevent = OC_PROCESS_NUMEVENTS - n;
 #else  /* OC_DYNAMIC_ALLOCATION */
+    q->stats.drops++;
+    queue_unlock();
     return OC_PROCESS_ERR_FULL;
 #endif /* !OC_DYNAMIC_ALLOCATION */
   }
 
-  snum = (oc_process_num_events_t)(fevent + nevents) % OC_PROCESS_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (q->first + q->count) % q->size;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  q->events[snum].posted = now;
+  ++q->count;
   ++nevents;
 
-#if OC_PROCESS_CONF_STATS
-  if (nevents > process_maxevents) {
-    process_maxevents = nevents;
+  if (q->count > q->stats.max_depth) {
+    q->stats.max_depth = q->count;
   }
-#endif /* OC_PROCESS_CONF_STATS */
+  queue_unlock();
 
   return OC_PROCESS_ERR_OK;
 }
 /*---------------------------------------------------------------------------*/
 void
+oc_process_set_priority(struct oc_process *p, oc_process_priority_t priority)
+{
+  if (p && priority < OC_PROCESS_NUM_PRIORITIES) {
+    p->priority = (unsigned char)priority;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+oc_process_set_quota(oc_process_priority_t priority, unsigned int quota)
+{
+  if (priority < OC_PROCESS_NUM_PRIORITIES && quota > 0) {
+    quotas[priority] = quota;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+oc_process_get_queue_stats(oc_process_priority_t priority,
+                           oc_process_queue_stats_t *stats)
+{
+  if (priority >= OC_PROCESS_NUM_PRIORITIES || !stats) {
+    return -1;
+  }
+  queue_lock();
+  *stats = queues[priority].stats;
+  stats->depth = queues[priority].count;
+  queue_unlock();
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+oc_process_reset_queue_stats(void)
+{
+  int i;
+  queue_lock();
+  for (i = 0; i < OC_PROCESS_NUM_PRIORITIES; i++) {
+    memset(&queues[i].stats, 0, sizeof(queues[i].stats));
+  }
+  queue_unlock();
+}
+/*---------------------------------------------------------------------------*/
+void
 oc_process_post_synch(struct oc_process *p, oc_process_event_t ev,
                       oc_process_data_t data)
 {
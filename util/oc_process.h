@@ -42,7 +42,9 @@
 
 #ifndef OC_PROCESS_H
 #define OC_PROCESS_H
+#include "port/oc_clock.h"
 #include "util/pt/pt.h"
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -82,6 +84,35 @@ typedef unsigned char oc_process_num_events_t;
 #define OC_PROCESS_ERR_FULL 1
 /* @} */
 
+/**
+ * Priority levels of the event queue. Each level has its own FIFO queue,
+ * oc_process_run() serves the levels from the highest to the lowest, up to a
+ * quota of events each.
+ *
+ * Events are queued at the priority of the receiving process, timer events
+ * always at OC_PROCESS_PRIORITY_TIMER and broadcasts at
+ * OC_PROCESS_PRIORITY_APPLICATION.
+ */
+typedef enum {
+  OC_PROCESS_PRIORITY_APPLICATION = 0, /**< default for all processes */
+  OC_PROCESS_PRIORITY_TIMER,           /**< timer events */
+  OC_PROCESS_PRIORITY_SECURITY,        /**< DTLS and OSCORE handling */
+  OC_PROCESS_PRIORITY_NETWORK,         /**< received and sent messages */
+  OC_PROCESS_NUM_PRIORITIES
+} oc_process_priority_t;
+
+/**
+ * Statistics of the event queue of one priority level.
+ */
+typedef struct oc_process_queue_stats_t
+{
+  uint32_t depth;           /**< events currently queued */
+  uint32_t max_depth;       /**< most events queued at once */
+  uint32_t delivered;       /**< events delivered */
+  uint32_t drops;           /**< events dropped because the queue was full */
+  oc_clock_time_t max_wait; /**< longest time from post to delivery, ticks */
+} oc_process_queue_stats_t;
+
 #define OC_PROCESS_NONE NULL
 
 #define OC_PROCESS_EVENT_NONE 0x80
@@ -324,6 +355,7 @@ struct oc_process
   PT_THREAD((*thread)(struct pt *, oc_process_event_t, oc_process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+  unsigned char priority;
 };
 
 /**
@@ -491,11 +523,12 @@ void oc_process_init(void);
 void oc_process_shutdown(void);
 
 /**
- * Run the system once - call poll handlers and process one event.
+ * Run the system once - call poll handlers and process queued events.
  *
  * This function should be called repeatedly from the main() program
  * to actually run the Contiki system. It calls the necessary poll
- * handlers, and processes one event. The function returns the number
+ * handlers, and processes up to the quota of events of every priority
+ * level, the highest level first. The function returns the number
  * of events that are waiting in the event queue so that the caller
  * may choose to put the CPU to sleep when there are no pending
  * events.
@@ -505,6 +538,40 @@ void oc_process_shutdown(void);
  */
 int oc_process_run(void);
 
+/**
+ * Set the priority at which events for a process are queued.
+ *
+ * \param p The process.
+ * \param priority The priority level.
+ */
+void oc_process_set_priority(struct oc_process *p,
+                             oc_process_priority_t priority);
+
+/**
+ * Set the number of events of a priority level delivered by one call of
+ * oc_process_run().
+ *
+ * \param priority The priority level.
+ * \param quota The number of events, at least 1.
+ */
+void oc_process_set_quota(oc_process_priority_t priority, unsigned int quota);
+
+/**
+ * Get the statistics of the event queue of a priority level.
+ *
+ * \param priority The priority level.
+ * \param stats Filled with the statistics.
+ *
+ * \return 0 on success, -1 for an invalid priority level.
+ */
+int oc_process_get_queue_stats(oc_process_priority_t priority,
+                               oc_process_queue_stats_t *stats);
+
+/**
+ * Reset the maximum and counter values of the queue statistics.
+ */
+void oc_process_reset_queue_stats(void);
+
 /**
  * Check if a process is running.
  *
@@ -0,0 +1,234 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "oc_uri_trie.h"
+#include <string.h>
+
+static oc_uri_trie_node_t *
+new_node(struct oc_memb *pool, const char *label, size_t label_len)
+{
+  oc_uri_trie_node_t *node = (oc_uri_trie_node_t *)oc_memb_alloc(pool);
+  if (node) {
+    memset(node, 0, sizeof(*node));
+    memcpy(node->label, label, label_len);
+    node->label_len = (uint8_t)label_len;
+  }
+  return node;
+}
+
+/* the link that points to the child of node starting with c */
+static oc_uri_trie_node_t **
+find_child(oc_uri_trie_node_t *node, char c)
+{
+  oc_uri_trie_node_t **link = &node->child;
+  while (*link && (*link)->label[0] != c) {
+    link = &(*link)->sibling;
+  }
+  return link;
+}
+
+/* splits the node at link after len bytes of its label, and returns the
+ * node holding the first part */
+static oc_uri_trie_node_t *
+split(struct oc_memb *pool, oc_uri_trie_node_t **link, size_t len)
+{
+  oc_uri_trie_node_t *tail = *link;
+  oc_uri_trie_node_t *head = new_node(pool, tail->label, len);
+  if (!head) {
+    return NULL;
+  }
+  head->sibling = tail->sibling;
+  head->child = tail;
+  tail->sibling = NULL;
+  tail->label_len = (uint8_t)(tail->label_len - len);
+  memmove(tail->label, tail->label + len, tail->label_len);
+  *link = head;
+  return head;
+}
+
+/* the node at which key ends, created as needed */
+static oc_uri_trie_node_t *
+insert(struct oc_memb *pool, oc_uri_trie_node_t *node, const char *key,
+       size_t key_len)
+{
+  size_t pos = 0;
+  while (pos < key_len) {
+    oc_uri_trie_node_t **link = find_child(node, key[pos]);
+    if (!*link) {
+      size_t len = key_len - pos;
+      if (len > OC_URI_TRIE_LABEL_SIZE) {
+        len = OC_URI_TRIE_LABEL_SIZE;
+      }
+      *link = new_node(pool, key + pos, len);
+      if (!*link) {
+        return NULL;
+      }
+      node = *link;
+      pos += len;
+      continue;
+    }
+    size_t common = 0;
+    while (common < (*link)->label_len && pos + common < key_len &&
+           (*link)->label[common] == key[pos + common]) {
+      common++;
+    }
+    if (common < (*link)->label_len && !split(pool, link, common)) {
+      return NULL;
+    }
+    node = *link;
+    pos += common;
+  }
+  return node;
+}
+
+static bool
+is_wildcard(const char *key, size_t key_len)
+{
+  return key_len > 0 && key[key_len - 1] == '*';
+}
+
+bool
+oc_uri_trie_add(struct oc_memb *pool, oc_uri_trie_node_t **root,
+                const char *key, size_t key_len, void *value)
+{
+  if (!*root) {
+    *root = new_node(pool, NULL, 0);
+    if (!*root) {
+      return false;
+    }
+  }
+  bool wildcard = is_wildcard(key, key_len);
+  oc_uri_trie_node_t *node =
+    insert(pool, *root, key, wildcard ? key_len - 1 : key_len);
+  if (!node) {
+    return false;
+  }
+  void **slot = wildcard ? &node->wildcard : &node->exact;
+  if (*slot && *slot != value) {
+    return false;
+  }
+  *slot = value;
+  return true;
+}
+
+/* merges a node without value into its only child when their labels fit
+ * into one node */
+static void
+merge(struct oc_memb *pool, oc_uri_trie_node_t **link)
+{
+  oc_uri_trie_node_t *node = *link;
+  oc_uri_trie_node_t *child = node->child;
+  if (node->exact || node->wildcard || !child || child->sibling ||
+      node->label_len + child->label_len > OC_URI_TRIE_LABEL_SIZE) {
+    return;
+  }
+  memmove(child->label + node->label_len, child->label, child->label_len);
+  memcpy(child->label, node->label, node->label_len);
+  child->label_len = (uint8_t)(child->label_len + node->label_len);
+  child->sibling = node->sibling;
+  *link = child;
+  oc_memb_free(pool, node);
+}
+
+/* returns true when the node at link is left empty and was released */
+static bool
+remove_key(struct oc_memb *pool, oc_uri_trie_node_t **link, const char *key,
+           size_t key_len, bool wildcard, const void *value)
+{
+  oc_uri_trie_node_t *node = *link;
+  if (key_len == 0) {
+    void **slot = wildcard ? &node->wildcard : &node->exact;
+    if (*slot == value) {
+      *slot = NULL;
+    }
+  } else {
+    oc_uri_trie_node_t **child = find_child(node, key[0]);
+    if (!*child || (*child)->label_len > key_len ||
+        memcmp((*child)->label, key, (*child)->label_len) != 0) {
+      return false;
+    }
+    size_t len = (*child)->label_len;
+    if (!remove_key(pool, child, key + len, key_len - len, wildcard, value)) {
+      merge(pool, child);
+    }
+  }
+  if (!node->exact && !node->wildcard && !node->child) {
+    *link = node->sibling;
+    oc_memb_free(pool, node);
+    return true;
+  }
+  return false;
+}
+
+void
+oc_uri_trie_remove(struct oc_memb *pool, oc_uri_trie_node_t **root,
+                   const char *key, size_t key_len, const void *value)
+{
+  if (!*root) {
+    return;
+  }
+  bool wildcard = is_wildcard(key, key_len);
+  remove_key(pool, root, key, wildcard ? key_len - 1 : key_len, wildcard,
+             value);
+}
+
+void *
+oc_uri_trie_find(const oc_uri_trie_node_t *root, const char *path,
+                 size_t path_len)
+{
+  const oc_uri_trie_node_t *node = root;
+  void *wildcard = NULL;
+  size_t pos = 0;
+  while (node) {
+    if (pos == path_len) {
+      return node->exact ? node->exact : wildcard;
+    }
+    /* a wildcard needs a non-empty rest of the path */
+    if (node->wildcard) {
+      wildcard = node->wildcard;
+    }
+    node = node->child;
+    while (node && node->label[0] != path[pos]) {
+      node = node->sibling;
+    }
+    if (!node || node->label_len > path_len - pos ||
+        memcmp(node->label, path + pos, node->label_len) != 0) {
+      break;
+    }
+    pos += node->label_len;
+  }
+  return wildcard;
+}
+
+static void
+free_nodes(struct oc_memb *pool, oc_uri_trie_node_t *node)
+{
+  while (node) {
+    oc_uri_trie_node_t *sibling = node->sibling;
+    free_nodes(pool, node->child);
+    oc_memb_free(pool, node);
+    node = sibling;
+  }
+}
+
+void
+oc_uri_trie_clear(struct oc_memb *pool, oc_uri_trie_node_t **root)
+{
+  free_nodes(pool, *root);
+  *root = NULL;
+}
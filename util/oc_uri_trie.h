@@ -0,0 +1,97 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2023 Cascoda Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+/**
+ * \defgroup uri_trie Radix trie of resource paths
+ *
+ * A URI trie finds the value registered for a resource path in a single
+ * walk of the path bytes. Each node holds a label of up to
+ * OC_URI_TRIE_LABEL_SIZE bytes, so a path is stored in as few nodes as its
+ * length and its branching points need.
+ *
+ * A key that ends with '*' is a wildcard. It matches every path that starts
+ * with the key without the '*' and has at least one more byte, so "fp/g/*"
+ * matches "fp/g/1" but not "fp/g/". A path matches its exact key first,
+ * otherwise the longest wildcard.
+ *
+ * Keys are passed without the leading '/'. The nodes come from a memory
+ * pool of the owner, which passes it to every call that adds or removes
+ * nodes.
+ */
+
+#ifndef OC_URI_TRIE_H
+#define OC_URI_TRIE_H
+
+#include "util/oc_memb.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OC_URI_TRIE_LABEL_SIZE (15)
+
+typedef struct oc_uri_trie_node_s
+{
+  struct oc_uri_trie_node_s *child;   /**< first child */
+  struct oc_uri_trie_node_s *sibling; /**< next child of the parent */
+  void *exact;    /**< value of the key that ends here */
+  void *wildcard; /**< value of the key that ends here, followed by '*' */
+  uint8_t label_len;
+  char label[OC_URI_TRIE_LABEL_SIZE];
+} oc_uri_trie_node_t;
+
+/**
+ * Add a value under a key.
+ *
+ * \param pool the pool of oc_uri_trie_node_t the nodes are taken from
+ * \param root the root of the trie, NULL for an empty trie
+ * \return false if another value is registered under the key, or the pool
+ *         is exhausted
+ */
+bool oc_uri_trie_add(struct oc_memb *pool, oc_uri_trie_node_t **root,
+                     const char *key, size_t key_len, void *value);
+
+/**
+ * Remove the value added under a key. The nodes no longer needed are
+ * released.
+ */
+void oc_uri_trie_remove(struct oc_memb *pool, oc_uri_trie_node_t **root,
+                        const char *key, size_t key_len, const void *value);
+
+/**
+ * Find the value of a path.
+ *
+ * \return the value of the exact key, otherwise of the longest wildcard that
+ *         matches, NULL if there is none
+ */
+void *oc_uri_trie_find(const oc_uri_trie_node_t *root, const char *path,
+                       size_t path_len);
+
+/**
+ * Remove all values and release all nodes.
+ */
+void oc_uri_trie_clear(struct oc_memb *pool, oc_uri_trie_node_t **root);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OC_URI_TRIE_H */